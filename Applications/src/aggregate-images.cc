@@ -23,6 +23,7 @@
 #include "mirtk/IOConfig.h"
 
 #include "mirtk/GenericImage.h"
+#include "mirtk/ImageReader.h"
 #include "mirtk/DataStatistics.h"
 #include "mirtk/Histogram1D.h"
 
@@ -89,6 +90,12 @@ void PrintHelp(const char* name)
   cout << "      No. of bins used for histogram-based aggregation functions. (default: 64)\n";
   cout << "  -parzen [yes|no|on|off]\n";
   cout << "      Use Parzen window based histogram estimation. (default: off)\n";
+  cout << "  -slab-size <n>\n";
+  cout << "      Read and aggregate input images slab-by-slab, where each slab consists of at most <n>\n";
+  cout << "      consecutive slices. Only one slab of each input image is kept in memory at a time,\n";
+  cout << "      which is needed when aggregating a large number of images. The input files are read\n";
+  cout << "      twice when image statistics are required, e.g., for :option:`-normalization`.\n";
+  cout << "      Not supported with median :option:`-normalization`. (default: 0, i.e., read entire images)\n";
   cout << "  -intersection [yes|no|on|off]\n";
   cout << "      Calculate aggregation function for every voxel for which no input value is\n";
   cout << "      equal the specified :option:`-padding` value. By default, only voxels for which\n";
@@ -187,32 +194,106 @@ UniquePtr<bool[]> ForegroundMaskArray(const InputImage &image)
 }
 
 // -----------------------------------------------------------------------------
-/// Normalize image intensities
-void Normalize(InputImage &image, NormalizationMode mode = Normalization_ZScore)
+/// Running statistics of foreground intensities of an image read slab-by-slab
+///
+/// The statistics are updated in the same order and using the same formulas
+/// as the DataStatistic functions used when the entire image is in memory.
+struct ForegroundStatistics
 {
-  if (mode == Normalization_None) return;
+  int    _Count;
+  double _Mean;
+  double _Var;
+  double _Min;
+  double _Max;
+
+  ForegroundStatistics()
+  :
+    _Count(0), _Mean(0.), _Var(0.), _Min(+inf), _Max(-inf)
+  {}
+
+  /// Update statistics given next slab of image, where background is NaN
+  void Add(const InputImage &slab)
+  {
+    double d, delta;
+    const int n = slab.NumberOfVoxels();
+    const InputType *p = slab.Data();
+    for (int i = 0; i < n; ++i, ++p) {
+      if (!IsNaN(*p)) {
+        ++_Count;
+        d = static_cast<double>(*p);
+        delta = d - _Mean;
+        _Mean += delta / _Count;
+        _Var  += delta * (d - _Mean);
+        if (d < _Min) _Min = d;
+        if (d > _Max) _Max = d;
+      }
+    }
+  }
 
-  const auto mask   = ForegroundMaskArray(image);
-  const int  n      = image.NumberOfVoxels();
-  auto * const data = image.Data();
+  /// Mean foreground intensity
+  double Mean() const
+  {
+    return (_Count < 1 ? NaN : _Mean);
+  }
+
+  /// Standard deviation of foreground intensities
+  double Sigma() const
+  {
+    if (_Count < 1) return NaN;
+    if (_Count < 2) return 0.;
+    return sqrt(_Var / (_Count - 1));
+  }
+
+  /// Minimum foreground intensity
+  double Min() const
+  {
+    return (_Min > _Max ? NaN : _Min);
+  }
+
+  /// Maximum foreground intensity
+  double Max() const
+  {
+    return (_Min > _Max ? NaN : _Max);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Linear intensity map of input image
+struct IntensityMap
+{
+  double _Scale;     ///< Slope of normalization function
+  double _Shift;     ///< Intercept of normalization function
+  bool   _Rescale;   ///< Whether to rescale normalized intensities
+  double _Slope;     ///< Slope of rescaling function
+  double _Intercept; ///< Intercept of rescaling function
+  double _Min;       ///< Minimum rescaled intensity
+  double _Max;       ///< Maximum rescaled intensity
+
+  IntensityMap()
+  :
+    _Scale(1.), _Shift(0.), _Rescale(false), _Slope(1.), _Intercept(0.), _Min(-inf), _Max(+inf)
+  {}
+};
 
-  double s = 1.;
-  double t = 0.;
+// -----------------------------------------------------------------------------
+/// Get parameters of linear intensity normalization function
+void GetNormalization(NormalizationMode mode, double mean, double sigma,
+                      double median, double min_value, double max_value,
+                      double &s, double &t)
+{
+  s = 1.;
+  t = 0.;
 
   switch (mode) {
     case Normalization_Mean: {
-      double mean = Mean::Calculate(n, data, mask.get());
       if (!fequal(mean, 0.)) s = 1. / mean;
     } break;
 
     case Normalization_Median: {
-      double median = Median::Calculate(n, data, mask.get());
       if (!fequal(median, 0.)) s = 1. / median;
     } break;
 
     case Normalization_ZScore: {
-      double mean, sigma;
-      NormalDistribution::Calculate(mean, sigma, n, data, mask.get());
       if (fequal(sigma, 0.)) {
         t = - mean;
       } else {
@@ -222,8 +303,6 @@ void Normalize(InputImage &image, NormalizationMode mode = Normalization_ZScore)
     } break;
 
     case Normalization_UnitRange: {
-      double min_value, max_value;
-      Extrema::Calculate(min_value, max_value, n, data, mask.get());
       double range = max_value - min_value;
       if (fequal(range, 0.)) {
         t = - min_value;
@@ -235,16 +314,106 @@ void Normalize(InputImage &image, NormalizationMode mode = Normalization_ZScore)
 
     default: break;
   };
+}
 
+// -----------------------------------------------------------------------------
+/// Get parameters of linear intensity rescaling function
+void GetRescaling(double min_value, double max_value, double vmin, double vmax,
+                  double &scale, double &shift)
+{
+  scale = 1.;
+  if (!fequal(max_value, min_value)) {
+    scale = (vmax - vmin) / (max_value - min_value);
+  }
+  shift = vmin - scale * min_value;
+}
+
+// -----------------------------------------------------------------------------
+/// Normalize intensity value using linear function
+inline InputType Normalize(InputType v, double s, double t)
+{
+  return static_cast<InputType>(s * static_cast<double>(v) + t);
+}
+
+// -----------------------------------------------------------------------------
+/// Rescale intensity value using linear function and clamp to range
+inline InputType Rescale(InputType v, double scale, double shift, double vmin, double vmax)
+{
+  return voxel_cast<InputType>(clamp(scale * static_cast<double>(v) + shift, vmin, vmax));
+}
+
+// -----------------------------------------------------------------------------
+/// Normalize foreground intensities using linear function
+void Normalize(InputImage &image, double s, double t)
+{
   if (!fequal(s, 1.) || !fequal(t, 0.)) {
-    auto p = data;
-    auto m = mask.get();
-    for (int i = 0; i < n; ++i, ++p, ++m) {
-      if (*m) (*p) = static_cast<InputType>(s * static_cast<double>(*p) + t);
+    const int n = image.NumberOfVoxels();
+    auto p = image.Data();
+    for (int i = 0; i < n; ++i, ++p) {
+      if (!IsNaN(*p)) (*p) = Normalize(*p, s, t);
     }
   }
 }
 
+// -----------------------------------------------------------------------------
+/// Rescale foreground intensities using linear function and clamp to range
+void Rescale(InputImage &image, double scale, double shift, double vmin, double vmax)
+{
+  if (!fequal(scale, 1.) || !fequal(shift, 0.)) {
+    const int n = image.NumberOfVoxels();
+    auto p = image.Data();
+    for (int i = 0; i < n; ++i, ++p) {
+      if (!IsNaN(*p)) (*p) = Rescale(*p, scale, shift, vmin, vmax);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Apply intensity map to slab of input image
+void Apply(InputImage &slab, const IntensityMap &map)
+{
+  Normalize(slab, map._Scale, map._Shift);
+  if (map._Rescale) {
+    Rescale(slab, map._Slope, map._Intercept, map._Min, map._Max);
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Normalize image intensities
+void Normalize(InputImage &image, NormalizationMode mode = Normalization_ZScore)
+{
+  if (mode == Normalization_None) return;
+
+  const auto mask   = ForegroundMaskArray(image);
+  const int  n      = image.NumberOfVoxels();
+  auto * const data = image.Data();
+
+  double mean = NaN, sigma = NaN, median = NaN, min_value = NaN, max_value = NaN;
+  switch (mode) {
+    case Normalization_Mean: {
+      mean = Mean::Calculate(n, data, mask.get());
+    } break;
+
+    case Normalization_Median: {
+      median = Median::Calculate(n, data, mask.get());
+    } break;
+
+    case Normalization_ZScore: {
+      NormalDistribution::Calculate(mean, sigma, n, data, mask.get());
+    } break;
+
+    case Normalization_UnitRange: {
+      Extrema::Calculate(min_value, max_value, n, data, mask.get());
+    } break;
+
+    default: break;
+  };
+
+  double s, t;
+  GetNormalization(mode, mean, sigma, median, min_value, max_value, s, t);
+  Normalize(image, s, t);
+}
+
 // -----------------------------------------------------------------------------
 /// Normalize image intensities
 void Normalize(InputImages &images, NormalizationMode mode = Normalization_ZScore)
@@ -260,25 +429,15 @@ void Normalize(InputImages &images, NormalizationMode mode = Normalization_ZScor
 /// Rescale intensities
 void Rescale(InputImage &image, double vmin, double vmax)
 {
-  double scale = 1., shift = 0.;
+  double scale, shift;
   double min_value, max_value;
 
   const auto mask = ForegroundMaskArray(image);
   const int  n    = image.NumberOfVoxels();
-  auto *data      = image.Data();
 
-  Extrema::Calculate(min_value, max_value, n, data, mask.get());
-  if (!fequal(max_value, min_value)) {
-    scale = (vmax - vmin) / (max_value - min_value);
-  }
-  shift = vmin - scale * min_value;
-  if (!fequal(scale, 1.) || !fequal(shift, 0.)) {
-    for (int idx = 0; idx < n; ++idx) {
-      if (mask[idx]) {
-        data[idx] = voxel_cast<InputType>(clamp(scale * static_cast<double>(data[idx]) + shift, vmin, vmax));
-      }
-    }
-  }
+  Extrema::Calculate(min_value, max_value, n, image.Data(), mask.get());
+  GetRescaling(min_value, max_value, vmin, vmax, scale, shift);
+  Rescale(image, scale, shift, vmin, vmax);
 }
 
 // -----------------------------------------------------------------------------
@@ -456,164 +615,49 @@ double EntropyIndex(Array<T> &samples, int alpha = 1)
 }
 
 // =============================================================================
-// Main
+// Voxel-wise aggregation
 // =============================================================================
 
 // -----------------------------------------------------------------------------
-int main(int argc, char **argv)
+/// Replace background values by NaN to be able to identify background after normalization
+void ReplacePaddingByNaN(InputImage &image, double padding)
 {
-  // Parse command arguments
-  REQUIRES_POSARGS(3);
-
-  AggregationMode mode;
-  if (!FromString(POSARG(1), mode)) {
-    FatalError("Invalid aggregation mode: " << POSARG(1));
-  }
-
-  const char        *mask_name     = nullptr;
-  const char        *output_name   = nullptr;
-  ImageDataType      dtype         = MIRTK_VOXEL_UNKNOWN;
-  NormalizationMode  normalization = Normalization_None;
-  int                alpha         = 0;
-  int                bins          = 64;
-  bool               parzen        = false;
-  double             padding       = NaN;
-  double             threshold     = 0.;
-  bool               intersection  = false;
-  double             rescale_min   = NaN;
-  double             rescale_max   = NaN;
-
-  for (ALL_OPTIONS) {
-    if (OPTION("-output")) output_name = ARGUMENT;
-    else if (OPTION("-mask")) mask_name = ARGUMENT;
-    else if (OPTION("-dtype") || OPTION("-datatype")) {
-      PARSE_ARGUMENT(dtype);
-    }
-    else if (OPTION("-normalization") || OPTION("-normalize")) {
-      if (HAS_ARGUMENT) {
-        const string arg = ToLower(ARGUMENT);
-        bool bval;
-        if (FromString(arg, bval)) {
-          normalization = (bval ? Normalization_ZScore : Normalization_None);
-        } else if (arg == "none") {
-          normalization = Normalization_None;
-        } else if (arg == "mean") {
-          normalization = Normalization_Mean;
-        } else if (arg == "median") {
-          normalization = Normalization_Median;
-        } else if (arg == "zscore" || arg == "z-score") {
-          normalization = Normalization_ZScore;
-        } else if (arg == "unit") {
-          normalization = Normalization_UnitRange;
-        } else {
-          FatalError("Invalid -normalization mode: " << arg);
-        }
-      } else {
-        normalization = Normalization_ZScore;
-      }
-    }
-    else if (OPTION("-rescale")) {
-      PARSE_ARGUMENT(rescale_min);
-      if (HAS_ARGUMENT) {
-        PARSE_ARGUMENT(rescale_max);
-      } else {
-        rescale_max = rescale_min;
-        rescale_min = 0.;
+  if (!IsNaN(padding)) {
+    const int nvox = image.NumberOfVoxels();
+    for (int vox = 0; vox < nvox; ++vox) {
+      if (fequal(image(vox), padding)) {
+        image(vox) = numeric_limits<InputType>::quiet_NaN();
       }
     }
-    else if (OPTION("-threshold")) {
-      PARSE_ARGUMENT(threshold);
-    }
-    else if (OPTION("-padding")) PARSE_ARGUMENT(padding);
-    else if (OPTION("-alpha")) PARSE_ARGUMENT(alpha);
-    else if (OPTION("-bins")) PARSE_ARGUMENT(bins);
-    else HANDLE_BOOL_OPTION(parzen);
-    else HANDLE_BOOL_OPTION(intersection);
-    else HANDLE_COMMON_OR_UNKNOWN_OPTION();
-  }
-  if (!output_name) {
-    FatalError("Option -output is required!");
   }
+  image.PutBackgroundValueAsDouble(NaN);
+}
 
-  // Initialize I/O factories
-  InitializeIOLibrary();
-
-  // Read input images
-  Array<InputImage> images(NUM_POSARGS - 1);
-  if (verbose) {
-    cout << "Reading " << images.size() << " images...";
-    cout.flush();
-  }
-  images[0].Read(POSARG(2));
-  const int nvox = images[0].NumberOfVoxels();
-  for (int i = 3; i <= NUM_POSARGS; ++i) {
-    images[i - 2].Read(POSARG(i));
-    if (images[i - 2].Attributes() != images[0].Attributes()) {
-      if (verbose) cout << " failed" << endl;
-      FatalError("Input image " << POSARG(i) << " has different attributes than previous input images!");
-    }
-  }
-  if (verbose) cout << " done" << endl;
-
-  // Replace background values by NaN to be able to identify background after normalization
+// -----------------------------------------------------------------------------
+/// Shift foreground intensities by given minimum value and set background to zero
+void ShiftToPositive(InputImages &images, double min_value)
+{
   for (auto &image : images) {
-    if (!IsNaN(padding)) {
-      for (int vox = 0; vox < nvox; ++vox) {
-        if (fequal(image(vox), padding)) {
-          image(vox) = numeric_limits<InputType>::quiet_NaN();
-        }
-      }
-    }
-    image.PutBackgroundValueAsDouble(NaN);
-  }
-
-  // Normalize images
-  if (normalization != Normalization_None) {
-    if (verbose) {
-      cout << "Normalizing images...";
-      cout.flush();
-    }
-    Normalize(images, normalization);
-    if (verbose) cout << " done" << endl;
-  }
-
-  // Rescale images
-  if (rescale_min < rescale_max) {
-    if (verbose) {
-      cout << "Rescaling images...";
-      cout.flush();
-    }
-    Rescale(images, rescale_min, rescale_max);
-    if (verbose) cout << " done" << endl;
-  }
-
-  // Ensure all (normalized) intensities are positive
-  if (mode == AM_Gini || mode == AM_Theil || mode == AM_EntropyIndex) {
-    double min_value = inf;
-    for (const auto &image : images) {
-      double vmin, vmax;
-      image.GetMinMaxAsDouble(vmin, vmax);
-      if (vmin < min_value) min_value = vmin;
-    }
-    if (IsInf(min_value)) {
-      FatalError("Neither input image seems to have any foreground given -padding value of " << padding);
-    }
-    min_value -= 1.;
-    for (auto &image : images) {
-      for (int vox = 0; vox < nvox; ++vox) {
-        if (image.IsForeground(vox)) {
-          image(vox) -= static_cast<InputType>(min_value);
-        } else {
-          image(vox) = 0.;
-        }
+    const int nvox = image.NumberOfVoxels();
+    for (int vox = 0; vox < nvox; ++vox) {
+      if (image.IsForeground(vox)) {
+        image(vox) -= static_cast<InputType>(min_value);
+      } else {
+        image(vox) = 0.;
       }
-      image.PutBackgroundValueAsDouble(0.);
     }
+    image.PutBackgroundValueAsDouble(0.);
   }
+}
 
-  // Initialize output image
-  double bg = NaN;
-  OutputImage output(images[0].Attributes());
+// -----------------------------------------------------------------------------
+/// Initialize output image, where background voxels are set to NaN
+void InitializeOutput(OutputImage &output, const InputImages &images,
+                      double padding, bool intersection, const BinaryImage *mask = nullptr)
+{
+  const double bg = NaN;
+  const int nvox = images[0].NumberOfVoxels();
+  output.Initialize(images[0].Attributes());
   if (!IsNaN(padding)) {
     if (intersection) {
       output = 0.;
@@ -637,94 +681,70 @@ int main(int argc, char **argv)
       }
     }
   }
-  if (mask_name) {
-    BinaryImage mask(mask_name);
-    if (mask.Attributes() != output.Attributes()) {
-      FatalError("Mask has different attributes!");
-    }
+  if (mask) {
     for (int vox = 0; vox < nvox; ++vox) {
-      if (mask(vox) == BinaryPixel(0)) output(vox) = static_cast<OutputType>(bg);
+      if ((*mask)(vox) == BinaryPixel(0)) output(vox) = static_cast<OutputType>(bg);
     }
   }
   output.PutBackgroundValueAsDouble(bg);
-  if (verbose > 1) {
-    int nbg = 0;
-    for (int vox = 0; vox < nvox; ++vox) {
-      if (output.IsBackground(vox)) ++nbg;
-    }
-    cout << "No. of foreground voxels = " << nvox - nbg << endl;
-    cout << "No. of background voxels = " << nbg << endl;
-  }
-
-  // Parameters of histogram based measures
-  InputType min_value, max_value;
-  if (mode == AM_Entropy || mode == AM_Mode) {
-    GetMinMax(images, min_value, max_value);
-    if (bins == 0) {
-      bins = iceil(max_value) - ifloor(min_value);
-      if (bins == 0) bins = 1;
-    }
-  }
+}
 
-  // Evaluate aggregation function for samples given at each voxel
-  if (verbose) {
-    cout << "Performing voxel-wise aggregation...";
-    cout.flush();
-  }
-  AggregateValuesAtEachVoxel eval;
-  eval._Images = &images;
-  eval._Output = &output;
-  eval._Padding = voxel_cast<InputType>(padding);
-  eval._MinValues = iround(threshold * double(images.size()));
+// -----------------------------------------------------------------------------
+/// Create function used to aggregate the input values at each voxel
+AggregationFunction NewAggregationFunction(AggregationMode mode, int alpha,
+                                           InputType min_value, InputType max_value,
+                                           int bins, bool parzen)
+{
+  AggregationFunction func;
   switch (mode) {
     case AM_Mean: {
-      eval._Function = [](const InputArray &values) -> OutputType {
+      func = [](const InputArray &values) -> OutputType {
         const auto n = static_cast<int>(values.size());
         return static_cast<OutputType>(Mean::Calculate(n, values.data()));
       };
     } break;
 
     case AM_Median: {
-      eval._Function = [](const InputArray &values) -> OutputType {
+      func = [](const InputArray &values) -> OutputType {
         const auto n = static_cast<int>(values.size());
         return static_cast<OutputType>(Median::Calculate(n, values.data()));
       };
     } break;
 
     case AM_StDev: {
-      eval._Function = [](const InputArray &values) -> OutputType {
+      func = [](const InputArray &values) -> OutputType {
         const auto n = static_cast<int>(values.size());
         return static_cast<OutputType>(StDev::Calculate(n, values.data()));
       };
     } break;
 
     case AM_Variance: {
-      eval._Function = [](const InputArray &values) -> OutputType {
+      func = [](const InputArray &values) -> OutputType {
         const auto n = static_cast<int>(values.size());
         return static_cast<OutputType>(Var::Calculate(n, values.data()));
       };
     } break;
 
     case AM_Gini: {
-      eval._Function = [](InputArray &values) -> OutputType {
+      func = [](InputArray &values) -> OutputType {
         return static_cast<OutputType>(GiniCoefficient(values));
       };
     } break;
 
     case AM_Theil: {
-      eval._Function = [](InputArray &values) -> OutputType {
+      func = [](InputArray &values) -> OutputType {
         return static_cast<OutputType>(EntropyIndex(values, 1));
       };
     } break;
 
     case AM_EntropyIndex: {
-      eval._Function = [alpha](InputArray &values) -> OutputType {
+      func = [alpha](InputArray &values) -> OutputType {
         return static_cast<OutputType>(EntropyIndex(values, alpha));
       };
     } break;
 
     case AM_Entropy: {
-      eval._Function = [min_value, max_value, bins, parzen](const InputArray &values) -> OutputType {
+      func = [min_value, max_value, bins, parzen](const InputArray &values) -> OutputType {
         Histogram1D<int> hist(bins);
         hist.Min(static_cast<double>(min_value));
         hist.Max(static_cast<double>(max_value));
@@ -737,7 +757,7 @@ int main(int argc, char **argv)
     } break;
 
     case AM_Mode: {
-      eval._Function = [min_value, max_value, bins, parzen](const InputArray &values) -> OutputType {
+      func = [min_value, max_value, bins, parzen](const InputArray &values) -> OutputType {
         Histogram1D<int> hist(bins);
         hist.Min(static_cast<double>(min_value));
         hist.Max(static_cast<double>(max_value));
@@ -751,7 +771,7 @@ int main(int argc, char **argv)
     } break;
 
     case AM_LabelConsistency: {
-      eval._Function = [](const InputArray &values) -> OutputType {
+      func = [](const InputArray &values) -> OutputType {
         const auto n = static_cast<int>(values.size());
         int m = 0;
         for (int i = 0; i < n; ++i)
@@ -766,13 +786,340 @@ int main(int argc, char **argv)
     } break;
 
     default:
-      if (verbose) cout << " failed" << endl;
       FatalError("Invalid aggregation mode: " << mode);
   };
-  parallel_for(blocked_range<int>(0, nvox), eval);
-  if (verbose) cout << " done" << endl;
+  return func;
+}
+
+// -----------------------------------------------------------------------------
+/// Read slab of input image and apply rescaling function of image file
+void ReadSlab(ImageReader *reader, int k1, int k2, InputImage &slab)
+{
+  UniquePtr<BaseImage> image(reader->ReadSlab(k1, k2));
+  slab = *image;
+  if (reader->Slope() != .0 && reader->Slope() != 1.0) {
+    slab *= reader->Slope();
+  }
+  if (reader->Intercept() != .0) {
+    slab += reader->Intercept();
+  }
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  // Parse command arguments
+  REQUIRES_POSARGS(3);
+
+  AggregationMode mode;
+  if (!FromString(POSARG(1), mode)) {
+    FatalError("Invalid aggregation mode: " << POSARG(1));
+  }
+
+  const char        *mask_name     = nullptr;
+  const char        *output_name   = nullptr;
+  ImageDataType      dtype         = MIRTK_VOXEL_UNKNOWN;
+  NormalizationMode  normalization = Normalization_None;
+  int                alpha         = 0;
+  int                bins          = 64;
+  bool               parzen        = false;
+  double             padding       = NaN;
+  double             threshold     = 0.;
+  bool               intersection  = false;
+  double             rescale_min   = NaN;
+  double             rescale_max   = NaN;
+  int                slab_size     = 0;
+
+  for (ALL_OPTIONS) {
+    if (OPTION("-output")) output_name = ARGUMENT;
+    else if (OPTION("-mask")) mask_name = ARGUMENT;
+    else if (OPTION("-dtype") || OPTION("-datatype")) {
+      PARSE_ARGUMENT(dtype);
+    }
+    else if (OPTION("-normalization") || OPTION("-normalize")) {
+      if (HAS_ARGUMENT) {
+        const string arg = ToLower(ARGUMENT);
+        bool bval;
+        if (FromString(arg, bval)) {
+          normalization = (bval ? Normalization_ZScore : Normalization_None);
+        } else if (arg == "none") {
+          normalization = Normalization_None;
+        } else if (arg == "mean") {
+          normalization = Normalization_Mean;
+        } else if (arg == "median") {
+          normalization = Normalization_Median;
+        } else if (arg == "zscore" || arg == "z-score") {
+          normalization = Normalization_ZScore;
+        } else if (arg == "unit") {
+          normalization = Normalization_UnitRange;
+        } else {
+          FatalError("Invalid -normalization mode: " << arg);
+        }
+      } else {
+        normalization = Normalization_ZScore;
+      }
+    }
+    else if (OPTION("-rescale")) {
+      PARSE_ARGUMENT(rescale_min);
+      if (HAS_ARGUMENT) {
+        PARSE_ARGUMENT(rescale_max);
+      } else {
+        rescale_max = rescale_min;
+        rescale_min = 0.;
+      }
+    }
+    else if (OPTION("-threshold")) {
+      PARSE_ARGUMENT(threshold);
+    }
+    else if (OPTION("-padding")) PARSE_ARGUMENT(padding);
+    else if (OPTION("-alpha")) PARSE_ARGUMENT(alpha);
+    else if (OPTION("-bins")) PARSE_ARGUMENT(bins);
+    else if (OPTION("-slab-size")) PARSE_ARGUMENT(slab_size);
+    else HANDLE_BOOL_OPTION(parzen);
+    else HANDLE_BOOL_OPTION(intersection);
+    else HANDLE_COMMON_OR_UNKNOWN_OPTION();
+  }
+  if (!output_name) {
+    FatalError("Option -output is required!");
+  }
+
+  // Initialize I/O factories
+  InitializeIOLibrary();
+
+  OutputImage output;
+  AggregateValuesAtEachVoxel eval;
+  eval._Padding = voxel_cast<InputType>(padding);
+  eval._MinValues = iround(threshold * double(NUM_POSARGS - 1));
+
+  // Parameters of histogram based measures
+  InputType min_value = 0.f, max_value = 0.f;
+
+  if (slab_size <= 0) {
+
+    // Read input images
+    Array<InputImage> images(NUM_POSARGS - 1);
+    if (verbose) {
+      cout << "Reading " << images.size() << " images...";
+      cout.flush();
+    }
+    images[0].Read(POSARG(2));
+    for (int i = 3; i <= NUM_POSARGS; ++i) {
+      images[i - 2].Read(POSARG(i));
+      if (images[i - 2].Attributes() != images[0].Attributes()) {
+        if (verbose) cout << " failed" << endl;
+        FatalError("Input image " << POSARG(i) << " has different attributes than previous input images!");
+      }
+    }
+    if (verbose) cout << " done" << endl;
+
+    // Replace background values by NaN to be able to identify background after normalization
+    for (auto &image : images) {
+      ReplacePaddingByNaN(image, padding);
+    }
+
+    // Normalize images
+    if (normalization != Normalization_None) {
+      if (verbose) {
+        cout << "Normalizing images...";
+        cout.flush();
+      }
+      Normalize(images, normalization);
+      if (verbose) cout << " done" << endl;
+    }
+
+    // Rescale images
+    if (rescale_min < rescale_max) {
+      if (verbose) {
+        cout << "Rescaling images...";
+        cout.flush();
+      }
+      Rescale(images, rescale_min, rescale_max);
+      if (verbose) cout << " done" << endl;
+    }
+
+    // Ensure all (normalized) intensities are positive
+    if (mode == AM_Gini || mode == AM_Theil || mode == AM_EntropyIndex) {
+      double min_value = inf;
+      for (const auto &image : images) {
+        double vmin, vmax;
+        image.GetMinMaxAsDouble(vmin, vmax);
+        if (vmin < min_value) min_value = vmin;
+      }
+      if (IsInf(min_value)) {
+        FatalError("Neither input image seems to have any foreground given -padding value of " << padding);
+      }
+      ShiftToPositive(images, min_value - 1.);
+    }
+
+    // Initialize output image
+    if (mask_name) {
+      BinaryImage mask(mask_name);
+      if (mask.Attributes() != images[0].Attributes()) {
+        FatalError("Mask has different attributes!");
+      }
+      InitializeOutput(output, images, padding, intersection, &mask);
+    } else {
+      InitializeOutput(output, images, padding, intersection);
+    }
+    if (verbose > 1) {
+      const int nvox = output.NumberOfVoxels();
+      int nbg = 0;
+      for (int vox = 0; vox < nvox; ++vox) {
+        if (output.IsBackground(vox)) ++nbg;
+      }
+      cout << "No. of foreground voxels = " << nvox - nbg << endl;
+      cout << "No. of background voxels = " << nbg << endl;
+    }
+
+    // Parameters of histogram based measures
+    if (mode == AM_Entropy || mode == AM_Mode) {
+      GetMinMax(images, min_value, max_value);
+      if (bins == 0) {
+        bins = iceil(max_value) - ifloor(min_value);
+        if (bins == 0) bins = 1;
+      }
+    }
+
+    // Evaluate aggregation function for samples given at each voxel
+    if (verbose) {
+      cout << "Performing voxel-wise aggregation...";
+      cout.flush();
+    }
+    eval._Images   = &images;
+    eval._Output   = &output;
+    eval._Function = NewAggregationFunction(mode, alpha, min_value, max_value, bins, parzen);
+    parallel_for(blocked_range<int>(0, output.NumberOfVoxels()), eval);
+    if (verbose) cout << " done" << endl;
+
+  } else {
+
+    if (normalization == Normalization_Median) {
+      FatalError("Option -slab-size cannot be used with -normalization median");
+    }
+
+    // Open input images and read image headers
+    const int nimages = NUM_POSARGS - 1;
+    Array<UniquePtr<ImageReader> > readers(nimages);
+    for (int i = 0; i < nimages; ++i) {
+      readers[i].reset(ImageReader::New(POSARG(i + 2)));
+      if (readers[i]->Attributes() != readers[0]->Attributes()) {
+        FatalError("Input image " << POSARG(i + 2) << " has different attributes than previous input images!");
+      }
+    }
+    const ImageAttributes &attr = readers[0]->Attributes();
+    const int nslabs = (attr._z + slab_size - 1) / slab_size;
+
+    UniquePtr<BinaryImage> mask;
+    if (mask_name) {
+      mask.reset(new BinaryImage(mask_name));
+      if (mask->Attributes() != attr) {
+        FatalError("Mask has different attributes!");
+      }
+    }
+
+    // Determine intensity maps and range of input images from foreground statistics
+    const bool positive  = (mode == AM_Gini || mode == AM_Theil || mode == AM_EntropyIndex);
+    const bool histogram = (mode == AM_Entropy || mode == AM_Mode);
+    const bool rescale   = (rescale_min < rescale_max);
+    Array<IntensityMap> maps(nimages);
+    double shift = 0.;
+    if (normalization != Normalization_None || rescale || positive || histogram) {
+      if (verbose) {
+        cout << "Computing statistics of " << nimages << " images...";
+        cout.flush();
+      }
+      InputImage slab;
+      double global_min = +inf, global_max = -inf;
+      for (int i = 0; i < nimages; ++i) {
+        ForegroundStatistics stats;
+        for (int k1 = 0; k1 < attr._z; k1 += slab_size) {
+          ReadSlab(readers[i].get(), k1, min(k1 + slab_size, attr._z) - 1, slab);
+          ReplacePaddingByNaN(slab, padding);
+          stats.Add(slab);
+        }
+        IntensityMap &map = maps[i];
+        GetNormalization(normalization, stats.Mean(), stats.Sigma(), NaN,
+                         stats.Min(), stats.Max(), map._Scale, map._Shift);
+        // Intensity map is monotonic, i.e., maps extrema to extrema
+        InputType vmin = static_cast<InputType>(stats.Min());
+        InputType vmax = static_cast<InputType>(stats.Max());
+        if (!fequal(map._Scale, 1.) || !fequal(map._Shift, 0.)) {
+          const InputType a = Normalize(vmin, map._Scale, map._Shift);
+          const InputType b = Normalize(vmax, map._Scale, map._Shift);
+          vmin = min(a, b), vmax = max(a, b);
+        }
+        if (rescale) {
+          map._Rescale = true;
+          map._Min     = rescale_min;
+          map._Max     = rescale_max;
+          GetRescaling(vmin, vmax, rescale_min, rescale_max, map._Slope, map._Intercept);
+          if (!fequal(map._Slope, 1.) || !fequal(map._Intercept, 0.)) {
+            vmin = Rescale(vmin, map._Slope, map._Intercept, map._Min, map._Max);
+            vmax = Rescale(vmax, map._Slope, map._Intercept, map._Min, map._Max);
+          }
+        }
+        // Same as GenericImage::GetMinMax when image has no foreground
+        if (IsNaN(vmin) || IsNaN(vmax)) vmin = vmax = 0.f;
+        global_min = min(global_min, static_cast<double>(vmin));
+        global_max = max(global_max, static_cast<double>(vmax));
+      }
+      if (positive) {
+        if (IsInf(global_min)) {
+          FatalError("Neither input image seems to have any foreground given -padding value of " << padding);
+        }
+        shift = global_min - 1.;
+      }
+      if (histogram) {
+        min_value = static_cast<InputType>(global_min);
+        max_value = static_cast<InputType>(global_max);
+        if (bins == 0) {
+          bins = iceil(max_value) - ifloor(min_value);
+          if (bins == 0) bins = 1;
+        }
+      }
+      if (verbose) cout << " done" << endl;
+    }
+
+    // Aggregate input values slab-by-slab
+    if (verbose) {
+      cout << "Performing voxel-wise aggregation of " << nslabs << " slabs...";
+      cout.flush();
+    }
+    output.Initialize(attr);
+    InputImages slabs(nimages);
+    OutputImage output_slab;
+    BinaryImage mask_slab;
+    eval._Images   = &slabs;
+    eval._Output   = &output_slab;
+    eval._Function = NewAggregationFunction(mode, alpha, min_value, max_value, bins, parzen);
+    for (int k1 = 0; k1 < attr._z; k1 += slab_size) {
+      const int k2 = min(k1 + slab_size, attr._z) - 1;
+      for (int i = 0; i < nimages; ++i) {
+        ReadSlab(readers[i].get(), k1, k2, slabs[i]);
+        ReplacePaddingByNaN(slabs[i], padding);
+        Apply(slabs[i], maps[i]);
+      }
+      if (positive) ShiftToPositive(slabs, shift);
+      if (mask) mask->GetRegion(mask_slab, 0, 0, k1, attr._x, attr._y, k2 + 1);
+      InitializeOutput(output_slab, slabs, padding, intersection, mask ? &mask_slab : nullptr);
+      parallel_for(blocked_range<int>(0, output_slab.NumberOfVoxels()), eval);
+      for (int l = 0; l < attr._t; ++l) {
+        memcpy(output.Data(0, 0, k1, l), output_slab.Data(0, 0, 0, l),
+               output_slab.NumberOfSpatialVoxels() * sizeof(OutputType));
+      }
+    }
+    slabs.clear();
+    output.PutBackgroundValueAsDouble(NaN);
+    if (verbose) cout << " done" << endl;
+  }
 
   // Set suitable background value
+  double bg;
+  const int nvox = output.NumberOfVoxels();
   if (mode == AM_Mean || mode == AM_Median) {
     OutputType omin, omax;
     output.GetMinMax(omin, omax);
@@ -349,37 +349,20 @@ int main(int argc, char *argv[])
     // Euclidean distance transform
     case DT_Euclidean: {
       EuclideanDistanceTransformType edt(euclidean_mode);
-      RealImage &inputA  = image, inputB(image.Attributes());
-      RealImage &outputA = dmap,  outputB;
 
       for (int idx = 0; idx < image.NumberOfVoxels(); ++idx) {
-        if (image(idx) > .5) {
-          inputA(idx) = 1.0;
-          inputB(idx) = 0.0;
-        } else {
-          inputA(idx) = 0.0;
-          inputB(idx) = 1.0;
-        }
+        image(idx) = (image(idx) > .5 ? 1.0 : 0.0);
       }
 
-      if (verbose) cout << "  Computing distance transform of interior...", cout.flush();
+      if (verbose) cout << "  Computing signed distance transform...", cout.flush();
 
-      edt.Input (& inputA);
-      edt.Output(&outputA);
-      edt.Run();
-
-      if (verbose) cout << " done\n  Computing distance transform of exterior...", cout.flush();
-
-      edt.Input (& inputB);
-      edt.Output(&outputB);
+      edt.OutputDistance(EuclideanDistanceTransformType::DT_SignedDistance);
+      edt.Input (&image);
+      edt.Output(&dmap);
       edt.Run();
 
       if (verbose) cout << " done" << endl;
 
-      for (int idx = 0; idx < image.NumberOfVoxels(); ++idx) {
-        dmap(idx) = sqrt(outputA(idx)) - sqrt(outputB(idx));
-      }
-
       if (radial > 0) {
         edt.Input (&dmap);
         edt.Output(&dmap);
@@ -238,6 +238,12 @@ void PrintHelp(const char *name)
   cout << "      Another name for this option is the '=' sign, but the optional arguments are\n";
   cout << "      are not supported by this alternative notation. See Examples for usage.\n";
   cout << "\n";
+  cout << "Execution options:\n";
+  cout << "  -fuse [on|off], -nofuse\n";
+  cout << "      Whether to apply consecutive element-wise operations in a single pass over\n";
+  cout << "      the data. Statistics and output operations are performed in between.\n";
+  cout << "      The result is identical in either case. (default: on)\n";
+  cout << "\n";
   cout << "Data statistics options:\n";
   cout << "  -append <file>\n";
   cout << "      Append output to a file. (default: STDOUT)\n";
@@ -394,6 +400,7 @@ int main(int argc, char **argv)
   const char *delimiter     = NULL;
   bool        print_header  = false;
   int         digits        = 5;
+  bool        fuse          = true;
 
   Array<string> header;
   Array<string> prefix;
@@ -990,6 +997,11 @@ int main(int argc, char **argv)
       ops.push_back(UniquePtr<Op>(new Count()));
     } else if (OPTION("-delimiter") || OPTION("-delim") || OPTION("-d") || OPTION("-sep")) {
       delimiter = ARGUMENT;
+    } else if (OPTION("-fuse")) {
+      if (HAS_ARGUMENT) PARSE_ARGUMENT(fuse);
+      else fuse = true;
+    } else if (OPTION("-nofuse")) {
+      fuse = false;
     } else if (OPTION("-precision") || OPTION("-digits")) {
       if (!FromString(ARGUMENT, digits) || digits < 0) {
         cerr << "Invalid -precision argument, value must be non-negative integer!" << endl;
@@ -1021,9 +1033,29 @@ int main(int argc, char **argv)
     }
   }
 
-  // Process input data, either transform it or compute statistics from it
+  // Group consecutive element-wise operations such that each group is applied
+  // in a single pass over the data, separated by statistics and outputs
+  Array<UniquePtr<Op> > sequences;
+  Array<Op *>           pipeline;
+  ElementWiseOpSequence *sequence = nullptr;
   for (size_t i = 0; i < ops.size(); ++i) {
-    ops[i]->Process(n, data.get(), mask.get());
+    ElementWiseOp *op = (fuse ? dynamic_cast<ElementWiseOp *>(ops[i].get()) : nullptr);
+    if (op != nullptr) {
+      if (sequence == nullptr) {
+        sequence = new ElementWiseOpSequence();
+        sequences.push_back(UniquePtr<Op>(sequence));
+        pipeline.push_back(sequence);
+      }
+      sequence->Add(op);
+    } else {
+      sequence = nullptr;
+      pipeline.push_back(ops[i].get());
+    }
+  }
+
+  // Process input data, either transform it or compute statistics from it
+  for (size_t i = 0; i < pipeline.size(); ++i) {
+    pipeline[i]->Process(n, data.get(), mask.get());
   }
   mask.reset();
 
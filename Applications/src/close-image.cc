@@ -47,11 +47,25 @@ void PrintHelp(const char *name)
   cout << "Optional arguments:\n";
   cout << "  -iterations <n>     Number of dilation/erosion iterations. (default: 1)\n";
   cout << "  -connectivity <n>   Type of voxel connectivity (4, 6, 18, or 26). (default: 26)\n";
+  cout << "  -radius <r>         Radius of ball structuring element in mm. When specified, the input\n";
+  cout << "                      image is treated as binary mask and the iterations are ignored.\n";
   PrintStandardOptions(cout);
   cout << "\n";
   cout.flush();
 }
 
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+template <class TVoxel>
+void CloseImage(BaseImage *image, int iterations, ConnectivityType connectivity, double radius)
+{
+  if (radius > .0) Close<TVoxel>(image, radius);
+  else             Close<TVoxel>(image, iterations, connectivity);
+}
+
 // =============================================================================
 // Main
 // =============================================================================
@@ -66,6 +80,7 @@ int main(int argc, char *argv[])
 
   int              iterations   = 1;
   ConnectivityType connectivity = CONNECTIVITY_26;
+  double           radius       = .0;
 
   for (ALL_OPTIONS) {
     if (OPTION("-iterations") || OPTION("-iter")) {
@@ -74,6 +89,9 @@ int main(int argc, char *argv[])
     else if (OPTION("-connectivity") || OPTION("-neighbors") || OPTION("-number-of-neighbors")) {
       PARSE_ARGUMENT(connectivity);
     }
+    else if (OPTION("-radius")) {
+      PARSE_ARGUMENT(radius);
+    }
     else HANDLE_COMMON_OR_UNKNOWN_OPTION();
   }
 
@@ -82,12 +100,12 @@ int main(int argc, char *argv[])
 
   if (verbose) cout << "Closing ... ", cout.flush();
   switch (image->GetDataType()) {
-    case MIRTK_VOXEL_BINARY:  Close<BinaryPixel>(image.get(), iterations, connectivity); break;
-    case MIRTK_VOXEL_GREY:    Close<GreyPixel  >(image.get(), iterations, connectivity); break;
-    case MIRTK_VOXEL_REAL:    Close<RealPixel  >(image.get(), iterations, connectivity); break;
+    case MIRTK_VOXEL_BINARY:  CloseImage<BinaryPixel>(image.get(), iterations, connectivity, radius); break;
+    case MIRTK_VOXEL_GREY:    CloseImage<GreyPixel  >(image.get(), iterations, connectivity, radius); break;
+    case MIRTK_VOXEL_REAL:    CloseImage<RealPixel  >(image.get(), iterations, connectivity, radius); break;
     default: {
       RealImage other(*image);
-      Close<RealPixel>(&other, iterations, connectivity);
+      CloseImage<RealPixel>(&other, iterations, connectivity, radius);
       *image = other;
     } break;
   }
@@ -150,13 +150,11 @@ void ComputeDistanceMap(vtkSmartPointer<vtkPolyData> surface, const BinaryImage
   // Calculate Euclidean distance transforms
   typedef EuclideanDistanceTransform<RealPixel> DistanceTransform;
   DistanceTransform edt(DistanceTransform::DT_3D);
+  edt.OutputDistance(DistanceTransform::DT_Distance);
   edt.Input (&dmap);
   edt.Output(&dmap);
   edt.Run();
 
-  for (int vox = 0; vox < nvox; ++vox) {
-    dmap(vox) = sqrt(dmap(vox));
-  }
   if (invert) dmap *= -1.0;
 }
 
@@ -48,11 +48,25 @@ void PrintHelp(const char *name)
   cout << "Optional arguments:\n";
   cout << "  -iterations <n>     Number of iterations. (default: 1)\n";
   cout << "  -connectivity <n>   Type of voxel connectivity (4, 6, 18, or 26). (default: 26)\n";
+  cout << "  -radius <r>         Radius of ball structuring element in mm. When specified, the input\n";
+  cout << "                      image is treated as binary mask and the iterations are ignored.\n";
   PrintStandardOptions(cout);
   cout << "\n";
   cout.flush();
 }
 
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+template <class TVoxel>
+void DilateImage(BaseImage *image, int iterations, ConnectivityType connectivity, double radius)
+{
+  if (radius > .0) Dilate<TVoxel>(image, radius);
+  else             Dilate<TVoxel>(image, iterations, connectivity);
+}
+
 // =============================================================================
 // Main
 // =============================================================================
@@ -67,6 +81,7 @@ int main(int argc, char *argv[])
 
   int              iterations   = 1;
   ConnectivityType connectivity = CONNECTIVITY_26;
+  double           radius       = .0;
 
   for (ALL_OPTIONS) {
     if (OPTION("-iterations") || OPTION("-iter")) {
@@ -75,6 +90,9 @@ int main(int argc, char *argv[])
     else if (OPTION("-connectivity") || OPTION("-neighbors") || OPTION("-number-of-neighbors")) {
       PARSE_ARGUMENT(connectivity);
     }
+    else if (OPTION("-radius")) {
+      PARSE_ARGUMENT(radius);
+    }
     else HANDLE_COMMON_OR_UNKNOWN_OPTION();
   }
 
@@ -83,12 +101,12 @@ int main(int argc, char *argv[])
 
   if (verbose) cout << "Dilating ... ", cout.flush();
   switch (image->GetDataType()) {
-    case MIRTK_VOXEL_BINARY:  Dilate<BinaryPixel>(image.get(), iterations, connectivity); break;
-    case MIRTK_VOXEL_GREY:    Dilate<GreyPixel  >(image.get(), iterations, connectivity); break;
-    case MIRTK_VOXEL_REAL:    Dilate<RealPixel  >(image.get(), iterations, connectivity); break;
+    case MIRTK_VOXEL_BINARY:  DilateImage<BinaryPixel>(image.get(), iterations, connectivity, radius); break;
+    case MIRTK_VOXEL_GREY:    DilateImage<GreyPixel  >(image.get(), iterations, connectivity, radius); break;
+    case MIRTK_VOXEL_REAL:    DilateImage<RealPixel  >(image.get(), iterations, connectivity, radius); break;
     default: {
       RealImage other(*image);
-      Dilate<RealPixel>(&other, iterations, connectivity);
+      DilateImage<RealPixel>(&other, iterations, connectivity, radius);
       *image = other;
     } break;
   }
@@ -24,6 +24,8 @@
 #include "mirtk/GenericImage.h"
 #include "mirtk/ImageFunction.h"
 #include "mirtk/Histogram1D.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/UnorderedMap.h"
 
 using namespace mirtk;
 
@@ -58,6 +60,11 @@ void PrintHelp(const char *name)
   cout << "  -images-delim, -images-delimiter <c>\n";
   cout << "      Delimiter used in :option:`-images` file.\n";
   cout << "      (default: ',' for .csv, '\\t' for .tsv, and ' ' otherwise)\n";
+  cout << "  -batch-size <n>\n";
+  cout << "      Number of images kept in memory when the overlap between all pairs of images\n";
+  cout << "      is evaluated. Each image is read once per batch instead of once per pair.\n";
+  cout << "      Use a value greater or equal the number of images to read each image only once.\n";
+  cout << "      (default: 1)\n";
   cout << "  -Rx1 <int>\n";
   cout << "      Region of interest lower index threshold in x dimension.\n";
   cout << "  -Ry1 <int>\n";
@@ -329,6 +336,125 @@ double Evaluate(OverlapMetric metric, const BaseImage *target, const BaseImage *
   }
 }
 
+// -----------------------------------------------------------------------------
+/// Sparse confusion matrix of segmentation labels
+///
+/// Counts the number of voxels with a given pair of target and source labels
+/// in a single pass over all voxels. The number of true/false positives and
+/// negatives of any (merged) label segment is derived from these counts.
+class LabelConfusionMatrix
+{
+  /// Number of voxels for each co-occurring pair of target and source label
+  UnorderedMap<unsigned int, int> _Count;
+
+  /// Total number of voxels
+  int _NumberOfVoxels;
+
+  /// Key of pair of labels
+  static unsigned int Key(GreyPixel tgt, GreyPixel src)
+  {
+    return (static_cast<unsigned int>(static_cast<unsigned short>(tgt)) << 16)
+         |  static_cast<unsigned int>(static_cast<unsigned short>(src));
+  }
+
+  /// Target label of key
+  static GreyPixel TargetLabel(unsigned int key)
+  {
+    return static_cast<GreyPixel>(static_cast<unsigned short>(key >> 16));
+  }
+
+  /// Source label of key
+  static GreyPixel SourceLabel(unsigned int key)
+  {
+    return static_cast<GreyPixel>(static_cast<unsigned short>(key & 0xFFFF));
+  }
+
+  /// Count label pairs of voxels in parallel
+  struct CountLabelPairs
+  {
+    const BaseImage                *_Target;
+    const BaseImage                *_Source;
+    UnorderedMap<unsigned int, int> _Count;
+
+    CountLabelPairs(const BaseImage *target, const BaseImage *source)
+    :
+      _Target(target), _Source(source)
+    {}
+
+    CountLabelPairs(const CountLabelPairs &other, split)
+    :
+      _Target(other._Target), _Source(other._Source)
+    {}
+
+    void join(const CountLabelPairs &other)
+    {
+      for (const auto &entry : other._Count) {
+        _Count[entry.first] += entry.second;
+      }
+    }
+
+    void operator ()(const blocked_range<int> &re)
+    {
+      // Consecutive voxels mostly have the same pair of labels
+      unsigned int key, prev_key = 0;
+      int count = 0;
+      for (int idx = re.begin(); idx != re.end(); ++idx) {
+        key = Key(voxel_cast<GreyPixel>(_Target->GetAsDouble(idx)),
+                  voxel_cast<GreyPixel>(_Source->GetAsDouble(idx)));
+        if (key != prev_key) {
+          if (count > 0) _Count[prev_key] += count;
+          prev_key = key;
+          count = 0;
+        }
+        ++count;
+      }
+      if (count > 0) _Count[prev_key] += count;
+    }
+  };
+
+public:
+
+  /// Constructor
+  LabelConfusionMatrix() : _NumberOfVoxels(0) {}
+
+  /// Count label pairs of corresponding target and source voxels
+  void Compute(const BaseImage *target, const BaseImage *source)
+  {
+    _NumberOfVoxels = target->NumberOfVoxels();
+    if (source->NumberOfVoxels() != _NumberOfVoxels) {
+      Throw(ERR_InvalidArgument, __FUNCTION__, "Both images must have the same number of voxels");
+    }
+    CountLabelPairs body(target, source);
+    parallel_reduce(blocked_range<int>(0, _NumberOfVoxels), body);
+    _Count.swap(body._Count);
+  }
+
+  /// Get number of true/false positives/negatives of (merged) segment
+  ///
+  /// The segment {0} refers to the union of all positive labels.
+  void Get(const OrderedSet<GreyPixel> &labels, int &tp, int &fn, int &fp, int &tn) const
+  {
+    const bool all = (labels.size() == 1 && *labels.begin() == 0);
+    tp = fn = fp = 0;
+    bool tgt, src;
+    for (const auto &entry : _Count) {
+      const GreyPixel t = TargetLabel(entry.first);
+      const GreyPixel s = SourceLabel(entry.first);
+      if (all) {
+        tgt = (t > 0);
+        src = (s > 0);
+      } else {
+        tgt = (labels.find(t) != labels.end());
+        src = (labels.find(s) != labels.end());
+      }
+      if      (tgt && src) tp += entry.second;
+      else if (tgt)        fn += entry.second;
+      else if (src)        fp += entry.second;
+    }
+    tn = _NumberOfVoxels - tp - fn - fp;
+  }
+};
+
 // -----------------------------------------------------------------------------
 struct Arguments
 {
@@ -358,6 +484,7 @@ struct Arguments
     k1(0), k2(-1),
     digits(2),
     delim(","),
+    table(false),
     header(true),
     idcol_flag(true),
     idcol_path(false),
@@ -553,7 +680,9 @@ void AppendOverlap(ostream *os,
 
   } else {
 
-    const int num = target->NumberOfVoxels();
+    // Count co-occurrences of target and source labels
+    LabelConfusionMatrix confusion;
+    confusion.Compute(target, source);
 
     // Iterate over segments
     for (size_t roi = 0; roi < args.segments.size(); ++roi) {
@@ -567,30 +696,8 @@ void AppendOverlap(ostream *os,
         *os << *it;
       }
       // Determine TP, FP, TN, FN
-      int tp = 0, fp = 0, tn = 0, fn = 0;
-      if (labels.size() == 0 && (*labels.begin()) == 0) {
-        for (int idx = 0; idx < num; ++idx) {
-          auto tgt = voxel_cast<GreyPixel>(target->GetAsDouble(idx));
-          auto src = voxel_cast<GreyPixel>(source->GetAsDouble(idx));
-          tgt = (tgt > 0 ? 1 : 0);
-          src = (src > 0 ? 1 : 0);
-          if      (tgt == 1 && src == 1) ++tp;
-          else if (tgt == 1 && src == 0) ++fn;
-          else if (tgt == 0 && src == 1) ++fp;
-          else                           ++tn;
-        }
-      } else {
-        for (int idx = 0; idx < num; ++idx) {
-          auto tgt = voxel_cast<GreyPixel>(target->GetAsDouble(idx));
-          auto src = voxel_cast<GreyPixel>(source->GetAsDouble(idx));
-          if (labels.find(tgt) != labels.end()) {
-            if (labels.find(src) != labels.end()) ++tp;
-            else                                  ++fn;
-          }
-          else if (labels.find(src) != labels.end()) ++fp;
-          else                                       ++tn;
-        }
-      }
+      int tp, fp, tn, fn;
+      confusion.Get(labels, tp, fn, fp, tn);
       // Compute overlap metrics
       for (size_t m = 0; m < args.metrics.size(); ++m) {
         *os << args.delim;
@@ -642,6 +749,7 @@ int main(int argc, char **argv)
   const char *table_name   = nullptr;
   const char *image_list   = nullptr;
   const char *image_delim  = nullptr;
+  int         batch_size   = 1;
 
   verbose = 1; // by default, include textual description of output value
                // can be disabled by caller using "-v 0" option in order to
@@ -715,6 +823,10 @@ int main(int argc, char **argv)
         args.metrics.push_back(metric);
       } while (HAS_ARGUMENT);
     }
+    else if (OPTION("-batch-size")) {
+      PARSE_ARGUMENT(batch_size);
+      if (batch_size < 1) FatalError("Invalid -batch-size argument, must be positive");
+    }
     else if (OPTION("-precision")) PARSE_ARGUMENT(args.digits);
     else if (OPTION("-delim")) args.delim = ARGUMENT;
     else if (OPTION("-Rx1")) PARSE_ARGUMENT(args.i1);
@@ -807,17 +919,38 @@ int main(int argc, char **argv)
 
   } else {
 
+    // Keep a batch of images in memory and compare each of these to all
+    // subsequent images such that each of the latter is read once per batch.
+    // The rows of each batch are buffered to preserve the output order.
+    const int n = static_cast<int>(image_names.size());
     const char *source_name;
-    for (size_t i = 0; i < image_names.size(); ++i) {
-      target_name = image_names[i].c_str();
-      auto target = ReadImage(target_name, args);
-      for (size_t j = i + 1; j < image_names.size(); ++j) {
+    for (int b1 = 0; b1 < n - 1; b1 += batch_size) {
+      const int b2 = min(b1 + batch_size, n - 1);
+      Array<UniquePtr<BaseImage> > targets(b2 - b1);
+      Array<ostringstream> rows(b2 - b1);
+      for (int i = b1; i < b2; ++i) {
+        targets[i - b1] = ReadImage(image_names[i].c_str(), args);
+      }
+      for (int j = b1 + 1; j < n; ++j) {
         source_name = image_names[j].c_str();
-        if (os != &cout) {
-          cout << "Evaluating overlap between " << FileName(target_name) << " and " << FileName(source_name) << endl;
+        UniquePtr<BaseImage> source_image;
+        const BaseImage *source;
+        if (j < b2) {
+          source = targets[j - b1].get();
+        } else {
+          source_image = ReadImage(source_name, args);
+          source = source_image.get();
+        }
+        for (int i = b1; i < min(j, b2); ++i) {
+          target_name = image_names[i].c_str();
+          if (os != &cout) {
+            cout << "Evaluating overlap between " << FileName(target_name) << " and " << FileName(source_name) << endl;
+          }
+          AppendOverlap(&rows[i - b1], targets[i - b1].get(), source, target_name, source_name, args);
         }
-        auto source = ReadImage(source_name, args);
-        AppendOverlap(os, target.get(), source.get(), target_name, source_name, args);
+      }
+      for (int i = b1; i < b2; ++i) {
+        *os << rows[i - b1].str();
       }
     }
 
@@ -144,8 +144,13 @@ int main(int argc, char *argv[])
     cout << "No. of connected components: " << nregions << "\n";
     if (verbose > 1) {
       for (int i = 0; i < nregions; ++i) {
+        const ConnectedComponent &comp = cc.Components()[i];
         cout << "  Size of component " << ToString(i+1, 3) << ": "
-             << ToString(cc.ComponentSize()[i], 6) << "\n";
+             << ToString(comp.Size, 6) << ", bounds = ["
+             << comp.Bounds[0] << ", " << comp.Bounds[1] << "] x ["
+             << comp.Bounds[2] << ", " << comp.Bounds[3] << "] x ["
+             << comp.Bounds[4] << ", " << comp.Bounds[5] << "], centroid = ("
+             << comp.Centroid[0] << ", " << comp.Centroid[1] << ", " << comp.Centroid[2] << ")\n";
       }
     }
     cout.flush();
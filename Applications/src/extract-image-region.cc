@@ -23,6 +23,7 @@
 
 #include "mirtk/PointSet.h"
 #include "mirtk/BaseImage.h"
+#include "mirtk/ImageReader.h" // memory_map_images
 #include "mirtk/IOConfig.h"
 
 using namespace mirtk;
@@ -177,7 +178,11 @@ int main(int argc, char **argv)
   const char *output_name = POSARG(2);
 
   // Read input image
+  //
+  // Uncompressed image data is mapped into memory such that only the
+  // voxels within the extracted region are loaded from disk.
   InitializeIOLibrary();
+  memory_map_images = true;
   UniquePtr<BaseImage> in(BaseImage::New(input_name));
 
   // Parse optional arguments and adjust image region accordingly
@@ -438,6 +443,9 @@ int main(int argc, char **argv)
     }
   }
 
+  // Unmap input image file before output may overwrite it
+  in.reset();
+
   // Write output region
   if (split == -1) {
     out->Write(output_name);
@@ -595,38 +595,24 @@ int main(int argc, char *argv[])
 
     // Compute signed distance map
     if (dmap_name) {
-    	// Create separate inside/outside masks
-      RealImage inside_mask (attr);
-      RealImage outside_mask(attr);
+    	// Create binary object mask
+      RealImage object_mask(attr);
       for (int vox = 0; vox < nvox; ++vox) {
-        if (mask(vox)) {
-          inside_mask (vox) = 0.0;
-          outside_mask(vox) = 1.0;
-        } else {
-          inside_mask (vox) = 1.0;
-          outside_mask(vox) = 0.0;
-        }
+        object_mask(vox) = (mask(vox) ? 1.0 : 0.0);
       }
 
-      // Calculate Euclidean distance transforms
+      // Calculate signed Euclidean distance transform
       typedef EuclideanDistanceTransform<RealPixel> DistanceTransform;
       DistanceTransform edt(DistanceTransform::DT_3D);
-      RealImage inside_dmap, outside_dmap;
+      edt.OutputDistance(DistanceTransform::DT_SignedDistance);
+      RealImage dmap;
 
-      edt.Input (&inside_mask);
-      edt.Output(&inside_dmap);
+      edt.Input (&object_mask);
+      edt.Output(&dmap);
       edt.Run();
 
-      edt.Input (&outside_mask);
-      edt.Output(&outside_dmap);
-      edt.Run();
-
-      for (int vox = 0; vox < nvox; ++vox) {
-        inside_dmap(vox) = sqrt(outside_dmap(vox)) - sqrt(inside_dmap(vox));
-      }
-
       // Write signed distance map
-      inside_dmap.Write(dmap_name);
+      dmap.Write(dmap_name);
     }
   }
 
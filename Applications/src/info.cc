@@ -445,6 +445,8 @@ int main(int argc, char *argv[])
       else HANDLE_COMMON_OR_UNKNOWN_OPTION();
     }
 
+    // Map uncompressed image data into memory instead of reading a copy
+    memory_map_images = true;
     UniquePtr<BaseImage> image(image_reader->Run());
     if (!attributes) {
       cout << "Information from ImageReader::Print\n\n";
@@ -21,6 +21,7 @@
 #include "mirtk/Common.h"
 #include "mirtk/Options.h"
 #include "mirtk/Transformations.h"
+#include "mirtk/DisplacementFieldInversion.h"
 
 using namespace mirtk;
 
@@ -128,30 +129,25 @@ int main(int argc, char **argv)
         BSplineFreeFormTransformation3D *affd2 = new BSplineFreeFormTransformation3D(*affd1);
 
         // Evaluate inverse displacements
-        double x, y, z;
-
-        double *dx = new double[affd1->NumberOfDOFs() / 3];
-        double *dy = new double[affd1->NumberOfDOFs() / 3];
-        double *dz = new double[affd1->NumberOfDOFs() / 3];
-
-        int index = 0;
-        for (int k = 0; k < affd1->Z(); ++k)
-        for (int j = 0; j < affd1->Y(); ++j)
-        for (int i = 0; i < affd1->X(); ++i, ++index) {
-          x = i, y = j, z = k;
-          affd1->LatticeToWorld(x, y, z);
-          affd1->InverseDisplacement(x, y, z);
-          dx[index] = x;
-          dy[index] = y;
-          dz[index] = z;
+        const int ncps = affd1->NumberOfDOFs() / 3;
+
+        double *dx = CAllocate<double>(ncps);
+        double *dy = CAllocate<double>(ncps);
+        double *dz = CAllocate<double>(ncps);
+
+        DisplacementFieldInversion inversion(affd1);
+        inversion.Run(affd1->Attributes(), dx, dy, dz);
+        if (verbose > 1) {
+          cout << "Inversion of control point displacements:\n";
+          inversion.Print(cout, 1);
         }
 
         // Interpolate inverse displacements
         affd2->Interpolate(dx, dy, dz);
 
-        delete[] dx;
-        delete[] dy;
-        delete[] dz;
+        Deallocate(dx);
+        Deallocate(dy);
+        Deallocate(dz);
 
         ffd2 = affd2;
 
@@ -35,11 +35,13 @@ using namespace mirtk;
 void PrintHelp(const char *name)
 {
   cout << "\n";
-  cout << "Usage: " << name << " <target> <source> <output> [options]\n";
+  cout << "Usage: " << name << " <target> <source> <output> [<source> <output>...] [options]\n";
   cout << "\n";
   cout << "Description:\n";
   cout << "  Matches the intensity distribution of the source image to match the\n";
   cout << "  distribution of the target image using a piecewise linear function [1].\n";
+  cout << "  When more than one source image is given, all source images are matched\n";
+  cout << "  to the same target image whose histogram is computed only once.\n";
   cout << "\n";
   cout << "  [1] Nyul, Udupa, and Zhang, \"New variants of a method of MRI scale standardization\",\n";
   cout << "      IEEE TMI 19(2), pp. 143-150, 2000, http://dx.doi.org/10.1109/42.836373.\n";
@@ -48,12 +50,17 @@ void PrintHelp(const char *name)
   cout << "  target   Reference image.\n";
   cout << "  source   Input image whose histogram should match the reference histogram.\n";
   cout << "  output   Output image with histogram matching the reference histogram.\n";
+  cout << "           Each additional source image must be followed by its output image.\n";
   cout << "\n";
   cout << "Options:\n";
   cout << "  -Tp <value>\n";
   cout << "    Target padding value. (default: NaN)\n";
   cout << "  -Sp <value>\n";
   cout << "    Source padding value. (default: NaN)\n";
+  cout << "  -Tm <file>\n";
+  cout << "    Target foreground mask. (default: none)\n";
+  cout << "  -Sm <file>\n";
+  cout << "    Source foreground mask, must be defined on the lattice of each source image. (default: none)\n";
   cout << "  -dtype short|int|float|double\n";
   cout << "    Data type of output image. (default: input data type)\n";
   PrintCommonOptions(cout);
@@ -61,6 +68,25 @@ void PrintHelp(const char *name)
 }
 
 
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+// ------------------------------------------------------------------------------
+/// Restrict foreground of image with optional padding value to given mask
+void PutMask(RealImage &image, const BinaryImage &mask, const char *mask_name)
+{
+  if (!image.HasSpatialAttributesOf(&mask)) {
+    FatalError("Mask " << mask_name << " is not defined on the lattice of the image!");
+  }
+  const int nvox = mask.NumberOfVoxels();
+  BinaryImage *fg = new BinaryImage(mask);
+  for (int idx = 0; idx < image.NumberOfVoxels(); ++idx) {
+    if (image.IsBackground(idx)) fg->Put(idx % nvox, BinaryPixel(0));
+  }
+  image.PutMask(fg, true);
+}
+
 // =============================================================================
 // Main
 // =============================================================================
@@ -71,9 +97,13 @@ int main(int argc, char **argv)
   REQUIRES_POSARGS(3);
   InitializeIOLibrary();
 
+  if (NUM_POSARGS % 2 != 1) {
+    FatalError("Each source image must be followed by the name of its output image!");
+  }
+
   const char *target_name = POSARG(1);
-  const char *source_name = POSARG(2);
-  const char *output_name = POSARG(3);
+  const char *target_mask_name = nullptr;
+  const char *source_mask_name = nullptr;
 
   double source_padding = NaN;
   double target_padding = NaN;
@@ -82,6 +112,8 @@ int main(int argc, char **argv)
   for (ALL_OPTIONS) {
     if      (OPTION("-Tp")) PARSE_ARGUMENT(target_padding);
     else if (OPTION("-Sp")) PARSE_ARGUMENT(source_padding);
+    else if (OPTION("-Tm")) target_mask_name = ARGUMENT;
+    else if (OPTION("-Sm")) source_mask_name = ARGUMENT;
     else if (OPTION("-dtype")) PARSE_ARGUMENT(dtype);
     else HANDLE_COMMON_OR_UNKNOWN_OPTION();
   }
@@ -89,37 +121,53 @@ int main(int argc, char **argv)
   if (verbose) cout << "Reading target image ... ", cout.flush();
   RealImage target(target_name);
   target.PutBackgroundValueAsDouble(target_padding, true);
-  if (verbose) cout << "done" << endl;
-
-  if (verbose) cout << "Reading source image ... ", cout.flush();
-  RealImage source;
-  {
-    UniquePtr<BaseImage> tmp(BaseImage::New(source_name));
-    if (dtype == MIRTK_VOXEL_UNKNOWN) {
-      dtype = static_cast<ImageDataType>(tmp->GetDataType());
-    }
-    source = *tmp;
+  if (target_mask_name) {
+    PutMask(target, BinaryImage(target_mask_name), target_mask_name);
   }
-  source.PutBackgroundValueAsDouble(source_padding, true);
   if (verbose) cout << "done" << endl;
 
-  if (verbose) cout << "Matching histogram...";
+  BinaryImage source_mask;
+  if (source_mask_name) source_mask.Read(source_mask_name);
+
   HistogramMatching<RealPixel> match;
-  match.Input(&source);
   match.Reference(&target);
-  match.Output(&source);
-  match.Run();
-  if (verbose) cout << " done" << endl;
-
-  if (verbose) cout << "Writing output image...";
-  if (dtype != source.GetDataType()) {
-    UniquePtr<BaseImage> output(BaseImage::New(dtype));
-    *output = source;
-    output->Write(output_name);
-  } else {
-    source.Write(output_name);
+
+  for (int n = 2; n < NUM_POSARGS; n += 2) {
+    const char *source_name = POSARG(n);
+    const char *output_name = POSARG(n + 1);
+
+    if (verbose) cout << "Reading source image " << source_name << " ... ", cout.flush();
+    RealImage source;
+    ImageDataType output_dtype = dtype;
+    {
+      UniquePtr<BaseImage> tmp(BaseImage::New(source_name));
+      if (output_dtype == MIRTK_VOXEL_UNKNOWN) {
+        output_dtype = static_cast<ImageDataType>(tmp->GetDataType());
+      }
+      source = *tmp;
+    }
+    source.PutBackgroundValueAsDouble(source_padding, true);
+    if (source_mask_name) {
+      PutMask(source, source_mask, source_mask_name);
+    }
+    if (verbose) cout << "done" << endl;
+
+    if (verbose) cout << "Matching histogram...";
+    match.Input(&source);
+    match.Output(&source);
+    match.Run();
+    if (verbose) cout << " done" << endl;
+
+    if (verbose) cout << "Writing output image " << output_name << " ...";
+    if (output_dtype != source.GetDataType()) {
+      UniquePtr<BaseImage> output(BaseImage::New(output_dtype));
+      *output = source;
+      output->Write(output_name);
+    } else {
+      source.Write(output_name);
+    }
+    if (verbose) cout << " done" << endl;
   }
-  if (verbose) cout << " done" << endl;
 
   return 0;
 }
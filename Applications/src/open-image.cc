@@ -49,6 +49,8 @@ void PrintHelp(const char *name)
   cout << "Optional arguments:\n";
   cout << "  -iterations <n>     Number of dilation/erosion iterations. (default: 1)\n";
   cout << "  -connectivity <n>   Type of voxel connectivity (4, 6, 18, or 26). (default: 26)\n";
+  cout << "  -radius <r>         Radius of ball structuring element in mm. When specified, the input\n";
+  cout << "                      image is treated as binary mask and the iterations are ignored.\n";
   PrintStandardOptions(cout);
   cout << "\n";
   cout.flush();
@@ -60,10 +62,15 @@ void PrintHelp(const char *name)
 
 // -----------------------------------------------------------------------------
 template <class TVoxel>
-void Open(BaseImage *image, int iterations, ConnectivityType connectivity)
+void Open(BaseImage *image, int iterations, ConnectivityType connectivity, double radius)
 {
-  Erode <TVoxel>(image, iterations, connectivity);
-  Dilate<TVoxel>(image, iterations, connectivity);
+  if (radius > .0) {
+    Erode <TVoxel>(image, radius);
+    Dilate<TVoxel>(image, radius);
+  } else {
+    Erode <TVoxel>(image, iterations, connectivity);
+    Dilate<TVoxel>(image, iterations, connectivity);
+  }
 }
 
 // =============================================================================
@@ -80,6 +87,7 @@ int main(int argc, char *argv[])
 
   int              iterations   = 1;
   ConnectivityType connectivity = CONNECTIVITY_26;
+  double           radius       = .0;
 
   for (ALL_OPTIONS) {
     if (OPTION("-iterations") || OPTION("-iter")) {
@@ -88,6 +96,9 @@ int main(int argc, char *argv[])
     else if (OPTION("-connectivity") || OPTION("-neighbors") || OPTION("-number-of-neighbors")) {
       PARSE_ARGUMENT(connectivity);
     }
+    else if (OPTION("-radius")) {
+      PARSE_ARGUMENT(radius);
+    }
     else HANDLE_COMMON_OR_UNKNOWN_OPTION();
   }
 
@@ -96,9 +107,9 @@ int main(int argc, char *argv[])
 
   if (verbose) cout << "Opening ... ", cout.flush();
   switch (image->GetDataType()) {
-    case MIRTK_VOXEL_BINARY:  Open<BinaryPixel>(image.get(), iterations, connectivity); break;
-    case MIRTK_VOXEL_GREY:    Open<GreyPixel  >(image.get(), iterations, connectivity); break;
-    case MIRTK_VOXEL_REAL:    Open<RealPixel  >(image.get(), iterations, connectivity); break;
+    case MIRTK_VOXEL_BINARY:  Open<BinaryPixel>(image.get(), iterations, connectivity, radius); break;
+    case MIRTK_VOXEL_GREY:    Open<GreyPixel  >(image.get(), iterations, connectivity, radius); break;
+    case MIRTK_VOXEL_REAL:    Open<RealPixel  >(image.get(), iterations, connectivity, radius); break;
     default:
       FatalError("Unsupported voxel type: " << ToString(image->GetDataType()));
   }
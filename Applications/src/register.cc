@@ -246,6 +246,10 @@ void PrintHelp(const char* name)
   cout << "      Alias for :option:`-levels` <n> <n> which only performs the registration on a single level.\n";
   cout << "  -bg, -background, -padding <value>\n";
   cout << "      \"Background value\" (threshold) of input and output images (default: none)\n";
+  cout << "  -pyramid-cache <dir>\n";
+  cout << "      \"Image pyramid cache\" directory. The resolution pyramids of the input images are\n";
+  cout << "      written to files in this directory and reused by subsequent runs with identical input\n";
+  cout << "      image and pyramid settings, e.g., when registering an atlas to many subjects. (default: none)\n";
   cout << "  -ds <width>\n";
   cout << "      \"Control point spacing\" of free-form deformation on highest resolution level. (default: 4x min voxel size)\n";
   cout << "  -be <w>\n";
@@ -893,6 +897,9 @@ int main(int argc, char **argv)
       PARSE_ARGUMENT(v);
       Insert(params, "Background value", v);
     }
+    else if (OPTION("-pyramid-cache")) {
+      Insert(params, "Image pyramid cache", ARGUMENT);
+    }
     // Unknown option
     else HANDLE_COMMON_OR_UNKNOWN_OPTION();
   }
@@ -64,6 +64,9 @@ void PrintHelp(const char *name)
   cout << "  -z       Blur image in z dimension." << endl;
   cout << "  -short   Set data type of output to short integers." << endl;
   cout << "  -float   Set data type of output to floating point." << endl;
+  cout << "  -recursive" << endl;
+  cout << "           Use recursive Gaussian filter whose cost is independent of sigma." << endl;
+  cout << "           Recommended for large sigma values. (default: off)" << endl;
   PrintCommonOptions(cout);
   cout << endl;
 }
@@ -114,6 +117,7 @@ int main(int argc, char *argv[])
   InitializeIOLibrary();
   UniquePtr<ImageReader> reader(ImageReader::New(input_name));
   int data_type = reader->DataType();
+  bool recursive = false;
 
   // Parse and discard options
   DISCARD_PARSED_OPTIONS();
@@ -121,6 +125,7 @@ int main(int argc, char *argv[])
   for (ALL_OPTIONS) {
     if      (OPTION("-short")) data_type = MIRTK_VOXEL_SHORT;
     else if (OPTION("-float")) data_type = MIRTK_VOXEL_FLOAT;
+    else HANDLE_BOOLEAN_OPTION("recursive", recursive);
     else HANDLE_COMMON_OPTION();
   }
 
@@ -139,6 +144,7 @@ int main(int argc, char *argv[])
       GaussianBlurring<RealPixel> blur(
         sigma < 0. ? abs(sigma) * (input.XSize() + input.YSize() + input.ZSize()) / 3. : sigma
       );
+      blur.Recursive(recursive);
       blur.Input (&input);
       blur.Output(&input);
       blur.Run();
@@ -147,24 +153,28 @@ int main(int argc, char *argv[])
       GaussianBlurring<RealPixel> blur(
         sigma < 0. ? abs(sigma) * (input.XSize() + input.YSize() + input.ZSize() + input.TSize()) / 4. : sigma
       );
+      blur.Recursive(recursive);
       blur.Input (&input);
       blur.Output(&input);
       blur.Run();
     } else if (OPTION("-x") || OPTION("-X")) {
       default_blurring = false;
       GaussianBlurring<RealPixel> blur(sigma < 0. ? abs(sigma) * input.XSize() : sigma);
+      blur.Recursive(recursive);
       blur.Input (&input);
       blur.Output(&input);
       blur.RunX();
     } else if (OPTION("-y") || OPTION("-Y")) {
       default_blurring = false;
       GaussianBlurring<RealPixel> blur(sigma < 0. ? abs(sigma) * input.YSize() : sigma);
+      blur.Recursive(recursive);
       blur.Input (&input);
       blur.Output(&input);
       blur.RunY();
     } else if (OPTION("-z") || OPTION("-Z")) {
       default_blurring = false;
       GaussianBlurring<RealPixel> blur(sigma < 0. ? abs(sigma) * input.ZSize() : sigma);
+      blur.Recursive(recursive);
       blur.Input (&input);
       blur.Output(&input);
       blur.RunZ();
@@ -179,6 +189,7 @@ int main(int argc, char *argv[])
     GaussianBlurring<RealPixel> blur(
       sigma < 0. ? abs(sigma) * (input.XSize() + input.YSize() + input.ZSize()) / 3. : sigma
     );
+    blur.Recursive(recursive);
     blur.Input (&input);
     blur.Output(&input);
     blur.Run();
@@ -1772,12 +1772,10 @@ int main(int argc, char *argv[])
       input(vox) = (mask(vox) != 0 ? 0. : 1.);
     }
     EuclideanDistanceTransform<RealPixel> filter;
+    filter.OutputDistance(EuclideanDistanceTransform<RealPixel>::DT_Distance);
     filter.Input (&input);
     filter.Output(&output);
     filter.Run();
-    for (int vox = 0; vox < nvox; ++vox) {
-      output(vox) = sqrt(output(vox));
-    }
 
     output.Write(depth_name);
   }
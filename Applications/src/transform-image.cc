@@ -31,6 +31,7 @@
 #include "mirtk/HomogeneousTransformation.h"
 #include "mirtk/RigidTransformation.h"
 #include "mirtk/ImageTransformation.h"
+#include "mirtk/TransformationCompiler.h"
 #include "mirtk/InterpolateImageFunction.h"
 #include "mirtk/ResamplingWithPadding.h"
 #include "mirtk/NearestNeighborInterpolateImageFunction.h"
@@ -76,6 +77,18 @@ void PrintHelp(const char *name)
   cout << "      option -invdof/-dofin_i before each argument.\n";
   cout << "  -invert [on|off], -noinvert\n";
   cout << "      Enable/disable inversion of composite transformation. (default: off)\n";
+  cout << "  -compile <file>\n";
+  cout << "      Write composite transformation compiled into a single FFD on the output\n";
+  cout << "      image grid. By default, this FFD is a dense displacement field, i.e., a\n";
+  cout << "      linear FFD with one control point per output voxel. When given as\n";
+  cout << "      :option:`-dofin` argument for other images with the same :option:`-target`\n";
+  cout << "      grid, only a single interpolation per voxel is required. The compilation\n";
+  cout << "      error at the voxel cell centers is reported when :option:`-verbose`.\n";
+  cout << "      (default: none)\n";
+  cout << "  -compile-spacing <ds>\n";
+  cout << "      Approximate composite transformation written to :option:`-compile` file\n";
+  cout << "      by a cubic B-spline FFD with the given control point spacing instead.\n";
+  cout << "      (default: 0, dense displacement field)\n";
   cout << "  -interpolation, -interp <mode>\n";
   cout << "      Interpolation mode: (default: Linear)\n";
   for (int i = 1; i < Interpolation_Last; ++i) {
@@ -201,21 +214,50 @@ int ReduceTransformations(const ImageAttributes &target_attr,
     ImageAttributes attr = target_attr;
     attr.PutAffineMatrix(global->GetMatrix() * target_attr._smat, true);
     global.reset();  // included in image to world map
+    // FIXME: Need to maintain binary mask to be able to determine unique no.
+    //        of target voxels for which no complete inverse could be found.
     local.reset(new ImageTransformationCache(attr));
+    TransformationCompiler compiler;
+    compiler.SourceTime(source_attr._torigin);
+    compiler.TargetTime(target_attr._torigin);
     for (int i = pre_last + 1; i < static_cast<int>(dof.size()); ++i) {
-      if (inv[i]) {
-        // FIXME: Need to maintain binary mask to be able to determine unique no.
-        //        of target voxels for which no complete inverse could be found.
-        nsingular += dof[i]->InverseDisplacement(*local, source_attr._torigin, target_attr._torigin);
-      } else {
-        dof[i]->Displacement(*local, source_attr._torigin, target_attr._torigin);
-      }
+      compiler.Add(dof[i].get(), inv[i]);
     }
-    local->Modified(false);
+    compiler.Compile(*local);
+    nsingular = compiler.NumberOfSingularPoints();
   }
   return nsingular;
 }
 
+// ---------------------------------------------------------------------------
+/// Compile composite transformation into single FFD and write it to file
+void WriteCompiledTransformation(const char *fname,
+                                 const ImageAttributes &target_attr,
+                                 const ImageAttributes &source_attr,
+                                 const Array<UniquePtr<Transformation> > &dof,
+                                 const Array<bool> &inv, double ds)
+{
+  if (verbose) {
+    cout << "Compiling composite transformation...";
+    cout.flush();
+  }
+  TransformationCompiler compiler;
+  compiler.SourceTime(source_attr._torigin);
+  compiler.TargetTime(target_attr._torigin);
+  compiler.EvaluateError(verbose > 0);
+  for (size_t i = 0; i < dof.size(); ++i) {
+    compiler.Add(dof[i].get(), inv[i]);
+  }
+  UniquePtr<FreeFormTransformation> ffd;
+  if (ds > .0) ffd.reset(compiler.Compile(target_attr, ds, ds, ds));
+  else         ffd.reset(compiler.Compile(target_attr));
+  if (verbose) {
+    cout << " done\n";
+    compiler.Print(cout, 1);
+  }
+  ffd->Write(fname);
+}
+
 // ---------------------------------------------------------------------------
 struct ComposeImageToWorldWithAffineMap
 {
@@ -492,6 +534,8 @@ int main(int argc, char **argv)
   ImageDataType     dtype         = MIRTK_VOXEL_UNKNOWN;
   double            spacing[3]    = {0., 0., 0.};
   bool              all_labels    = false;
+  const char       *compile_name  = nullptr;
+  double            compile_ds    = .0;
   OrderedSet<GreyPixel> labels;
 
   double target_t = NaN;
@@ -522,6 +566,12 @@ int main(int argc, char **argv)
     else if (OPTION("-target")) {
       target_name = ARGUMENT;
     }
+    else if (OPTION("-compile")) {
+      compile_name = ARGUMENT;
+    }
+    else if (OPTION("-compile-spacing")) {
+      PARSE_ARGUMENT(compile_ds);
+    }
     else if (OPTION("-target-affdof")) {
       tgtdof_name   = ARGUMENT;
       tgtdof_invert = false;
@@ -752,6 +802,12 @@ int main(int argc, char **argv)
 
     interpolator->DefaultValue(source_padding);
 
+    // Write compiled composite transformation
+    if (compile_name) {
+      WriteCompiledTransformation(compile_name, target->Attributes(), source->Attributes(),
+                                  dofs, dofin_invert, compile_ds);
+    }
+
     if (dofs.size() == 1) {
 
       // Transform source intensity image
@@ -863,6 +919,12 @@ int main(int argc, char **argv)
       attr.PutAffineMatrix(source.GetAffineMatrix(), affdof_apply);
     }
 
+    // Write compiled composite transformation
+    if (compile_name) {
+      WriteCompiledTransformation(compile_name, attr, source.Attributes(),
+                                  dofs, dofin_invert, compile_ds);
+    }
+
     // Transform source segmentation using NN interpolation
     if (interpolation == Interpolation_NN) {
 
@@ -0,0 +1,279 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmark.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Random.h"
+#include "mirtk/Algorithm.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/BSplineFreeFormTransformation3D.h"
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Registry
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+Array<UniquePtr<Benchmark> > &Benchmarks()
+{
+  static Array<UniquePtr<Benchmark> > benchmarks;
+  return benchmarks;
+}
+
+// =============================================================================
+// Synthetic input data
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+ImageAttributes SyntheticDomain(int size)
+{
+  ImageAttributes domain(size, size, size, 1.0, 1.0, 1.0);
+  domain._xorigin = domain._yorigin = domain._zorigin = .0;
+  return domain;
+}
+
+// -----------------------------------------------------------------------------
+namespace BenchmarkUtils {
+
+/// Add Gaussian blob to image
+template <class TVoxel>
+class AddBlobs
+{
+  GenericImage<TVoxel> *_Image;
+  const Array<double>  *_Blobs;
+
+public:
+
+  AddBlobs(GenericImage<TVoxel> *image, const Array<double> *blobs)
+  :
+    _Image(image), _Blobs(blobs)
+  {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int    nx  = _Image->X();
+    const int    ny  = _Image->Y();
+    const int    nb  = static_cast<int>(_Blobs->size() / 5);
+    const double *b  = _Blobs->data();
+    double value, d2;
+    for (int k = re.begin(); k != re.end(); ++k)
+    for (int j = 0; j < ny; ++j)
+    for (int i = 0; i < nx; ++i) {
+      value = _Image->Get(i, j, k);
+      for (int n = 0; n < nb; ++n) {
+        d2 = pow(i - b[5*n], 2) + pow(j - b[5*n+1], 2) + pow(k - b[5*n+2], 2);
+        value += b[5*n+4] * exp(-.5 * d2 / pow(b[5*n+3], 2));
+      }
+      _Image->Put(i, j, k, voxel_cast<TVoxel>(min(value, 100.0)));
+    }
+  }
+};
+
+
+} // namespace BenchmarkUtils
+using namespace BenchmarkUtils;
+
+// -----------------------------------------------------------------------------
+template <class TVoxel>
+void SyntheticImage(GenericImage<TVoxel> &image, const ImageAttributes &domain, int seed)
+{
+  mt19937 rng(seed);
+  uniform_real_distribution<double> uniform(.0, 1.0);
+
+  image.Initialize(domain, 1);
+
+  const int n = image.NumberOfVoxels();
+  for (int vox = 0; vox < n; ++vox) {
+    image.Put(vox, voxel_cast<TVoxel>(10.0 * uniform(rng)));
+  }
+
+  const int    nblobs  = 16;
+  const double extent  = max(max(domain._x, domain._y), domain._z);
+  Array<double> blobs(5 * nblobs);
+  for (int b = 0; b < nblobs; ++b) {
+    blobs[5*b  ] = uniform(rng) * (domain._x - 1);
+    blobs[5*b+1] = uniform(rng) * (domain._y - 1);
+    blobs[5*b+2] = uniform(rng) * (domain._z - 1);
+    blobs[5*b+3] = extent * (.05 + .1 * uniform(rng));
+    blobs[5*b+4] = 30.0 + 60.0 * uniform(rng);
+  }
+  parallel_for(blocked_range<int>(0, image.Z()), AddBlobs<TVoxel>(&image, &blobs));
+}
+
+template void SyntheticImage(GenericImage<float>  &, const ImageAttributes &, int);
+template void SyntheticImage(GenericImage<double> &, const ImageAttributes &, int);
+
+// -----------------------------------------------------------------------------
+void SyntheticDeformation(BSplineFreeFormTransformation3D &ffd,
+                          const ImageAttributes &domain, double spacing,
+                          double magnitude, int seed)
+{
+  mt19937 rng(seed);
+  uniform_real_distribution<double> uniform(-magnitude, magnitude);
+  ffd.Initialize(domain, spacing, spacing, spacing);
+  for (int cp = 0; cp < ffd.NumberOfCPs(); ++cp) {
+    ffd.Put(cp, uniform(rng), uniform(rng), uniform(rng));
+  }
+}
+
+// =============================================================================
+// Timing results
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+double BenchmarkResult::Min() const
+{
+  return _Time.empty() ? .0 : *min_element(_Time.begin(), _Time.end());
+}
+
+// -----------------------------------------------------------------------------
+double BenchmarkResult::Median() const
+{
+  if (_Time.empty()) return .0;
+  Array<double> t(_Time);
+  sort(t.begin(), t.end());
+  const size_t n = t.size();
+  return (n % 2 == 1) ? t[n / 2] : .5 * (t[n / 2 - 1] + t[n / 2]);
+}
+
+// -----------------------------------------------------------------------------
+double BenchmarkResult::Mean() const
+{
+  if (_Time.empty()) return .0;
+  double sum = .0;
+  for (size_t i = 0; i < _Time.size(); ++i) sum += _Time[i];
+  return sum / _Time.size();
+}
+
+// -----------------------------------------------------------------------------
+double BenchmarkResult::StdDev() const
+{
+  if (_Time.size() < 2) return .0;
+  const double mean = Mean();
+  double var = .0;
+  for (size_t i = 0; i < _Time.size(); ++i) var += pow(_Time[i] - mean, 2);
+  return sqrt(var / (_Time.size() - 1));
+}
+
+// -----------------------------------------------------------------------------
+double BenchmarkResult::Throughput() const
+{
+  const double t = Median();
+  return (t > .0 ? 1e-6 * _NumberOfElements / t : .0);
+}
+
+// -----------------------------------------------------------------------------
+void WriteTable(ostream &os, const Array<BenchmarkResult> &results)
+{
+  size_t width = 48;
+  for (size_t i = 0; i < results.size(); ++i) {
+    width = max(width, results[i]._Name.length() + 2);
+  }
+  const ios::fmtflags flags = os.flags();
+  os << left << setw(static_cast<int>(width)) << "Benchmark" << right
+     << setw(6)  << "Size"
+     << setw(9)  << "Threads"
+     << setw(12) << "Min [ms]"
+     << setw(12) << "Median [ms]"
+     << setw(12) << "Mean [ms]"
+     << setw(12) << "StdDev [ms]"
+     << setw(12) << "MElem/s" << "\n";
+  os << fixed;
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult &r = results[i];
+    os << left << setw(static_cast<int>(width)) << r._Name << right
+       << setw(6)  << r._Size
+       << setw(9)  << r._NumberOfThreads
+       << setprecision(3)
+       << setw(12) << 1e3 * r.Min()
+       << setw(12) << 1e3 * r.Median()
+       << setw(12) << 1e3 * r.Mean()
+       << setw(12) << 1e3 * r.StdDev()
+       << setprecision(2)
+       << setw(12) << r.Throughput() << "\n";
+  }
+  os.flags(flags);
+  os.flush();
+}
+
+// -----------------------------------------------------------------------------
+void WriteCSV(ostream &os, const Array<BenchmarkResult> &results)
+{
+  const ios::fmtflags flags = os.flags();
+  os << "benchmark,size,threads,elements,repetitions,min_ms,median_ms,mean_ms,stddev_ms,melements_per_s\n";
+  os << setprecision(6);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult &r = results[i];
+    os << r._Name << ","
+       << r._Size << ","
+       << r._NumberOfThreads << ","
+       << static_cast<long>(r._NumberOfElements) << ","
+       << r._Time.size() << ","
+       << 1e3 * r.Min() << ","
+       << 1e3 * r.Median() << ","
+       << 1e3 * r.Mean() << ","
+       << 1e3 * r.StdDev() << ","
+       << r.Throughput() << "\n";
+  }
+  os.flags(flags);
+  os.flush();
+}
+
+// -----------------------------------------------------------------------------
+void WriteJSON(ostream &os, const Array<BenchmarkResult> &results)
+{
+  const ios::fmtflags flags = os.flags();
+  os << "{\n";
+  #ifdef HAVE_TBB
+    os << "  \"tbb\": true,\n";
+  #else
+    os << "  \"tbb\": false,\n";
+  #endif
+  os << "  \"results\": [";
+  os << setprecision(6);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult &r = results[i];
+    os << (i > 0 ? "," : "") << "\n    {";
+    os << "\"benchmark\": \"" << r._Name << "\", ";
+    os << "\"size\": " << r._Size << ", ";
+    os << "\"threads\": " << r._NumberOfThreads << ", ";
+    os << "\"elements\": " << static_cast<long>(r._NumberOfElements) << ", ";
+    os << "\"min_ms\": " << 1e3 * r.Min() << ", ";
+    os << "\"median_ms\": " << 1e3 * r.Median() << ", ";
+    os << "\"mean_ms\": " << 1e3 * r.Mean() << ", ";
+    os << "\"stddev_ms\": " << 1e3 * r.StdDev() << ", ";
+    os << "\"melements_per_s\": " << r.Throughput() << ", ";
+    os << "\"time_ms\": [";
+    for (size_t n = 0; n < r._Time.size(); ++n) {
+      if (n > 0) os << ", ";
+      os << 1e3 * r._Time[n];
+    }
+    os << "]}";
+  }
+  os << "\n  ]\n}\n";
+  os.flags(flags);
+  os.flush();
+}
+
+
+} // namespace mirtk
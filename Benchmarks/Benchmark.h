@@ -0,0 +1,158 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_Benchmark_H
+#define MIRTK_Benchmark_H
+
+#include "mirtk/Array.h"
+#include "mirtk/String.h"
+#include "mirtk/Stream.h"
+#include "mirtk/Memory.h"
+#include "mirtk/ImageAttributes.h"
+#include "mirtk/GenericImage.h"
+
+
+namespace mirtk {
+
+
+class BSplineFreeFormTransformation3D;
+
+
+// =============================================================================
+// Benchmark interface
+// =============================================================================
+
+/**
+ * Base class of micro-benchmarks of core library kernels
+ *
+ * A benchmark prepares its input data for a cubic volume of a given edge
+ * length in SetUp, and executes the timed kernel in Run. The benchmark
+ * driver calls Run repeatedly for each requested image size and number
+ * of threads. Only the execution of Run is timed.
+ */
+class Benchmark
+{
+public:
+
+  /// Destructor
+  virtual ~Benchmark() {}
+
+  /// Unique name of benchmark
+  virtual const char *Name() const = 0;
+
+  /// Prepare input data for cubic image domain with given edge length
+  virtual void SetUp(int) = 0;
+
+  /// Execute timed kernel
+  virtual void Run() = 0;
+
+  /// Release input data
+  virtual void TearDown() {}
+
+  /// Number of elements (e.g., voxels) processed by each Run
+  virtual double NumberOfElements() const = 0;
+};
+
+/// Registered benchmarks in order of registration
+Array<UniquePtr<Benchmark> > &Benchmarks();
+
+/// Add benchmark to list of registered benchmarks during static initialization
+struct BenchmarkRegistration
+{
+  BenchmarkRegistration(Benchmark *benchmark)
+  {
+    Benchmarks().push_back(UniquePtr<Benchmark>(benchmark));
+  }
+};
+
+/// Register benchmark class with benchmark driver
+#define mirtkRegisterBenchmarkMacro(type) \
+  static mirtk::BenchmarkRegistration type##Registration(new type())
+
+// =============================================================================
+// Synthetic input data
+// =============================================================================
+
+/// Cubic image domain with unit voxel size centered at the origin
+ImageAttributes SyntheticDomain(int size);
+
+/// Initialize image with smooth random blobs and uniform noise
+///
+/// The image intensities are in the range [0, 100]. The same seed always
+/// generates the same image such that timings are repeatable.
+///
+/// \param[out] image  Synthetic image.
+/// \param[in]  domain Image domain.
+/// \param[in]  seed   Seed of random number generator.
+template <class TVoxel>
+void SyntheticImage(GenericImage<TVoxel> &image, const ImageAttributes &domain, int seed = 0);
+
+/// Initialize cubic B-spline FFD with random control point displacements
+///
+/// \param[out] ffd       Free-form deformation.
+/// \param[in]  domain    Image domain.
+/// \param[in]  spacing   Control point spacing.
+/// \param[in]  magnitude Maximum control point displacement.
+/// \param[in]  seed      Seed of random number generator.
+void SyntheticDeformation(BSplineFreeFormTransformation3D &ffd,
+                          const ImageAttributes &domain, double spacing,
+                          double magnitude, int seed = 0);
+
+// =============================================================================
+// Timing results
+// =============================================================================
+
+/// Timings of one benchmark for a given image size and number of threads
+struct BenchmarkResult
+{
+  string _Name;             ///< Name of benchmark
+  int    _Size;             ///< Edge length of cubic image domain
+  int    _NumberOfThreads;  ///< Maximum number of threads
+  double _NumberOfElements; ///< Number of processed elements per repetition
+  Array<double> _Time;      ///< Wall clock time of each repetition in seconds
+
+  /// Minimum time of all repetitions
+  double Min() const;
+
+  /// Median time of all repetitions
+  double Median() const;
+
+  /// Mean time of all repetitions
+  double Mean() const;
+
+  /// Standard deviation of time of all repetitions
+  double StdDev() const;
+
+  /// Throughput in million elements per second based on median time
+  double Throughput() const;
+};
+
+/// Write results as human readable table
+void WriteTable(ostream &, const Array<BenchmarkResult> &);
+
+/// Write results as comma separated values
+void WriteCSV(ostream &, const Array<BenchmarkResult> &);
+
+/// Write results as JSON document
+void WriteJSON(ostream &, const Array<BenchmarkResult> &);
+
+
+} // namespace mirtk
+
+#endif // MIRTK_Benchmark_H
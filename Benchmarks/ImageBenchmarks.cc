@@ -0,0 +1,137 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmark.h"
+
+#include "mirtk/Parallel.h"
+#include "mirtk/GaussianBlurring.h"
+#include "mirtk/FastCubicBSplineInterpolateImageFunction.h"
+
+using namespace mirtk;
+
+
+// =============================================================================
+// GaussianBlurring
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Isotropic Gaussian blurring of floating point image
+class GaussianBlurringBenchmark : public Benchmark
+{
+  RealImage _Input;
+  RealImage _Output;
+
+public:
+
+  const char *Name() const { return "GaussianBlurring"; }
+
+  void SetUp(int size)
+  {
+    SyntheticImage(_Input, SyntheticDomain(size));
+    _Output.Initialize(_Input.Attributes());
+  }
+
+  void Run()
+  {
+    GaussianBlurring<RealPixel> blur(2.0);
+    blur.Input (&_Input);
+    blur.Output(&_Output);
+    blur.Run();
+  }
+
+  void TearDown()
+  {
+    _Input .Clear();
+    _Output.Clear();
+  }
+
+  double NumberOfElements() const
+  {
+    return _Input.NumberOfVoxels();
+  }
+};
+
+mirtkRegisterBenchmarkMacro(GaussianBlurringBenchmark);
+
+// =============================================================================
+// FastCubicBSplineInterpolateImageFunction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Resampling of image on grid shifted by a fraction of a voxel
+class FastCubicBSplineInterpolationBenchmark : public Benchmark
+{
+  typedef GenericFastCubicBSplineInterpolateImageFunction<RealImage> InterpolatorType;
+
+  RealImage        _Input;
+  RealImage        _Output;
+  InterpolatorType _Interpolator;
+
+  struct Resample
+  {
+    const InterpolatorType *_Interpolator;
+    RealImage              *_Output;
+
+    void operator ()(const blocked_range<int> &re) const
+    {
+      const int nx = _Output->X();
+      const int ny = _Output->Y();
+      for (int k = re.begin(); k != re.end(); ++k)
+      for (int j = 0; j < ny; ++j)
+      for (int i = 0; i < nx; ++i) {
+        _Output->Put(i, j, k, static_cast<RealPixel>(
+          _Interpolator->Evaluate(i + .37, j + .59, k + .21)
+        ));
+      }
+    }
+  };
+
+public:
+
+  const char *Name() const { return "FastCubicBSplineInterpolation"; }
+
+  void SetUp(int size)
+  {
+    SyntheticImage(_Input, SyntheticDomain(size));
+    _Output.Initialize(_Input.Attributes());
+    _Interpolator.Input(&_Input);
+    _Interpolator.Initialize();
+  }
+
+  void Run()
+  {
+    Resample body;
+    body._Interpolator = &_Interpolator;
+    body._Output       = &_Output;
+    parallel_for(blocked_range<int>(0, _Output.Z()), body);
+  }
+
+  void TearDown()
+  {
+    _Input .Clear();
+    _Output.Clear();
+  }
+
+  double NumberOfElements() const
+  {
+    return _Output.NumberOfVoxels();
+  }
+};
+
+mirtkRegisterBenchmarkMacro(FastCubicBSplineInterpolationBenchmark);
@@ -0,0 +1,82 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmark.h"
+
+#include "mirtk/BSplineFreeFormTransformation3D.h"
+#include "mirtk/RegisteredImage.h"
+#include "mirtk/NormalizedMutualImageInformation.h"
+
+using namespace mirtk;
+
+
+// =============================================================================
+// NormalizedMutualImageInformation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Update of deformed source image, joint histogram and NMI value
+class NormalizedMutualImageInformationBenchmark : public Benchmark
+{
+  RegisteredImage::InputImageType  _Target;
+  RegisteredImage::InputImageType  _Source;
+  BSplineFreeFormTransformation3D  _FFD;
+  UniquePtr<NormalizedMutualImageInformation> _Similarity;
+
+public:
+
+  const char *Name() const { return "NormalizedMutualImageInformation"; }
+
+  void SetUp(int size)
+  {
+    const ImageAttributes domain = SyntheticDomain(size);
+    SyntheticImage(_Target, domain, 1);
+    SyntheticImage(_Source, domain, 2);
+    SyntheticDeformation(_FFD, domain, 4.0, 2.0);
+    _Similarity.reset(new NormalizedMutualImageInformation());
+    _Similarity->Domain(domain);
+    _Similarity->Target()->InputImage(&_Target);
+    _Similarity->Source()->InputImage(&_Source);
+    _Similarity->Source()->Transformation(&_FFD);
+    _Similarity->Source()->InterpolationMode(Interpolation_FastCubicBSpline);
+    _Similarity->Initialize();
+    _Similarity->Update(false);
+  }
+
+  void Run()
+  {
+    _Similarity->Update(false);
+    _Similarity->ResetValue();
+    _Similarity->Value();
+  }
+
+  void TearDown()
+  {
+    _Similarity.reset();
+    _Target.Clear();
+    _Source.Clear();
+  }
+
+  double NumberOfElements() const
+  {
+    return _Target.NumberOfSpatialVoxels();
+  }
+};
+
+mirtkRegisterBenchmarkMacro(NormalizedMutualImageInformationBenchmark);
@@ -0,0 +1,169 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmark.h"
+
+#include "mirtk/BSplineFreeFormTransformation3D.h"
+#include "mirtk/RegisteredImage.h"
+
+using namespace mirtk;
+
+
+// =============================================================================
+// BSplineFreeFormTransformation3D
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Evaluation of dense displacement field of cubic B-spline FFD
+class BSplineFFDDisplacementBenchmark : public Benchmark
+{
+  BSplineFreeFormTransformation3D _FFD;
+  GenericImage<double>            _Displacement;
+
+public:
+
+  const char *Name() const { return "BSplineFreeFormTransformation3D::Displacement"; }
+
+  void SetUp(int size)
+  {
+    const ImageAttributes domain = SyntheticDomain(size);
+    SyntheticDeformation(_FFD, domain, 4.0, 2.0);
+    _Displacement.Initialize(domain, 3);
+  }
+
+  void Run()
+  {
+    _FFD.Displacement(_Displacement);
+  }
+
+  void TearDown()
+  {
+    _Displacement.Clear();
+  }
+
+  double NumberOfElements() const
+  {
+    return _Displacement.NumberOfSpatialVoxels();
+  }
+};
+
+mirtkRegisterBenchmarkMacro(BSplineFFDDisplacementBenchmark);
+
+// -----------------------------------------------------------------------------
+/// Conversion of voxel-wise similarity gradient to gradient w.r.t. control points
+template <BSplineFreeFormTransformation3D::ParametricGradientType Method>
+class BSplineFFDParametricGradientBenchmark : public Benchmark
+{
+  BSplineFreeFormTransformation3D _FFD;
+  GenericImage<double>            _Gradient;
+  Array<double>                   _Output;
+
+public:
+
+  const char *Name() const
+  {
+    if (Method == BSplineFreeFormTransformation3D::PG_Analytic) {
+      return "BSplineFreeFormTransformation3D::ParametricGradient (Analytic)";
+    }
+    return "BSplineFreeFormTransformation3D::ParametricGradient";
+  }
+
+  void SetUp(int size)
+  {
+    const ImageAttributes domain = SyntheticDomain(size);
+    SyntheticDeformation(_FFD, domain, 4.0, 2.0);
+    _FFD.ParametricGradientCalculation(Method);
+    _Gradient.Initialize(domain, 3);
+    GenericImage<double> channel;
+    for (int c = 0; c < 3; ++c) {
+      SyntheticImage(channel, domain, c + 1);
+      memcpy(_Gradient.Data(0, 0, 0, c), channel.Data(), channel.NumberOfVoxels() * sizeof(double));
+    }
+    _Output.resize(_FFD.NumberOfDOFs());
+  }
+
+  void Run()
+  {
+    fill(_Output.begin(), _Output.end(), .0);
+    _FFD.ParametricGradient(&_Gradient, _Output.data());
+  }
+
+  void TearDown()
+  {
+    _Gradient.Clear();
+    _Output.clear();
+  }
+
+  double NumberOfElements() const
+  {
+    return _Gradient.NumberOfSpatialVoxels();
+  }
+};
+
+typedef BSplineFFDParametricGradientBenchmark<BSplineFreeFormTransformation3D::PG_Default>  BSplineFFDParametricGradientDefaultBenchmark;
+typedef BSplineFFDParametricGradientBenchmark<BSplineFreeFormTransformation3D::PG_Analytic> BSplineFFDParametricGradientAnalyticBenchmark;
+
+mirtkRegisterBenchmarkMacro(BSplineFFDParametricGradientDefaultBenchmark);
+mirtkRegisterBenchmarkMacro(BSplineFFDParametricGradientAnalyticBenchmark);
+
+// =============================================================================
+// RegisteredImage
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Update of intensities and gradient of image deformed by cubic B-spline FFD
+class RegisteredImageUpdateBenchmark : public Benchmark
+{
+  RegisteredImage::InputImageType _Input;
+  BSplineFreeFormTransformation3D _FFD;
+  RegisteredImage                 _Image;
+
+public:
+
+  const char *Name() const { return "RegisteredImage::Update"; }
+
+  void SetUp(int size)
+  {
+    const ImageAttributes domain = SyntheticDomain(size);
+    SyntheticImage(_Input, domain);
+    SyntheticDeformation(_FFD, domain, 4.0, 2.0);
+    _Image.InputImage(&_Input);
+    _Image.Transformation(&_FFD);
+    _Image.InterpolationMode(Interpolation_FastCubicBSpline);
+    _Image.Initialize(domain, 4);
+  }
+
+  void Run()
+  {
+    _Image.Update(true, true, false, true);
+  }
+
+  void TearDown()
+  {
+    _Image.Clear();
+    _Input.Clear();
+  }
+
+  double NumberOfElements() const
+  {
+    return _Image.NumberOfVoxels();
+  }
+};
+
+mirtkRegisterBenchmarkMacro(RegisteredImageUpdateBenchmark);
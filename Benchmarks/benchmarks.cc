@@ -0,0 +1,224 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/Common.h"
+#include "mirtk/Options.h"
+#include "mirtk/Parallel.h"
+
+#include "Benchmark.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace mirtk;
+
+
+// =============================================================================
+// Help
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void PrintHelp(const char *name)
+{
+  cout << "\n";
+  cout << "Usage: " << name << " [options]\n";
+  cout << "\n";
+  cout << "Description:\n";
+  cout << "  Times core image, transformation and image similarity kernels on synthetic\n";
+  cout << "  cubic volumes for each combination of the specified image sizes and numbers\n";
+  cout << "  of threads. The synthetic input data is generated with a fixed seed such\n";
+  cout << "  that timings of different builds can be compared with each other.\n";
+  cout << "\n";
+  cout << "Options:\n";
+  cout << "  -list                  List names of available benchmarks and exit.\n";
+  cout << "  -filter <name>...      Only run benchmarks whose name contains any of the\n";
+  cout << "                         given strings. (default: all)\n";
+  cout << "  -size <n>...           Edge length of synthetic cubic volumes. (default: 64 128)\n";
+  cout << "  -thread-counts <n>...  Maximum numbers of threads. Ignored when built without\n";
+  cout << "                         TBB. (default: 1 and number of hardware threads)\n";
+  cout << "  -repetitions <n>       Number of timed repetitions. (default: 5)\n";
+  cout << "  -warmup <n>            Number of untimed repetitions before timing. (default: 1)\n";
+  cout << "  -format <fmt>          Output format, i.e., \"table\", \"csv\", or \"json\". (default: table)\n";
+  cout << "  -output <file>         Write results to named file instead of standard output.\n";
+  PrintStandardOptions(cout);
+  cout << endl;
+}
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Limit maximum number of threads used by parallel_for and parallel_reduce
+void SetNumberOfThreads(int n)
+{
+  #ifdef HAVE_TBB
+    tbb_scheduler.reset();
+    tbb_scheduler.reset(new task_scheduler_init(n));
+  #endif
+}
+
+// -----------------------------------------------------------------------------
+/// Whether benchmark matches any of the given name filters
+bool IsSelected(const Benchmark &benchmark, const Array<string> &filters)
+{
+  if (filters.empty()) return true;
+  const string name = benchmark.Name();
+  for (size_t i = 0; i < filters.size(); ++i) {
+    if (name.find(filters[i]) != string::npos) return true;
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+/// Time repeated execution of benchmark
+BenchmarkResult Time(Benchmark &benchmark, int size, int nthreads, int warmup, int repetitions)
+{
+  typedef std::chrono::steady_clock Clock;
+
+  BenchmarkResult result;
+  result._Name             = benchmark.Name();
+  result._Size             = size;
+  result._NumberOfThreads  = nthreads;
+  result._NumberOfElements = benchmark.NumberOfElements();
+
+  for (int n = 0; n < warmup; ++n) {
+    benchmark.Run();
+  }
+  result._Time.reserve(repetitions);
+  for (int n = 0; n < repetitions; ++n) {
+    const Clock::time_point start = Clock::now();
+    benchmark.Run();
+    const Clock::time_point end = Clock::now();
+    result._Time.push_back(std::chrono::duration<double>(end - start).count());
+  }
+  return result;
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  EXPECTS_POSARGS(0);
+
+  Array<string> filters;
+  Array<int>    sizes;
+  Array<int>    thread_counts;
+  int           repetitions = 5;
+  int           warmup      = 1;
+  string        format      = "table";
+  const char   *output_name = nullptr;
+  bool          list        = false;
+
+  for (ALL_OPTIONS) {
+    if (OPTION("-list")) list = true;
+    else if (OPTION("-filter")) {
+      do {
+        filters.push_back(ARGUMENT);
+      } while (HAS_ARGUMENT);
+    }
+    else if (OPTION("-size")) {
+      do {
+        int size;
+        PARSE_ARGUMENT(size);
+        if (size < 8) FatalError("Image size must be at least 8");
+        sizes.push_back(size);
+      } while (HAS_ARGUMENT);
+    }
+    else if (OPTION("-thread-counts")) {
+      do {
+        int n;
+        PARSE_ARGUMENT(n);
+        if (n < 1) FatalError("Number of threads must be positive");
+        thread_counts.push_back(n);
+      } while (HAS_ARGUMENT);
+    }
+    else if (OPTION("-repetitions")) PARSE_ARGUMENT(repetitions);
+    else if (OPTION("-warmup")) PARSE_ARGUMENT(warmup);
+    else if (OPTION("-format")) format = ToLower(ARGUMENT);
+    else if (OPTION("-output")) output_name = ARGUMENT;
+    else HANDLE_STANDARD_OR_UNKNOWN_OPTION();
+  }
+
+  if (list) {
+    for (size_t b = 0; b < Benchmarks().size(); ++b) {
+      cout << Benchmarks()[b]->Name() << "\n";
+    }
+    cout.flush();
+    return 0;
+  }
+
+  if (format != "table" && format != "csv" && format != "json") {
+    FatalError("Invalid -format argument: " << format);
+  }
+  if (repetitions < 1) {
+    FatalError("Number of repetitions must be positive");
+  }
+  if (sizes.empty()) {
+    sizes.push_back(64);
+    sizes.push_back(128);
+  }
+  #ifdef HAVE_TBB
+    if (thread_counts.empty()) {
+      thread_counts.push_back(1);
+      const int nmax = static_cast<int>(std::thread::hardware_concurrency());
+      if (nmax > 1) thread_counts.push_back(nmax);
+    }
+  #else
+    if (!thread_counts.empty() && verbose) {
+      Warning("Built without TBB, ignoring -thread-counts");
+    }
+    thread_counts.assign(1, 1);
+  #endif
+
+  // Run selected benchmarks
+  Array<BenchmarkResult> results;
+  for (size_t b = 0; b < Benchmarks().size(); ++b) {
+    Benchmark &benchmark = *Benchmarks()[b];
+    if (!IsSelected(benchmark, filters)) continue;
+    for (size_t s = 0; s < sizes.size(); ++s) {
+      benchmark.SetUp(sizes[s]);
+      for (size_t t = 0; t < thread_counts.size(); ++t) {
+        if (verbose) {
+          cerr << benchmark.Name() << ": size = " << sizes[s]
+               << ", threads = " << thread_counts[t] << endl;
+        }
+        SetNumberOfThreads(thread_counts[t]);
+        results.push_back(Time(benchmark, sizes[s], thread_counts[t], warmup, repetitions));
+      }
+      benchmark.TearDown();
+    }
+  }
+
+  // Write results
+  ofstream ofs;
+  if (output_name) {
+    ofs.open(output_name);
+    if (!ofs) FatalError("Failed to open output file: " << output_name);
+  }
+  ostream &os = (output_name ? static_cast<ostream &>(ofs) : cout);
+  if      (format == "csv")  WriteCSV  (os, results);
+  else if (format == "json") WriteJSON (os, results);
+  else                       WriteTable(os, results);
+
+  return 0;
+}
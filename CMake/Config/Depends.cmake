@@ -54,39 +54,3 @@
 
 # Directory with source files of third-party libraries
 set(MIRTK_THIRDPARTY_DIR "${MIRTK_SOURCE_DIR}/ThirdParty")
-
-
-# ------------------------------------------------------------------------------
-# libLBFGS (optional)
-set(LBFGS_SOURCE_DIR "${MIRTK_THIRDPARTY_DIR}/LBFGS")
-
-# Set default for WITH_LibLBFGS option
-if (NOT DEFINED WITH_LBFGS_DEFAULT AND EXISTS "${LBFGS_SOURCE_DIR}/CMakeLists.txt")
-  set(WITH_LBFGS_DEFAULT ON)
-endif ()
-
-# When third-party submodule is available and library is needed
-if ((DEFINED WITH_LBFGS AND WITH_LBFGS) OR (NOT DEFINED WITH_LBFGS AND WITH_LBFGS_DEFAULT))
-  basis_check_if_package_is_needed_by_modules(is_needed LBFGS)
-  if (is_needed AND EXISTS "${LBFGS_SOURCE_DIR}/CMakeLists.txt")
-    message(STATUS "Configuring module ThirdParty/LBFGS...")
-    set(LBFGS_INSTALL_HEADERS     FALSE)
-    set(LBFGS_INSTALL_STATIC_LIBS TRUE) # needed because of CMake install(EXPORT)
-    set(LBFGS_INSTALL_LIBRARY_DIR ${INSTALL_LIBRARY_DIR})
-    set(LBFGS_lib_TARGET_NAME     LibLBFGS)
-    basis_add_export_target(export_args ${LBFGS_lib_TARGET_NAME} FALSE ${LBFGS_INSTALL_STATIC_LIBS})
-    if (export_args)
-      list(GET export_args 1 LBFGS_EXPORT_NAME)
-    else ()
-      set(LBFGS_EXPORT_NAME)
-    endif ()
-    add_subdirectory("${LBFGS_SOURCE_DIR}" "${MIRTK_BINARY_DIR}/ThirdParty/LBFGS")
-    set_target_properties(${LBFGS_lib_TARGET_NAME} PROPERTIES OUTPUT_NAME MIRTKlbfgs)
-    set(LBFGS_FOUND       TRUE)
-    set(LBFGS_LIBRARIES   ${LBFGS_lib_TARGET_NAME})
-    set(LBFGS_INCLUDE_DIR "${LBFGS_SOURCE_DIR}/include")
-    set(LBFGS_DIR         "${MIRTK_BINARY_DIR}/ThirdParty/LBFGS")
-    message(STATUS "Configuring module ThirdParty/LBFGS... - done")
-  endif ()
-  unset(is_needed)
-endif ()
@@ -86,6 +86,11 @@ macro(mirtk_project_begin)
   if (WITH_PROFILING)
     add_definitions(-DMIRTK_WITH_PROFILING)
   endif ()
+  # Store registered image channels in single-precision (cf. Transformation/include/mirtk/RegisteredImage.h)
+  # The choice changes the layout of RegisteredImage and is therefore recorded
+  # in the configured mirtk/CommonConfig.h header instead of a compile definition
+  option(WITH_FLOAT_REGISTERED_IMAGE "Use single-precision for registered images of image similarity measures" OFF)
+  mark_as_advanced(WITH_FLOAT_REGISTERED_IMAGE)
   # Start BASIS project
   basis_project_begin()
 endmacro ()
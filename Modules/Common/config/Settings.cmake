@@ -40,6 +40,8 @@ basis_set_config_option(WITH_MATLAB_CONFIG "${MATLAB_FOUND}")
 basis_set_config_option(WITH_VTK_CONFIG    "${VTK_FOUND}")
 basis_set_config_option(WITH_ZLIB_CONFIG   "${ZLIB_FOUND}")
 
+basis_set_config_option(USE_FLOAT_REGISTERED_IMAGE_CONFIG "${WITH_FLOAT_REGISTERED_IMAGE}")
+
 configure_file(
   "${PROJECT_CONFIG_DIR}/config.h.in"
   "${BINARY_INCLUDE_DIR}/mirtk/CommonConfig.h"
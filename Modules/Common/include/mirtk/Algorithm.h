@@ -41,6 +41,7 @@ using std::sort;
 using std::stable_sort;
 using std::partial_sort;
 using std::nth_element;
+using std::partition;
 using std::reverse;
 using std::shuffle;
 using std::set_intersection;
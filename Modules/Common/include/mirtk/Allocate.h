@@ -22,6 +22,19 @@
 
 #include "mirtk/Exception.h"
 
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#if defined(_MSC_VER)
+#  include <malloc.h>
+#endif
+
+
+/// Default alignment in bytes of memory allocated by AllocateAligned
+#ifndef MIRTK_DEFAULT_ALIGNMENT
+#  define MIRTK_DEFAULT_ALIGNMENT 64
+#endif
+
 
 namespace mirtk {
 
@@ -107,6 +120,66 @@ inline Type *CAllocate(int n, const Type *init = nullptr)
   return matrix;
 }
 
+// -----------------------------------------------------------------------------
+/// Allocate 1D array aligned to the given memory boundary
+///
+/// The memory must be freed using DeallocateAligned. Because no destructors
+/// are called by DeallocateAligned, this is only supported for types which
+/// are trivially destructible.
+template <class Type>
+inline void AllocateAligned(Type *&matrix, int n, size_t alignment = MIRTK_DEFAULT_ALIGNMENT)
+{
+  static_assert(std::is_trivially_destructible<Type>::value,
+                "AllocateAligned requires a trivially destructible type");
+  // Set pointer to nullptr if memory size is not positive
+  if (n <= 0) {
+    matrix = nullptr;
+    return;
+  }
+  // Alignment must be a power of two multiple of sizeof(void *)
+  if (alignment < sizeof(void *)) alignment = sizeof(void *);
+  const size_t size = static_cast<size_t>(n) * sizeof(Type);
+  // Allocate data memory
+  void *ptr = nullptr;
+  #if defined(_MSC_VER)
+    ptr = _aligned_malloc(size, alignment);
+  #else
+    if (posix_memalign(&ptr, alignment, size) != 0) ptr = nullptr;
+  #endif
+  if (ptr == nullptr) {
+    Throw(ERR_Memory, __FUNCTION__, "Failed to allocate ", size, " bytes");
+  }
+  // Default construct elements
+  matrix = static_cast<Type *>(ptr);
+  for (int i = 0; i < n; ++i) new (matrix + i) Type;
+}
+
+// -----------------------------------------------------------------------------
+/// Allocate 1D array aligned to the given memory boundary and initialize it
+template <class Type>
+inline void CAllocateAligned(Type *&matrix, int n, const Type &init = Type(),
+                             size_t alignment = MIRTK_DEFAULT_ALIGNMENT)
+{
+  // Allocate data memory
+  AllocateAligned(matrix, n, alignment);
+  // Initialize data memory
+  if (matrix) {
+    for (int i = 0; i < n; i++) matrix[i] = init;
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Allocate 1D array aligned to the default memory boundary and initialize it
+template <class Type>
+inline Type *CAllocateAligned(int n, const Type *init = nullptr)
+{
+  Type *matrix;
+  const Type default_value = Type();
+  if (!init) init = &default_value;
+  CAllocateAligned(matrix, n, *init);
+  return matrix;
+}
+
 // -----------------------------------------------------------------------------
 /// Allocate 1D array of pointers initialized to nullptr
 template <typename Type>
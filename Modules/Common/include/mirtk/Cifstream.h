@@ -28,12 +28,16 @@
 
 namespace mirtk {
 
+namespace BlockGzip { struct Index; }
+
 
 /**
  * Class for reading (compressed) file streams.
  *
  * This class defines and implements functions for reading compressed file
  * streams. The file streams can be either uncompressed or compressed.
+ * Files in blocked gzip (BGZF) format as written by Cofstream are
+ * decompressed block-wise in parallel.
  */
 
 class Cifstream : public Object
@@ -43,6 +47,9 @@ class Cifstream : public Object
   /// File pointer to potentially compressed file
   void *_File;
 
+  /// Index of compressed blocks if file is in blocked gzip format
+  BlockGzip::Index *_Blocks;
+
   /// Flag indicating whether file bytes are swapped
   mirtkPublicAttributeMacro(bool, Swapped);
 
@@ -96,6 +103,9 @@ public:
   /// Current position in file
   long Tell() const;
 
+  /// Whether the opened file is compressed
+  bool IsCompressed() const;
+
   /// Returns whether file is swapped
   /// \deprecated Use Swapped() instead.
   MIRTK_Common_DEPRECATED int IsSwapped() const;
@@ -33,22 +33,40 @@ namespace mirtk {
  * Class for writing (compressed) file streams.
  *
  * This class defines and implements functions for writing compressed file
- * streams. At the moment only the writing of uncompressed file streams is
- * supported.
+ * streams. Files with extension ".gz" are written in blocked gzip (BGZF)
+ * format, i.e., as a series of independent gzip members of at most 64 kB
+ * of uncompressed data each. The blocks are compressed in parallel and the
+ * resulting file can be decompressed by any gzip compatible reader.
  */
 
 class Cofstream : public Object
 {
   mirtkObjectMacro(Cofstream);
 
-  /// File pointer to uncompressed file
+  /// File pointer
   FILE *_File;
 
-  /// File pointer to compressed file
 #if MIRTK_Common_WITH_ZLIB
-  void *_ZFile;
+  /// Buffer of uncompressed data not yet written to compressed file
+  char *_Buffer;
+
+  /// Number of uncompressed bytes in buffer
+  long _BufferSize;
+
+  /// Number of uncompressed bytes written to compressed file
+  long _Offset;
+
+  /// Compress buffered blocks and write them to file
+  ///
+  /// \param[in] all Whether to also write last incomplete block.
+  ///
+  /// \returns Whether blocks were written successfully.
+  bool WriteBlocks(bool all);
 #endif
 
+  /// Compression level (0-9) or -1 for zlib default
+  mirtkPublicAttributeMacro(int, CompressionLevel);
+
   /// Flag whether file is compressed
   mirtkPublicAttributeMacro(bool, Compressed);
 
@@ -113,8 +131,15 @@ public:
   void Open(const char *);
 
   /// Close file
+  ///
+  /// Compresses and writes any buffered data before the file is closed.
+  /// Raises an ERR_IOError if the remaining data could not be written or
+  /// the file could not be closed.
   void Close();
 
+  /// Current position in (uncompressed) file
+  long Tell() const;
+
   /// Returns whether file is compressed
   /// \deprecated Used Compressed() instead.
   MIRTK_Common_DEPRECATED int IsCompressed() const;
@@ -20,6 +20,12 @@
 #ifndef MIRTK_Deallocate_H
 #define MIRTK_Deallocate_H
 
+#include <cstdlib>
+#if defined(_MSC_VER)
+#  include <malloc.h>
+#endif
+
+
 namespace mirtk {
 
 
@@ -39,6 +45,18 @@ inline void Deallocate(Type *&p)
   p = NULL;
 }
 
+/// Deallocate 1D array allocated by AllocateAligned or CAllocateAligned
+template <typename Type>
+inline void DeallocateAligned(Type *&p)
+{
+  #if defined(_MSC_VER)
+    _aligned_free(p);
+  #else
+    free(p);
+  #endif
+  p = NULL;
+}
+
 /// Deallocate 2D array stored in contiguous memory block
 ///
 /// \param[in] matrix Previously allocated array or \c NULL.
@@ -0,0 +1,147 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_MemoryMappedFile_H
+#define MIRTK_MemoryMappedFile_H
+
+#include "mirtk/CommonExport.h"
+
+#include "mirtk/Object.h"
+
+#include <cstddef>
+
+
+namespace mirtk {
+
+
+/**
+ * Read-only or copy-on-write mapping of a file region into memory.
+ *
+ * The pages of the mapped region are loaded by the operating system upon
+ * first access only. A copy-on-write mapping can be modified, but changes
+ * are private to the process and never written back to the file. The file
+ * must not be truncated or otherwise modified while it is mapped.
+ */
+class MemoryMappedFile : public Object
+{
+  mirtkObjectMacro(MemoryMappedFile);
+
+public:
+
+  /// Enumeration of memory access modes
+  enum AccessMode
+  {
+    ReadOnly,   ///< Mapped memory must not be modified
+    CopyOnWrite ///< Modified pages are private copies of file pages
+  };
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Name of mapped file
+  mirtkReadOnlyAttributeMacro(string, FileName);
+
+  /// Memory access mode
+  mirtkReadOnlyAttributeMacro(AccessMode, Mode);
+
+  /// Byte offset of mapped region from start of file
+  mirtkReadOnlyAttributeMacro(size_t, Offset);
+
+  /// Size of mapped region in bytes
+  mirtkReadOnlyAttributeMacro(size_t, Size);
+
+private:
+
+  /// Start address of mapping, aligned to page boundary before requested offset
+  void *_Base;
+
+  /// Number of bytes mapped starting at page aligned base address
+  size_t _MappedSize;
+
+  /// Handle of file mapping object (Windows only)
+  void *_Handle;
+
+  /// Copy constructor
+  /// \note Intentionally not implemented.
+  MemoryMappedFile(const MemoryMappedFile &);
+
+  /// Assignment operator
+  /// \note Intentionally not implemented.
+  MemoryMappedFile &operator =(const MemoryMappedFile &);
+
+public:
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+
+  /// Constructor
+  MemoryMappedFile();
+
+  /// Destructor
+  virtual ~MemoryMappedFile();
+
+  // ---------------------------------------------------------------------------
+  // Mapping
+
+  /// Map region of file into memory
+  ///
+  /// \param[in] fname  Name of file.
+  /// \param[in] offset Byte offset of region from start of file.
+  /// \param[in] size   Size of region in bytes. If zero, the region extends
+  ///                   from the offset to the end of the file.
+  /// \param[in] mode   Memory access mode.
+  ///
+  /// \returns Whether the file region was mapped successfully. When the file
+  ///          does not exist, is too short, or cannot be mapped, this mapping
+  ///          is left closed and the caller should read the file instead.
+  bool Open(const char *fname, size_t offset = 0, size_t size = 0,
+            AccessMode mode = CopyOnWrite);
+
+  /// Unmap file
+  void Close();
+
+  /// Whether a file region is currently mapped
+  bool IsOpen() const;
+
+  /// Start address of mapped file region
+  void *Data() const;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+inline bool MemoryMappedFile::IsOpen() const
+{
+  return _Base != nullptr;
+}
+
+// -----------------------------------------------------------------------------
+inline void *MemoryMappedFile::Data() const
+{
+  if (_Base == nullptr) return nullptr;
+  return reinterpret_cast<char *>(_Base) + (_MappedSize - _Size);
+}
+
+
+} // namespace mirtk
+
+#endif // MIRTK_MemoryMappedFile_H
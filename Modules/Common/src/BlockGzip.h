@@ -0,0 +1,243 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_BlockGzip_H
+#define MIRTK_BlockGzip_H
+
+// Blocked gzip (BGZF) format used by Cifstream and Cofstream
+//
+// A BGZF file is a concatenation of independent gzip members, each of which
+// compresses at most MaxBlockDataSize bytes. The size of each compressed
+// member is stored in a "BC" extra field of its gzip header. Such a file can
+// be decompressed by any gzip reader, but because the block boundaries are
+// known, blocks can also be compressed and decompressed in parallel.
+//
+// See also the SAM/BAM format specification, section 4.1.
+
+#include "mirtk/CommonConfig.h" // MIRTK_Common_WITH_ZLIB
+
+#if MIRTK_Common_WITH_ZLIB
+
+#include "mirtk/Array.h"
+
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+
+
+namespace mirtk {
+namespace BlockGzip {
+
+
+// -----------------------------------------------------------------------------
+/// Maximum number of uncompressed bytes per block
+const int MaxBlockDataSize = 0xff00;
+
+/// Maximum size of a compressed block including header and footer
+const int MaxBlockSize = 0x10000;
+
+/// Size of block header including "BC" extra field
+const int BlockHeaderSize = 18;
+
+/// Size of block footer (CRC32 and ISIZE)
+const int BlockFooterSize = 8;
+
+/// Number of blocks buffered by Cofstream before these are compressed
+const int BufferedBlocks = 64;
+
+/// Empty block appended to a BGZF file to mark its end
+const unsigned char EndOfFileBlock[28] = {
+  0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00,
+  0x42, 0x43, 0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00
+};
+
+// -----------------------------------------------------------------------------
+/// Read unsigned 16-bit little endian integer
+inline unsigned int GetUInt16(const unsigned char *p)
+{
+  return static_cast<unsigned int>(p[0]) | (static_cast<unsigned int>(p[1]) << 8);
+}
+
+// -----------------------------------------------------------------------------
+/// Read unsigned 32-bit little endian integer
+inline unsigned long GetUInt32(const unsigned char *p)
+{
+  return  static_cast<unsigned long>(p[0])
+       | (static_cast<unsigned long>(p[1]) <<  8)
+       | (static_cast<unsigned long>(p[2]) << 16)
+       | (static_cast<unsigned long>(p[3]) << 24);
+}
+
+// -----------------------------------------------------------------------------
+/// Write unsigned 16-bit little endian integer
+inline void PutUInt16(unsigned char *p, unsigned int v)
+{
+  p[0] = static_cast<unsigned char>( v       & 0xff);
+  p[1] = static_cast<unsigned char>((v >> 8) & 0xff);
+}
+
+// -----------------------------------------------------------------------------
+/// Write unsigned 32-bit little endian integer
+inline void PutUInt32(unsigned char *p, unsigned long v)
+{
+  p[0] = static_cast<unsigned char>( v        & 0xff);
+  p[1] = static_cast<unsigned char>((v >>  8) & 0xff);
+  p[2] = static_cast<unsigned char>((v >> 16) & 0xff);
+  p[3] = static_cast<unsigned char>((v >> 24) & 0xff);
+}
+
+// -----------------------------------------------------------------------------
+/// Whether given bytes are the header of a BGZF block
+inline bool IsBlockHeader(const unsigned char *h)
+{
+  return h[0] == 0x1f && h[1] == 0x8b && h[2] == 8 && (h[3] & 4) != 0
+      && GetUInt16(h + 10) == 6 && h[12] == 'B' && h[13] == 'C'
+      && GetUInt16(h + 14) == 2;
+}
+
+// -----------------------------------------------------------------------------
+/// Total size of BGZF block in bytes given its header
+inline int BlockSize(const unsigned char *h)
+{
+  return static_cast<int>(GetUInt16(h + 16)) + 1;
+}
+
+// -----------------------------------------------------------------------------
+/// Compress data into a single BGZF block
+///
+/// \param[out] block Output buffer of size MaxBlockSize.
+/// \param[in]  data  Uncompressed data.
+/// \param[in]  n     Number of uncompressed bytes, at most MaxBlockDataSize.
+/// \param[in]  level Compression level.
+///
+/// \returns Size of compressed block or -1 on error.
+inline int CompressBlock(unsigned char *block, const char *data, int n, int level = Z_DEFAULT_COMPRESSION)
+{
+  const unsigned char header[BlockHeaderSize] = {
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00,
+    0x42, 0x43, 0x02, 0x00, 0x00, 0x00
+  };
+  z_stream zs;
+  int      status;
+  // Store data uncompressed if compressed block would exceed maximum size
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, attempt == 0 ? level : Z_NO_COMPRESSION,
+                     Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      return -1;
+    }
+    zs.next_in   = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    zs.avail_in  = static_cast<uInt>(n);
+    zs.next_out  = block + BlockHeaderSize;
+    zs.avail_out = static_cast<uInt>(MaxBlockSize - BlockHeaderSize - BlockFooterSize);
+    status = deflate(&zs, Z_FINISH);
+    deflateEnd(&zs);
+    if (status == Z_STREAM_END) break;
+    if (status != Z_OK && status != Z_BUF_ERROR) return -1;
+  }
+  if (status != Z_STREAM_END) return -1;
+  const int size = BlockHeaderSize + static_cast<int>(zs.total_out) + BlockFooterSize;
+  memcpy(block, header, BlockHeaderSize);
+  PutUInt16(block + 16, static_cast<unsigned int>(size - 1));
+  const uLong crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(data), static_cast<uInt>(n));
+  PutUInt32(block + size - 8, crc);
+  PutUInt32(block + size - 4, static_cast<unsigned long>(n));
+  return size;
+}
+
+// -----------------------------------------------------------------------------
+/// Decompress a single BGZF block
+///
+/// \param[out] data  Output buffer for uncompressed data.
+/// \param[in]  n     Number of uncompressed bytes stored in block.
+/// \param[in]  block Compressed BGZF block including header and footer.
+/// \param[in]  size  Size of compressed block.
+///
+/// \returns Whether block was decompressed successfully and its CRC matches.
+inline bool InflateBlock(char *data, int n, const unsigned char *block, int size)
+{
+  if (size < BlockHeaderSize + BlockFooterSize) return false;
+  if (n == 0) return true;
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  if (inflateInit2(&zs, -15) != Z_OK) return false;
+  zs.next_in   = const_cast<Bytef *>(block + BlockHeaderSize);
+  zs.avail_in  = static_cast<uInt>(size - BlockHeaderSize - BlockFooterSize);
+  zs.next_out  = reinterpret_cast<Bytef *>(data);
+  zs.avail_out = static_cast<uInt>(n);
+  const int status = inflate(&zs, Z_FINISH);
+  inflateEnd(&zs);
+  if (status != Z_STREAM_END || zs.total_out != static_cast<uLong>(n)) return false;
+  const uLong crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(data), static_cast<uInt>(n));
+  return crc == GetUInt32(block + size - 8);
+}
+
+// =============================================================================
+// Block index
+// =============================================================================
+
+/**
+ * Index of blocks of a BGZF file opened for reading
+ */
+struct Index
+{
+  /// File pointer
+  FILE *File;
+
+  /// Offsets of compressed blocks in file
+  Array<long> CompressedOffset;
+
+  /// Sizes of compressed blocks including header and footer
+  Array<int> CompressedSize;
+
+  /// Offsets of uncompressed block data, with one extra entry for the total size
+  Array<long> Offset;
+
+  /// Current position in uncompressed data
+  long Position;
+
+  /// Index of block whose uncompressed data is cached, or -1
+  int CachedBlock;
+
+  /// Uncompressed data of most recently read block
+  Array<char> Cache;
+
+  /// Constructor
+  Index() : File(nullptr), Position(0), CachedBlock(-1) {}
+
+  /// Number of blocks
+  int NumberOfBlocks() const
+  {
+    return static_cast<int>(Offset.size()) - 1;
+  }
+
+  /// Total size of uncompressed data
+  long Size() const
+  {
+    return Offset.back();
+  }
+};
+
+
+} } // namespace mirtk::BlockGzip
+
+#endif // MIRTK_Common_WITH_ZLIB
+
+#endif // MIRTK_BlockGzip_H
@@ -24,6 +24,10 @@
 #include "mirtk/Memory.h"       // swap16, swap32
 
 #if MIRTK_Common_WITH_ZLIB
+#  include "mirtk/Math.h"     // min, max
+#  include "mirtk/Parallel.h" // parallel_for
+#  include "BlockGzip.h"
+#  include <algorithm>        // upper_bound
 #  include <zlib.h>
 #else
 #  include <cstdio>
@@ -33,10 +37,166 @@
 namespace mirtk {
 
 
+#if MIRTK_Common_WITH_ZLIB
+
+// =============================================================================
+// Blocked gzip file
+// =============================================================================
+
+namespace CifstreamUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Open file and create index of its blocks if it is a blocked gzip file
+BlockGzip::Index *OpenBlockGzip(const char *fname)
+{
+  FILE *fp;
+  #ifdef WINDOWS
+    if (fopen_s(&fp, fname, "rb") != 0) fp = nullptr;
+  #else
+    fp = fopen(fname, "rb");
+  #endif
+  if (fp == nullptr) return nullptr;
+  UniquePtr<BlockGzip::Index> index(new BlockGzip::Index());
+  unsigned char header[BlockGzip::BlockHeaderSize];
+  unsigned char isize[4];
+  long coffset = 0, offset = 0;
+  size_t n;
+  while ((n = fread(header, 1, BlockGzip::BlockHeaderSize, fp)) > 0) {
+    if (n != BlockGzip::BlockHeaderSize || !BlockGzip::IsBlockHeader(header)) {
+      fclose(fp);
+      return nullptr;
+    }
+    const int bsize = BlockGzip::BlockSize(header);
+    if (fseek(fp, coffset + bsize - 4, SEEK_SET) != 0 || fread(isize, 1, 4, fp) != 4) {
+      fclose(fp);
+      return nullptr;
+    }
+    const long usize = static_cast<long>(BlockGzip::GetUInt32(isize));
+    if (usize > 0) {
+      index->CompressedOffset.push_back(coffset);
+      index->CompressedSize.push_back(bsize);
+      index->Offset.push_back(offset);
+    }
+    coffset += bsize;
+    offset  += usize;
+  }
+  if (index->Offset.empty() && coffset == 0) {
+    fclose(fp);
+    return nullptr;
+  }
+  index->Offset.push_back(offset);
+  index->File = fp;
+  return index.release();
+}
+
+// -----------------------------------------------------------------------------
+/// Read compressed data of blocks [b1, b2] into memory
+bool ReadCompressedBlocks(BlockGzip::Index &index, int b1, int b2, Array<unsigned char> &data)
+{
+  const long begin = index.CompressedOffset[b1];
+  const long end   = index.CompressedOffset[b2] + index.CompressedSize[b2];
+  data.resize(end - begin);
+  if (fseek(index.File, begin, SEEK_SET) != 0) return false;
+  return fread(data.data(), 1, data.size(), index.File) == data.size();
+}
+
+// -----------------------------------------------------------------------------
+/// Decompress blocks in parallel
+struct InflateBlocks
+{
+  const BlockGzip::Index *_Index;
+  const unsigned char    *_Input;
+  int                     _FirstBlock;
+  char                   *_Output;
+  long                    _Begin;
+  long                    _End;
+  int                    *_Status;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    Array<char> block;
+    for (int b = re.begin(); b != re.end(); ++b) {
+      const long offset  = _Index->Offset[b];
+      const int  usize   = static_cast<int>(_Index->Offset[b + 1] - offset);
+      const int  csize   = _Index->CompressedSize[b];
+      const unsigned char *input = _Input + (_Index->CompressedOffset[b] - _Index->CompressedOffset[_FirstBlock]);
+      if (_Begin <= offset && offset + usize <= _End) {
+        _Status[b - _FirstBlock] = BlockGzip::InflateBlock(_Output + (offset - _Begin), usize, input, csize) ? 1 : 0;
+      } else {
+        block.resize(usize);
+        _Status[b - _FirstBlock] = BlockGzip::InflateBlock(block.data(), usize, input, csize) ? 1 : 0;
+        const long begin = max(_Begin, offset);
+        const long end   = min(_End,   offset + usize);
+        memcpy(_Output + (begin - _Begin), block.data() + (begin - offset), end - begin);
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Read uncompressed data from blocked gzip file
+bool ReadBlocks(BlockGzip::Index &index, char *mem, long start, long num)
+{
+  if (start != -1) index.Position = start;
+  if (num <= 0) return true;
+  const long begin = index.Position;
+  const long end   = min(begin + num, index.Size());
+  if (begin >= end) return false;
+  // Blocks containing the first and last requested byte
+  const int b1 = static_cast<int>(std::upper_bound(index.Offset.begin(), index.Offset.end(), begin) - index.Offset.begin()) - 1;
+  const int b2 = static_cast<int>(std::upper_bound(index.Offset.begin(), index.Offset.end(), end - 1) - index.Offset.begin()) - 1;
+  if (b1 == b2) {
+    // Decompress single block and keep it for subsequent small reads
+    if (index.CachedBlock != b1) {
+      Array<unsigned char> data;
+      index.CachedBlock = -1;
+      if (!ReadCompressedBlocks(index, b1, b1, data)) return false;
+      index.Cache.resize(index.Offset[b1 + 1] - index.Offset[b1]);
+      if (!BlockGzip::InflateBlock(index.Cache.data(), static_cast<int>(index.Cache.size()),
+                                   data.data(), static_cast<int>(data.size()))) {
+        return false;
+      }
+      index.CachedBlock = b1;
+    }
+    memcpy(mem, index.Cache.data() + (begin - index.Offset[b1]), end - begin);
+  } else {
+    // Decompress blocks in parallel directly into output memory
+    Array<unsigned char> data;
+    if (!ReadCompressedBlocks(index, b1, b2, data)) return false;
+    Array<int> status(b2 - b1 + 1, 0);
+    InflateBlocks inflate;
+    inflate._Index      = &index;
+    inflate._Input      = data.data();
+    inflate._FirstBlock = b1;
+    inflate._Output     = mem;
+    inflate._Begin      = begin;
+    inflate._End        = end;
+    inflate._Status     = status.data();
+    parallel_for(blocked_range<int>(b1, b2 + 1), inflate);
+    for (size_t i = 0; i < status.size(); ++i) {
+      if (status[i] == 0) return false;
+    }
+  }
+  index.Position = end;
+  return (end - begin) == num;
+}
+
+
+} // namespace CifstreamUtils
+using namespace CifstreamUtils;
+
+#endif // MIRTK_Common_WITH_ZLIB
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
 // -----------------------------------------------------------------------------
 Cifstream::Cifstream(const char *fname)
 :
   _File(nullptr),
+  _Blocks(nullptr),
   _Swapped(GetByteOrder() == LittleEndian)
 {
   if (fname) Open(fname);
@@ -51,7 +211,10 @@ Cifstream::~Cifstream()
 // -----------------------------------------------------------------------------
 void Cifstream::Open(const char *fname)
 {
+  Close();
   #if MIRTK_Common_WITH_ZLIB
+    _Blocks = OpenBlockGzip(fname);
+    if (_Blocks != nullptr) return;
     _File = gzopen(fname, "rb");
   #elif defined(WINDOWS)
     FILE *fp;
@@ -69,6 +232,13 @@ void Cifstream::Open(const char *fname)
 // -----------------------------------------------------------------------------
 void Cifstream::Close()
 {
+  #if MIRTK_Common_WITH_ZLIB
+    if (_Blocks != nullptr) {
+      fclose(_Blocks->File);
+      delete _Blocks;
+      _Blocks = nullptr;
+    }
+  #endif
   if (_File != nullptr) {
     #if MIRTK_Common_WITH_ZLIB
       gzclose(reinterpret_cast<gzFile>(_File));
@@ -95,16 +265,32 @@ void Cifstream::IsSwapped(int swapped)
 long Cifstream::Tell() const
 {
 #if MIRTK_Common_WITH_ZLIB
+  if (_Blocks) return _Blocks->Position;
   return gztell(reinterpret_cast<gzFile>(_File));
 #else
   return ftell(reinterpret_cast<FILE *>(_File));
 #endif
 }
 
+// -----------------------------------------------------------------------------
+bool Cifstream::IsCompressed() const
+{
+#if MIRTK_Common_WITH_ZLIB
+  if (_Blocks) return true;
+  return _File != nullptr && gzdirect(reinterpret_cast<gzFile>(_File)) == 0;
+#else
+  return false;
+#endif
+}
+
 // -----------------------------------------------------------------------------
 void Cifstream::Seek(long offset)
 {
 #if MIRTK_Common_WITH_ZLIB
+  if (_Blocks) {
+    _Blocks->Position = offset;
+    return;
+  }
   gzseek(reinterpret_cast<gzFile>(_File), offset, SEEK_SET);
 #else
   fseek(reinterpret_cast<FILE *>(_File), offset, SEEK_SET);
@@ -115,6 +301,7 @@ void Cifstream::Seek(long offset)
 bool Cifstream::Read(char *mem, long start, long num)
 {
 #if MIRTK_Common_WITH_ZLIB
+  if (_Blocks) return ReadBlocks(*_Blocks, mem, start, num);
   gzFile fp = reinterpret_cast<gzFile>(_File);
   if (start != -1) gzseek(fp, start, SEEK_SET);
   return (gzread(fp, mem, num) == num);
@@ -190,9 +377,21 @@ bool Cifstream::ReadAsString(char *data, long length, long offset)
 {
   // Read string
 #if MIRTK_Common_WITH_ZLIB
-  gzFile fp = reinterpret_cast<gzFile>(_File);
-  if (offset != -1) gzseek(fp, offset, SEEK_SET);
-  if (gzgets(fp, data, length) == Z_NULL) return false;
+  if (_Blocks) {
+    // Read characters until end-of-line as done by gzgets
+    if (length <= 0) return false;
+    if (offset != -1) _Blocks->Position = offset;
+    long n = 0;
+    while (n < length - 1 && ReadBlocks(*_Blocks, data + n, -1, 1)) {
+      if (data[n++] == '\n') break;
+    }
+    data[n] = '\0';
+    if (n == 0) return false;
+  } else {
+    gzFile fp = reinterpret_cast<gzFile>(_File);
+    if (offset != -1) gzseek(fp, offset, SEEK_SET);
+    if (gzgets(fp, data, length) == Z_NULL) return false;
+  }
 #else
   FILE *fp = reinterpret_cast<FILE *>(_File);
   if (offset != -1) fseek(fp, offset, SEEK_SET);
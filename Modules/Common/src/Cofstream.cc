@@ -24,20 +24,65 @@
 #include "mirtk/Memory.h"       // swap16, swap32
 
 #if MIRTK_Common_WITH_ZLIB
-#  include <zlib.h>
+#  include "mirtk/Math.h"     // min
+#  include "mirtk/Parallel.h" // parallel_for
+#  include "BlockGzip.h"
 #endif
 
 
 namespace mirtk {
 
 
+#if MIRTK_Common_WITH_ZLIB
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace CofstreamUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Compress blocks of uncompressed data in parallel
+struct CompressBlocks
+{
+  const char    *_Data;
+  long           _Size;
+  unsigned char *_Output;
+  int           *_BlockSize;
+  int            _Level;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int b = re.begin(); b != re.end(); ++b) {
+      const long offset = static_cast<long>(b) * BlockGzip::MaxBlockDataSize;
+      const long n = min(_Size - offset, static_cast<long>(BlockGzip::MaxBlockDataSize));
+      _BlockSize[b] = BlockGzip::CompressBlock(_Output + static_cast<size_t>(b) * BlockGzip::MaxBlockSize,
+                                               _Data + offset, static_cast<int>(n), _Level);
+    }
+  }
+};
+
+
+} // namespace CofstreamUtils
+using namespace CofstreamUtils;
+
+#endif // MIRTK_Common_WITH_ZLIB
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
 // -----------------------------------------------------------------------------
 Cofstream::Cofstream(const char *fname)
 :
   _File(nullptr),
   #if MIRTK_Common_WITH_ZLIB
-    _ZFile(nullptr),
+    _Buffer(nullptr),
+    _BufferSize(0),
+    _Offset(0),
   #endif
+  _CompressionLevel(-1),
   _Compressed(false),
   _Swapped(GetByteOrder() == LittleEndian)
 {
@@ -58,46 +103,106 @@ void Cofstream::Open(const char *fname)
   if (len == 0) {
     Throw(ERR_InvalidArgument, __func__, "Filename is empty");
   }
-  if (len > 3 && (strncmp(fname + len-3, ".gz", 3) == 0 || strncmp(fname + len-3, ".GZ", 3) == 0)) {
-    #if MIRTK_Common_WITH_ZLIB
-      gzFile fp = gzopen(fname, "wb");
-      if (fp == nullptr) {
-        Throw(ERR_IOError, __func__, "Failed to open file ", fname);
-      }
-      _ZFile = fp;
-      _Compressed = true;
-    #else // MIRTK_Common_WITH_ZLIB
+  _Compressed = (len > 3 && (strncmp(fname + len-3, ".gz", 3) == 0 || strncmp(fname + len-3, ".GZ", 3) == 0));
+  #if !MIRTK_Common_WITH_ZLIB
+    if (_Compressed) {
       Throw(ERR_IOError, __func__, "Cannot write compressed file when Common module not built WITH_ZLIB");
-    #endif // MIRTK_Common_WITH_ZLIB
-  } else {
-    #ifdef WINDOWS
-      errno_t err = fopen_s(&_File, fname, "wb");
-      if (err != 0) _File = nullptr;
-    #else
-      _File = fopen(fname, "wb");
-    #endif
-    if (_File == nullptr) {
-      Throw(ERR_IOError, __func__, "Failed to open file ", fname);
     }
-    _Compressed = false;
+  #endif // MIRTK_Common_WITH_ZLIB
+  #ifdef WINDOWS
+    errno_t err = fopen_s(&_File, fname, "wb");
+    if (err != 0) _File = nullptr;
+  #else
+    _File = fopen(fname, "wb");
+  #endif
+  if (_File == nullptr) {
+    Throw(ERR_IOError, __func__, "Failed to open file ", fname);
   }
+  #if MIRTK_Common_WITH_ZLIB
+    if (_Compressed) {
+      _Buffer     = new char[BlockGzip::BufferedBlocks * BlockGzip::MaxBlockDataSize];
+      _BufferSize = 0;
+      _Offset     = 0;
+    }
+  #endif // MIRTK_Common_WITH_ZLIB
 }
 
 // -----------------------------------------------------------------------------
 void Cofstream::Close()
 {
+  bool flushed = true;
   #if MIRTK_Common_WITH_ZLIB
-    if (_ZFile != nullptr) {
-      gzclose(reinterpret_cast<gzFile>(_ZFile));
-      _ZFile = nullptr;
+    if (_Buffer != nullptr) {
+      if (_File != nullptr) {
+        flushed = WriteBlocks(true) &&
+                  fwrite(BlockGzip::EndOfFileBlock, sizeof(BlockGzip::EndOfFileBlock), 1, _File) == 1;
+      }
+      delete[] _Buffer;
+      _Buffer     = nullptr;
+      _BufferSize = 0;
+      _Offset     = 0;
     }
   #endif // MIRTK_Common_WITH_ZLIB
+  bool closed = true;
   if (_File != nullptr) {
-    fclose(_File);
-    _File = nullptr;
+    closed = (fclose(_File) == 0);
+    _File  = nullptr;
+  }
+  if (!flushed) {
+    Throw(ERR_IOError, __func__, "Failed to write remaining compressed data blocks");
+  }
+  if (!closed) {
+    Throw(ERR_IOError, __func__, "Failed to close file");
+  }
+}
+
+// -----------------------------------------------------------------------------
+long Cofstream::Tell() const
+{
+  #if MIRTK_Common_WITH_ZLIB
+    if (_Compressed) return _Offset + _BufferSize;
+  #endif // MIRTK_Common_WITH_ZLIB
+  return ftell(_File);
+}
+
+#if MIRTK_Common_WITH_ZLIB
+
+// -----------------------------------------------------------------------------
+bool Cofstream::WriteBlocks(bool all)
+{
+  int nblocks = static_cast<int>(_BufferSize / BlockGzip::MaxBlockDataSize);
+  if (all && nblocks * BlockGzip::MaxBlockDataSize < _BufferSize) ++nblocks;
+  if (nblocks == 0) return true;
+  const long size = min(_BufferSize, static_cast<long>(nblocks) * BlockGzip::MaxBlockDataSize);
+
+  // Compress blocks
+  Array<unsigned char> output(static_cast<size_t>(nblocks) * BlockGzip::MaxBlockSize);
+  Array<int>           bsize(nblocks);
+  CompressBlocks compress;
+  compress._Data      = _Buffer;
+  compress._Size      = size;
+  compress._Output    = output.data();
+  compress._BlockSize = bsize.data();
+  compress._Level     = _CompressionLevel;
+  parallel_for(blocked_range<int>(0, nblocks), compress);
+
+  // Write compressed blocks in order
+  for (int b = 0; b < nblocks; ++b) {
+    if (bsize[b] < 0) return false;
+    if (fwrite(output.data() + static_cast<size_t>(b) * BlockGzip::MaxBlockSize, bsize[b], 1, _File) != 1) {
+      return false;
+    }
   }
+
+  // Keep remaining data of incomplete block
+  _BufferSize -= size;
+  if (_BufferSize > 0) memmove(_Buffer, _Buffer + size, _BufferSize);
+  _Offset += size;
+  return true;
 }
 
+#endif // MIRTK_Common_WITH_ZLIB
+
 // -----------------------------------------------------------------------------
 int Cofstream::IsCompressed() const
 {
@@ -127,15 +232,28 @@ bool Cofstream::Write(const char *data, long offset, long length)
 {
   #if MIRTK_Common_WITH_ZLIB
     if (_Compressed) {
-      gzFile fp = reinterpret_cast<gzFile>(_ZFile);
+      const long capacity = static_cast<long>(BlockGzip::BufferedBlocks) * BlockGzip::MaxBlockDataSize;
       if (offset != -1) {
-        if (gztell(fp) > offset) {
+        const long pos = Tell();
+        if (pos > offset) {
           Throw(ERR_IOError, __func__, "Writing compressed files only supports"
-                " forward seek (pos=", gztell(fp), ", offset=", offset, ")");
+                " forward seek (pos=", pos, ", offset=", offset, ")");
         }
-        gzseek(fp, offset, SEEK_SET);
+        // Fill gap with zeros as done by gzseek
+        for (long n = offset - pos, m; n > 0; n -= m) {
+          m = min(n, capacity - _BufferSize);
+          memset(_Buffer + _BufferSize, 0, m);
+          _BufferSize += m;
+          if (_BufferSize == capacity && !WriteBlocks(false)) return false;
+        }
+      }
+      for (long m; length > 0; length -= m, data += m) {
+        m = min(length, capacity - _BufferSize);
+        memcpy(_Buffer + _BufferSize, data, m);
+        _BufferSize += m;
+        if (_BufferSize == capacity && !WriteBlocks(false)) return false;
       }
-      return (gzwrite(fp, data, length) == length);
+      return true;
     }
   #endif // MIRTK_Common_WITH_ZLIB
   if (offset != -1) fseek(_File, offset, SEEK_SET);
@@ -267,9 +385,7 @@ bool Cofstream::WriteAsString(const char *data, long offset)
 {
   #if MIRTK_Common_WITH_ZLIB
     if (_Compressed) {
-      gzFile fp = reinterpret_cast<gzFile>(_ZFile);
-      if (offset != -1) gzseek(fp, offset, SEEK_SET);
-      return (gzputs(fp, data) > 0);
+      return Write(data, offset, static_cast<long>(strlen(data)));
     }
   #endif // MIRTK_Common_WITH_ZLIB
   if (offset != -1) fseek(_File, offset, SEEK_SET);
@@ -0,0 +1,186 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/MemoryMappedFile.h"
+
+#include "mirtk/Config.h" // WINDOWS
+
+#ifdef WINDOWS
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+MemoryMappedFile::MemoryMappedFile()
+:
+  _Mode(CopyOnWrite),
+  _Offset(0),
+  _Size(0),
+  _Base(nullptr),
+  _MappedSize(0),
+  _Handle(nullptr)
+{
+}
+
+// -----------------------------------------------------------------------------
+MemoryMappedFile::~MemoryMappedFile()
+{
+  Close();
+}
+
+// =============================================================================
+// Mapping
+// =============================================================================
+
+#ifdef WINDOWS
+
+// -----------------------------------------------------------------------------
+bool MemoryMappedFile::Open(const char *fname, size_t offset, size_t size, AccessMode mode)
+{
+  Close();
+
+  HANDLE file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return false;
+
+  LARGE_INTEGER fsize;
+  if (!GetFileSizeEx(file, &fsize) || static_cast<size_t>(fsize.QuadPart) < offset) {
+    CloseHandle(file);
+    return false;
+  }
+  if (size == 0) size = static_cast<size_t>(fsize.QuadPart) - offset;
+  if (size == 0 || static_cast<size_t>(fsize.QuadPart) - offset < size) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) return false;
+
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  const size_t granularity = static_cast<size_t>(info.dwAllocationGranularity);
+  const size_t base_offset = offset - offset % granularity;
+  const size_t mapped_size = size + (offset - base_offset);
+
+  const DWORD access = (mode == ReadOnly ? FILE_MAP_READ : FILE_MAP_COPY);
+  void *base = MapViewOfFile(mapping, access,
+                             static_cast<DWORD>(static_cast<unsigned long long>(base_offset) >> 32),
+                             static_cast<DWORD>(base_offset & 0xffffffffUL),
+                             mapped_size);
+  if (base == NULL) {
+    CloseHandle(mapping);
+    return false;
+  }
+
+  _FileName   = fname;
+  _Mode       = mode;
+  _Offset     = offset;
+  _Size       = size;
+  _Base       = base;
+  _MappedSize = mapped_size;
+  _Handle     = mapping;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void MemoryMappedFile::Close()
+{
+  if (_Base != nullptr) {
+    UnmapViewOfFile(_Base);
+    CloseHandle(reinterpret_cast<HANDLE>(_Handle));
+  }
+  _FileName.clear();
+  _Offset     = 0;
+  _Size       = 0;
+  _Base       = nullptr;
+  _MappedSize = 0;
+  _Handle     = nullptr;
+}
+
+#else // WINDOWS
+
+// -----------------------------------------------------------------------------
+bool MemoryMappedFile::Open(const char *fname, size_t offset, size_t size, AccessMode mode)
+{
+  Close();
+
+  const int fd = open(fname, O_RDONLY);
+  if (fd == -1) return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+      static_cast<size_t>(info.st_size) < offset) {
+    close(fd);
+    return false;
+  }
+  if (size == 0) size = static_cast<size_t>(info.st_size) - offset;
+  if (size == 0 || static_cast<size_t>(info.st_size) - offset < size) {
+    close(fd);
+    return false;
+  }
+
+  const size_t pagesize    = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t base_offset = offset - offset % pagesize;
+  const size_t mapped_size = size + (offset - base_offset);
+
+  int prot = PROT_READ;
+  if (mode == CopyOnWrite) prot |= PROT_WRITE;
+  void *base = mmap(nullptr, mapped_size, prot, MAP_PRIVATE, fd, static_cast<off_t>(base_offset));
+  // The mapping keeps a reference to the file, the descriptor is no longer needed
+  close(fd);
+  if (base == MAP_FAILED) return false;
+
+  _FileName   = fname;
+  _Mode       = mode;
+  _Offset     = offset;
+  _Size       = size;
+  _Base       = base;
+  _MappedSize = mapped_size;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void MemoryMappedFile::Close()
+{
+  if (_Base != nullptr) munmap(_Base, _MappedSize);
+  _FileName.clear();
+  _Offset     = 0;
+  _Size       = 0;
+  _Base       = nullptr;
+  _MappedSize = 0;
+}
+
+#endif // WINDOWS
+
+
+} // namespace mirtk
@@ -0,0 +1,107 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2016 Imperial College London
+ * Copyright 2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include "mirtk/Config.h" // WINDOWS
+#include "mirtk/Cfstream.h"
+#include "mirtk/Array.h"
+#include "mirtk/Exception.h"
+
+#include <cstdio>
+
+using namespace mirtk;
+
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Write test data spanning several compressed blocks and read it back
+void TestWriteRead(const char *fname)
+{
+  const int n = 100000;
+  Array<int> values(n), result(n, 0);
+  for (int i = 0; i < n; ++i) values[i] = (i * 7919) % 1000;
+  {
+    Cofstream to(fname);
+    ASSERT_TRUE(to.WriteAsString("header\n"));
+    ASSERT_TRUE(to.WriteAsInt(values.data(), n, 16));
+    EXPECT_EQ(16 + n * static_cast<long>(sizeof(int)), to.Tell());
+    to.Close();
+  }
+  {
+    Cifstream from(fname);
+    char line[16];
+    ASSERT_TRUE(from.ReadAsString(line, 16));
+    EXPECT_STREQ("header", line);
+    ASSERT_TRUE(from.ReadAsInt(result.data(), n, 16));
+    EXPECT_EQ(values, result);
+    // Small read from the middle of the file
+    int value;
+    ASSERT_TRUE(from.ReadAsInt(&value, 1, 16 + 54321 * sizeof(int)));
+    EXPECT_EQ(values[54321], value);
+    // Read beyond end of file
+    EXPECT_FALSE(from.ReadAsInt(&value, 1, 16 + n * sizeof(int)));
+  }
+  remove(fname);
+}
+
+// =============================================================================
+// Tests
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+TEST(Cfstream, Uncompressed)
+{
+  TestWriteRead("testCfstream.bin");
+}
+
+// -----------------------------------------------------------------------------
+#if MIRTK_Common_WITH_ZLIB
+TEST(Cfstream, BlockCompressed)
+{
+  TestWriteRead("testCfstream.bin.gz");
+}
+#endif
+
+// -----------------------------------------------------------------------------
+#ifndef WINDOWS
+TEST(Cfstream, CloseReportsWriteError)
+{
+  // Buffered data is only written to the full device when the file is closed
+  EXPECT_EXIT({
+    Cofstream to("/dev/full");
+    to.WriteAsString("data");
+    to.Close();
+  }, ::testing::ExitedWithCode(ERR_IOError), "Failed to close file");
+}
+#endif
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -67,6 +67,14 @@ public:
   /// \returns Newly read image. Must be deleted by caller.
   virtual BaseImage *Run();
 
+  /// Read slab of consecutive image slices from file
+  ///
+  /// The MetaImage library only reads entire images. This function therefore
+  /// reads the image and extracts the requested slab.
+  ///
+  /// \returns Newly read image slab. Must be deleted by caller.
+  virtual BaseImage *ReadSlab(int, int);
+
 protected:
 
   /// Copy header information from MetaImage instance
@@ -75,6 +83,14 @@ protected:
   /// Read header of MetaImage file
   virtual void ReadHeader();
 
+  /// Name of file containing the image data
+  virtual string DataFileName() const;
+
+  /// Map image data into memory if it is stored uncompressed in a single file
+  ///
+  /// \returns Image whose data is a memory mapped file region or \c nullptr.
+  BaseImage *MapDataFile() const;
+
 };
 
 
@@ -74,6 +74,9 @@ protected:
   /// Read header of NIFTI file
   virtual void ReadHeader();
 
+  /// Name of file containing the image data
+  virtual string DataFileName() const;
+
 };
 
 
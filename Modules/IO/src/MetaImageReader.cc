@@ -22,6 +22,8 @@
 #include "mirtk/MetaImageReader.h"
 #include "mirtk/ImageReaderFactory.h"
 
+#include <fstream>
+
 
 namespace mirtk {
 
@@ -67,6 +69,7 @@ void MetaImageReader::Initialize()
 {
   // Close (unused) file stream
   this->Close();
+  _ContainsNaN = -1;
 
   // Read image header
   this->ReadHeader();
@@ -191,6 +194,49 @@ void MetaImageReader::CopyHeader(const MetaImage &meta_image)
 
   // Data starts here 
   _Start = static_cast<int>(meta_image.HeaderSize());
+
+  // Name of image data file if all data is stored in a single file
+  _ImageName.clear();
+  const string data_file = meta_image.ElementDataFileName();
+  if (data_file == "LOCAL" || data_file == "Local" || data_file == "local") {
+    _ImageName = _FileName;
+  } else if (data_file.compare(0, 4, "LIST") != 0 && data_file.find('%') == string::npos) {
+    string path;
+    const bool abs_path = (data_file[0] == '/' || data_file[0] == '\\' ||
+                           (data_file.length() > 1 && data_file[1] == ':'));
+    if (!abs_path && MET_GetFilePath(_FileName, path)) {
+      _ImageName = path + data_file;
+    } else {
+      _ImageName = data_file;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+string MetaImageReader::DataFileName() const
+{
+  return _ImageName;
+}
+
+// -----------------------------------------------------------------------------
+BaseImage *MetaImageReader::MapDataFile() const
+{
+  const MetaImage &meta_image = *_MetaImage;
+  if (_ImageName.empty() || !meta_image.BinaryData() || meta_image.CompressedData()) {
+    return nullptr;
+  }
+  if (meta_image.ElementNumberOfChannels() != 1) return nullptr;
+  if (meta_image.BinaryDataByteOrderMSB() != MET_SystemByteOrderMSB()) return nullptr;
+  // Image data is either preceded by a header of given size or, when the
+  // header size is unknown, stored at the end of the data file
+  long offset = meta_image.HeaderSize();
+  if (offset == -1 || (offset == 0 && _ImageName == _FileName)) {
+    std::ifstream ifs(_ImageName.c_str(), std::ios::binary | std::ios::ate);
+    if (!ifs) return nullptr;
+    const long size = static_cast<long>(_Attributes.NumberOfLatticePoints()) * _Bytes;
+    offset = static_cast<long>(ifs.tellg()) - size;
+  }
+  return ImageReader::MapImageData(_ImageName.c_str(), offset);
 }
 
 // -----------------------------------------------------------------------------
@@ -207,6 +253,15 @@ void MetaImageReader::ReadHeader()
 // -----------------------------------------------------------------------------
 BaseImage *MetaImageReader::Run()
 {
+  // Map uncompressed image data with native byte order into memory
+  if (memory_map_images) {
+    UniquePtr<BaseImage> output(this->MapDataFile());
+    if (output) {
+      this->Finalize(output.get());
+      return output.release();
+    }
+  }
+
   if (!_MetaImage->Read(_FileName.c_str(), true)) {
     cerr << this->NameOfClass() << ": Failed to read MetaImage file " << _FileName << endl;
     exit(1);
@@ -235,5 +290,18 @@ BaseImage *MetaImageReader::Run()
   return output.release();
 }
 
+// -----------------------------------------------------------------------------
+BaseImage *MetaImageReader::ReadSlab(int k1, int k2)
+{
+  if (k1 < 0 || k2 < k1 || k2 >= _Attributes._z) {
+    cerr << this->NameOfClass() << "::ReadSlab: Slice indices out of range" << endl;
+    exit(1);
+  }
+  UniquePtr<BaseImage> image(this->Run());
+  BaseImage *output = nullptr;
+  image->GetRegion(output, 0, 0, k1, _Attributes._x, _Attributes._y, k2 + 1);
+  return output;
+}
+
 
 } // namespace mirtk
@@ -166,6 +166,7 @@ void NiftiImageReader::Initialize()
 {
   // Close old file
   this->Close();
+  _ContainsNaN = -1;
 
   // Read header
   this->ReadHeader();
@@ -396,6 +397,12 @@ void NiftiImageReader::ReadHeader()
   _Start = static_cast<int>(_Nifti->nim->iname_offset);
 }
 
+// -----------------------------------------------------------------------------
+string NiftiImageReader::DataFileName() const
+{
+  return _ImageName;
+}
+
 // -----------------------------------------------------------------------------
 void NiftiImageReader::Print() const
 {
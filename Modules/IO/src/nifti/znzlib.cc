@@ -61,8 +61,24 @@ znzFile znzopen(const char *path, const char *mode, int use_compression)
 
 #ifdef HAVE_ZLIB
   file->zfptr = NULL;
+  file->zofptr = NULL;
 
-  if (use_compression) {
+  if (use_compression && mode[0] == 'w') {
+    /* write blocked gzip file using MIRTK output stream, which
+       compresses blocks in parallel (compression level may follow mode) */
+    FILE *fp = fopen(path,mode);
+    if (fp == NULL) {
+      free(file);
+      return NULL;
+    }
+    fclose(fp);
+    file->withz = 1;
+    file->zofptr = new Cofstream();
+    for (const char *c = mode; *c != '\0'; ++c) {
+      if ('0' <= *c && *c <= '9') file->zofptr->CompressionLevel(*c - '0');
+    }
+    file->zofptr->Open(path);
+  } else if (use_compression) {
     file->withz = 1;
     if((file->zfptr = gzopen(path,mode)) == NULL) {
         free(file);
@@ -94,6 +110,7 @@ znzFile znzdopen(int fd, const char *mode, int use_compression)
      return NULL;
   }
 #ifdef HAVE_ZLIB
+  file->zofptr = NULL;
   if (use_compression) {
     file->withz = 1;
     file->zfptr = gzdopen(fd,mode);
@@ -118,6 +135,7 @@ int Xznzclose(znzFile * file)
   if (*file!=NULL) {
 #ifdef HAVE_ZLIB
     if ((*file)->zfptr!=NULL)  { retval = gzclose((*file)->zfptr); }
+    if ((*file)->zofptr!=NULL) { (*file)->zofptr->Close(); delete (*file)->zofptr; }
 #endif
     if ((*file)->nzfptr!=NULL) { retval = fclose((*file)->nzfptr); }
                                                                                 
@@ -142,6 +160,8 @@ size_t znzread(void* buf, size_t size, size_t nmemb, znzFile file)
   unsigned   n2read;
   int        nread;
 
+  if (file->zofptr!=NULL) return 0;
+
   if (file->zfptr!=NULL) {
     /* gzread/write take unsigned int length, so maybe read in int pieces
        (noted by M Hanke, example given by M Adler)   6 July 2010 [rickr] */
@@ -177,6 +197,11 @@ size_t znzwrite(const void* buf, size_t size, size_t nmemb, znzFile file)
   unsigned   n2write;
   int        nwritten;
 
+  if (file->zofptr!=NULL) {
+    if (!file->zofptr->Write(cbuf, -1, (long)remain)) return 0;
+    return nmemb;
+  }
+
   if (file->zfptr!=NULL) {
     while( remain > 0 ) {
        n2write = (remain < ZNZ_MAX_BLOCK_SIZE) ? remain : ZNZ_MAX_BLOCK_SIZE;
@@ -207,6 +232,14 @@ long znzseek(znzFile file, long offset, int whence)
   if (file==NULL) { return 0; }
 #ifdef HAVE_ZLIB
   if (file->zfptr!=NULL) return (long) gzseek(file->zfptr,offset,whence);
+  if (file->zofptr!=NULL) {
+    /* only forward seeks are supported, gap is filled with zeros */
+    const long pos = file->zofptr->Tell();
+    if (whence == SEEK_CUR) offset += pos;
+    else if (whence != SEEK_SET) return -1;
+    if (offset < pos || !file->zofptr->Write(NULL, offset, 0)) return -1;
+    return offset;
+  }
 #endif
   return fseek(file->nzfptr,offset,whence);
 }
@@ -222,6 +255,7 @@ int znzrewind(znzFile stream)
   */
 
   if (stream->zfptr!=NULL) return (int)gzseek(stream->zfptr, 0L, SEEK_SET);
+  if (stream->zofptr!=NULL) return (stream->zofptr->Tell() == 0L ? 0 : -1);
 #endif
   rewind(stream->nzfptr);
   return 0;
@@ -232,6 +266,7 @@ long znztell(znzFile file)
   if (file==NULL) { return 0; }
 #ifdef HAVE_ZLIB
   if (file->zfptr!=NULL) return (long) gztell(file->zfptr);
+  if (file->zofptr!=NULL) return file->zofptr->Tell();
 #endif
   return ftell(file->nzfptr);
 }
@@ -241,6 +276,7 @@ int znzputs(const char * str, znzFile file)
   if (file==NULL) { return 0; }
 #ifdef HAVE_ZLIB
   if (file->zfptr!=NULL) return gzputs(file->zfptr,str);
+  if (file->zofptr!=NULL) return (file->zofptr->WriteAsString(str) ? (int)strlen(str) : -1);
 #endif
   return fputs(str,file->nzfptr);
 }
@@ -251,6 +287,7 @@ char * znzgets(char* str, int size, znzFile file)
   if (file==NULL) { return NULL; }
 #ifdef HAVE_ZLIB
   if (file->zfptr!=NULL) return gzgets(file->zfptr,str,size);
+  if (file->zofptr!=NULL) return NULL;
 #endif
   return fgets(str,size,file->nzfptr);
 }
@@ -261,6 +298,7 @@ int znzflush(znzFile file)
   if (file==NULL) { return 0; }
 #ifdef HAVE_ZLIB
   if (file->zfptr!=NULL) return gzflush(file->zfptr,Z_SYNC_FLUSH);
+  if (file->zofptr!=NULL) return 0;
 #endif
   return fflush(file->nzfptr);
 }
@@ -271,6 +309,7 @@ int znzeof(znzFile file)
   if (file==NULL) { return 0; }
 #ifdef HAVE_ZLIB
   if (file->zfptr!=NULL) return gzeof(file->zfptr);
+  if (file->zofptr!=NULL) return 0;
 #endif
   return feof(file->nzfptr);
 }
@@ -281,6 +320,7 @@ int znzputc(int c, znzFile file)
   if (file==NULL) { return 0; }
 #ifdef HAVE_ZLIB
   if (file->zfptr!=NULL) return gzputc(file->zfptr,c);
+  if (file->zofptr!=NULL) return (file->zofptr->WriteAsChar((char)c) ? c : -1);
 #endif
   return fputc(c,file->nzfptr);
 }
@@ -291,6 +331,7 @@ int znzgetc(znzFile file)
   if (file==NULL) { return 0; }
 #ifdef HAVE_ZLIB
   if (file->zfptr!=NULL) return gzgetc(file->zfptr);
+  if (file->zofptr!=NULL) return -1;
 #endif
   return fgetc(file->nzfptr);
 }
@@ -303,7 +344,7 @@ int znzprintf(znzFile stream, const char *format, ...)
   if (stream==NULL) { return 0; }
   va_start(va, format);
 #ifdef HAVE_ZLIB
-  if (stream->zfptr!=NULL) {
+  if (stream->zfptr!=NULL || stream->zofptr!=NULL) {
     char *tmpstr;
     int size;  /* local to HAVE_ZLIB block */
     size = strlen(format) + 1000000;  /* overkill I hope */
@@ -313,7 +354,11 @@ int znzprintf(znzFile stream, const char *format, ...)
        return retval;
     }
     vsprintf(tmpstr,format,va);
-    retval=gzprintf(stream->zfptr,"%s",tmpstr);
+    if (stream->zofptr!=NULL) {
+      retval=(stream->zofptr->WriteAsString(tmpstr) ? (int)strlen(tmpstr) : -1);
+    } else {
+      retval=gzprintf(stream->zfptr,"%s",tmpstr);
+    }
     free(tmpstr);
   } else 
 #endif
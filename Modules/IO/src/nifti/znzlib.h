@@ -55,6 +55,7 @@ NB: seeks for writable files with compression are quite restricted
 #  else
 #    include "zlib.h"
 #  endif
+#  include "mirtk/Cofstream.h"
 #endif
 
 
@@ -66,6 +67,7 @@ struct znzptr {
   FILE* nzfptr;
 #ifdef HAVE_ZLIB
   gzFile zfptr;
+  Cofstream *zofptr; /* blocked gzip output stream, written in parallel */
 #endif
 } ;
 
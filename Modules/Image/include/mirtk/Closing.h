@@ -43,6 +43,9 @@ class Closing : public ImageToImage<TVoxel>
   /// Number of dilation/erosion iterations
   mirtkPublicAttributeMacro(int, NumberOfIterations);
 
+  /// Radius of ball structuring element in world units, unused if not positive
+  mirtkPublicAttributeMacro(double, Radius);
+
 public:
 
   /// Constructor
@@ -76,6 +79,19 @@ void Close(BaseImage *image, int iterations, ConnectivityType connectivity)
   closing.Run();
 }
 
+// -----------------------------------------------------------------------------
+template <class TVoxel>
+void Close(BaseImage *image, double radius)
+{
+  GenericImage<TVoxel> * const im = dynamic_cast<GenericImage<TVoxel> *>(image);
+  mirtkAssert(im != nullptr, "template function called with correct type");
+  Closing<TVoxel> closing;
+  closing.Radius(radius);
+  closing.Input (im);
+  closing.Output(im);
+  closing.Run();
+}
+
 
 } // namespace mirtk
 
@@ -23,7 +23,6 @@
 #include "mirtk/ImageToImage.h"
 
 #include "mirtk/Array.h"
-#include "mirtk/OrderedSet.h"
 #include "mirtk/NeighborhoodOffsets.h"
 
 
@@ -38,12 +37,27 @@ enum ConnectedComponentsOrdering
   CC_SmallestFirst ///< Sort by increasing size
 };
 
+/// Statistics of a connected component
+struct ConnectedComponent
+{
+  int    Size;        ///< Number of voxels
+  int    Bounds[6];   ///< Bounding box in voxel coordinates, i.e., (i1, i2, j1, j2, k1, k2)
+  double Centroid[3]; ///< Centroid in voxel coordinates
+};
+
 
 /**
  * Label the connected components of a segmentation.
  *
  * The components are sorted by decreasing size, i.e., the first
  * component is the largest connected component.
+ *
+ * Neighboring voxels are connected when they have the same non-zero label.
+ * The image is split into slabs of consecutive slices which are labelled in
+ * parallel using a union-find forest. Components which cross slab boundaries
+ * are merged afterwards. The size, bounding box, and centroid of each
+ * component are computed while assigning the final component labels.
+ * Voxels of different time frames are never connected.
  */
 template <class TVoxel = GreyPixel>
 class ConnectedComponents : public ImageToImage<TVoxel>
@@ -61,15 +75,15 @@ protected:
   /// What connectivity to assume when running the filter.
   mirtkPublicAttributeMacro(ConnectivityType, Connectivity);
 
-  /// List of voxel offsets of the neighborhood
-  mirtkAttributeMacro(NeighborhoodOffsets, Offsets);
-
   /// Number of connected components
   mirtkReadOnlyAttributeMacro(int, NumberOfComponents);
 
   /// Sizes of connected components
   mirtkReadOnlyAttributeMacro(Array<int>, ComponentSize);
 
+  /// Statistics of connected components
+  mirtkReadOnlyAttributeMacro(Array<ConnectedComponent>, Components);
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 
@@ -84,7 +98,7 @@ public:
   // ---------------------------------------------------------------------------
   // Execution
 
-  /// Run erosion
+  /// Label connected components
   virtual void Run();
 
   /// Remove specified component from the output image
@@ -98,6 +112,11 @@ public:
   /// \param[in] label Component label (1-based).
   int ComponentSize(VoxelType label) const;
 
+  /// Statistics of the specified component
+  ///
+  /// \param[in] label Component label (1-based).
+  const ConnectedComponent &Component(VoxelType label) const;
+
 protected:
 
   /// Initialize the filter execution
@@ -153,6 +172,13 @@ inline int ConnectedComponents<TVoxel>::ComponentSize(VoxelType label) const
   return _ComponentSize[label-1];
 }
 
+// -----------------------------------------------------------------------------
+template <class TVoxel>
+inline const ConnectedComponent &ConnectedComponents<TVoxel>::Component(VoxelType label) const
+{
+  return _Components[label-1];
+}
+
 
 } // namespace mirtk
 
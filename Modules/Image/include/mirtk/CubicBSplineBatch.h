@@ -0,0 +1,119 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2017 Imperial College London
+ * Copyright 2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_CubicBSplineBatch_H
+#define MIRTK_CubicBSplineBatch_H
+
+#include "mirtk/ImageExport.h"
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Instruction sets
+// =============================================================================
+
+/// Instruction set used for batch evaluation of cubic B-splines
+enum CubicBSplineBatchMode
+{
+  CubicBSplineBatch_Default, ///< Fastest instruction set supported by the CPU
+  CubicBSplineBatch_Scalar,  ///< One point at a time
+  CubicBSplineBatch_AVX2,    ///< 256-bit AVX2 vectors with gather loads
+  CubicBSplineBatch_AVX512   ///< 512-bit AVX-512 vectors with gather loads
+};
+
+/// Fastest instruction set for batch evaluation supported by the CPU
+///
+/// Vectorized evaluation is available on x86 processors when MIRTK is
+/// compiled with GCC or Clang. The CPU is queried only once at runtime.
+MIRTK_Image_EXPORT CubicBSplineBatchMode CubicBSplineBatchCPUMode();
+
+// =============================================================================
+// Evaluation
+// =============================================================================
+
+/// Evaluate 3D cubic B-spline and optionally its first order derivatives at multiple points
+///
+/// The 4x4x4 coefficients of point p start at index offset[p] of the coefficient
+/// array, where rows are X and slices XY coefficients apart. The spline weights
+/// of point p are given by the rows a[p], b[p], and c[p] of the lookup tables
+/// of BSpline<T>, which must have been initialized before. Vectorized modes
+/// evaluate multiple points at once in the same order of operations as the
+/// scalar mode, such that all modes yield the same result up to rounding
+/// differences when the compiler contracts products and sums differently.
+///
+/// \param[in]  mode   Instruction set.
+/// \param[in]  n      Number of points.
+/// \param[in]  coeff  Spline coefficients.
+/// \param[in]  X      Number of coefficients in each row.
+/// \param[in]  XY     Number of coefficients in each slice.
+/// \param[in]  offset Index of first coefficient of each point.
+/// \param[in]  a      Lookup table index of spline weights along x.
+/// \param[in]  b      Lookup table index of spline weights along y.
+/// \param[in]  c      Lookup table index of spline weights along z.
+/// \param[out] v      Spline values.
+/// \param[out] dx     Spline derivatives w.r.t. x, or nullptr if not needed.
+/// \param[out] dy     Spline derivatives w.r.t. y, required when \p dx is given.
+/// \param[out] dz     Spline derivatives w.r.t. z, required when \p dx is given.
+MIRTK_Image_EXPORT void
+EvaluateCubicBSpline3D(CubicBSplineBatchMode mode, int n,
+                       const double *coeff, int X, int XY, const int *offset,
+                       const int *a, const int *b, const int *c, double *v,
+                       double *dx = nullptr, double *dy = nullptr, double *dz = nullptr);
+
+/// Evaluate 3D cubic B-spline with single-precision coefficients
+MIRTK_Image_EXPORT void
+EvaluateCubicBSpline3D(CubicBSplineBatchMode mode, int n,
+                       const float *coeff, int X, int XY, const int *offset,
+                       const int *a, const int *b, const int *c, float *v,
+                       float *dx = nullptr, float *dy = nullptr, float *dz = nullptr);
+
+/// Evaluate 3D cubic B-spline at multiple points given the spline weights of each point
+///
+/// Instead of rows of the lookup tables of BSpline<T>, the four spline weights
+/// of point p along each axis are given by wx[4*p+i], wy[4*p+j], and wz[4*p+k],
+/// e.g., the exact weights computed by BSpline<T>::Weights. Otherwise the same
+/// as the overload which takes lookup table indices, but without derivatives.
+///
+/// \param[in]  mode   Instruction set.
+/// \param[in]  n      Number of points.
+/// \param[in]  coeff  Spline coefficients.
+/// \param[in]  X      Number of coefficients in each row.
+/// \param[in]  XY     Number of coefficients in each slice.
+/// \param[in]  offset Index of first coefficient of each point.
+/// \param[in]  wx     Spline weights along x, four per point.
+/// \param[in]  wy     Spline weights along y, four per point.
+/// \param[in]  wz     Spline weights along z, four per point.
+/// \param[out] v      Spline values.
+MIRTK_Image_EXPORT void
+EvaluateCubicBSpline3D(CubicBSplineBatchMode mode, int n,
+                       const double *coeff, int X, int XY, const int *offset,
+                       const double *wx, const double *wy, const double *wz, double *v);
+
+/// Evaluate 3D cubic B-spline with single-precision coefficients and given spline weights
+MIRTK_Image_EXPORT void
+EvaluateCubicBSpline3D(CubicBSplineBatchMode mode, int n,
+                       const float *coeff, int X, int XY, const int *offset,
+                       const float *wx, const float *wy, const float *wz, float *v);
+
+
+} // namespace mirtk
+
+#endif // MIRTK_CubicBSplineBatch_H
@@ -22,6 +22,7 @@
 
 #include "mirtk/BaseImage.h"
 #include "mirtk/CubicBSplineInterpolateImageFunction.h"
+#include "mirtk/CubicBSplineBatch.h"
 
 
 namespace mirtk {
@@ -37,6 +38,19 @@ class GenericCubicBSplineInterpolateImageFunction3D
   mirtkObjectMacro(GenericCubicBSplineInterpolateImageFunction3D);
   mirtkGenericInterpolatorTypes(GenericCubicBSplineInterpolateImageFunction);
 
+public:
+
+  typedef typename Superclass::Kernel Kernel;
+
+  /// Maximum number of points evaluated at once by batch evaluation functions
+  static const int BatchSize = 64;
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Instruction set used by batch evaluation functions
+  mirtkPublicAttributeMacro(CubicBSplineBatchMode, BatchMode);
+
 public:
 
   /// Default constructor
@@ -104,6 +118,47 @@ public:
   /// If fully outside the foreground region, the _DefaultValue is returned.
   virtual VoxelType GetWithPaddingOutside(double, double, double, double = 0) const;
 
+  // Import overloads of base class which are not overridden
+  using Superclass::EvaluateInside;
+  using Superclass::Evaluate;
+
+  /// Evaluate all channels of image without handling boundary conditions
+  ///
+  /// The tensor product spline weights and the index of the first coefficient
+  /// are computed only once and shared by all channels, e.g., the components
+  /// of a precomputed image gradient, instead of once per channel.
+  virtual void EvaluateInside(double *, double, double, double = 0, int = 1) const;
+
+  /// Evaluate all channels of image at multiple points without handling boundary conditions
+  ///
+  /// The points must lie inside the domain for which EvaluateInside is defined.
+  /// The exact spline weights of up to BatchSize points are computed at once
+  /// and the points are evaluated using the instruction set specified by
+  /// BatchMode, in the same order of operations as EvaluateInside.
+  ///
+  /// \param[in]  n Number of points.
+  /// \param[in]  x Voxel coordinates of points along x axis.
+  /// \param[in]  y Voxel coordinates of points along y axis.
+  /// \param[in]  z Voxel coordinates of points along z axis.
+  /// \param[out] v Values of image channels, where v[p * T + l] is the value
+  ///               of channel l at point p and T the number of channels.
+  void EvaluateInside(int n, const double *x, const double *y, const double *z, double *v) const;
+
+  /// Evaluate all channels of image at multiple points
+  ///
+  /// Consecutive points inside the domain for which EvaluateInside is defined
+  /// are evaluated in batches, whereas points near the boundary or outside the
+  /// image domain are evaluated one at a time using EvaluateOutside.
+  void Evaluate(int n, const double *x, const double *y, const double *z, double *v) const;
+
+protected:
+
+  /// Evaluate points inside the domain in batches of at most BatchSize points
+  void EvaluateBatchInside(int, const double *, const double *, const double *, double *) const;
+
+  /// Evaluate consecutive inside points in batches and other points one at a time
+  void EvaluateBatch(int, const double *, const double *, const double *, double *, bool) const;
+
 };
 
 /**
@@ -27,10 +27,70 @@
 namespace mirtk {
 
 
+// =============================================================================
+// Auxiliary functions
+// =============================================================================
+
+namespace CubicBSplineInterpolateImageFunction3DUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Batch evaluation of cubic B-spline with given type of coefficients
+///
+/// Only scalar coefficients are supported, see EvaluateCubicBSpline3D.
+template <class T>
+struct BatchEvaluation
+{
+  static const bool Supported = false;
+
+  template <class W>
+  static void Evaluate(CubicBSplineBatchMode, int, const T *, int, int, const int *,
+                       const W *, const W *, const W *, T *)
+  {
+  }
+};
+
+// -----------------------------------------------------------------------------
+template <>
+struct BatchEvaluation<float>
+{
+  static const bool Supported = true;
+
+  static void Evaluate(CubicBSplineBatchMode mode, int n, const float *coeff, int X, int XY,
+                       const int *offset, const float *wx, const float *wy, const float *wz,
+                       float *v)
+  {
+    EvaluateCubicBSpline3D(mode, n, coeff, X, XY, offset, wx, wy, wz, v);
+  }
+};
+
+// -----------------------------------------------------------------------------
+template <>
+struct BatchEvaluation<double>
+{
+  static const bool Supported = true;
+
+  static void Evaluate(CubicBSplineBatchMode mode, int n, const double *coeff, int X, int XY,
+                       const int *offset, const double *wx, const double *wy, const double *wz,
+                       double *v)
+  {
+    EvaluateCubicBSpline3D(mode, n, coeff, X, XY, offset, wx, wy, wz, v);
+  }
+};
+
+
+} // namespace CubicBSplineInterpolateImageFunction3DUtils
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
 // -----------------------------------------------------------------------------
 template <class TImage>
 GenericCubicBSplineInterpolateImageFunction3D<TImage>
 ::GenericCubicBSplineInterpolateImageFunction3D()
+:
+  _BatchMode(CubicBSplineBatch_Default)
 {
   this->NumberOfDimensions(3);
 }
@@ -117,6 +177,142 @@ GenericCubicBSplineInterpolateImageFunction3D<TImage>
   }
 }
 
+// -----------------------------------------------------------------------------
+template <class TImage>
+inline void GenericCubicBSplineInterpolateImageFunction3D<TImage>
+::EvaluateInside(double *v, double x, double y, double z, int vt) const
+{
+  int i = ifloor(x);
+  int j = ifloor(y);
+  int k = ifloor(z);
+
+  Real wx[4]; Kernel::Weights(Real(x - i), wx);
+  Real wy[4]; Kernel::Weights(Real(y - j), wy);
+  Real wz[4]; Kernel::Weights(Real(z - k), wz);
+
+  // Tensor product weights in order of coefficient iteration
+  Real w[64], wyz, *wabc = w;
+  for (int c = 0; c <= 3; ++c)
+  for (int b = 0; b <= 3; ++b) {
+    wyz = wy[b] * wz[c];
+    for (int a = 0; a <= 3; ++a, ++wabc) {
+      (*wabc) = wx[a] * wyz;
+    }
+  }
+
+  --i, --j, --k;
+
+  const int s2 = this->_s2;
+  const int s3 = this->_s3;
+
+  RealType        val;
+  const RealType *coeff;
+  const Real     *wa;
+
+  for (int l = 0; l < this->Input()->T(); ++l, v += vt) {
+    val   = voxel_cast<RealType>(0);
+    coeff = this->_Coefficient.Data(i, j, k, l);
+    wa    = w;
+    for (int c = 0; c <= 3; ++c, coeff += s3) {
+      for (int b = 0; b <= 3; ++b, coeff += s2, wa += 4) {
+        val += wa[0] * coeff[0];
+        val += wa[1] * coeff[1];
+        val += wa[2] * coeff[2];
+        val += wa[3] * coeff[3];
+        coeff += 4;
+      }
+    }
+    (*v) = voxel_cast<double>(voxel_cast<VoxelType>(val));
+  }
+}
+
+// =============================================================================
+// Batch evaluation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+template <class TImage>
+void GenericCubicBSplineInterpolateImageFunction3D<TImage>
+::EvaluateBatchInside(int n, const double *x, const double *y, const double *z, double *v) const
+{
+  typedef CubicBSplineInterpolateImageFunction3DUtils::BatchEvaluation<RealType> Batch;
+
+  const int nc  = this->Input()->T();
+  const int X   = this->_Coefficient.X();
+  const int XY  = this->_Coefficient.Y() * X;
+  const int XYZ = this->_Coefficient.Z() * XY;
+
+  int      offset[BatchSize];
+  Real     wx[4 * BatchSize], wy[4 * BatchSize], wz[4 * BatchSize];
+  RealType val[BatchSize];
+  int      i, j, k, m;
+
+  for (int p0 = 0; p0 < n; p0 += BatchSize) {
+    m = min(n - p0, int(BatchSize));
+    // Spline weights and first coefficient are shared by all channels
+    for (int p = 0, q = p0; p < m; ++p, ++q) {
+      i = ifloor(x[q]);
+      j = ifloor(y[q]);
+      k = ifloor(z[q]);
+      Kernel::Weights(Real(x[q] - i), wx + 4 * p);
+      Kernel::Weights(Real(y[q] - j), wy + 4 * p);
+      Kernel::Weights(Real(z[q] - k), wz + 4 * p);
+      offset[p] = (i - 1) + (j - 1) * X + (k - 1) * XY;
+    }
+    for (int l = 0; l < nc; ++l) {
+      const RealType *coeff = this->_Coefficient.Data() + l * XYZ;
+      Batch::Evaluate(_BatchMode, m, coeff, X, XY, offset, wx, wy, wz, val);
+      for (int p = 0; p < m; ++p) {
+        v[(p0 + p) * nc + l] = voxel_cast<double>(voxel_cast<VoxelType>(val[p]));
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+template <class TImage>
+void GenericCubicBSplineInterpolateImageFunction3D<TImage>
+::EvaluateBatch(int n, const double *x, const double *y, const double *z,
+                double *v, bool inside) const
+{
+  typedef CubicBSplineInterpolateImageFunction3DUtils::BatchEvaluation<RealType> Batch;
+  if (!Batch::Supported) {
+    this->Throw(ERR_NotImplemented, __FUNCTION__, "Not implemented for non-scalar voxel type");
+  }
+
+  const int nc = this->Input()->T();
+
+  int p = 0, q;
+  while (p < n) {
+    // Consecutive points for which no boundary conditions are needed
+    for (q = p; q < n && (inside || this->IsInside(x[q], y[q], z[q])); ++q);
+    if (q > p) {
+      EvaluateBatchInside(q - p, x + p, y + p, z + p, v + p * nc);
+      p = q;
+    }
+    // Consecutive points which require extrapolation of the image
+    for (; p < n && !this->IsInside(x[p], y[p], z[p]); ++p) {
+      this->EvaluateOutside(v + p * nc, x[p], y[p], z[p], 1);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+template <class TImage>
+void GenericCubicBSplineInterpolateImageFunction3D<TImage>
+::EvaluateInside(int n, const double *x, const double *y, const double *z, double *v) const
+{
+  EvaluateBatch(n, x, y, z, v, true);
+}
+
+// -----------------------------------------------------------------------------
+template <class TImage>
+void GenericCubicBSplineInterpolateImageFunction3D<TImage>
+::Evaluate(int n, const double *x, const double *y, const double *z, double *v) const
+{
+  EvaluateBatch(n, x, y, z, v, false);
+}
+
 
 } // namespace mirtk
 
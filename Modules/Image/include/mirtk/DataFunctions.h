@@ -22,45 +22,172 @@
 
 #include "mirtk/DataOp.h"
 #include "mirtk/DataStatistics.h"
+#include "mirtk/Array.h"
 #include "mirtk/Parallel.h"
 
 
 namespace mirtk { namespace data { namespace op {
 
 
+// -----------------------------------------------------------------------------
+/// Base class of operations which process each data element independently
+///
+/// The processing of a data sequence is split into the initialization of the
+/// operation for the given data, the processing of the data elements within
+/// a range of indices, and the release of temporary resources afterwards.
+/// This allows ElementWiseOpSequence to apply a chain of element-wise
+/// operations in a single pass over the data.
+class ElementWiseOp : public Op
+{
+  /// Body of parallel_for loop which calls the virtual Apply function
+  class Body
+  {
+    const ElementWiseOp *_Op;
+
+  public:
+
+    Body(const ElementWiseOp *op) : _Op(op) {}
+
+    void operator()(const blocked_range<int> &re) const
+    {
+      _Op->Apply(re);
+    }
+  };
+
+public:
+
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = nullptr) = 0;
+
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &) const = 0;
+
+  /// Finalize processing and release temporary memory
+  virtual void Finalize() {}
+
+  /// Process given data (not thread-safe!)
+  virtual void Process(int n, double *data, bool *mask = nullptr)
+  {
+    this->Initialize(n, data, mask);
+    parallel_for(blocked_range<int>(0, n), Body(this));
+    this->Finalize();
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Sequence of element-wise operations processed in a single pass
+///
+/// Instead of one parallel pass over the entire data sequence for each
+/// operation, the data is split into blocks which are small enough to remain
+/// in cache, and all operations are applied to one block before the next.
+/// The result is identical to processing the operations one after another.
+/// The operations are not owned by the sequence.
+class ElementWiseOpSequence : public ElementWiseOp
+{
+  /// Number of data elements processed by all operations at once
+  mirtkPublicAttributeMacro(int, BlockSize);
+
+  /// Operations in order of execution
+  Array<ElementWiseOp *> _Ops;
+
+public:
+
+  /// Constructor
+  ElementWiseOpSequence(int block_size = 2048) : _BlockSize(block_size) {}
+
+  /// Append operation to sequence
+  void Add(ElementWiseOp *op)
+  {
+    _Ops.push_back(op);
+  }
+
+  /// Number of operations in sequence
+  int NumberOfOps() const
+  {
+    return static_cast<int>(_Ops.size());
+  }
+
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = nullptr)
+  {
+    for (size_t i = 0; i < _Ops.size(); ++i) {
+      _Ops[i]->Initialize(n, data, mask);
+    }
+  }
+
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
+  {
+    for (int begin = re.begin(), end; begin < re.end(); begin = end) {
+      end = min(begin + _BlockSize, re.end());
+      const blocked_range<int> block(begin, end);
+      for (size_t i = 0; i < _Ops.size(); ++i) {
+        _Ops[i]->Apply(block);
+      }
+    }
+  }
+
+  /// Finalize processing and release temporary memory
+  virtual void Finalize()
+  {
+    for (size_t i = 0; i < _Ops.size(); ++i) {
+      _Ops[i]->Finalize();
+    }
+  }
+};
+
 // -----------------------------------------------------------------------------
 /// Reset data mask
-class ResetMask : public Op
+class ResetMask : public ElementWiseOp
 {
 private:
 
-  bool _Value;
+  bool *_Mask;
+  bool  _Value;
 
 public:
 
-  ResetMask(bool value = true) : _Value(value) {}
+  ResetMask(bool value = true) : _Mask(nullptr), _Value(value) {}
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *, bool *mask = nullptr)
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int, double *, bool *mask = nullptr)
+  {
+    _Mask = mask;
+  }
+
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    if (mask != nullptr) {
-      memset(mask, _Value ? 1 : 0, n * sizeof(bool));
+    if (_Mask != nullptr) {
+      memset(_Mask + re.begin(), _Value ? 1 : 0, (re.end() - re.begin()) * sizeof(bool));
     }
   }
 };
 
 // -----------------------------------------------------------------------------
 /// Invert mask values
-class InvertMask : public Op
+class InvertMask : public ElementWiseOp
 {
+private:
+
+  bool *_Mask;
+
 public:
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *, bool *mask = nullptr)
+  InvertMask() : _Mask(nullptr) {}
+
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int, double *, bool *mask = nullptr)
   {
-    if (mask != nullptr) {
-      for (int i = 0; i < n; ++i) {
-        mask[i] = !mask[i];
+    _Mask = mask;
+  }
+
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
+  {
+    if (_Mask != nullptr) {
+      for (int i = re.begin(); i != re.end(); ++i) {
+        _Mask[i] = !_Mask[i];
       }
     }
   }
@@ -68,7 +195,7 @@ public:
 
 // -----------------------------------------------------------------------------
 /// Set value of unmasked data points
-class SetInsideValue : public Op
+class SetInsideValue : public ElementWiseOp
 {
 private:
 
@@ -80,8 +207,15 @@ public:
 
   SetInsideValue(double value = .0) : _Value(value) {}
 
-  // Called by TBB's parallel_for, for internal use only!
-  void operator()(const blocked_range<int> &re) const
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int, double *data, bool *mask = NULL)
+  {
+    _Data = data;
+    _Mask = mask;
+  }
+
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
     double *data = _Data + re.begin();
     if (_Mask) {
@@ -95,19 +229,11 @@ public:
       }
     }
   }
-
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
-  {
-    _Data = data;
-    _Mask = mask;
-    parallel_for(blocked_range<int>(0, n), *this);
-  }
 };
 
 // -----------------------------------------------------------------------------
 /// Set value of masked data points
-class SetOutsideValue : public Op
+class SetOutsideValue : public ElementWiseOp
 {
 private:
 
@@ -119,30 +245,31 @@ public:
 
   SetOutsideValue(double value = .0) : _Value(value) {}
 
-  // Called by TBB's parallel_for, for internal use only!
-  void operator()(const blocked_range<int> &re) const
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int, double *data, bool *mask = NULL)
   {
-    double *data = _Data + re.begin();
-    bool   *mask = _Mask + re.begin();
-    for (int i = re.begin(); i != re.end(); ++i, ++data, ++mask) {
-      if (*mask == false) *data = _Value;
-    }
+    _Data = data;
+    _Mask = mask;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    if (mask) {
-      _Data = data;
-      _Mask = mask;
-      parallel_for(blocked_range<int>(0, n), *this);
+    if (_Mask) {
+      double *data = _Data + re.begin();
+      bool   *mask = _Mask + re.begin();
+      for (int i = re.begin(); i != re.end(); ++i, ++data, ++mask) {
+        if (*mask == false) *data = _Value;
+      }
     }
   }
 };
 
 // -----------------------------------------------------------------------------
 /// Base class of element-wise data transformations
-class ElementWiseUnaryOp : public Op
+///
+/// Subclasses implement Op and override Apply by calling ApplyOp.
+class ElementWiseUnaryOp : public ElementWiseOp
 {
 private:
 
@@ -151,39 +278,45 @@ private:
 
 public:
 
-  // Called by TBB's parallel_for, for internal use only!
-  void operator()(const blocked_range<int> &re) const
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int, double *data, bool *mask = NULL)
   {
+    _Data = data;
+    _Mask = mask;
+  }
+
+  /// Transform data value and/or mask it by setting mask = false
+  virtual double Op(double value, bool &) const = 0;
+
+protected:
+
+  /// Process data elements in given range using Op of the specified subclass
+  ///
+  /// The Op function is called non-virtually such that it can be inlined.
+  template <class TOp>
+  void ApplyOp(const blocked_range<int> &re) const
+  {
+    const TOp * const op = static_cast<const TOp *>(this);
     double *data = _Data + re.begin();
     if (_Mask) {
       bool *mask = _Mask + re.begin();
       for (int i = re.begin(); i != re.end(); ++i, ++data, ++mask) {
-        if (*mask) *data = this->Op(*data, *mask);
+        if (*mask) *data = op->TOp::Op(*data, *mask);
       }
     } else {
       bool mask = true;
       for (int i = re.begin(); i != re.end(); ++i, ++data) {
-        *data = this->Op(*data, mask);
+        *data = op->TOp::Op(*data, mask);
       }
     }
   }
-
-  /// Transform data value and/or mask it by setting mask = false
-  virtual double Op(double value, bool &) const = 0;
-
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
-  {
-    _Data = data;
-    _Mask = mask;
-    // MUST be called in the base class which defines Op!
-    //parallel_for(blocked_range<int>(0, n), *this);
-  }
 };
 
 // -----------------------------------------------------------------------------
 /// Base class of element-wise data transformations
-class ElementWiseBinaryOp : public Op
+///
+/// Subclasses implement Op and override Apply by calling ApplyOp.
+class ElementWiseBinaryOp : public ElementWiseOp
 {
   /// Constant value of right-hand side
   mirtkPublicAttributeMacro(double, Constant);
@@ -258,23 +391,54 @@ protected:
 
 public:
 
-  // Called by TBB's parallel_for, for internal use only!
-  void operator()(const blocked_range<int> &re) const
+  /// Transform data value and/or mask it by setting mask = false
+  virtual double Op(double value, double, bool &) const = 0;
+
+  /// Initialize processing and read data from file
+  virtual void Initialize(int n, double *data, bool *mask = nullptr)
   {
+    _Data = data;
+    _Mask = mask;
+    _Other.reset();
+    if (!_FileName.empty()) {
+      UniquePtr<double[]> other;
+      if (n != Read(_FileName.c_str(), other, nullptr, nullptr, nullptr, _ArrayName.c_str(), _IsCellData)) {
+        cerr << "Input file " << _FileName << " has different number of data points!" << endl;
+        exit(1);
+      }
+      _Other = SharedPtr<double>(other.release(), std::default_delete<double[]>());
+    }
+  }
+
+  /// Finalize processing and release temporary memory
+  virtual void Finalize()
+  {
+    _Other.reset();
+  }
+
+protected:
+
+  /// Process data elements in given range using Op of the specified subclass
+  ///
+  /// The Op function is called non-virtually such that it can be inlined.
+  template <class TOp>
+  void ApplyOp(const blocked_range<int> &re) const
+  {
+    const TOp * const op = static_cast<const TOp *>(this);
     double *data = _Data + re.begin();
     if (_Other) {
       double *other = _Other.get() + re.begin();
       if (_Mask) {
         bool *mask = _Mask + re.begin();
         for (int i = re.begin(); i != re.end(); ++i) {
-          if (*mask) *data = this->Op(*data, *other, *mask);
+          if (*mask) *data = op->TOp::Op(*data, *other, *mask);
           ++data, ++other, ++mask;
         }
       } else {
         bool mask;
         for (int i = re.begin(); i != re.end(); ++i) {
           mask = true;
-          *data = this->Op(*data, *other, mask);
+          *data = op->TOp::Op(*data, *other, mask);
           ++data, ++other;
         }
       }
@@ -283,46 +447,19 @@ public:
       if (_Mask) {
         bool *mask = _Mask + re.begin();
         for (int i = re.begin(); i != re.end(); ++i) {
-          if (*mask) *data = this->Op(*data, c, *mask);
+          if (*mask) *data = op->TOp::Op(*data, c, *mask);
           ++data, ++mask;
         }
       } else {
         bool mask;
         for (int i = re.begin(); i != re.end(); ++i) {
           mask = true;
-          *data = this->Op(*data, c, mask);
+          *data = op->TOp::Op(*data, c, mask);
           ++data;
         }
       }
     }
   }
-
-  /// Transform data value and/or mask it by setting mask = false
-  virtual double Op(double value, double, bool &) const = 0;
-
-protected:
-
-  /// Initialize processing and read data from file
-  void Initialize(int n, double *data, bool *mask = nullptr)
-  {
-    _Data = data;
-    _Mask = mask;
-    _Other.reset();
-    if (!_FileName.empty()) {
-      UniquePtr<double[]> other;
-      if (n != Read(_FileName.c_str(), other, nullptr, nullptr, nullptr, _ArrayName.c_str(), _IsCellData)) {
-        cerr << "Input file " << _FileName << " has different number of data points!" << endl;
-        exit(1);
-      }
-      _Other = SharedPtr<double>(other.release(), std::default_delete<double[]>());
-    }
-  }
-
-  /// Finalize processing and release temporary memory
-  void Finalize()
-  {
-    _Other.reset();
-  }
 };
 
 // -----------------------------------------------------------------------------
@@ -337,11 +474,10 @@ public:
     return abs(value);
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Abs>(re);
   }
 };
 
@@ -361,11 +497,10 @@ public:
     return pow(value, _Exponent);
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Pow>(re);
   }
 };
 
@@ -381,11 +516,10 @@ public:
     return exp(value);
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Exp>(re);
   }
 };
 
@@ -407,11 +541,10 @@ public:
     return log(value) / log(_Base);
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Log>(re);
   }
 };
 
@@ -432,11 +565,10 @@ public:
     return log2(value);
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Lb>(re);
   }
 };
 
@@ -457,11 +589,10 @@ public:
     return log(value);
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Ln>(re);
   }
 };
 
@@ -482,11 +613,10 @@ public:
     return log10(value);
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Lg>(re);
   }
 };
 
@@ -506,11 +636,10 @@ public:
     return fmod(value, _Denominator);
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Mod>(re);
   }
 };
 
@@ -526,11 +655,10 @@ public:
     return floor(value);
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Floor>(re);
   }
 };
 
@@ -546,11 +674,10 @@ public:
     return ceil(value);
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Ceil>(re);
   }
 };
 
@@ -566,11 +693,10 @@ public:
     return round(value);
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Round>(re);
   }
 };
 
@@ -595,12 +721,10 @@ public:
     return value + constant;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    Initialize(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
-    Finalize();
+    ApplyOp<Add>(re);
   }
 };
 
@@ -625,12 +749,10 @@ public:
     return value - constant;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    Initialize(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
-    Finalize();
+    ApplyOp<Sub>(re);
   }
 };
 
@@ -655,12 +777,10 @@ public:
     return value * constant;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    Initialize(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
-    Finalize();
+    ApplyOp<Mul>(re);
   }
 };
 
@@ -685,12 +805,10 @@ public:
     return (constant != .0 ? value / constant : numeric_limits<double>::quiet_NaN());
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    Initialize(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
-    Finalize();
+    ApplyOp<Div>(re);
   }
 };
 
@@ -715,12 +833,10 @@ public:
     return (constant != .0 ? value / constant : .0);
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    Initialize(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
-    Finalize();
+    ApplyOp<DivWithZero>(re);
   }
 };
 
@@ -752,11 +868,10 @@ public:
     }
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Map>(re);
   }
 };
 
@@ -788,12 +903,10 @@ public:
     return value;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    Initialize(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
-    Finalize();
+    ApplyOp<Mask>(re);
   }
 };
 
@@ -864,13 +977,18 @@ public:
     return value;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
+  {
+    ApplyOp<MaskOutsideInterval>(re);
+  }
+
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = NULL)
   {
     if (_LowerThresholdPointer) _LowerThreshold = *_LowerThresholdPointer;
     if (_UpperThresholdPointer) _UpperThreshold = *_UpperThresholdPointer;
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ElementWiseUnaryOp::Initialize(n, data, mask);
   }
 };
 
@@ -941,13 +1059,18 @@ public:
     return value;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
+  {
+    ApplyOp<MaskOutsideOpenInterval>(re);
+  }
+
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = NULL)
   {
     if (_LowerThresholdPointer) _LowerThreshold = *_LowerThresholdPointer;
     if (_UpperThresholdPointer) _UpperThreshold = *_UpperThresholdPointer;
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ElementWiseUnaryOp::Initialize(n, data, mask);
   }
 };
 
@@ -1018,13 +1141,18 @@ public:
     return value;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
+  {
+    ApplyOp<MaskInsideInterval>(re);
+  }
+
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = NULL)
   {
     if (_LowerThresholdPointer) _LowerThreshold = *_LowerThresholdPointer;
     if (_UpperThresholdPointer) _UpperThreshold = *_UpperThresholdPointer;
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ElementWiseUnaryOp::Initialize(n, data, mask);
   }
 };
 
@@ -1095,13 +1223,18 @@ public:
     return value;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
+  {
+    ApplyOp<MaskInsideOpenInterval>(re);
+  }
+
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = NULL)
   {
     if (_LowerThresholdPointer) _LowerThreshold = *_LowerThresholdPointer;
     if (_UpperThresholdPointer) _UpperThreshold = *_UpperThresholdPointer;
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ElementWiseUnaryOp::Initialize(n, data, mask);
   }
 };
 
@@ -1118,11 +1251,10 @@ public:
     return value;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<MaskEvenValues>(re);
   }
 };
 
@@ -1139,11 +1271,10 @@ public:
     return value;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<MaskOddValues>(re);
   }
 };
 
@@ -1183,12 +1314,17 @@ public:
     return value;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
+  {
+    ApplyOp<LowerThreshold>(re);
+  }
+
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = NULL)
   {
     if (_ThresholdPointer) _Threshold = *_ThresholdPointer;
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ElementWiseUnaryOp::Initialize(n, data, mask);
   }
 };
 
@@ -1228,12 +1364,17 @@ public:
     return value;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
+  {
+    ApplyOp<UpperThreshold>(re);
+  }
+
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = NULL)
   {
     if (_ThresholdPointer) _Threshold = *_ThresholdPointer;
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ElementWiseUnaryOp::Initialize(n, data, mask);
   }
 };
 
@@ -1301,13 +1442,18 @@ public:
     return value;
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
+  {
+    ApplyOp<Clamp>(re);
+  }
+
+  /// Initialize processing of given data (not thread-safe!)
+  virtual void Initialize(int n, double *data, bool *mask = NULL)
   {
     if (_LowerThresholdPointer) _LowerThreshold = *_LowerThresholdPointer;
     if (_UpperThresholdPointer) _UpperThreshold = *_UpperThresholdPointer;
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ElementWiseUnaryOp::Initialize(n, data, mask);
   }
 };
 
@@ -1347,11 +1493,10 @@ public:
     }
   }
 
-  /// Process given data (not thread-safe!)
-  virtual void Process(int n, double *data, bool *mask = NULL)
+  /// Process data elements with index in the given range
+  virtual void Apply(const blocked_range<int> &re) const
   {
-    ElementWiseUnaryOp::Process(n, data, mask);
-    parallel_for(blocked_range<int>(0, n), *this);
+    ApplyOp<Binarize>(re);
   }
 };
 
@@ -73,23 +73,40 @@ public:
   virtual void Process(vtkDataArray *data, bool *mask = nullptr)
   {
     const int n = static_cast<int>(data->GetNumberOfTuples() * data->GetNumberOfComponents());
-    if (data->GetDataType() == VTK_DOUBLE) {
-      this->Process(n, reinterpret_cast<double *>(data->GetVoidPointer(0)), mask);
-    } else {
-      UniquePtr<double[]> _data(new double[n]);
-      double *tuple = _data.get();
-      for (vtkIdType i = 0; i < data->GetNumberOfTuples(); ++i) {
-        data->GetTuple(i, tuple);
-        tuple += data->GetNumberOfComponents();
-      }
-      this->Process(n, _data.get(), mask);
-      tuple = _data.get();
-      for (vtkIdType i = 0; i < data->GetNumberOfTuples(); ++i) {
-        data->SetTuple(i, tuple);
-        tuple += data->GetNumberOfComponents();
-      }
+    void * const p = data->GetVoidPointer(0);
+    switch (data->GetDataType()) {
+      case VTK_DOUBLE: this->Process(n, reinterpret_cast<double *>(p), mask); break;
+      case VTK_FLOAT:  this->ProcessAsDouble(n, reinterpret_cast<float *>(p), mask); break;
+      case VTK_INT:    this->ProcessAsDouble(n, reinterpret_cast<int   *>(p), mask); break;
+      case VTK_SHORT:  this->ProcessAsDouble(n, reinterpret_cast<short *>(p), mask); break;
+      default: {
+        UniquePtr<double[]> _data(new double[n]);
+        double *tuple = _data.get();
+        for (vtkIdType i = 0; i < data->GetNumberOfTuples(); ++i) {
+          data->GetTuple(i, tuple);
+          tuple += data->GetNumberOfComponents();
+        }
+        this->Process(n, _data.get(), mask);
+        tuple = _data.get();
+        for (vtkIdType i = 0; i < data->GetNumberOfTuples(); ++i) {
+          data->SetTuple(i, tuple);
+          tuple += data->GetNumberOfComponents();
+        }
+      } break;
     }
   }
+
+protected:
+
+  /// Process contiguous data of other type by converting it to double
+  template <class T>
+  void ProcessAsDouble(int n, T *data, bool *mask)
+  {
+    UniquePtr<double[]> _data(new double[n]);
+    for (int i = 0; i < n; ++i) _data[i] = static_cast<double>(data[i]);
+    this->Process(n, _data.get(), mask);
+    for (int i = 0; i < n; ++i) data[i] = static_cast<T>(_data[i]);
+  }
 #endif
 };
 
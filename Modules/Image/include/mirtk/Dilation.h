@@ -23,13 +23,18 @@
 
 #include "mirtk/Assert.h"
 #include "mirtk/NeighborhoodOffsets.h"
+#include "mirtk/Morphology.h"
 
 
 namespace mirtk {
 
 
 /**
- * morphological erosion of images.
+ * morphological dilation of images.
+ *
+ * Multiple iterations are applied at once, see ApplyMorphologicalOperation.
+ * When a positive radius is set, the input image is instead treated as binary
+ * mask and dilated with a Euclidean ball structuring element.
  */
 template <class TVoxel>
 class Dilation : public ImageToImage<TVoxel>
@@ -39,8 +44,11 @@ class Dilation : public ImageToImage<TVoxel>
   /// What connectivity to assume when running the filter.
   mirtkPublicAttributeMacro(ConnectivityType, Connectivity);
 
-  /// List of voxel offsets of the neighborhood
-  mirtkAttributeMacro(NeighborhoodOffsets, Offsets);
+  /// Number of iterations
+  mirtkPublicAttributeMacro(int, NumberOfIterations);
+
+  /// Radius of ball structuring element in world units, unused if not positive
+  mirtkPublicAttributeMacro(double, Radius);
 
 public:
 
@@ -50,14 +58,9 @@ public:
   /// Destructor
   virtual ~Dilation();
 
-  /// Run erosion
+  /// Run dilation
   virtual void Run();
 
-protected:
-
-  /// Initialize the filter
-  virtual void Initialize();
-
 };
 
 
@@ -69,9 +72,23 @@ void Dilate(BaseImage *image, int iterations, ConnectivityType connectivity)
   mirtkAssert(im != nullptr, "template function called with correct type");
   Dilation<TVoxel> dilation;
   dilation.Connectivity(connectivity);
+  dilation.NumberOfIterations(iterations);
+  dilation.Input (im);
+  dilation.Output(im);
+  dilation.Run();
+}
+
+// -----------------------------------------------------------------------------
+template <class TVoxel>
+void Dilate(BaseImage *image, double radius)
+{
+  GenericImage<TVoxel> * const im = dynamic_cast<GenericImage<TVoxel> *>(image);
+  mirtkAssert(im != nullptr, "template function called with correct type");
+  Dilation<TVoxel> dilation;
+  dilation.Radius(radius);
   dilation.Input (im);
   dilation.Output(im);
-  for (int i = 0; i < iterations; ++i) dilation.Run();
+  dilation.Run();
 }
 
 
@@ -23,6 +23,7 @@
 
 #include "mirtk/Assert.h"
 #include "mirtk/NeighborhoodOffsets.h"
+#include "mirtk/Morphology.h"
 
 
 namespace mirtk {
@@ -30,6 +31,10 @@ namespace mirtk {
 
 /**
  * morphological erosion of images.
+ *
+ * Multiple iterations are applied at once, see ApplyMorphologicalOperation.
+ * When a positive radius is set, the input image is instead treated as binary
+ * mask and eroded with a Euclidean ball structuring element.
  */
 template <class TVoxel>
 class Erosion : public ImageToImage<TVoxel>
@@ -39,8 +44,11 @@ class Erosion : public ImageToImage<TVoxel>
   /// What connectivity to assume when running the filter.
   mirtkPublicAttributeMacro(ConnectivityType, Connectivity);
 
-  /// List of voxel offsets of the neighborhood
-  mirtkAttributeMacro(NeighborhoodOffsets, Offsets);
+  /// Number of iterations
+  mirtkPublicAttributeMacro(int, NumberOfIterations);
+
+  /// Radius of ball structuring element in world units, unused if not positive
+  mirtkPublicAttributeMacro(double, Radius);
 
 public:
 
@@ -53,11 +61,6 @@ public:
   /// Run erosion
   virtual void Run();
 
-protected:
-
-  /// Initialize the filter
-  virtual void Initialize();
-
 };
 
 
@@ -69,9 +72,23 @@ void Erode(BaseImage *image, int iterations, ConnectivityType connectivity)
   mirtkAssert(im != nullptr, "template function called with correct type");
   Erosion<TVoxel> erosion;
   erosion.Connectivity(connectivity);
+  erosion.NumberOfIterations(iterations);
+  erosion.Input (im);
+  erosion.Output(im);
+  erosion.Run();
+}
+
+// -----------------------------------------------------------------------------
+template <class TVoxel>
+void Erode(BaseImage *image, double radius)
+{
+  GenericImage<TVoxel> * const im = dynamic_cast<GenericImage<TVoxel> *>(image);
+  mirtkAssert(im != nullptr, "template function called with correct type");
+  Erosion<TVoxel> erosion;
+  erosion.Radius(radius);
   erosion.Input (im);
   erosion.Output(im);
-  for (int i = 0; i < iterations; ++i) erosion.Run();
+  erosion.Run();
 }
 
 
@@ -35,11 +35,27 @@ public:
   /// 2D or 3D distance transform
   enum Mode { DT_2D, DT_3D };
 
+  /// Type of output distance values
+  enum DistanceType
+  {
+    DT_SquaredDistance, ///< Squared Euclidean distance to nearest non-zero voxel
+    DT_Distance,        ///< Euclidean distance to nearest non-zero voxel
+    DT_SignedDistance   ///< Distance to object boundary, negative inside object
+  };
+
 protected:
 
   /// 2D or 3D distance transform
   Mode _distanceTransformMode;
 
+  /// Type of output distance values (default: DT_SquaredDistance)
+  ///
+  /// All distances are in world units, i.e., take the voxel size into account.
+  /// The signed distance is the difference of the distance to the nearest
+  /// non-zero (object) voxel and the distance to the nearest zero (background)
+  /// voxel. Both transforms are computed by a single call of Run.
+  mirtkPublicAttributeMacro(DistanceType, OutputDistance);
+
   /// Calculate the Vornoi diagram
   int edtVornoiEDT(long *, long);
 
@@ -49,15 +65,18 @@ protected:
   /// Calculate 3D distance transform
   void edtComputeEDT_3D(char *, long *, long, long, long);
 
-  /// Calculate the Vornoi diagram for anisotripic voxel sizes
-  int edtVornoiEDT_anisotropic(VoxelType *, long, double);
-
   /// Calculate 2D distance transform for anisotripic voxel sizes
   void edtComputeEDT_2D_anisotropic(const VoxelType *, VoxelType *, long, long, double, double);
 
+  /// Calculate 2D distance transform of each slice for anisotripic voxel sizes
+  void edtComputeEDT_2D_anisotropic(const VoxelType *, VoxelType *, long, long, long, double, double);
+
   /// Calculate 3D distance transform for anisotripic voxel sizes
   void edtComputeEDT_3D_anisotropic(const VoxelType *, VoxelType *, long, long, long, double, double, double);
 
+  /// Calculate squared 2D or 3D distance transform depending on the mode
+  void ComputeEDT(const VoxelType *, VoxelType *, long, long, long, double, double, double);
+
 public:
 
   /// Default constructor
@@ -27,10 +27,69 @@
 namespace mirtk {
 
 
+// =============================================================================
+// Auxiliary functions
+// =============================================================================
+
+namespace FastCubicBSplineInterpolateImageFunction3DUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Batch evaluation of cubic B-spline with given type of coefficients
+///
+/// Only scalar coefficients are supported, see EvaluateCubicBSpline3D.
+template <class T>
+struct BatchEvaluation
+{
+  static const bool Supported = false;
+
+  static void Evaluate(CubicBSplineBatchMode, int, const T *, int, int, const int *,
+                       const int *, const int *, const int *, T *, T *, T *, T *)
+  {
+  }
+};
+
+// -----------------------------------------------------------------------------
+template <>
+struct BatchEvaluation<float>
+{
+  static const bool Supported = true;
+
+  static void Evaluate(CubicBSplineBatchMode mode, int n, const float *coeff, int X, int XY,
+                       const int *offset, const int *a, const int *b, const int *c,
+                       float *v, float *dx, float *dy, float *dz)
+  {
+    EvaluateCubicBSpline3D(mode, n, coeff, X, XY, offset, a, b, c, v, dx, dy, dz);
+  }
+};
+
+// -----------------------------------------------------------------------------
+template <>
+struct BatchEvaluation<double>
+{
+  static const bool Supported = true;
+
+  static void Evaluate(CubicBSplineBatchMode mode, int n, const double *coeff, int X, int XY,
+                       const int *offset, const int *a, const int *b, const int *c,
+                       double *v, double *dx, double *dy, double *dz)
+  {
+    EvaluateCubicBSpline3D(mode, n, coeff, X, XY, offset, a, b, c, v, dx, dy, dz);
+  }
+};
+
+
+} // namespace FastCubicBSplineInterpolateImageFunction3DUtils
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
 // -----------------------------------------------------------------------------
 template <class TImage>
 GenericFastCubicBSplineInterpolateImageFunction3D<TImage>
 ::GenericFastCubicBSplineInterpolateImageFunction3D()
+:
+  _BatchMode(CubicBSplineBatch_Default)
 {
   this->NumberOfDimensions(3);
 }
@@ -117,6 +176,184 @@ GenericFastCubicBSplineInterpolateImageFunction3D<TImage>
   }
 }
 
+// -----------------------------------------------------------------------------
+template <class TImage>
+inline void GenericFastCubicBSplineInterpolateImageFunction3D<TImage>
+::EvaluateInside(double *v, double x, double y, double z, int vt) const
+{
+  int i = ifloor(x);
+  int j = ifloor(y);
+  int k = ifloor(z);
+
+  const int A = Kernel::VariableToIndex(Real(x - i));
+  const int B = Kernel::VariableToIndex(Real(y - j));
+  const int C = Kernel::VariableToIndex(Real(z - k));
+
+  // Tensor product weights in order of coefficient iteration
+  Real w[64], wyz, *wabc = w;
+  for (int c = 0; c <= 3; ++c)
+  for (int b = 0; b <= 3; ++b) {
+    wyz = Kernel::LookupTable[B][b] * Kernel::LookupTable[C][c];
+    for (int a = 0; a <= 3; ++a, ++wabc) {
+      (*wabc) = Kernel::LookupTable[A][a] * wyz;
+    }
+  }
+
+  --i, --j, --k;
+
+  const int s2 = this->_s2;
+  const int s3 = this->_s3;
+
+  RealType        val;
+  const RealType *coeff;
+  const Real     *wa;
+
+  for (int l = 0; l < this->Input()->T(); ++l, v += vt) {
+    val   = voxel_cast<RealType>(0);
+    coeff = this->_Coefficient.Data(i, j, k, l);
+    wa    = w;
+    for (int c = 0; c <= 3; ++c, coeff += s3) {
+      for (int b = 0; b <= 3; ++b, coeff += s2, wa += 4) {
+        val += wa[0] * coeff[0];
+        val += wa[1] * coeff[1];
+        val += wa[2] * coeff[2];
+        val += wa[3] * coeff[3];
+        coeff += 4;
+      }
+    }
+    (*v) = voxel_cast<double>(voxel_cast<VoxelType>(val));
+  }
+}
+
+// =============================================================================
+// Batch evaluation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+template <class TImage>
+void GenericFastCubicBSplineInterpolateImageFunction3D<TImage>
+::EvaluateBatchInside(int n, const double *x, const double *y, const double *z,
+                      double *v, double *d) const
+{
+  typedef FastCubicBSplineInterpolateImageFunction3DUtils::BatchEvaluation<RealType> Batch;
+
+  const int nc  = this->Input()->T();
+  const int X   = this->_Coefficient.X();
+  const int XY  = this->_Coefficient.Y() * X;
+  const int XYZ = this->_Coefficient.Z() * XY;
+
+  int      offset[BatchSize], a[BatchSize], b[BatchSize], c[BatchSize];
+  RealType val[BatchSize], dx[BatchSize], dy[BatchSize], dz[BatchSize];
+  int      i, j, k, m, r;
+
+  for (int p0 = 0; p0 < n; p0 += BatchSize) {
+    m = min(n - p0, int(BatchSize));
+    // Spline weights and first coefficient are shared by all channels
+    for (int p = 0, q = p0; p < m; ++p, ++q) {
+      i = ifloor(x[q]);
+      j = ifloor(y[q]);
+      k = ifloor(z[q]);
+      a[p] = Kernel::VariableToIndex(Real(x[q] - i));
+      b[p] = Kernel::VariableToIndex(Real(y[q] - j));
+      c[p] = Kernel::VariableToIndex(Real(z[q] - k));
+      offset[p] = (i - 1) + (j - 1) * X + (k - 1) * XY;
+    }
+    for (int l = 0; l < nc; ++l) {
+      const RealType *coeff = this->_Coefficient.Data() + l * XYZ;
+      if (d) {
+        Batch::Evaluate(_BatchMode, m, coeff, X, XY, offset, a, b, c, val, dx, dy, dz);
+      } else {
+        Batch::Evaluate(_BatchMode, m, coeff, X, XY, offset, a, b, c, val, nullptr, nullptr, nullptr);
+      }
+      for (int p = 0; p < m; ++p) {
+        r = (p0 + p) * nc + l;
+        v[r] = voxel_cast<double>(voxel_cast<VoxelType>(val[p]));
+        if (d) {
+          d[3 * r    ] = voxel_cast<double>(dx[p]);
+          d[3 * r + 1] = voxel_cast<double>(dy[p]);
+          d[3 * r + 2] = voxel_cast<double>(dz[p]);
+        }
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+template <class TImage>
+void GenericFastCubicBSplineInterpolateImageFunction3D<TImage>
+::EvaluateBatch(int n, const double *x, const double *y, const double *z,
+                double *v, double *d, bool inside) const
+{
+  typedef FastCubicBSplineInterpolateImageFunction3DUtils::BatchEvaluation<RealType> Batch;
+  if (!Batch::Supported) {
+    this->Throw(ERR_NotImplemented, __FUNCTION__, "Not implemented for non-scalar voxel type");
+  }
+
+  const int nc = this->Input()->T();
+
+  Matrix jac;
+  int    p = 0, q;
+  while (p < n) {
+    // Consecutive points for which no boundary conditions are needed
+    for (q = p; q < n && (inside || this->IsInside(x[q], y[q], z[q])); ++q);
+    if (q > p) {
+      EvaluateBatchInside(q - p, x + p, y + p, z + p, v + p * nc, d ? d + 3 * p * nc : nullptr);
+      p = q;
+    }
+    // Consecutive points which require extrapolation of the image
+    for (; p < n && !this->IsInside(x[p], y[p], z[p]); ++p) {
+      this->EvaluateOutside(v + p * nc, x[p], y[p], z[p], 1);
+      if (d) {
+        for (int l = 0; l < nc; ++l) {
+          if (this->_InfiniteCoefficient) {
+            this->Jacobian3D(jac, this->_InfiniteCoefficient, x[p], y[p], z[p], l);
+          } else {
+            this->Jacobian3D(jac, x[p], y[p], z[p], l);
+          }
+          double * const g = d + 3 * (p * nc + l);
+          g[0] = jac(0, 0);
+          g[1] = jac(0, 1);
+          g[2] = jac(0, 2);
+        }
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+template <class TImage>
+void GenericFastCubicBSplineInterpolateImageFunction3D<TImage>
+::EvaluateInside(int n, const double *x, const double *y, const double *z, double *v) const
+{
+  EvaluateBatch(n, x, y, z, v, nullptr, true);
+}
+
+// -----------------------------------------------------------------------------
+template <class TImage>
+void GenericFastCubicBSplineInterpolateImageFunction3D<TImage>
+::Evaluate(int n, const double *x, const double *y, const double *z, double *v) const
+{
+  EvaluateBatch(n, x, y, z, v, nullptr, false);
+}
+
+// -----------------------------------------------------------------------------
+template <class TImage>
+void GenericFastCubicBSplineInterpolateImageFunction3D<TImage>
+::EvaluateWithGradientInside(int n, const double *x, const double *y, const double *z,
+                             double *v, double *d) const
+{
+  EvaluateBatch(n, x, y, z, v, d, true);
+}
+
+// -----------------------------------------------------------------------------
+template <class TImage>
+void GenericFastCubicBSplineInterpolateImageFunction3D<TImage>
+::EvaluateWithGradient(int n, const double *x, const double *y, const double *z,
+                       double *v, double *d) const
+{
+  EvaluateBatch(n, x, y, z, v, d, false);
+}
+
 
 } // namespace mirtk
 
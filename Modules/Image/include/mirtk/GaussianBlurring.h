@@ -39,6 +39,18 @@ namespace mirtk {
  * the 1D convolution with a 1D Gaussian kernel is performed only for
  * dimensions of more than one voxel size and for which a non-zero
  * standard deviation for the Gaussian kernel has been set.
+ *
+ * When the Recursive attribute is set, the convolution with a truncated FIR
+ * kernel, whose size and thus cost per voxel grows linearly with the standard
+ * deviation, is replaced by the fourth order recursive (IIR) Gaussian filter
+ * of Deriche (1993) with constant cost per voxel. The outputs of a causal and
+ * an anti-causal recursion along each image line are summed, where neighboring
+ * image lines are filtered simultaneously. Convolution at the boundary of the
+ * image (foreground) is normalized as in the non-recursive case. This mode
+ * is recommended for large standard deviations, where it is much faster than
+ * the FIR convolution. Along dimensions with a standard deviation of less than
+ * one voxel, the FIR kernel is used also in recursive mode as the recursive
+ * approximation of such a narrow Gaussian is inaccurate.
  */
 template <class TVoxel>
 class GaussianBlurring : public SeparableConvolution<TVoxel>
@@ -62,6 +74,9 @@ protected:
   /// Standard deviation of Gaussian kernel in t
   mirtkAttributeMacro(double, SigmaT);
 
+  /// Whether to use recursive approximation of Gaussian convolution
+  mirtkPublicAttributeMacro(bool, Recursive);
+
 protected:
 
   // Base class setters unused, should not be called by user
@@ -79,6 +94,9 @@ protected:
   /// Initialize filter
   virtual void Initialize();
 
+  /// Blur image using recursive Gaussian filter
+  void RunRecursive();
+
 public:
 
   /// Constructor
@@ -96,6 +114,9 @@ public:
   /// Set sigma
   virtual void SetSigma(double, double, double = 0., double = 0.);
 
+  /// Blur image
+  virtual void Run();
+
   /// Kernel size used for a given sigma (divided by voxel size)
   static int KernelSize(double);
 
@@ -26,11 +26,15 @@
 #define MIRTK_GenericImage_H
 
 #include "mirtk/VoxelCast.h"
+#include "mirtk/Memory.h"
 
 
 namespace mirtk {
 
 
+class MemoryMappedFile;
+
+
 /**
  * Generic class for 2D or 3D images
  *
@@ -66,24 +70,46 @@ public:
 
 protected:
 
-  /// Pointer array for access to image data
+  /// Optional pointer array for legacy access to image data
   ///
-  /// \note The image data is stored in a contiguous memory block which can
-  ///       be alternatively referred to as 1D data array using \c _data.
+  /// \note The image data is stored in a contiguous memory block which is
+  ///       addressed using the precomputed voxel strides. This pointer array
+  ///       is only allocated upon request by the Matrix accessor.
   VoxelType ****_matrix;
 
   /// Pointer to image data
   VoxelType *_data;
 
+  /// Offset between voxels (x, y) and (x, y+1) in the contiguous data array
+  int _ystride;
+
+  /// Offset between voxels (x, y, z) and (x, y, z+1) in the contiguous data array
+  int _zstride;
+
+  /// Offset between voxels (x, y, z, t) and (x, y, z, t+1) in the contiguous data array
+  int _tstride;
+
   /// Whether image data memory itself is owned by this instance
   bool _dataOwner;
 
+  /// Memory mapped file region holding the image data (if any)
+  ///
+  /// The image data is not owned by this instance in this case, but the file
+  /// mapping is kept alive for as long as any image references its data.
+  SharedPtr<MemoryMappedFile> _dataMapping;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 
   /// Allocate image memory
   void AllocateImage(VoxelType * = NULL);
 
+  /// Update voxel strides after change of image dimensions
+  void UpdateStrides();
+
+  /// Free optional pointer array for legacy access to image data
+  void DeallocateMatrix();
+
 public:
 
   /// Default constructor
@@ -141,6 +167,19 @@ public:
   /// Initialize an image
   void Initialize(int, int, int = 1, int = 1, VoxelType *data = NULL);
 
+  /// Initialize an image whose data is the given memory mapped file region
+  ///
+  /// The image data is not copied. Instead, the image references the mapped
+  /// memory directly, such that voxel data is only loaded from disk when first
+  /// accessed. The mapped file region must contain the image data in the
+  /// in-memory representation of this image, i.e., with matching voxel type
+  /// and byte order. The image must not be modified when the file was mapped
+  /// read-only.
+  void Initialize(const ImageAttributes &, SharedPtr<MemoryMappedFile>);
+
+  /// Whether image data is a memory mapped file region
+  bool IsMemoryMapped() const;
+
   /// Copy image data from 1D array
   void CopyFrom(const VoxelType *);
 
@@ -280,6 +319,16 @@ public:
   /// Get raw pointer to contiguous image data
   virtual const void *GetDataPointer(int, int, int = 0, int = 0) const;
 
+  /// Index of voxel in contiguous image data array
+  int DataIndex(int, int, int = 0, int = 0) const;
+
+  /// Get pointer array for legacy access to image data as \c matrix[t][z][y][x]
+  ///
+  /// The pointer array is allocated on first use and remains valid until the
+  /// image memory is reallocated or its dimensions are modified.
+  /// \deprecated Use Data or DataIndex instead.
+  VoxelType ****Matrix();
+
   /// Get enumeration value corresponding to voxel type
   virtual int GetDataType() const;
 
@@ -522,7 +571,7 @@ GenericImage<VoxelType>& GenericImage<VoxelType>::operator=(const GenericImage<V
 template <class VoxelType>
 GenericImage<VoxelType>::operator bool() const
 {
-  return bool(_attr) && _matrix != nullptr;
+  return bool(_attr) && _data != nullptr;
 }
 
 // =============================================================================
@@ -551,21 +600,21 @@ inline void GenericImage<VoxelType>::Put(int index, VoxelType val)
 template <class VoxelType>
 inline void GenericImage<VoxelType>::Put(int x, int y, VoxelType val)
 {
-  _matrix[0][0][y][x] = val;
+  _data[DataIndex(x, y)] = val;
 }
 
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 inline void GenericImage<VoxelType>::Put(int x, int y, int z, VoxelType val)
 {
-  _matrix[0][z][y][x] = val;
+  _data[DataIndex(x, y, z)] = val;
 }
 
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 inline void GenericImage<VoxelType>::Put(int x, int y, int z, int t, VoxelType val)
 {
-  _matrix[t][z][y][x] = val;
+  _data[DataIndex(x, y, z, t)] = val;
 }
 
 // -----------------------------------------------------------------------------
@@ -579,7 +628,7 @@ inline VoxelType GenericImage<VoxelType>::Get(int index) const
 template <class VoxelType>
 inline VoxelType GenericImage<VoxelType>::Get(int x, int y, int z, int t) const
 {
-  return _matrix[t][z][y][x];
+  return _data[DataIndex(x, y, z, t)];
 }
 
 // -----------------------------------------------------------------------------
@@ -600,14 +649,14 @@ inline const VoxelType &GenericImage<VoxelType>::operator ()(int index) const
 template <class VoxelType>
 inline VoxelType& GenericImage<VoxelType>::operator()(int x, int y, int z, int t)
 {
-  return _matrix[t][z][y][x];
+  return _data[DataIndex(x, y, z, t)];
 }
 
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 inline const VoxelType& GenericImage<VoxelType>::operator()(int x, int y, int z, int t) const
 {
-  return _matrix[t][z][y][x];
+  return _data[DataIndex(x, y, z, t)];
 }
 
 // =============================================================================
@@ -644,21 +693,21 @@ inline void GenericImage<VoxelType>::PutAsDouble(int index, double val)
 template <class VoxelType>
 inline void GenericImage<VoxelType>::PutAsDouble(int x, int y, double val)
 {
-  _matrix[0][0][y][x] = voxel_cast<VoxelType>(val);
+  _data[DataIndex(x, y)] = voxel_cast<VoxelType>(val);
 }
 
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 inline void GenericImage<VoxelType>::PutAsDouble(int x, int y, int z, double val)
 {
-  _matrix[0][z][y][x] = voxel_cast<VoxelType>(val);
+  _data[DataIndex(x, y, z)] = voxel_cast<VoxelType>(val);
 }
 
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 inline void GenericImage<VoxelType>::PutAsDouble(int x, int y, int z, int t, double val)
 {
-  _matrix[t][z][y][x] = voxel_cast<VoxelType>(val);
+  _data[DataIndex(x, y, z, t)] = voxel_cast<VoxelType>(val);
 }
 
 // -----------------------------------------------------------------------------
@@ -672,7 +721,7 @@ inline double GenericImage<VoxelType>::GetAsDouble(int index) const
 template <class VoxelType>
 inline double GenericImage<VoxelType>::GetAsDouble(int x, int y, int z, int t) const
 {
-  return voxel_cast<double>(_matrix[t][z][y][x]);
+  return voxel_cast<double>(_data[DataIndex(x, y, z, t)]);
 }
 
 // -----------------------------------------------------------------------------
@@ -686,21 +735,21 @@ inline void GenericImage<VoxelType>::PutAsVector(int index, const Vector &value)
 template <class VoxelType>
 inline void GenericImage<VoxelType>::PutAsVector(int x, int y, const Vector &value)
 {
-  _matrix[0][0][y][x] = voxel_cast<VoxelType>(value);
+  _data[DataIndex(x, y)] = voxel_cast<VoxelType>(value);
 }
 
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 inline void GenericImage<VoxelType>::PutAsVector(int x, int y, int z, const Vector &value)
 {
-  _matrix[0][z][y][x] = voxel_cast<VoxelType>(value);
+  _data[DataIndex(x, y, z)] = voxel_cast<VoxelType>(value);
 }
 
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 inline void GenericImage<VoxelType>::PutAsVector(int x, int y, int z, int t, const Vector &value)
 {
-  _matrix[t][z][y][x] = voxel_cast<VoxelType>(value);
+  _data[DataIndex(x, y, z, t)] = voxel_cast<VoxelType>(value);
 }
 
 // -----------------------------------------------------------------------------
@@ -714,7 +763,7 @@ inline void GenericImage<VoxelType>::GetAsVector(Vector &value, int index) const
 template <class VoxelType>
 inline void GenericImage<VoxelType>::GetAsVector(Vector &value, int x, int y, int z, int t) const
 {
-  value = voxel_cast<Vector>(_matrix[t][z][y][x]);
+  value = voxel_cast<Vector>(_data[DataIndex(x, y, z, t)]);
 }
 
 // -----------------------------------------------------------------------------
@@ -728,7 +777,7 @@ inline Vector GenericImage<VoxelType>::GetAsVector(int index) const
 template <class VoxelType>
 inline Vector GenericImage<VoxelType>::GetAsVector(int x, int y, int z, int t) const
 {
-  return voxel_cast<Vector>(_matrix[t][z][y][x]);
+  return voxel_cast<Vector>(_data[DataIndex(x, y, z, t)]);
 }
 
 // =============================================================================
@@ -753,14 +802,14 @@ inline const VoxelType *GenericImage<VoxelType>::Data(int i) const
 template <class VoxelType>
 inline VoxelType *GenericImage<VoxelType>::Data(int x, int y, int z, int t)
 {
-  return &_matrix[t][z][y][x];
+  return &_data[DataIndex(x, y, z, t)];
 }
 
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 inline const VoxelType *GenericImage<VoxelType>::Data(int x, int y, int z, int t) const
 {
-  return &_matrix[t][z][y][x];
+  return &_data[DataIndex(x, y, z, t)];
 }
 
 // -----------------------------------------------------------------------------
@@ -781,14 +830,21 @@ inline const void *GenericImage<VoxelType>::GetDataPointer(int i) const
 template <class VoxelType>
 inline void *GenericImage<VoxelType>::GetDataPointer(int x, int y, int z, int t)
 {
-  return &_matrix[t][z][y][x];
+  return &_data[DataIndex(x, y, z, t)];
 }
 
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 inline const void *GenericImage<VoxelType>::GetDataPointer(int x, int y, int z, int t) const
 {
-  return &_matrix[t][z][y][x];
+  return &_data[DataIndex(x, y, z, t)];
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+inline int GenericImage<VoxelType>::DataIndex(int x, int y, int z, int t) const
+{
+  return x + y * _ystride + z * _zstride + t * _tstride;
 }
 
 // -----------------------------------------------------------------------------
@@ -848,14 +904,14 @@ inline void GenericImage<VoxelType>::GetMinMaxPad(VoxelType *min, VoxelType *max
 template <class VoxelType>
 inline VoxelType *GenericImage<VoxelType>::GetPointerToVoxels(int x, int y, int z, int t)
 {
-  return &_matrix[t][z][y][x];
+  return &_data[DataIndex(x, y, z, t)];
 }
 
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 inline const VoxelType *GenericImage<VoxelType>::GetPointerToVoxels(int x, int y, int z, int t) const
 {
-  return &_matrix[t][z][y][x];
+  return &_data[DataIndex(x, y, z, t)];
 }
 
 ////////////////////////////////////////////////////////////////////////////////
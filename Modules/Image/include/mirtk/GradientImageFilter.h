@@ -78,6 +78,14 @@ protected:
   /// Padding value
   mirtkPublicAttributeMacro(double, PaddingValue);
 
+  /// Standard deviation of Gaussian derivative kernel in mm
+  ///
+  /// When positive, the partial derivatives are computed by convolution with
+  /// the first derivative of a Gaussian using the recursive filters of
+  /// Deriche (1993), whose cost does not depend on the standard deviation.
+  /// Otherwise, the derivatives are approximated by central differences (default).
+  mirtkPublicAttributeMacro(double, Sigma);
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 
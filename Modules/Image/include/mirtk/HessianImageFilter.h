@@ -69,6 +69,14 @@ protected:
   /// Which Hessian component(s) to output
   mirtkPublicAttributeMacro(OutputType, Type);
 
+  /// Standard deviation of Gaussian derivative kernel in mm
+  ///
+  /// When positive, the second order derivatives are computed by convolution
+  /// with the derivatives of a Gaussian using the recursive filters of
+  /// Deriche (1993), whose cost does not depend on the standard deviation.
+  /// Otherwise, they are approximated by finite differences (default).
+  mirtkPublicAttributeMacro(double, Sigma);
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 public:
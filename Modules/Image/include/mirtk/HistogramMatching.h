@@ -20,6 +20,7 @@
 #define MIRTK_HistogramMatching_H
 
 #include "mirtk/ImageToImage.h"
+#include "mirtk/Histogram1D.h"
 
 
 namespace mirtk {
@@ -33,6 +34,11 @@ namespace mirtk {
  *
  * \note Source code adapted from an implementation by Vladimir Fonov in EZminc (https://github.com/vfonov/EZminc)
  * \note Only the foreground intensities of the input images are considered.
+ *
+ * The histograms are computed and the piecewise linear intensity map is applied
+ * in parallel. The histogram of the reference image is computed only once after
+ * a reference image was set, such that a batch of images can be matched to the
+ * same reference by setting a new input and output before each call of Run.
  */
 template <class TVoxel>
 class HistogramMatching : public ImageToImage<TVoxel>
@@ -40,7 +46,7 @@ class HistogramMatching : public ImageToImage<TVoxel>
   mirtkInPlaceImageFilterMacro(HistogramMatching, TVoxel);
 
   /// Reference image
-  mirtkPublicAggregateMacro(const ImageType, Reference);
+  mirtkReadOnlyAggregateMacro(const ImageType, Reference);
 
   /// Number of histogram bins
   mirtkPublicAttributeMacro(int, NumberOfBins);
@@ -51,11 +57,23 @@ class HistogramMatching : public ImageToImage<TVoxel>
   /// Cut off value
   mirtkPublicAttributeMacro(double, CutOff);
 
+  /// Histogram of reference image foreground intensities
+  Histogram1D<int> _ReferenceHistogram;
+
+  /// Whether histogram of current reference image was computed
+  bool _ReferenceHistogramValid;
+
 public:
 
   /// Constructor
   HistogramMatching();
 
+  /// Set reference image
+  ///
+  /// The histogram of the reference image is computed by the next call of Run
+  /// and reused by subsequent runs until the reference image is set again.
+  void Reference(const ImageType *);
+
   /// Run filter on entire image
   virtual void Run();
 
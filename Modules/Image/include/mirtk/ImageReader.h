@@ -20,6 +20,8 @@
 #ifndef MIRTK_ImageReader_H
 #define MIRTK_ImageReader_H
 
+#include "mirtk/ImageExport.h"
+
 #include "mirtk/Cifstream.h"
 #include "mirtk/ImageAttributes.h"
 #include "mirtk/BaseImage.h"
@@ -28,6 +30,17 @@
 namespace mirtk {
 
 
+/// Whether to map uncompressed image data into memory instead of reading it
+///
+/// When enabled, ImageReader::Run creates images whose data is a copy-on-write
+/// mapping of the image file if the file is uncompressed and its voxel type
+/// and byte order match the in-memory representation. Voxel data is then only
+/// loaded from disk upon first access. This is disabled by default, because
+/// the image file must not be overwritten while such an image is in use.
+/// Images whose axes have to be reflected are always read.
+MIRTK_Image_EXPORT extern bool memory_map_images;
+
+
 /**
  * Abstract base class for any general file to image filter.
  *
@@ -73,6 +86,9 @@ protected:
   /// Start of image data
   int _Start;
 
+  /// Whether floating point image data contains NaN values (-1: unknown)
+  int _ContainsNaN;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 public:
@@ -114,10 +130,49 @@ public:
   /// \returns Newly read image. Must be deleted by caller.
   virtual BaseImage *Run();
 
+  /// Read slab of consecutive image slices from file
+  ///
+  /// Only the voxel data of the slices [k1, k2] of each channel or frame is
+  /// read such that the memory required is proportional to the slab size.
+  /// When the image file is compressed, slabs should be read in order of
+  /// increasing slice indices to avoid decompressing the data multiple times.
+  ///
+  /// The background value of each slab is set to NaN when the image contains
+  /// NaN values anywhere, not only within the slab, such that all slabs are
+  /// consistent with the image returned by Run. To this end, the floating
+  /// point data of the entire file is scanned once slice by slice before the
+  /// first slab is read, unless the image was read before by Run.
+  ///
+  /// \param[in] k1 Index of first slice.
+  /// \param[in] k2 Index of last slice.
+  ///
+  /// \returns Newly read image slab. Must be deleted by caller.
+  virtual BaseImage *ReadSlab(int k1, int k2);
+
 protected:
 
+  /// Name of file containing the image data
+  virtual string DataFileName() const;
+
+  /// Create image whose data is a memory mapped region of a file
+  ///
+  /// \param[in] fname  Name of file containing the image data.
+  /// \param[in] offset Byte offset of first voxel from start of file.
+  ///
+  /// \returns Image of the data type of the file or \c nullptr when the data
+  ///          cannot be mapped, in which case it has to be read instead.
+  ///          This is also the case when image axes have to be reflected,
+  ///          because this would copy every page of the mapped file.
+  BaseImage *MapImageData(const char *fname, long offset) const;
+
+  /// Whether floating point image data in file contains NaN values
+  ///
+  /// The data is read one slice at a time upon first call and the result
+  /// is cached until the reader is initialized for another file.
+  bool DataContainsNaN();
+
   /// Finalize read image
-  void Finalize(BaseImage *) const;
+  void Finalize(BaseImage *output);
 
   /// Read header. This is an abstract function. Each derived class has to
   /// implement this function in order to initialize the read-only attributes
@@ -0,0 +1,87 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_Morphology_H
+#define MIRTK_Morphology_H
+
+#include "mirtk/GenericImage.h"
+#include "mirtk/NeighborhoodOffsets.h"
+
+
+namespace mirtk {
+
+
+/// Type of morphological operation
+enum MorphologicalOperation
+{
+  MO_Dilation, ///< Maximum of values within structuring element
+  MO_Erosion   ///< Minimum of values within structuring element
+};
+
+
+/**
+ * Apply multiple iterations of morphological operation at once
+ *
+ * The result is identical to the given number of iterations of the Dilation
+ * or Erosion filter with the respective neighborhood connectivity, where the
+ * voxels at the image boundary keep their input value. Instead of sweeping
+ * the image once for each iteration, the 26-neighborhood is applied as box
+ * structuring element of radius equal to the number of iterations by a running
+ * maximum/minimum along each image axis (van Herk, 1992; Gil and Werman, 1993),
+ * whose cost per voxel is independent of the radius. Binary images with values
+ * 0 and 1 only are processed with the image rows packed into 64-bit words,
+ * which is also used to iterate the 4-, 6-, and 18-neighborhood. Other images
+ * are processed by iterating the neighborhood with a single temporary image.
+ *
+ * \param[in]  op           Morphological operation.
+ * \param[in]  input        Input image.
+ * \param[out] output       Output image, must differ from input image.
+ * \param[in]  iterations   Number of iterations.
+ * \param[in]  connectivity Neighborhood connectivity.
+ */
+template <class TVoxel>
+void ApplyMorphologicalOperation(MorphologicalOperation op,
+                                 const GenericImage<TVoxel> &input,
+                                 GenericImage<TVoxel> &output,
+                                 int iterations, ConnectivityType connectivity);
+
+/**
+ * Apply morphological operation with Euclidean ball structuring element
+ *
+ * The input image is treated as binary mask, where non-zero values are
+ * foreground. The output foreground is obtained by thresholding the Euclidean
+ * distance transform of the input foreground (dilation) or background (erosion),
+ * and has value 1. The ball radius is in world units, i.e., takes the voxel
+ * size into account. Each frame of a temporal sequence is processed separately.
+ *
+ * \param[in]  op     Morphological operation.
+ * \param[in]  input  Input mask.
+ * \param[out] output Output mask, may be identical to input image.
+ * \param[in]  radius Radius of ball in world units.
+ */
+template <class TVoxel>
+void ApplyMorphologicalOperation(MorphologicalOperation op,
+                                 const GenericImage<TVoxel> &input,
+                                 GenericImage<TVoxel> &output,
+                                 double radius);
+
+
+} // namespace mirtk
+
+#endif // MIRTK_Morphology_H
@@ -34,7 +34,8 @@ template <class VoxelType>
 Closing<VoxelType>::Closing()
 :
   _Connectivity(ConnectivityType::CONNECTIVITY_26),
-  _NumberOfIterations(1)
+  _NumberOfIterations(1),
+  _Radius(.0)
 {
 }
 
@@ -77,46 +78,67 @@ void Closing<VoxelType>::Run()
     output->ClearBackgroundValue();
   }
 
-  i1 -= _NumberOfIterations;
-  j1 -= _NumberOfIterations;
-  k1 -= _NumberOfIterations;
-  i2 += _NumberOfIterations;
-  j2 += _NumberOfIterations;
-  k2 += _NumberOfIterations;
+  // Margin by which foreground may grow beyond its bounding box
+  int mi, mj, mk;
+  if (_Radius > .0) {
+    mi = iceil(_Radius / output->XSize());
+    mj = iceil(_Radius / output->YSize());
+    mk = iceil(_Radius / output->ZSize());
+  } else {
+    mi = mj = mk = _NumberOfIterations;
+  }
+
+  i1 -= mi;
+  j1 -= mj;
+  k1 -= mk;
+  i2 += mi;
+  j2 += mj;
+  k2 += mk;
 
   if (i1 < 0 || i2 >= output->X() ||
       j1 < 0 || j2 >= output->Y() ||
       k1 < 0 || k2 >= output->Z()) {
 
-    GenericImage<VoxelType> padded(i2 - i1 + 1, j2 - j1 + 1, k2 - k1 + 1);
+    ImageAttributes attr = output->Attributes();
+    attr._x = i2 - i1 + 1;
+    attr._y = j2 - j1 + 1;
+    attr._z = k2 - k1 + 1;
+    attr._t = 1;
+    GenericImage<VoxelType> padded(attr);
 
-    i1 += _NumberOfIterations;
-    j1 += _NumberOfIterations;
-    k1 += _NumberOfIterations;
-    i2 -= _NumberOfIterations;
-    j2 -= _NumberOfIterations;
-    k2 -= _NumberOfIterations;
+    i1 += mi;
+    j1 += mj;
+    k1 += mk;
+    i2 -= mi;
+    j2 -= mj;
+    k2 -= mk;
 
     for (int k = k1; k <= k2; ++k)
     for (int j = j1; j <= j2; ++j)
     for (int i = i1; i <= i2; ++i) {
-      padded(i - i1 + _NumberOfIterations,
-             j - j1 + _NumberOfIterations,
-             k - k1 + _NumberOfIterations)
+      padded(i - i1 + mi, j - j1 + mj, k - k1 + mk)
           = static_cast<VoxelType>(output->GetAsDouble(i, j, k));
     }
 
-    Dilate<VoxelType>(&padded, _NumberOfIterations, _Connectivity);
-    Erode <VoxelType>(&padded, _NumberOfIterations, _Connectivity);
+    if (_Radius > .0) {
+      Dilate<VoxelType>(&padded, _Radius);
+      Erode <VoxelType>(&padded, _Radius);
+    } else {
+      Dilate<VoxelType>(&padded, _NumberOfIterations, _Connectivity);
+      Erode <VoxelType>(&padded, _NumberOfIterations, _Connectivity);
+    }
 
     for (int k = k1; k <= k2; ++k)
     for (int j = j1; j <= j2; ++j)
     for (int i = i1; i <= i2; ++i) {
-      output->PutAsDouble(i, j, k, static_cast<double>(padded(i - i1 + _NumberOfIterations,
-                                                              j - j1 + _NumberOfIterations,
-                                                              k - k1 + _NumberOfIterations)));
+      output->PutAsDouble(i, j, k, static_cast<double>(padded(i - i1 + mi, j - j1 + mj, k - k1 + mk)));
     }
 
+  } else if (_Radius > .0) {
+
+    Dilate<VoxelType>(output, _Radius);
+    Erode <VoxelType>(output, _Radius);
+
   } else {
 
     Dilate<VoxelType>(output, _NumberOfIterations, _Connectivity);
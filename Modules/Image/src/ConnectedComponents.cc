@@ -19,9 +19,8 @@
 
 #include "mirtk/ConnectedComponents.h"
 
-#include "mirtk/Assert.h"
-#include "mirtk/Queue.h"
-#include "mirtk/OrderedSet.h"
+#include "mirtk/Math.h"
+#include "mirtk/Parallel.h"
 #include "mirtk/Algorithm.h"
 
 
@@ -32,83 +31,158 @@ namespace mirtk {
 // Auxiliaries
 // =============================================================================
 
+namespace ConnectedComponentsUtils {
+
+
 // -----------------------------------------------------------------------------
-/// Marks all voxels as unvisited and collects set of unique segmentation labels
-template <class TLabel>
-void MarkUnvisited(const GenericImage<TLabel> &segmentation,
-                   GenericImage<TLabel>       &components)
+/// Offsets of the neighbors which precede a voxel in raster scan order
+struct PrecedingNeighbors
 {
-  for (int idx = 0; idx < segmentation.NumberOfVoxels(); ++idx) {
-    if (segmentation(idx)) {
-      components(idx) = voxel_limits<TLabel>::max_value();
-    } else {
-      components(idx) = TLabel(0);
+  int _Size;          ///< Number of preceding neighbors
+  int _Offset[13][3]; ///< Voxel index offsets of preceding neighbors
+
+  PrecedingNeighbors(ConnectivityType conn)
+  :
+    _Size(0)
+  {
+    for (int dk = -1; dk <= 0; ++dk)
+    for (int dj = -1; dj <= 1; ++dj)
+    for (int di = -1; di <= 1; ++di) {
+      if (dk == 0 && (dj > 0 || (dj == 0 && di >= 0))) continue;
+      const int n = abs(di) + abs(dj) + abs(dk);
+      bool is_neighbor;
+      switch (conn) {
+        case CONNECTIVITY_4:  is_neighbor = (dk == 0 && n == 1); break;
+        case CONNECTIVITY_6:  is_neighbor = (n == 1); break;
+        case CONNECTIVITY_18: is_neighbor = (n <= 2); break;
+        default:              is_neighbor = true; break;
+      }
+      if (is_neighbor) {
+        _Offset[_Size][0] = di;
+        _Offset[_Size][1] = dj;
+        _Offset[_Size][2] = dk;
+        ++_Size;
+      }
     }
   }
-}
+};
 
 // -----------------------------------------------------------------------------
-/// Finds index of next unlabeled component voxel or -1 when done
-template <class TLabel>
-int NextSeed(const GenericImage<TLabel> &components)
+/// Find root of voxel in union-find forest with path halving
+inline int FindRoot(int *parent, int idx)
 {
-  for (int idx = 0; idx < components.NumberOfVoxels(); ++idx) {
-    if (components(idx) == voxel_limits<TLabel>::max_value()) return idx;
+  while (parent[idx] != idx) {
+    parent[idx] = parent[parent[idx]];
+    idx = parent[idx];
   }
-  return -1;
+  return idx;
 }
 
 // -----------------------------------------------------------------------------
-/// Performs region growing for a specific input label and seed
+/// Merge sets containing the two voxels
+///
+/// The root of the merged set is the voxel with smallest index. Hence, the
+/// parent of a voxel never has a greater index than the voxel itself.
+inline void Union(int *parent, int a, int b)
+{
+  a = FindRoot(parent, a);
+  b = FindRoot(parent, b);
+  if      (a < b) parent[b] = a;
+  else if (b < a) parent[a] = b;
+}
+
+// -----------------------------------------------------------------------------
+/// Union-find labelling of a slab of consecutive image slices
+///
+/// Each slab is labelled independently of the others. Only neighbors within
+/// the same slab are considered, such that slabs can be processed in parallel.
+/// Components crossing slab boundaries are merged by Run afterwards.
+/// Slices of different time frames are never connected.
 template <class TLabel>
-int LabelComponent(const NeighborhoodOffsets  &offsets,
-                   const GenericImage<TLabel> &segmentation,
-                   GenericImage<TLabel>       &components,
-                   int                         seed,
-                   TLabel                      component_label)
+class LabelSlabs
 {
-  const TLabel unvisited     = voxel_limits<TLabel>::max_value();
-  const TLabel current_label = segmentation(seed);
-  const TLabel * start_label = segmentation.Data();
-
-  int idx, neighbor_idx, num = 0;
-  Queue<int> active;
-  active.push(seed);
-
-  while (!active.empty()) {
-    idx = active.front();
-    active.pop();
-    if (components(idx) == unvisited) {
-      components(idx) = component_label, ++num;
-      if (segmentation.IsBoundary(idx)) {
-        const TLabel *neighbor_label, *label = segmentation.Data(idx);
-        const TLabel *neighbor_comp,  *comp  = components  .Data(idx);
-        for (int n = 0; n < offsets.Size(); ++n) {
-          neighbor_label = label + offsets(n);
-          neighbor_idx   = static_cast<int>(neighbor_label - start_label);
-          if (0 <= neighbor_idx && neighbor_idx < segmentation.NumberOfVoxels()) {
-            neighbor_comp = comp + offsets(n);
-            if (*neighbor_label == current_label && *neighbor_comp == unvisited) {
-              active.push(neighbor_idx);
-            }
-          }
+  const GenericImage<TLabel> *_Segmentation;
+  const PrecedingNeighbors   *_Neighbors;
+  int                        *_Parent;
+  int                         _SlicesPerSlab;
+
+public:
+
+  /// Connect voxel to its preceding neighbors with the same label
+  ///
+  /// \param[in] k1 First slice (across time frames) whose voxels are connected.
+  static void Connect(const GenericImage<TLabel> &seg, const PrecedingNeighbors &nbrs,
+                      int *parent, int i, int j, int s, int k1)
+  {
+    const int nx = seg.X(), ny = seg.Y(), nz = seg.Z();
+    const int k  = s % nz;
+    const int idx = i + nx * (j + ny * s);
+    const TLabel label = seg(idx);
+    int a, b, c;
+    for (int n = 0; n < nbrs._Size; ++n) {
+      a = i + nbrs._Offset[n][0];
+      b = j + nbrs._Offset[n][1];
+      c = k + nbrs._Offset[n][2];
+      if (a < 0 || a >= nx || b < 0 || b >= ny || c < 0) continue;
+      if (nbrs._Offset[n][2] < 0 && s - 1 < k1) continue;
+      const int nbr = a + nx * (b + ny * (s + nbrs._Offset[n][2]));
+      if (seg(nbr) == label) Union(parent, idx, nbr);
+    }
+  }
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int nx = _Segmentation->X();
+    const int ny = _Segmentation->Y();
+    const int ns = _Segmentation->Z() * _Segmentation->T();
+    const TLabel zero(0);
+    for (int slab = re.begin(); slab != re.end(); ++slab) {
+      const int k1 = slab * _SlicesPerSlab;
+      const int k2 = min(k1 + _SlicesPerSlab, ns);
+      for (int s = k1; s < k2; ++s)
+      for (int j = 0; j < ny; ++j)
+      for (int i = 0; i < nx; ++i) {
+        const int idx = i + nx * (j + ny * s);
+        if ((*_Segmentation)(idx) == zero) {
+          _Parent[idx] = -1;
+        } else {
+          _Parent[idx] = idx;
+          Connect(*_Segmentation, *_Neighbors, _Parent, i, j, s, k1);
         }
-      } else {
-        const TLabel *neighbor_label, *label = segmentation.Data(idx);
-        const TLabel *neighbor_comp,  *comp  = components  .Data(idx);
-        for (int n = 0; n < offsets.Size(); ++n) {
-          neighbor_label = label + offsets(n);
-          neighbor_comp  = comp  + offsets(n);
-          if (*neighbor_label == current_label && *neighbor_comp == unvisited) {
-            active.push(static_cast<int>(neighbor_label - start_label));
-          }
+      }
+    }
+  }
+
+  /// Label slabs in parallel and merge components at slab boundaries
+  static void Run(const GenericImage<TLabel> &seg, const PrecedingNeighbors &nbrs, int *parent)
+  {
+    // Use slabs of at least 8 slices, but no more than 32 slabs such that
+    // the serial merge at slab boundaries is negligible
+    const int ns = seg.Z() * seg.T();
+    const int nslabs = max(1, min(32, ns / 8));
+    LabelSlabs body;
+    body._Segmentation  = &seg;
+    body._Neighbors     = &nbrs;
+    body._Parent        = parent;
+    body._SlicesPerSlab = (ns + nslabs - 1) / nslabs;
+    parallel_for(blocked_range<int>(0, nslabs), body);
+    // Merge components at slab boundaries
+    const TLabel zero(0);
+    for (int s = body._SlicesPerSlab; s < ns; s += body._SlicesPerSlab) {
+      if (s % seg.Z() == 0) continue; // first slice of time frame
+      for (int j = 0; j < seg.Y(); ++j)
+      for (int i = 0; i < seg.X(); ++i) {
+        if (seg(i + seg.X() * (j + seg.Y() * s)) != zero) {
+          Connect(seg, nbrs, parent, i, j, s, s - 1);
         }
       }
     }
   }
+};
 
-  return num;
-}
+
+} // namespace ConnectedComponentsUtils
+using namespace ConnectedComponentsUtils;
 
 // =============================================================================
 // Construction/Destruction
@@ -142,9 +216,7 @@ void ConnectedComponents<VoxelType>::Initialize()
 
   _NumberOfComponents = 0;
   _ComponentSize.clear();
-
-  MarkUnvisited(*this->Input(), *this->Output());
-  _Offsets.Initialize(this->Input(), _Connectivity);
+  _Components.clear();
 }
 
 // -----------------------------------------------------------------------------
@@ -153,18 +225,66 @@ void ConnectedComponents<VoxelType>::Run()
 {
   this->Initialize();
 
-  int num, seed;
-  VoxelType c(0);
-  while ((seed = NextSeed(*this->Output())) != -1) {
-    if (++c == voxel_limits<VoxelType>::max_value()) {
-      cerr << "ConnectedComponents::Run: No. of components exceeded maximum label value!" << endl;
-      exit(1);
+  const GenericImage<VoxelType> &input  = *this->Input();
+  GenericImage<VoxelType>       &output = *this->Output();
+
+  // Build union-find forest of equally labelled neighboring voxels
+  Array<int> parent(input.NumberOfVoxels());
+  LabelSlabs<VoxelType>::Run(input, PrecedingNeighbors(_Connectivity), parent.data());
+
+  // Assign component labels in raster scan order of first component voxel
+  // and accumulate component statistics in the same pass
+  const double max_label = voxel_limits<VoxelType>::max_value();
+  const int nz = input.Z();
+  int idx = 0, root;
+  for (int s = 0; s < nz * input.T(); ++s)
+  for (int j = 0; j < input.Y(); ++j)
+  for (int i = 0; i < input.X(); ++i, ++idx) {
+    if (parent[idx] < 0) {
+      output(idx) = VoxelType(0);
+      continue;
+    }
+    // Parent of preceding voxels already points to the root
+    root = parent[idx] = parent[parent[idx]];
+    if (root == idx) {
+      if (_NumberOfComponents >= max_label) {
+        cerr << "ConnectedComponents::Run: No. of components exceeded maximum label value!" << endl;
+        exit(1);
+      }
+      ++_NumberOfComponents;
+      output(idx) = voxel_cast<VoxelType>(_NumberOfComponents);
+      ConnectedComponent comp;
+      comp.Size = 0;
+      comp.Bounds[0] = comp.Bounds[1] = i;
+      comp.Bounds[2] = comp.Bounds[3] = j;
+      comp.Bounds[4] = comp.Bounds[5] = s % nz;
+      comp.Centroid[0] = comp.Centroid[1] = comp.Centroid[2] = 0.;
+      _Components.push_back(comp);
+    } else {
+      output(idx) = output(root);
     }
-    num = LabelComponent(_Offsets, *this->Input(), *this->Output(), seed, c);
-    mirtkAssert(num > 0, "found seed must be valid and no. of unvisited voxels decrease");
-    _ComponentSize.push_back(num);
+    ConnectedComponent &comp = _Components[static_cast<int>(output(idx)) - 1];
+    const int k = s % nz;
+    comp.Size += 1;
+    if (i < comp.Bounds[0]) comp.Bounds[0] = i;
+    if (i > comp.Bounds[1]) comp.Bounds[1] = i;
+    if (j < comp.Bounds[2]) comp.Bounds[2] = j;
+    if (j > comp.Bounds[3]) comp.Bounds[3] = j;
+    if (k < comp.Bounds[4]) comp.Bounds[4] = k;
+    if (k > comp.Bounds[5]) comp.Bounds[5] = k;
+    comp.Centroid[0] += i;
+    comp.Centroid[1] += j;
+    comp.Centroid[2] += k;
+  }
+
+  _ComponentSize.resize(_Components.size());
+  for (size_t c = 0; c < _Components.size(); ++c) {
+    ConnectedComponent &comp = _Components[c];
+    comp.Centroid[0] /= comp.Size;
+    comp.Centroid[1] /= comp.Size;
+    comp.Centroid[2] /= comp.Size;
+    _ComponentSize[c] = comp.Size;
   }
-  _NumberOfComponents = static_cast<int>(c);
 
   this->Finalize();
 }
@@ -185,16 +305,18 @@ void ConnectedComponents<VoxelType>::Finalize()
       new_label[order[i]] = voxel_cast<VoxelType>(i + 1);
     }
     GenericImage<VoxelType> &output = *this->Output();
-    const Array<int> new_size = _ComponentSize; // make copy
-    VoxelType current;
     const VoxelType zero(0);
     for (int idx = 0; idx < output.NumberOfVoxels(); ++idx) {
-      current = output(idx);
-      if (current > zero) {
-        output(idx)                   = new_label[current-1];
-        _ComponentSize[output(idx)-1] = new_size [current-1];
+      const VoxelType current = output(idx);
+      if (current != zero) {
+        output(idx) = new_label[static_cast<int>(current) - 1];
       }
     }
+    const Array<ConnectedComponent> components = _Components; // make copy
+    for (int i = 0; i < _NumberOfComponents; ++i) {
+      _Components   [i] = components[order[i]];
+      _ComponentSize[i] = _Components[i].Size;
+    }
   }
 
   ImageToImage<VoxelType>::Finalize();
@@ -218,8 +340,12 @@ void ConnectedComponents<VoxelType>::DeleteComponent(VoxelType c)
 // Explicit template instantiations
 // =============================================================================
 
-template class ConnectedComponents<BytePixel>;
-template class ConnectedComponents<GreyPixel>;
+template class ConnectedComponents<char>;
+template class ConnectedComponents<unsigned char>;
+template class ConnectedComponents<short>;
+template class ConnectedComponents<unsigned short>;
+template class ConnectedComponents<int>;
+template class ConnectedComponents<unsigned int>;
 
 
 } // namespace mirtk
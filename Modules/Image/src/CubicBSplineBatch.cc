@@ -0,0 +1,420 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2017 Imperial College London
+ * Copyright 2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/CubicBSplineBatch.h"
+
+#include "mirtk/BSpline.h"
+
+// Vectorized functions are compiled for the respective instruction set using
+// function attributes such that MIRTK can be built without -mavx2 or -mavx512f
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#  define MIRTK_CubicBSplineBatch_WITH_AVX2 1
+#  define MIRTK_CubicBSplineBatch_WITH_AVX512 1
+#  define MIRTK_TARGET_AVX2   __attribute__((target("avx2")))
+#  define MIRTK_TARGET_AVX512 __attribute__((target("avx512f")))
+#  include <immintrin.h>
+#else
+#  define MIRTK_CubicBSplineBatch_WITH_AVX2 0
+#  define MIRTK_CubicBSplineBatch_WITH_AVX512 0
+#endif
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliary functions
+// =============================================================================
+
+namespace CubicBSplineBatchUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Tables of spline weights, where the four weights of row r start at index 4 * r
+template <class T>
+struct WeightTables
+{
+  const T *x,  *y,  *z;  ///< Spline weights
+  const T *x1, *y1, *z1; ///< Spline derivative weights, only used when evaluating derivatives
+};
+
+// -----------------------------------------------------------------------------
+/// Evaluate cubic B-spline one point at a time
+///
+/// \tparam D Whether to evaluate first order derivatives.
+template <class T, bool D>
+void EvaluateScalar(int n, const T *coeff, int X, int XY, const int *offset,
+                    const WeightTables<T> &lut, const int *a, const int *b, const int *c,
+                    T *v, T *dx, T *dy, T *dz)
+{
+  T val, gx, gy, gz, wyz, wy1z, wyz1, w;
+  for (int p = 0; p < n; ++p) {
+    const T * const wx  = lut.x  + 4 * a[p];
+    const T * const wy  = lut.y  + 4 * b[p];
+    const T * const wz  = lut.z  + 4 * c[p];
+    const T * const wx1 = (D ? lut.x1 + 4 * a[p] : nullptr);
+    const T * const wy1 = (D ? lut.y1 + 4 * b[p] : nullptr);
+    const T * const wz1 = (D ? lut.z1 + 4 * c[p] : nullptr);
+    val = gx = gy = gz = T(0);
+    for (int k = 0; k < 4; ++k)
+    for (int j = 0; j < 4; ++j) {
+      const T *row = coeff + offset[p] + k * XY + j * X;
+      wyz = wy[j] * wz[k];
+      if (D) {
+        wy1z = wy1[j] * wz [k];
+        wyz1 = wy [j] * wz1[k];
+      }
+      for (int i = 0; i < 4; ++i) {
+        w    = wx[i] * wyz;
+        val += w * row[i];
+        if (D) {
+          w   = wx1[i] * wyz;
+          gx += w * row[i];
+          w   = wx [i] * wy1z;
+          gy += w * row[i];
+          w   = wx [i] * wyz1;
+          gz += w * row[i];
+        }
+      }
+    }
+    v[p] = val;
+    if (D) dx[p] = gx, dy[p] = gy, dz[p] = gz;
+  }
+}
+
+#if MIRTK_CubicBSplineBatch_WITH_AVX2 || MIRTK_CubicBSplineBatch_WITH_AVX512
+
+// -----------------------------------------------------------------------------
+/// Define function template NAME<S, D>, which evaluates the cubic B-spline at
+/// S::N points at a time using the instruction set enabled by TARGET
+///
+/// Each vector lane performs the same operations as EvaluateScalar, where the
+/// spline weights and coefficients of the points are loaded by gather instructions.
+/// The same definition is expanded once for each instruction set, because the
+/// vector operations of S can only be inlined into a function of the same target.
+///
+/// The defined function returns the number of evaluated points, i.e., a multiple of S::N.
+#define MIRTK_CubicBSplineBatch_DefineEvaluateVectorized(NAME, TARGET)                  \
+template <class S, bool D>                                                              \
+TARGET int NAME(int n, const typename S::Real *coeff, int X, int XY, const int *offset, \
+                const WeightTables<typename S::Real> &lut,                              \
+                const int *a, const int *b, const int *c,                               \
+                typename S::Real *v, typename S::Real *dx,                              \
+                typename S::Real *dy, typename S::Real *dz)                             \
+{                                                                                       \
+  typedef typename S::Vector Vector;                                                    \
+  typedef typename S::Index  Index;                                                     \
+                                                                                        \
+  Vector wx[4], wy[4], wz[4], wx1[4], wy1[4], wz1[4];                                   \
+  Vector val, gx, gy, gz, wyz, wy1z, wyz1, w, cf;                                       \
+  Index  ia, ib, ic, row;                                                               \
+                                                                                        \
+  int p = 0;                                                                            \
+  for (; p + S::N <= n; p += S::N) {                                                    \
+    ia = S::Mul4(S::Load(a + p));                                                       \
+    ib = S::Mul4(S::Load(b + p));                                                       \
+    ic = S::Mul4(S::Load(c + p));                                                       \
+    for (int i = 0; i < 4; ++i) {                                                       \
+      wx[i] = S::Gather(lut.x, S::Add(ia, i));                                          \
+      wy[i] = S::Gather(lut.y, S::Add(ib, i));                                          \
+      wz[i] = S::Gather(lut.z, S::Add(ic, i));                                          \
+      if (D) {                                                                          \
+        wx1[i] = S::Gather(lut.x1, S::Add(ia, i));                                      \
+        wy1[i] = S::Gather(lut.y1, S::Add(ib, i));                                      \
+        wz1[i] = S::Gather(lut.z1, S::Add(ic, i));                                      \
+      }                                                                                 \
+    }                                                                                   \
+    const Index o = S::Load(offset + p);                                                \
+    val = gx = gy = gz = S::Zero();                                                     \
+    for (int k = 0; k < 4; ++k)                                                         \
+    for (int j = 0; j < 4; ++j) {                                                       \
+      row = S::Add(o, k * XY + j * X);                                                  \
+      wyz = S::Mul(wy[j], wz[k]);                                                       \
+      if (D) {                                                                          \
+        wy1z = S::Mul(wy1[j], wz [k]);                                                  \
+        wyz1 = S::Mul(wy [j], wz1[k]);                                                  \
+      }                                                                                 \
+      for (int i = 0; i < 4; ++i) {                                                     \
+        cf  = S::Gather(coeff, S::Add(row, i));                                         \
+        w   = S::Mul(wx[i], wyz);                                                       \
+        val = S::Add(val, S::Mul(w, cf));                                               \
+        if (D) {                                                                        \
+          w  = S::Mul(wx1[i], wyz);                                                     \
+          gx = S::Add(gx, S::Mul(w, cf));                                               \
+          w  = S::Mul(wx [i], wy1z);                                                    \
+          gy = S::Add(gy, S::Mul(w, cf));                                               \
+          w  = S::Mul(wx [i], wyz1);                                                    \
+          gz = S::Add(gz, S::Mul(w, cf));                                               \
+        }                                                                               \
+      }                                                                                 \
+    }                                                                                   \
+    S::Store(v + p, val);                                                               \
+    if (D) {                                                                            \
+      S::Store(dx + p, gx);                                                             \
+      S::Store(dy + p, gy);                                                             \
+      S::Store(dz + p, gz);                                                             \
+    }                                                                                   \
+  }                                                                                     \
+  return p;                                                                             \
+}
+
+#endif // MIRTK_CubicBSplineBatch_WITH_AVX2 || MIRTK_CubicBSplineBatch_WITH_AVX512
+#if MIRTK_CubicBSplineBatch_WITH_AVX2
+
+// -----------------------------------------------------------------------------
+/// AVX2 operations on four double-precision values
+struct AVX2Double
+{
+  typedef double  Real;
+  typedef __m256d Vector;
+  typedef __m128i Index;
+
+  static const int N = 4;
+
+  MIRTK_TARGET_AVX2 static Index  Load (const int *p)            { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+  MIRTK_TARGET_AVX2 static Index  Add  (Index i, int j)          { return _mm_add_epi32(i, _mm_set1_epi32(j)); }
+  MIRTK_TARGET_AVX2 static Index  Mul4 (Index i)                 { return _mm_slli_epi32(i, 2); }
+  MIRTK_TARGET_AVX2 static Vector Gather(const Real *p, Index i) { return _mm256_mask_i32gather_pd(Zero(), p, i, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8); }
+  MIRTK_TARGET_AVX2 static Vector Zero ()                        { return _mm256_setzero_pd(); }
+  MIRTK_TARGET_AVX2 static Vector Add  (Vector a, Vector b)      { return _mm256_add_pd(a, b); }
+  MIRTK_TARGET_AVX2 static Vector Mul  (Vector a, Vector b)      { return _mm256_mul_pd(a, b); }
+  MIRTK_TARGET_AVX2 static void   Store(Real *p, Vector v)       { _mm256_storeu_pd(p, v); }
+};
+
+// -----------------------------------------------------------------------------
+/// AVX2 operations on eight single-precision values
+struct AVX2Float
+{
+  typedef float   Real;
+  typedef __m256  Vector;
+  typedef __m256i Index;
+
+  static const int N = 8;
+
+  MIRTK_TARGET_AVX2 static Index  Load (const int *p)            { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+  MIRTK_TARGET_AVX2 static Index  Add  (Index i, int j)          { return _mm256_add_epi32(i, _mm256_set1_epi32(j)); }
+  MIRTK_TARGET_AVX2 static Index  Mul4 (Index i)                 { return _mm256_slli_epi32(i, 2); }
+  MIRTK_TARGET_AVX2 static Vector Gather(const Real *p, Index i) { return _mm256_mask_i32gather_ps(Zero(), p, i, _mm256_castsi256_ps(_mm256_set1_epi32(-1)), 4); }
+  MIRTK_TARGET_AVX2 static Vector Zero ()                        { return _mm256_setzero_ps(); }
+  MIRTK_TARGET_AVX2 static Vector Add  (Vector a, Vector b)      { return _mm256_add_ps(a, b); }
+  MIRTK_TARGET_AVX2 static Vector Mul  (Vector a, Vector b)      { return _mm256_mul_ps(a, b); }
+  MIRTK_TARGET_AVX2 static void   Store(Real *p, Vector v)       { _mm256_storeu_ps(p, v); }
+};
+
+// -----------------------------------------------------------------------------
+template <class T> struct AVX2;
+template <> struct AVX2<double> { typedef AVX2Double Type; };
+template <> struct AVX2<float>  { typedef AVX2Float  Type; };
+
+// -----------------------------------------------------------------------------
+/// Evaluate cubic B-spline at four or eight points at a time using AVX2
+MIRTK_CubicBSplineBatch_DefineEvaluateVectorized(EvaluateAVX2, MIRTK_TARGET_AVX2)
+
+#endif // MIRTK_CubicBSplineBatch_WITH_AVX2
+#if MIRTK_CubicBSplineBatch_WITH_AVX512
+
+// -----------------------------------------------------------------------------
+/// AVX-512 operations on eight double-precision values
+struct AVX512Double
+{
+  typedef double  Real;
+  typedef __m512d Vector;
+  typedef __m256i Index;
+
+  static const int N = 8;
+
+  MIRTK_TARGET_AVX512 static Index  Load (const int *p)            { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+  MIRTK_TARGET_AVX512 static Index  Add  (Index i, int j)          { return _mm256_add_epi32(i, _mm256_set1_epi32(j)); }
+  MIRTK_TARGET_AVX512 static Index  Mul4 (Index i)                 { return _mm256_slli_epi32(i, 2); }
+  MIRTK_TARGET_AVX512 static Vector Gather(const Real *p, Index i) { return _mm512_i32gather_pd(i, p, 8); }
+  MIRTK_TARGET_AVX512 static Vector Zero ()                        { return _mm512_setzero_pd(); }
+  MIRTK_TARGET_AVX512 static Vector Add  (Vector a, Vector b)      { return _mm512_add_pd(a, b); }
+  MIRTK_TARGET_AVX512 static Vector Mul  (Vector a, Vector b)      { return _mm512_mul_pd(a, b); }
+  MIRTK_TARGET_AVX512 static void   Store(Real *p, Vector v)       { _mm512_storeu_pd(p, v); }
+};
+
+// -----------------------------------------------------------------------------
+/// AVX-512 operations on sixteen single-precision values
+struct AVX512Float
+{
+  typedef float   Real;
+  typedef __m512  Vector;
+  typedef __m512i Index;
+
+  static const int N = 16;
+
+  MIRTK_TARGET_AVX512 static Index  Load (const int *p)            { return _mm512_loadu_si512(p); }
+  MIRTK_TARGET_AVX512 static Index  Add  (Index i, int j)          { return _mm512_add_epi32(i, _mm512_set1_epi32(j)); }
+  MIRTK_TARGET_AVX512 static Index  Mul4 (Index i)                 { return _mm512_slli_epi32(i, 2); }
+  MIRTK_TARGET_AVX512 static Vector Gather(const Real *p, Index i) { return _mm512_i32gather_ps(i, p, 4); }
+  MIRTK_TARGET_AVX512 static Vector Zero ()                        { return _mm512_setzero_ps(); }
+  MIRTK_TARGET_AVX512 static Vector Add  (Vector a, Vector b)      { return _mm512_add_ps(a, b); }
+  MIRTK_TARGET_AVX512 static Vector Mul  (Vector a, Vector b)      { return _mm512_mul_ps(a, b); }
+  MIRTK_TARGET_AVX512 static void   Store(Real *p, Vector v)       { _mm512_storeu_ps(p, v); }
+};
+
+// -----------------------------------------------------------------------------
+template <class T> struct AVX512;
+template <> struct AVX512<double> { typedef AVX512Double Type; };
+template <> struct AVX512<float>  { typedef AVX512Float  Type; };
+
+// -----------------------------------------------------------------------------
+/// Evaluate cubic B-spline at eight or sixteen points at a time using AVX-512
+MIRTK_CubicBSplineBatch_DefineEvaluateVectorized(EvaluateAVX512, MIRTK_TARGET_AVX512)
+
+#endif // MIRTK_CubicBSplineBatch_WITH_AVX512
+
+
+// -----------------------------------------------------------------------------
+template <class T>
+void Evaluate(CubicBSplineBatchMode mode, int n,
+              const T *coeff, int X, int XY, const int *offset,
+              const WeightTables<T> &lut, const int *a, const int *b, const int *c,
+              T *v, T *dx, T *dy, T *dz)
+{
+  // Use instruction set only when supported by the CPU
+  const CubicBSplineBatchMode cpu = CubicBSplineBatchCPUMode();
+  if (mode == CubicBSplineBatch_Default || mode > cpu) mode = cpu;
+  int p = 0;
+  #if MIRTK_CubicBSplineBatch_WITH_AVX512
+    if (mode == CubicBSplineBatch_AVX512) {
+      typedef typename AVX512<T>::Type S;
+      if (dx) p = EvaluateAVX512<S, true >(n, coeff, X, XY, offset, lut, a, b, c, v, dx, dy, dz);
+      else    p = EvaluateAVX512<S, false>(n, coeff, X, XY, offset, lut, a, b, c, v, dx, dy, dz);
+    }
+  #endif
+  #if MIRTK_CubicBSplineBatch_WITH_AVX2
+    if (mode == CubicBSplineBatch_AVX2) {
+      typedef typename AVX2<T>::Type S;
+      if (dx) p = EvaluateAVX2<S, true >(n, coeff, X, XY, offset, lut, a, b, c, v, dx, dy, dz);
+      else    p = EvaluateAVX2<S, false>(n, coeff, X, XY, offset, lut, a, b, c, v, dx, dy, dz);
+    }
+  #endif
+  // Remaining points
+  if (p < n) {
+    if (dx) {
+      EvaluateScalar<T, true >(n - p, coeff, X, XY, offset + p, lut, a + p, b + p, c + p,
+                               v + p, dx + p, dy + p, dz + p);
+    } else {
+      EvaluateScalar<T, false>(n - p, coeff, X, XY, offset + p, lut, a + p, b + p, c + p,
+                               v + p, nullptr, nullptr, nullptr);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Evaluate cubic B-spline using the lookup tables of BSpline<T>
+template <class T>
+void EvaluateLookupTable(CubicBSplineBatchMode mode, int n,
+                         const T *coeff, int X, int XY, const int *offset,
+                         const int *a, const int *b, const int *c,
+                         T *v, T *dx, T *dy, T *dz)
+{
+  WeightTables<T> lut;
+  lut.x  = lut.y  = lut.z  = &BSpline<T>::LookupTable  [0][0];
+  lut.x1 = lut.y1 = lut.z1 = &BSpline<T>::LookupTable_I[0][0];
+  Evaluate(mode, n, coeff, X, XY, offset, lut, a, b, c, v, dx, dy, dz);
+}
+
+// -----------------------------------------------------------------------------
+/// Evaluate cubic B-spline given the spline weights of each point
+///
+/// The weights of point p form row p of the weight tables, which are
+/// evaluated in chunks of points with the row indices of the chunk.
+template <class T>
+void EvaluateWeights(CubicBSplineBatchMode mode, int n,
+                     const T *coeff, int X, int XY, const int *offset,
+                     const T *wx, const T *wy, const T *wz, T *v)
+{
+  const int ChunkSize = 256;
+  int row[ChunkSize];
+  for (int p = 0; p < ChunkSize; ++p) row[p] = p;
+  WeightTables<T> w;
+  w.x1 = w.y1 = w.z1 = nullptr;
+  for (int p = 0, m; p < n; p += m) {
+    m = min(n - p, ChunkSize);
+    w.x = wx + 4 * p;
+    w.y = wy + 4 * p;
+    w.z = wz + 4 * p;
+    Evaluate<T>(mode, m, coeff, X, XY, offset + p, w, row, row, row, v + p, nullptr, nullptr, nullptr);
+  }
+}
+
+
+} // namespace CubicBSplineBatchUtils
+using namespace CubicBSplineBatchUtils;
+
+// =============================================================================
+// Instruction sets
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+CubicBSplineBatchMode CubicBSplineBatchCPUMode()
+{
+  #if MIRTK_CubicBSplineBatch_WITH_AVX512
+    static const bool avx512 = (__builtin_cpu_init(), __builtin_cpu_supports("avx512f") != 0);
+    if (avx512) return CubicBSplineBatch_AVX512;
+  #endif
+  #if MIRTK_CubicBSplineBatch_WITH_AVX2
+    static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+    if (avx2) return CubicBSplineBatch_AVX2;
+  #endif
+  return CubicBSplineBatch_Scalar;
+}
+
+// =============================================================================
+// Evaluation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void EvaluateCubicBSpline3D(CubicBSplineBatchMode mode, int n,
+                            const double *coeff, int X, int XY, const int *offset,
+                            const int *a, const int *b, const int *c, double *v,
+                            double *dx, double *dy, double *dz)
+{
+  EvaluateLookupTable(mode, n, coeff, X, XY, offset, a, b, c, v, dx, dy, dz);
+}
+
+// -----------------------------------------------------------------------------
+void EvaluateCubicBSpline3D(CubicBSplineBatchMode mode, int n,
+                            const float *coeff, int X, int XY, const int *offset,
+                            const int *a, const int *b, const int *c, float *v,
+                            float *dx, float *dy, float *dz)
+{
+  EvaluateLookupTable(mode, n, coeff, X, XY, offset, a, b, c, v, dx, dy, dz);
+}
+
+// -----------------------------------------------------------------------------
+void EvaluateCubicBSpline3D(CubicBSplineBatchMode mode, int n,
+                            const double *coeff, int X, int XY, const int *offset,
+                            const double *wx, const double *wy, const double *wz, double *v)
+{
+  EvaluateWeights(mode, n, coeff, X, XY, offset, wx, wy, wz, v);
+}
+
+// -----------------------------------------------------------------------------
+void EvaluateCubicBSpline3D(CubicBSplineBatchMode mode, int n,
+                            const float *coeff, int X, int XY, const int *offset,
+                            const float *wx, const float *wy, const float *wz, float *v)
+{
+  EvaluateWeights(mode, n, coeff, X, XY, offset, wx, wy, wz, v);
+}
+
+
+} // namespace mirtk
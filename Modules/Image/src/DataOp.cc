@@ -21,6 +21,8 @@
 
 #include "mirtk/Path.h"
 #include "mirtk/Memory.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/VoxelCast.h"
 #include "mirtk/BaseImage.h"
 #include "mirtk/ImageAttributes.h"
 
@@ -43,6 +45,93 @@
 namespace mirtk { namespace data {
 
 
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+namespace DataOpUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Convert data values from one type to another
+template <class TIn, class TOut>
+class ConvertValues
+{
+  const TIn *_Input;
+  TOut      *_Output;
+
+public:
+
+  ConvertValues(const TIn *input, TOut *output) : _Input(input), _Output(output) {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      _Output[i] = voxel_cast<TOut>(_Input[i]);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+template <class TIn, class TOut>
+void Convert(int n, const TIn *input, TOut *output)
+{
+  parallel_for(blocked_range<int>(0, n), ConvertValues<TIn, TOut>(input, output));
+}
+
+// -----------------------------------------------------------------------------
+/// Copy scalar image data to double array without a virtual call per voxel
+///
+/// \returns Whether the image data type is supported.
+bool GetImageData(const BaseImage *image, double *data)
+{
+  const int   n = image->NumberOfVoxels();
+  const void *p = image->GetDataPointer();
+  switch (image->GetDataType()) {
+    case MIRTK_VOXEL_CHAR:           Convert(n, reinterpret_cast<const char           *>(p), data); break;
+    case MIRTK_VOXEL_UNSIGNED_CHAR:  Convert(n, reinterpret_cast<const unsigned char  *>(p), data); break;
+    case MIRTK_VOXEL_SHORT:          Convert(n, reinterpret_cast<const short          *>(p), data); break;
+    case MIRTK_VOXEL_UNSIGNED_SHORT: Convert(n, reinterpret_cast<const unsigned short *>(p), data); break;
+    case MIRTK_VOXEL_INT:            Convert(n, reinterpret_cast<const int            *>(p), data); break;
+    case MIRTK_VOXEL_UNSIGNED_INT:   Convert(n, reinterpret_cast<const unsigned int   *>(p), data); break;
+    case MIRTK_VOXEL_FLOAT:          Convert(n, reinterpret_cast<const float          *>(p), data); break;
+    case MIRTK_VOXEL_DOUBLE:         Convert(n, reinterpret_cast<const double         *>(p), data); break;
+    default: return false;
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+/// Copy double array to scalar image data without a virtual call per voxel
+///
+/// \returns Whether the image data type is supported.
+bool PutImageData(BaseImage *image, const double *data)
+{
+  const int n = image->NumberOfVoxels();
+  void     *p = image->GetDataPointer();
+  switch (image->GetDataType()) {
+    case MIRTK_VOXEL_CHAR:           Convert(n, data, reinterpret_cast<char           *>(p)); break;
+    case MIRTK_VOXEL_UNSIGNED_CHAR:  Convert(n, data, reinterpret_cast<unsigned char  *>(p)); break;
+    case MIRTK_VOXEL_SHORT:          Convert(n, data, reinterpret_cast<short          *>(p)); break;
+    case MIRTK_VOXEL_UNSIGNED_SHORT: Convert(n, data, reinterpret_cast<unsigned short *>(p)); break;
+    case MIRTK_VOXEL_INT:            Convert(n, data, reinterpret_cast<int            *>(p)); break;
+    case MIRTK_VOXEL_UNSIGNED_INT:   Convert(n, data, reinterpret_cast<unsigned int   *>(p)); break;
+    case MIRTK_VOXEL_FLOAT:          Convert(n, data, reinterpret_cast<float          *>(p)); break;
+    case MIRTK_VOXEL_DOUBLE:         Convert(n, data, reinterpret_cast<double         *>(p)); break;
+    default: return false;
+  }
+  return true;
+}
+
+
+} // namespace DataOpUtils
+using namespace DataOpUtils;
+
+// =============================================================================
+// I/O functions
+// =============================================================================
+
+
 // -----------------------------------------------------------------------------
 DataFileType FileType(const char *name)
 {
@@ -137,8 +226,10 @@ int Read(const char *name, UniquePtr<double[]> &data, int *dtype, ImageAttribute
       if (dtype) *dtype = image->GetDataType();
       n = image->NumberOfVoxels();
       data.reset(Allocate<double>(n));
-      for (int i = 0; i < n; ++i) {
-        data[i] = image->GetAsDouble(i);
+      if (!GetImageData(image.get(), data.get())) {
+        for (int i = 0; i < n; ++i) {
+          data[i] = image->GetAsDouble(i);
+        }
       }
     } break;
     default:
@@ -234,7 +325,9 @@ void Write::Process(int n, double *data, bool *)
       }
       UniquePtr<BaseImage> image(BaseImage::New(_DataType));
       image->Initialize(_Attributes);
-      for (int i = 0; i < n; ++i) image->PutAsDouble(i, data[i]);
+      if (!PutImageData(image.get(), data)) {
+        for (int i = 0; i < n; ++i) image->PutAsDouble(i, data[i]);
+      }
       image->Write(_FileName.c_str());
     } break;
     default:
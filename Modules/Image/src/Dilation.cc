@@ -17,7 +17,6 @@
  */
 
 #include "mirtk/Dilation.h"
-#include "mirtk/BinaryVoxelFunction.h"
 
 
 namespace mirtk {
@@ -31,7 +30,9 @@ namespace mirtk {
 template <class VoxelType>
 Dilation<VoxelType>::Dilation()
 :
-  _Connectivity(ConnectivityType::CONNECTIVITY_26)
+  _Connectivity(ConnectivityType::CONNECTIVITY_26),
+  _NumberOfIterations(1),
+  _Radius(.0)
 {
 }
 
@@ -45,14 +46,6 @@ Dilation<VoxelType>::~Dilation()
 // Execution
 // =============================================================================
 
-// -----------------------------------------------------------------------------
-template <class VoxelType>
-void Dilation<VoxelType>::Initialize()
-{
-  ImageToImage<VoxelType>::Initialize();
-  _Offsets.Initialize(this->Input(), _Connectivity);
-}
-
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 void Dilation<VoxelType>::Run()
@@ -61,9 +54,12 @@ void Dilation<VoxelType>::Run()
 
   const GenericImage<VoxelType> * const input  = this->Input();
   GenericImage<VoxelType>       * const output = this->Output();
-  const ImageAttributes                &attr   = input->Attributes();
 
-  ParallelForEachVoxel(BinaryVoxelFunction::Dilate(_Offsets), attr, input, output);
+  if (_Radius > .0) {
+    ApplyMorphologicalOperation(MO_Dilation, *input, *output, _Radius);
+  } else {
+    ApplyMorphologicalOperation(MO_Dilation, *input, *output, _NumberOfIterations, _Connectivity);
+  }
 
   this->Finalize();
 }
@@ -17,7 +17,6 @@
  */
 
 #include "mirtk/Erosion.h"
-#include "mirtk/BinaryVoxelFunction.h"
 
 
 namespace mirtk {
@@ -31,7 +30,9 @@ namespace mirtk {
 template <class VoxelType>
 Erosion<VoxelType>::Erosion()
 :
-  _Connectivity(ConnectivityType::CONNECTIVITY_26)
+  _Connectivity(ConnectivityType::CONNECTIVITY_26),
+  _NumberOfIterations(1),
+  _Radius(.0)
 {
 }
 
@@ -45,14 +46,6 @@ Erosion<VoxelType>::~Erosion()
 // Execution
 // =============================================================================
 
-// -----------------------------------------------------------------------------
-template <class VoxelType>
-void Erosion<VoxelType>::Initialize()
-{
-  ImageToImage<VoxelType>::Initialize();
-  _Offsets.Initialize(this->Input(), _Connectivity);
-}
-
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 void Erosion<VoxelType>::Run()
@@ -61,9 +54,12 @@ void Erosion<VoxelType>::Run()
 
   const GenericImage<VoxelType> * const input  = this->Input();
   GenericImage<VoxelType>       * const output = this->Output();
-  const ImageAttributes                &attr   = input->Attributes();
 
-  ParallelForEachVoxel(BinaryVoxelFunction::Erode(_Offsets), attr, input, output);
+  if (_Radius > .0) {
+    ApplyMorphologicalOperation(MO_Erosion, *input, *output, _Radius);
+  } else {
+    ApplyMorphologicalOperation(MO_Erosion, *input, *output, _NumberOfIterations, _Connectivity);
+  }
 
   this->Finalize();
 }
@@ -19,6 +19,8 @@
 #include "mirtk/EuclideanDistanceTransform.h"
 
 #include "mirtk/Math.h"
+#include "mirtk/Memory.h"
+#include "mirtk/Parallel.h"
 #include "mirtk/Stream.h"
 
 #define EDT_MAX_IMAGE_DIMENSION 26754
@@ -29,10 +31,228 @@
 namespace mirtk {
 
 
+// =============================================================================
+// Auxiliary functions and functors
+// =============================================================================
+
+namespace EuclideanDistanceTransformUtils {
+
+
+// -----------------------------------------------------------------------------
+// This is Procedure edtVornoiEDT() in tPAMI paper for anisotropic voxels.
+//
+// The arrays g and h are used as workspace and must have at least size n.
+template <class VoxelType>
+int VornoiEDT_anisotropic(VoxelType *f, long n, double w, float *g, float *h)
+{
+  const VoxelType max_dist2 = VoxelType(EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC);
+
+  long i, l, n_S;
+  float a, b, c, v, lhs, rhs;
+
+  /* construct partial Vornoi diagram */
+  /* this loop is lines 1-14 in Procedure edtVornoiEDT() in tPAMI paper */
+  /* note we use 0 indexing in this program whereas paper uses 1 indexing */
+  for (i = 0, l = -1; i < n; i++) {
+    /* line 4 */
+    if (f[i] != max_dist2) {
+      /* line 5 */
+      if (l < 1) {
+        /* line 6 */
+        g[++l] = static_cast<float>(f[i]);
+        h[l] = static_cast<float>(w * i);
+      }
+      /* line 7 */
+      else {
+        /* line 8 */
+        while (l >= 1) {
+          /* compute removeEDT() in line 8 */
+          v = h[l];
+          a = v - h[l-1];
+          b = static_cast<float>(w * i) - v;
+          c = a + b;
+          /* compute Eq. 2 */
+          if ((c*g[l] - b*g[l-1] - a*static_cast<float>(f[i]) - a*b*c) > .0f) {
+            /* line 9 */
+            l--;
+          } else {
+            break;
+          }
+        }
+        /* line 11 */
+        g[++l] = static_cast<float>(f[i]);
+        h[l] = static_cast<float>(w * i);
+      }
+    }
+  }
+  /* query partial Vornoi diagram */
+  /* this is lines 15-25 in Procedure edtVornoiEDT() in tPAMI paper */
+  /* lines 15-17 */
+  if ((n_S = l + 1) == 0) {
+    return (0);
+  }
+  /* lines 18-19 */
+  for (i = 0, l = 0; i < n; i++) {
+    /* line 20 */
+    /* we reduce number of arithmetic operations by taking advantage of */
+    /* similarities in successive computations instead of treating them as */
+    /* independent ones */
+    a = h[l] - static_cast<float>(w * i);
+    lhs = g[l] + a * a;
+    while (l < n_S - 1) {
+      a = h[l+1] - static_cast<float>(w * i);
+      rhs = g[l+1] + a * a;
+      if (lhs > rhs) {
+        /* line 21 */
+        l++;
+        lhs = rhs;
+      } else {
+        break;
+      }
+    }
+    /* line 23 */
+    /* we put distance into the 1D array that was passed; */
+    /* must copy into EDT in calling procedure */
+    f[i] = static_cast<VoxelType>(lhs);
+  }
+  /* line 25 */
+  /* return 1 if we queried diagram, 0 if we returned because n_S = 0 */
+  return (1);
+} /* VornoiEDT_anisotropic */
+
+// -----------------------------------------------------------------------------
+/// Compute D_1 for each row (x direction) of the EDT as simple
+/// forward-and-reverse distance propagation (instead of calling VornoiEDT)
+///
+/// D_1 is distance to closest feature voxel in row. It is possible to use a
+/// simple distance propagation for D_1 because L_1 and L_2 norms are
+/// equivalent for the 1D case. Rows are processed in parallel.
+template <class VoxelType>
+struct ComputeRowEDT
+{
+  VoxelType *_EDT; ///< Distance map
+  long       _nX;  ///< Length of each row
+  double     _wX;  ///< Voxel size in x direction
+
+  void operator ()(const blocked_range<long> &re) const
+  {
+    const VoxelType max_dist2 = VoxelType(EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC);
+
+    VoxelType d, *p;
+    for (long j = re.begin(); j != re.end(); ++j) {
+      /* forward pass */
+      p = _EDT + j * _nX;
+      d = max_dist2;
+      for (long i = 0; i < _nX; i++, p++) {
+        /* set d = 0 when we encounter a feature voxel */
+        if (*p) {
+          *p = d = 0;
+        /* increment distance ... */
+        } else if (d != max_dist2) {
+          *p = ++d;
+        /* ... unless we haven't encountered a feature voxel yet */
+        } else {
+          *p = max_dist2;
+        }
+      }
+      /* reverse pass */
+      if (*(--p) != max_dist2) {
+        d = max_dist2;
+        for (long i = _nX - 1; i >= 0; i--, p--) {
+          /* set d = 0 when we encounter a feature voxel */
+          if (*p == 0) {
+            d = 0;
+          /* increment distance after encountering a feature voxel */
+          } else if (d != max_dist2) {
+            /* compare forward and reverse distances */
+            if (++d < *p) {
+              *p = d;
+            }
+          }
+          /* square distance */
+          /* (we use squared distance in rest of algorithm) */
+          *p *= static_cast<VoxelType>(_wX);
+          *p *= *p;
+        }
+      }
+    }
+  }
+
+  static void Run(VoxelType *edt, long nX, long nRows, double wX)
+  {
+    ComputeRowEDT body;
+    body._EDT = edt;
+    body._nX  = nX;
+    body._wX  = wX;
+    parallel_for(blocked_range<long>(0, nRows), body);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Solve 1D problem for each line of voxels along the y or z direction
+///
+/// Line number c starts at offset (c / _nPerPlane) * _PlaneStride +
+/// (c % _nPerPlane) of the distance map and consists of _n voxels which are
+/// _Stride elements apart. Lines are processed in parallel.
+template <class VoxelType>
+struct ComputeColumnEDT
+{
+  VoxelType *_EDT;         ///< Distance map
+  long       _n;           ///< Number of voxels in each line
+  long       _Stride;      ///< Offset between consecutive voxels of a line
+  long       _nPerPlane;   ///< Number of lines per plane
+  long       _PlaneStride; ///< Offset between planes
+  double     _w;           ///< Voxel size along lines
+
+  void operator ()(const blocked_range<long> &re) const
+  {
+    UniquePtr<VoxelType[]> f(new VoxelType[_n]);
+    UniquePtr<float[]>     g(new float[_n]);
+    UniquePtr<float[]>     h(new float[_n]);
+    VoxelType *p, *q;
+    for (long c = re.begin(); c != re.end(); ++c) {
+      /* fill array f with distances in column */
+      /* this is essentially line 4 in Procedure VoronoiEDT() in tPAMI paper */
+      VoxelType * const line = _EDT + (c / _nPerPlane) * _PlaneStride + (c % _nPerPlane);
+      p = line, q = f.get();
+      for (long k = 0; k < _n; k++, p += _Stride, q++) {
+        *q = *p;
+      }
+      /* call VornoiEDT */
+      if (VornoiEDT_anisotropic(f.get(), _n, _w, g.get(), h.get())) {
+        p = line, q = f.get();
+        for (long k = 0; k < _n; k++, p += _Stride, q++) {
+          *p = *q;
+        }
+      }
+    }
+  }
+
+  static void Run(VoxelType *edt, long n, long stride, long nLines,
+                  long nPerPlane, long planeStride, double w)
+  {
+    ComputeColumnEDT body;
+    body._EDT         = edt;
+    body._n           = n;
+    body._Stride      = stride;
+    body._nPerPlane   = nPerPlane;
+    body._PlaneStride = planeStride;
+    body._w           = w;
+    parallel_for(blocked_range<long>(0, nLines), body);
+  }
+};
+
+
+} // namespace EuclideanDistanceTransformUtils
+using namespace EuclideanDistanceTransformUtils;
+
+
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 EuclideanDistanceTransform<VoxelType>
 ::EuclideanDistanceTransform(Mode distanceTransformMode)
+:
+  _OutputDistance(DT_SquaredDistance)
 {
   _distanceTransformMode = distanceTransformMode;
 }
@@ -327,212 +547,41 @@ int EuclideanDistanceTransform<VoxelType>::edtVornoiEDT(long *f, long n)
   return (1);
 } /* edtVornoiEDT */
 
-// -----------------------------------------------------------------------------
-// This is Procedure edtVornoiEDT() in tPAMI paper.
-template <class VoxelType>
-int EuclideanDistanceTransform<VoxelType>::edtVornoiEDT_anisotropic(VoxelType *f, long n, double w)
-{
-  const VoxelType max_dist2 = VoxelType(EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC);
-
-  long i, l, n_S;
-  float a, b, c, v, lhs, rhs;
-  static int firstCall = 1;
-  static long size_gh = 0;
-  static float *g, *h;
-
-  /* this procedure is called often */
-  /* we keep static arrays to avoid frequent calls to malloc() */
-  /* the downside is that this memory is never freed, */
-  /* but it is not so much memory: max(nX,nY,nZ)*sizeof(long) */
-  /* need to check if arrays are sufficiently large */
-  if (n > size_gh && !firstCall) {
-    free(g);
-    free(h);
-    firstCall = 1;
-  }
-  /* malloc arrays if this is first call to procedure, or if arrays */
-  /* are too small and need to be reallocated */
-  if (firstCall) {
-    g = (float *)malloc(n * sizeof(float));
-    if (g == NULL) {
-      fprintf(stderr, "Error in edtVornoiEDT()\n");
-      fprintf(stderr, "Cannot malloc g\n");
-      exit(EXIT_FAILURE);
-    }
-    h = (float *)malloc(n * sizeof(float));
-    if (h == NULL) {
-      fprintf(stderr, "Error in edtVornoiEDT()\n");
-      fprintf(stderr, "Cannot malloc h\n");
-      exit(EXIT_FAILURE);
-    }
-    size_gh = n;
-    firstCall = 0;
-  }
-
-  /* construct partial Vornoi diagram */
-  /* this loop is lines 1-14 in Procedure edtVornoiEDT() in tPAMI paper */
-  /* note we use 0 indexing in this program whereas paper uses 1 indexing */
-  for (i = 0, l = -1; i < n; i++) {
-    /* line 4 */
-    if (f[i] != max_dist2) {
-      /* line 5 */
-      if (l < 1) {
-        /* line 6 */
-        g[++l] = static_cast<float>(f[i]);
-        h[l] = static_cast<float>(w * i);
-      }
-      /* line 7 */
-      else {
-        /* line 8 */
-        while (l >= 1) {
-          /* compute removeEDT() in line 8 */
-          v = h[l];
-          a = v - h[l-1];
-          b = static_cast<float>(w * i) - v;
-          c = a + b;
-          /* compute Eq. 2 */
-          if ((c*g[l] - b*g[l-1] - a*static_cast<float>(f[i]) - a*b*c) > .0f) {
-            /* line 9 */
-            l--;
-          } else {
-            break;
-          }
-        }
-        /* line 11 */
-        g[++l] = static_cast<float>(f[i]);
-        h[l] = static_cast<float>(w * i);
-      }
-    }
-  }
-  /* query partial Vornoi diagram */
-  /* this is lines 15-25 in Procedure edtVornoiEDT() in tPAMI paper */
-  /* lines 15-17 */
-  if ((n_S = l + 1) == 0) {
-    return (0);
-  }
-  /* lines 18-19 */
-  for (i = 0, l = 0; i < n; i++) {
-    /* line 20 */
-    /* we reduce number of arithmetic operations by taking advantage of */
-    /* similarities in successive computations instead of treating them as */
-    /* independent ones */
-    a = h[l] - static_cast<float>(w * i);
-    lhs = g[l] + a * a;
-    while (l < n_S - 1) {
-      a = h[l+1] - static_cast<float>(w * i);
-      rhs = g[l+1] + a * a;
-      if (lhs > rhs) {
-        /* line 21 */
-        l++;
-        lhs = rhs;
-      } else {
-        break;
-      }
-    }
-    /* line 23 */
-    /* we put distance into the 1D array that was passed; */
-    /* must copy into EDT in calling procedure */
-    f[i] = static_cast<VoxelType>(lhs);
-  }
-  /* line 25 */
-  /* return 1 if we queried diagram, 0 if we returned because n_S = 0 */
-  return (1);
-} /* edtVornoiEDT_anisotropic */
 
 // -----------------------------------------------------------------------------
 // This procedure computes the squared EDT of a 2D binary image with anisotropic
 // voxels. See notes for edtComputeEDT_2D. The difference relative to edtComputeEDT_2D
 // is that the edt is a float array instead of a long array, and there are
-// additional parameters for the image voxel dimensions wX and wY.
+// additional parameters for the image voxel dimensions wX and wY. The rows and
+// columns of the image are processed in parallel.
 template <class VoxelType>
 void EuclideanDistanceTransform<VoxelType>
 ::edtComputeEDT_2D_anisotropic(const VoxelType *img, VoxelType *edt, long nX, long nY, double wX, double wY)
 {
-  const VoxelType max_dist2 = VoxelType(EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC);
-
-  const VoxelType *c;
-  VoxelType d, *p, *q, *f;
+  edtComputeEDT_2D_anisotropic(img, edt, nX, nY, 1, wX, wY);
+} /* edtComputeEDT_2D_anisotropic */
 
+// -----------------------------------------------------------------------------
+// This procedure computes the squared 2D EDT of each of nZ consecutive planes.
+template <class VoxelType>
+void EuclideanDistanceTransform<VoxelType>
+::edtComputeEDT_2D_anisotropic(const VoxelType *img, VoxelType *edt, long nX, long nY, long nZ, double wX, double wY)
+{
   /* nXY is number of voxels in 2D image */
   const long nXY = nX * nY;
 
   /* if binary image is provided in the array img, copy it to the arry edt */
   /* this is effectively equivalent to computing D_0 */
-  if (img != nullptr) {
-    c = img;
-    p = edt;
-    memcpy(edt, img, nXY * sizeof(VoxelType));
+  if (img != nullptr && img != edt) {
+    memcpy(edt, img, nXY * nZ * sizeof(VoxelType));
   }
 
   /* compute D_1 as simple forward-and-reverse distance propagation */
-  /* (instead of calling edtVornoiEDT) */
-  /* D_1 is distance to closest feature voxel in row (x direction) */
-  /* it is possible to use a simple distance propagation for D_1  because */
-  /* L_1 and L_2 norms are equivalent for 1D case */
-  for (long j = 0; j < nY; j++) {
-    /* forward pass */
-    p = edt + j * nX;
-    d = max_dist2;
-    for (long i = 0; i < nX; i++, p++) {
-      /* set d = 0 when we encounter a feature voxel */
-      if (*p) {
-        *p = d = 0;
-      /* increment distance ... */
-      } else if (d != max_dist2) {
-        *p = ++d;
-      /* ... unless we haven't encountered a feature voxel yet */
-      } else {
-        *p = max_dist2;
-      }
-    }
-    /* reverse pass */
-    if (*(--p) != max_dist2) {
-      d = max_dist2;
-      for (long i = nX - 1; i >= 0; i--, p--) {
-        /* set d = 0 when we encounter a feature voxel */
-        if (*p == 0) {
-          d = 0;
-        /* increment distance after encountering a feature voxel */
-        } else if (d != max_dist2) {
-          /* compare forward and reverse distances */
-          if (++d < *p) {
-            *p = d;
-          }
-        }
-        /* square distance */
-        /* (we use squared distance in rest of algorithm) */
-        *p *= static_cast<VoxelType>(wX);
-        *p *= *p;
-      }
-    }
-  }
+  ComputeRowEDT<VoxelType>::Run(edt, nX, nY * nZ, wX);
 
   /* compute D_2 = squared EDT */
   /* solve 1D problem for each column (y direction) */
-  f = (VoxelType *)malloc(nY * sizeof(VoxelType));
-  if (f == NULL) {
-    fprintf(stderr, "Error in edtComputeEDT_2D()\n");
-    fprintf(stderr, "Cannot malloc f\n");
-    exit(EXIT_FAILURE);
-  }
-  for (long i = 0; i < nX; i++) {
-    /* fill array f with D_1 distances in column */
-    /* this is essentially line 4 in Procedure VoronoiEDT() in tPAMI paper */
-    p = edt + i;
-    q = f;
-    for (long j = 0; j < nY; j++, p += nX, q++) {
-      *q = *p;
-    }
-    /* call edtVornoiEDT */
-    if (edtVornoiEDT_anisotropic(f, nY, wY)) {
-      p = edt + i;
-      q = f;
-      for (long j = 0; j < nY; j++, p += nX, q++) {
-        *p = *q;
-      }
-    }
-  }
-  free(f);
+  ComputeColumnEDT<VoxelType>::Run(edt, nY, nX, nX * nZ, nX, nXY, wY);
 } /* edtComputeEDT_2D_anisotropic */
 
 // -----------------------------------------------------------------------------
@@ -543,60 +592,29 @@ void EuclideanDistanceTransform<VoxelType>
 ::edtComputeEDT_3D_anisotropic(const VoxelType *img, VoxelType *edt,
                                long nX, long nY, long nZ, double wX, double wY, double wZ)
 {
-  const VoxelType *c;
-  long i, k, nXY, nXYZ;
-  VoxelType *p, *q, *f;
-
   /* nXY is number of voxels in each plane (xy) */
-  /* nXYZ is number of voxels in 3D image */
-  nXY = nX * nY;
-  nXYZ = nX * nY * nZ;
+  const long nXY = nX * nY;
 
-  /* if binary image is provided in the array img, copy it to the arry edt */
-  /* this is effectively equivalent to computing D_0 */
-  if (img != NULL) {
-    c = img;
-    p = edt;
-    for (i = 0; i < nXYZ; i++, c++, p++) {
-      *p = *c;
-    }
-  }
-
-  /* compute D_2 */
-  /* call edtComputeEDT_2D for each plane */
-  p = edt;
-  for (k = 0; k < nZ; k++, p += nXY) {
-    edtComputeEDT_2D_anisotropic(NULL, p, nX, nY, wX, wY);
-  }
+  /* compute D_2 of each plane */
+  edtComputeEDT_2D_anisotropic(img, edt, nX, nY, nZ, wX, wY);
 
   /* compute D_3 */
   /* solve 1D problem for each column (z direction) */
-  f = (VoxelType *)malloc(nZ * sizeof(VoxelType));
-  if (f == NULL) {
-    fprintf(stderr, "Error in edtComputeEDT_3D()\n");
-    fprintf(stderr, "Cannot malloc f\n");
-    exit(EXIT_FAILURE);
-  }
-  for (i = 0; i < nXY; i++) {
-    /* fill array f with D_2 distances in column */
-    /* this is essentially line 4 in Procedure VoronoiEDT() in tPAMI paper */
-    p = edt + i;
-    q = f;
-    for (k = 0; k < nZ; k++, p += nXY, q++) {
-      *q = *p;
-    }
-    /* call edtVornoiEDT */
-    if (edtVornoiEDT_anisotropic(f, nZ, wZ)) {
-      p = edt + i;
-      q = f;
-      for (k = 0; k < nZ; k++, p += nXY, q++) {
-        *p = *q;
-      }
-    }
-  }
-  free(f);
+  ComputeColumnEDT<VoxelType>::Run(edt, nZ, nXY, nXY, nXY, 0, wZ);
 } /* edtComputeEDT_3D_anisotropic */
 
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void EuclideanDistanceTransform<VoxelType>
+::ComputeEDT(const VoxelType *img, VoxelType *edt, long nX, long nY, long nZ, double wX, double wY, double wZ)
+{
+  if (_distanceTransformMode == DT_3D) {
+    edtComputeEDT_3D_anisotropic(img, edt, nX, nY, nZ, wX, wY, wZ);
+  } else {
+    edtComputeEDT_2D_anisotropic(img, edt, nX, nY, nZ, wX, wY);
+  }
+}
+
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 void EuclideanDistanceTransform<VoxelType>::Run()
@@ -613,26 +631,40 @@ void EuclideanDistanceTransform<VoxelType>::Run()
   const int ny = input->Y();
   const int nz = input->Z();
   const int nt = input->T();
+  const int n  = nx * ny * nz;
 
   // Get voxel size
   const double dx = input->XSize();
   const double dy = input->YSize();
   const double dz = input->ZSize();
 
+  // Distance transform of background for signed distance
+  UniquePtr<VoxelType[]> bg;
+  if (_OutputDistance == DT_SignedDistance) bg.reset(new VoxelType[n]);
+
   for (int t = 0; t < nt; ++t) {
-	  if (_distanceTransformMode == DT_3D) {
-		  edtComputeEDT_3D_anisotropic(
-        input ->Data(0, 0, 0, t),
-			  output->Data(0, 0, 0, t),
-			  nx, ny, nz, dx, dy, dz);
-	  } else {
-		  for (int z = 0; z < nz; ++z) {
-			  edtComputeEDT_2D_anisotropic(
-          input ->Data(0, 0, z, t),
-				  output->Data(0, 0, z, t),
-				  nx, ny, dx, dy);
-		  }
-	  }
+    const VoxelType *img = input ->Data(0, 0, 0, t);
+    VoxelType       *edt = output->Data(0, 0, 0, t);
+    if (bg) {
+      for (int i = 0; i < n; ++i) {
+        bg[i] = (img[i] ? VoxelType(0) : VoxelType(1));
+      }
+    }
+    ComputeEDT(img, edt, nx, ny, nz, dx, dy, dz);
+    switch (_OutputDistance) {
+      case DT_SquaredDistance: break;
+      case DT_Distance: {
+        for (int i = 0; i < n; ++i) {
+          edt[i] = static_cast<VoxelType>(sqrt(edt[i]));
+        }
+      } break;
+      case DT_SignedDistance: {
+        ComputeEDT(nullptr, bg.get(), nx, ny, nz, dx, dy, dz);
+        for (int i = 0; i < n; ++i) {
+          edt[i] = static_cast<VoxelType>(sqrt(edt[i]) - sqrt(bg[i]));
+        }
+      } break;
+    }
   }
 
   // Do the final cleaning up
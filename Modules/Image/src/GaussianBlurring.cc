@@ -21,13 +21,195 @@
 #include "mirtk/GaussianBlurring.h"
 
 #include "mirtk/Math.h"
+#include "mirtk/Memory.h"
+#include "mirtk/ConvolutionFunction.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/Profiling.h"
 #include "mirtk/ScalarFunctionToImage.h"
 #include "mirtk/ScalarGaussian.h"
 
+#include "ImageLineUtils.h"
+
 
 namespace mirtk {
 
 
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace GaussianBlurringUtils {
+
+using namespace ImageLineUtils;
+
+
+// -----------------------------------------------------------------------------
+/// Blur image along one dimension using recursive Gaussian filter
+///
+/// The image is processed in slabs of neighboring lines, e.g., all lines
+/// along the x axis within a slice for blurring in x. The values of each
+/// slab are copied to a buffer before any output is written, such that the
+/// filter can run in-place.
+template <class TVoxel, class TKernel>
+class BlurLines
+{
+  const GenericImage<TVoxel>          *_Input;
+  GenericImage<TVoxel>                *_Output;
+  const BaseImage                     *_Mask;
+  const GenericImage<TKernel>         *_Kernel;
+  const RecursiveGaussianCoefficients *_Filter;
+  int                                  _PadMode;
+  double                               _Padding;
+  bool                                 _Normalize;
+  ImageLineSlabs                       _Slabs;
+  double                              *_Norm; ///< Normalization factors if no padding
+
+  /// Partition image into slabs of lines along given dimension
+  static ImageLineSlabs Slabs(const GenericImage<TVoxel> *image, int dim)
+  {
+    const int dims[4] = {image->X(), image->Y(), image->Z(), image->T()};
+    return ImageLineSlabs(dims, dim);
+  }
+
+public:
+
+  BlurLines(const GenericImage<TVoxel> *input, GenericImage<TVoxel> *output,
+            const BaseImage *mask, int dim, const GenericImage<TKernel> *kernel,
+            const RecursiveGaussianCoefficients *filter,
+            int padmode, double padding, bool normalize)
+  :
+    _Input(input), _Output(output), _Mask(mask),
+    _Kernel(kernel), _Filter(filter),
+    _PadMode(padmode), _Padding(padding), _Normalize(normalize),
+    _Slabs(Slabs(output, dim)), _Norm(nullptr)
+  {
+    // Without padding, the sum of kernel weights only depends on line position
+    if (_PadMode == 0 && _Normalize) {
+      const int m = _Slabs.Length();
+      double *tmp;
+      Allocate(_Norm, m);
+      Allocate(tmp, LineFilterBufferSize(1, m));
+      for (int q = 0; q < m; ++q) _Norm[q] = 1.;
+      Blur(_Norm, nullptr, 1, tmp);
+      Deallocate(tmp);
+    }
+  }
+
+  BlurLines(const BlurLines &other)
+  :
+    _Input(other._Input), _Output(other._Output), _Mask(other._Mask),
+    _Kernel(other._Kernel), _Filter(other._Filter),
+    _PadMode(other._PadMode), _Padding(other._Padding), _Normalize(other._Normalize),
+    _Slabs(other._Slabs), _Norm(nullptr)
+  {
+    if (other._Norm) {
+      Allocate(_Norm, _Slabs.Length());
+      memcpy(_Norm, other._Norm, _Slabs.Length() * sizeof(double));
+    }
+  }
+
+  ~BlurLines()
+  {
+    Deallocate(_Norm);
+  }
+
+  /// Number of slabs of lines
+  int NumberOfSlabs() const
+  {
+    return _Slabs.NumberOfSlabs();
+  }
+
+  /// Apply 1D filter to n lines stored in buffer
+  void Blur(double *v, const double *r, int n, double *tmp) const
+  {
+    const int m = _Slabs.Length();
+    if (_Filter) {
+      RecursiveGaussian(*_Filter, v, r, n, m, false, tmp);
+    } else {
+      ConvolveLines(_Kernel->Data(), _Kernel->X() / 2, v, r, n, m, false, tmp);
+    }
+  }
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const TVoxel * const in  = _Input ->Data();
+    TVoxel       * const out = _Output->Data();
+    const int n = _Slabs.Lines(), m = _Slabs.Length(), size = n * m;
+    double *v, *c = nullptr, *w = nullptr, *tmp;
+    Allocate(v, size);
+    Allocate(tmp, LineFilterBufferSize(n, m));
+    if (_PadMode != 0) Allocate(c, size);
+    if (_PadMode == 2 && _Normalize) Allocate(w, size);
+    for (int s = re.begin(); s != re.end(); ++s) {
+      const int offset = _Slabs.Offset(s);
+      // Copy slab to buffer and set foreground weights
+      for (int q = 0, i = 0; q < m; ++q)
+      for (int p = 0; p < n; ++p, ++i) {
+        const int idx = _Slabs.Index(offset, p, q);
+        v[i] = static_cast<double>(in[idx]);
+        if (_PadMode == 1) {
+          c[i] = (_Mask->IsForeground(idx) ? 1. : 0.);
+          v[i] *= c[i];
+        } else if (_PadMode == 2) {
+          if (AreEqualOrNaN(v[i], _Padding, ConvolutionFunction::Epsilon())) {
+            c[i] = v[i] = 0.;
+          } else {
+            c[i] = 1.;
+          }
+        }
+      }
+      // Filter image values and foreground weights
+      const double *r = (_PadMode == 2 ? c : nullptr);
+      Blur(v, r, n, tmp);
+      if (_Normalize) {
+        if (_PadMode == 0) {
+          for (int q = 0, i = 0; q < m; ++q)
+          for (int p = 0; p < n; ++p, ++i) {
+            v[i] /= _Norm[q];
+          }
+        } else {
+          if (_PadMode == 2) {
+            // Copy of foreground indicator needed as link weights
+            memcpy(w, c, size * sizeof(double));
+            Blur(w, r, n, tmp);
+            for (int i = 0; i < size; ++i) {
+              if (c[i] != .0 && !AreEqual(w[i], 0., ConvolutionFunction::Epsilon())) v[i] /= w[i];
+            }
+          } else {
+            Blur(c, r, n, tmp);
+            for (int i = 0; i < size; ++i) {
+              if (!AreEqual(c[i], 0., ConvolutionFunction::Epsilon())) v[i] /= c[i];
+            }
+          }
+        }
+      }
+      // Copy result to output slab
+      for (int q = 0, i = 0; q < m; ++q)
+      for (int p = 0; p < n; ++p, ++i) {
+        const int idx = _Slabs.Index(offset, p, q);
+        if (_PadMode == 2 && c[i] == .0) {
+          out[idx] = voxel_cast<TVoxel>(_Padding);
+        } else {
+          out[idx] = voxel_cast<TVoxel>(v[i]);
+        }
+      }
+    }
+    Deallocate(v);
+    Deallocate(c);
+    Deallocate(w);
+    Deallocate(tmp);
+  }
+};
+
+
+} // namespace GaussianBlurringUtils
+using namespace GaussianBlurringUtils;
+
+// =============================================================================
+// GaussianBlurring
+// =============================================================================
+
+
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 GaussianBlurring<VoxelType>::GaussianBlurring(double sigma)
@@ -43,7 +225,8 @@ GaussianBlurring<VoxelType>::GaussianBlurring(double xsigma, double ysigma, doub
   _SigmaX(xsigma),
   _SigmaY(ysigma),
   _SigmaZ(zsigma),
-  _SigmaT(tsigma)
+  _SigmaT(tsigma),
+  _Recursive(false)
 {
 }
 
@@ -135,6 +318,67 @@ void GaussianBlurring<VoxelType>::Initialize()
   this->_KernelT = _GaussianKernel[3].get();
 }
 
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void GaussianBlurring<VoxelType>::Run()
+{
+  if (_Recursive) {
+    this->RunRecursive();
+  } else {
+    SeparableConvolution<VoxelType>::Run();
+  }
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void GaussianBlurring<VoxelType>::RunRecursive()
+{
+  MIRTK_START_TIMING();
+
+  // Do the initial set up
+  this->Initialize();
+
+  const ImageType *input  = this->Input();
+  ImageType       *output = this->Output();
+
+  int    padmode = 0;
+  double padding = this->_PaddingValue;
+  if (this->_UseBackgroundMask && input->HasMask()) {
+    padmode = 1;
+  } else if (this->_UseBackgroundValue && input->HasBackgroundValue()) {
+    padding = input->GetBackgroundValueAsDouble();
+    padmode = 2;
+  } else if (this->_UsePaddingValue) {
+    padmode = 2;
+  }
+
+  // Blur along each dimension, where first pass reads input image and
+  // any following pass runs in-place on the output image
+  const KernelType *kernel[4] = {this->_KernelX, this->_KernelY, this->_KernelZ, this->_KernelT};
+  const double      sigma [4] = {_SigmaX / input->XSize(), _SigmaY / input->YSize(),
+                                 _SigmaZ / input->ZSize(), _SigmaT / input->TSize()};
+  const ImageType  *source    = input;
+  for (int dim = 0; dim < 4; ++dim) {
+    if (kernel[dim] == nullptr) continue;
+    UniquePtr<RecursiveGaussianCoefficients> filter;
+    if (sigma[dim] >= MinRecursiveSigma) {
+      filter.reset(new RecursiveGaussianCoefficients(sigma[dim]));
+    }
+    BlurLines<VoxelType, RealPixel> blur(source, output, input, dim, kernel[dim], filter.get(),
+                                         padmode, padding, this->_Normalize);
+    parallel_for(blocked_range<int>(0, blur.NumberOfSlabs()), blur);
+    source = output;
+  }
+  if (source != output) {
+    output->CopyFrom(input->Data());
+  }
+
+  // Do the final cleaning up
+  this->Finalize();
+
+  MIRTK_DEBUG_TIMING(5, this->NameOfClass() << " (recursive)");
+}
+
 // =============================================================================
 // Explicit template instantiations
 // =============================================================================
@@ -23,6 +23,7 @@
 
 #include "mirtk/Math.h"
 #include "mirtk/Memory.h"
+#include "mirtk/MemoryMappedFile.h"
 #include "mirtk/Path.h"
 #include "mirtk/Matrix3x3.h"
 #include "mirtk/VoxelCast.h"
@@ -58,9 +59,11 @@ void GenericImage<VoxelType>::AllocateImage(VoxelType *data)
   // Delete existing mask (if any)
   if (_maskOwner) Delete(_mask);
   // Free previously allocated memory
-  Deallocate(_matrix, _data);
-  if (_dataOwner) Deallocate(_data);
+  DeallocateMatrix();
+  if (_dataOwner) DeallocateAligned(_data);
+  _data      = nullptr;
   _dataOwner = false;
+  _dataMapping.reset();
   // Initialize memory
   const int nvox = _attr.NumberOfLatticePoints();
   if (nvox > 0) {
@@ -68,11 +71,37 @@ void GenericImage<VoxelType>::AllocateImage(VoxelType *data)
       _data      = data;
       _dataOwner = false;
     } else {
-      _data      = CAllocate<VoxelType>(nvox);
+      _data      = CAllocateAligned<VoxelType>(nvox);
       _dataOwner = true;
     }
+  }
+  UpdateStrides();
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void GenericImage<VoxelType>::UpdateStrides()
+{
+  _ystride = _attr._x;
+  _zstride = _attr._x * _attr._y;
+  _tstride = _attr._x * _attr._y * _attr._z;
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void GenericImage<VoxelType>::DeallocateMatrix()
+{
+  Deallocate(_matrix, _data);
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+VoxelType ****GenericImage<VoxelType>::Matrix()
+{
+  if (_matrix == nullptr && _data != nullptr) {
     Allocate(_matrix, _attr._x, _attr._y, _attr._z, _attr._t, _data);
   }
+  return _matrix;
 }
 
 // -----------------------------------------------------------------------------
@@ -81,6 +110,9 @@ GenericImage<VoxelType>::GenericImage()
 :
   _matrix   (NULL),
   _data     (NULL),
+  _ystride  (0),
+  _zstride  (0),
+  _tstride  (0),
   _dataOwner(false)
 {
 }
@@ -91,6 +123,9 @@ GenericImage<VoxelType>::GenericImage(const char *fname)
 :
   _matrix   (NULL),
   _data     (NULL),
+  _ystride  (0),
+  _zstride  (0),
+  _tstride  (0),
   _dataOwner(false)
 {
   Read(fname);
@@ -102,6 +137,9 @@ GenericImage<VoxelType>::GenericImage(int x, int y, int z, int t, VoxelType *dat
 :
   _matrix   (NULL),
   _data     (NULL),
+  _ystride  (0),
+  _zstride  (0),
+  _tstride  (0),
   _dataOwner(false)
 {
   ImageAttributes attr;
@@ -119,6 +157,9 @@ GenericImage<VoxelType>::GenericImage(int x, int y, int z, int t, int n, VoxelTy
 :
   _matrix   (NULL),
   _data     (NULL),
+  _ystride  (0),
+  _zstride  (0),
+  _tstride  (0),
   _dataOwner(false)
 {
   if (t > 1 && n > 1) {
@@ -142,6 +183,9 @@ GenericImage<VoxelType>::GenericImage(const ImageAttributes &attr, VoxelType *da
   BaseImage(attr),
   _matrix   (NULL),
   _data     (NULL),
+  _ystride  (0),
+  _zstride  (0),
+  _tstride  (0),
   _dataOwner(false)
 {
   AllocateImage(data);
@@ -154,6 +198,9 @@ GenericImage<VoxelType>::GenericImage(const ImageAttributes &attr, int n, VoxelT
   BaseImage(attr, n),
   _matrix   (NULL),
   _data     (NULL),
+  _ystride  (0),
+  _zstride  (0),
+  _tstride  (0),
   _dataOwner(false)
 {
   AllocateImage(data);
@@ -166,6 +213,9 @@ GenericImage<VoxelType>::GenericImage(const BaseImage &image)
   BaseImage(image),
   _matrix   (NULL),
   _data     (NULL),
+  _ystride  (0),
+  _zstride  (0),
+  _tstride  (0),
   _dataOwner(false)
 {
   // Initialize image
@@ -184,6 +234,9 @@ GenericImage<VoxelType>::GenericImage(const GenericImage &image)
   BaseImage(image),
   _matrix   (NULL),
   _data     (NULL),
+  _ystride  (0),
+  _zstride  (0),
+  _tstride  (0),
   _dataOwner(false)
 {
   if (image._dataOwner) {
@@ -191,6 +244,7 @@ GenericImage<VoxelType>::GenericImage(const GenericImage &image)
     memcpy(_data, image._data, _NumberOfVoxels * sizeof(VoxelType));
   } else {
     AllocateImage(const_cast<VoxelType *>(image.Data()));
+    _dataMapping = image._dataMapping;
   }
 }
 
@@ -201,6 +255,9 @@ GenericImage<VoxelType>::GenericImage(const GenericImage<VoxelType2> &image)
   BaseImage(image),
   _matrix   (NULL),
   _data     (NULL),
+  _ystride  (0),
+  _zstride  (0),
+  _tstride  (0),
   _dataOwner(false)
 {
   AllocateImage();
@@ -215,8 +272,8 @@ GenericImage<VoxelType>::GenericImage(const GenericImage<VoxelType2> &image)
 template <class VoxelType>
 GenericImage<VoxelType>::~GenericImage()
 {
-  Deallocate(_matrix, _data);
-  if (_dataOwner) Deallocate(_data);
+  DeallocateMatrix();
+  if (_dataOwner) DeallocateAligned(_data);
   if (_maskOwner) Delete(_mask);
 }
 
@@ -234,7 +291,7 @@ BaseImage *GenericImage<VoxelType>::Copy() const
 // -----------------------------------------------------------------------------
 template <class VoxelType> void GenericImage<VoxelType>::Initialize()
 {
-  if (_matrix) *this = VoxelType();
+  if (_data) *this = VoxelType();
 }
 
 // -----------------------------------------------------------------------------
@@ -290,6 +347,26 @@ void GenericImage<VoxelType>::Initialize(int x, int y, int z, int t, VoxelType *
   this->Initialize(x, y, z, t, 1, data);
 }
 
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void GenericImage<VoxelType>::Initialize(const ImageAttributes &attr, SharedPtr<MemoryMappedFile> file)
+{
+  const size_t size = static_cast<size_t>(attr.NumberOfLatticePoints()) * sizeof(VoxelType);
+  if (!file || !file->IsOpen() || file->Size() < size) {
+    Throw(ERR_InvalidArgument, __func__, "Memory mapped file region too small for image of given size");
+  }
+  PutAttributes(attr);
+  AllocateImage(reinterpret_cast<VoxelType *>(file->Data()));
+  _dataMapping = file;
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+bool GenericImage<VoxelType>::IsMemoryMapped() const
+{
+  return _dataMapping != nullptr;
+}
+
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 void GenericImage<VoxelType>::CopyFrom(const VoxelType *data)
@@ -307,7 +384,7 @@ void GenericImage<VoxelType>::CopyFrom(const BaseImage &image)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    _matrix[l][k][j][i] = voxel_cast<VoxelType>(image.GetAsVector(i, j, k, l));
+    _data[DataIndex(i, j, k, l)] = voxel_cast<VoxelType>(image.GetAsVector(i, j, k, l));
   }
   if (_maskOwner) delete _mask;
   if (image.OwnsMask()) {
@@ -376,10 +453,14 @@ GenericImage<VoxelType>& GenericImage<VoxelType>::operator=(const GenericImage &
 // -----------------------------------------------------------------------------
 template <class VoxelType> void GenericImage<VoxelType>::Clear()
 {
-  Deallocate(_matrix, _data);
-  if (_dataOwner) Deallocate(_data);
+  DeallocateMatrix();
+  if (_dataOwner) DeallocateAligned(_data);
   if (_maskOwner) Delete(_mask);
   _attr = ImageAttributes();
+  _data = nullptr;
+  _dataOwner = false;
+  _dataMapping.reset();
+  UpdateStrides();
 }
 
 // =============================================================================
@@ -391,7 +472,6 @@ template <class VoxelType>
 void GenericImage<VoxelType>
 ::GetRegion(GenericImage<VoxelType> &image, int k, int m) const
 {
-  int i, j;
   double x1, y1, z1, t1, x2, y2, z2, t2;
 
   if ((k < 0) || (k >= _attr._z) || (m < 0) || (m >= _attr._t)) {
@@ -427,11 +507,8 @@ void GenericImage<VoxelType>
   image.PutOrigin(x1 - x2, y1 - y2, z1 - z2, t1 - t2);
 
   // Copy region
-  for (j = 0; j < _attr._y; j++) {
-    for (i = 0; i < _attr._x; i++) {
-      image._matrix[0][0][j][i] = _matrix[m][k][j][i];
-    }
-  }
+  const VoxelType *src = this->Data(0, 0, k, m);
+  std::copy(src, src + _attr._x * _attr._y, image.Data());
 }
 
 // -----------------------------------------------------------------------------
@@ -464,7 +541,7 @@ void GenericImage<VoxelType>
 ::GetRegion(GenericImage<VoxelType> &image, int i1, int j1, int k1,
                                             int i2, int j2, int k2) const
 {
-  int i, j, k, l;
+  int j, k, l;
   double x1, y1, z1, x2, y2, z2;
 
   if ((i1 < 0) || (i1 >= i2) ||
@@ -504,9 +581,7 @@ void GenericImage<VoxelType>
   for (l = 0; l < _attr._t; l++) {
     for (k = k1; k < k2; k++) {
       for (j = j1; j < j2; j++) {
-        for (i = i1; i < i2; i++) {
-          image._matrix[l][k-k1][j-j1][i-i1] = _matrix[l][k][j][i];
-        }
+        std::copy_n(this->Data(i1, j, k, l), i2 - i1, image.Data(0, j-j1, k-k1, l));
       }
     }
   }
@@ -542,7 +617,7 @@ void GenericImage<VoxelType>
 ::GetRegion(GenericImage<VoxelType> &image, int i1, int j1, int k1, int l1,
                                             int i2, int j2, int k2, int l2) const
 {
-  int i, j, k, l;
+  int j, k, l;
   double x1, y1, z1, x2, y2, z2;
 
   if ((i1 < 0) || (i1 >= i2) ||
@@ -584,9 +659,7 @@ void GenericImage<VoxelType>
   for (l = l1; l < l2; l++) {
     for (k = k1; k < k2; k++) {
       for (j = j1; j < j2; j++) {
-        for (i = i1; i < i2; i++) {
-          image._matrix[l-l1][k-k1][j-j1][i-i1] = _matrix[l][k][j][i];
-        }
+        std::copy_n(this->Data(i1, j, k, l), i2 - i1, image.Data(0, j-j1, k-k1, l-l1));
       }
     }
   }
@@ -637,15 +710,7 @@ void GenericImage<VoxelType>::GetFrame(GenericImage<VoxelType> &image, int l1, i
   image.Initialize(attr);
 
   // Copy region
-  for (int l = l1; l <= l2; l++) {
-    for (int k = 0; k < _attr._z; k++) {
-      for (int j = 0; j < _attr._y; j++) {
-        for (int i = 0; i < _attr._x; i++) {
-          image._matrix[l-l1][k][j][i] = _matrix[l][k][j][i];
-        }
-      }
-    }
-  }
+  std::copy_n(this->Data(0, 0, 0, l1), (l2 - l1 + 1) * _tstride, image.Data());
 }
 
 // -----------------------------------------------------------------------------
@@ -1417,7 +1482,7 @@ void GenericImage<VoxelType>::ReflectX(bool modify_axes)
   for (int z = 0; z < _attr._z; ++z)
   for (int y = 0; y < _attr._y; ++y)
   for (int x = 0; x < _attr._x / 2; ++x) {
-    swap(_matrix[t][z][y][x], _matrix[t][z][y][_attr._x-(x+1)]);
+    swap(_data[DataIndex(x, y, z, t)], _data[DataIndex(_attr._x-(x+1), y, z, t)]);
   }
   if (modify_axes) {
     _attr._xaxis[0] = -_attr._xaxis[0];
@@ -1435,7 +1500,7 @@ void GenericImage<VoxelType>::ReflectY(bool modify_axes)
   for (int z = 0; z < _attr._z; ++z)
   for (int y = 0; y < _attr._y / 2; ++y)
   for (int x = 0; x < _attr._x; ++x) {
-    swap(_matrix[t][z][y][x], _matrix[t][z][_attr._y-(y+1)][x]);
+    swap(_data[DataIndex(x, y, z, t)], _data[DataIndex(x, _attr._y-(y+1), z, t)]);
   }
   if (modify_axes) {
     _attr._yaxis[0] = -_attr._yaxis[0];
@@ -1453,7 +1518,7 @@ void GenericImage<VoxelType>::ReflectZ(bool modify_axes)
   for (int z = 0; z < _attr._z / 2; ++z)
   for (int y = 0; y < _attr._y; ++y)
   for (int x = 0; x < _attr._x; ++x) {
-    swap(_matrix[t][z][y][x], _matrix[t][_attr._z-(z+1)][y][x]);
+    swap(_data[DataIndex(x, y, z, t)], _data[DataIndex(x, y, _attr._z-(z+1), t)]);
   }
   if (modify_axes) {
     _attr._zaxis[0] = -_attr._zaxis[0];
@@ -1471,7 +1536,7 @@ void GenericImage<VoxelType>::ReflectT(bool modify_axes)
   for (int z = 0; z < _attr._z; ++z)
   for (int y = 0; y < _attr._y; ++y)
   for (int x = 0; x < _attr._x; ++x) {
-    swap(_matrix[t][z][y][x], _matrix[_attr._t-(t+1)][z][y][x]);
+    swap(_data[DataIndex(x, y, z, t)], _data[DataIndex(x, y, z, _attr._t-(t+1))]);
   }
   if (modify_axes) {
     _attr._dt = -_attr._dt;
@@ -1484,7 +1549,7 @@ void GenericImage<VoxelType>::FlipXY(bool modify_origin)
 {
   // TODO: Implement BaseImage::FlipXY which flips the foreground mask (if any),
   //       adjusts the attributes, and updates the coordinate transformation matrices.
-  //       The subclass then only needs to reshape the image _matrix data itself.
+  //       The subclass then only needs to reshape the image data itself.
 
   // Allocate memory
   VoxelType ****matrix = Allocate<VoxelType>(_attr._y, _attr._x, _attr._z, _attr._t);
@@ -1494,7 +1559,7 @@ void GenericImage<VoxelType>::FlipXY(bool modify_origin)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    matrix[l][k][i][j] = _matrix[l][k][j][i];
+    matrix[l][k][i][j] = _data[DataIndex(i, j, k, l)];
   }
 
   // Swap image dimensions
@@ -1506,14 +1571,15 @@ void GenericImage<VoxelType>::FlipXY(bool modify_origin)
   // Swap origin coordinates
   if (modify_origin) swap(_attr._xorigin, _attr._yorigin);
 
-  // Reshape image matrix
+  // Update voxel strides
   //
   // Attention: DO NOT just swap the pointers to the data elements as this
   //            changes the memory location of the image data. This is not
   //            predictable by users of the class which may still hold a pointer
   //            to the old memory and in particular complicates the synchronization
   //            of host and device memory in CUGenericImage used by CUDA code.
-  _matrix = Reshape(_matrix, _attr._x, _attr._y, _attr._z, _attr._t);
+  DeallocateMatrix();
+  UpdateStrides();
 
   // Copy flipped image
   CopyFrom(matrix[0][0][0]);
@@ -1531,7 +1597,7 @@ void GenericImage<VoxelType>::FlipXZ(bool modify_origin)
 {
   // TODO: Implement BaseImage::FlipXZ which flips the foreground mask (if any),
   //       adjusts the attributes, and updates the coordinate transformation matrices.
-  //       The subclass then only needs to reshape the image _matrix data itself.
+  //       The subclass then only needs to reshape the image data itself.
 
   // Allocate memory
   VoxelType ****matrix = Allocate<VoxelType>(_attr._z, _attr._y, _attr._x, _attr._t);
@@ -1541,7 +1607,7 @@ void GenericImage<VoxelType>::FlipXZ(bool modify_origin)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    matrix[l][i][j][k] = _matrix[l][k][j][i];
+    matrix[l][i][j][k] = _data[DataIndex(i, j, k, l)];
   }
 
   // Swap image dimensions
@@ -1553,14 +1619,15 @@ void GenericImage<VoxelType>::FlipXZ(bool modify_origin)
   // Swap origin coordinates
   if (modify_origin) swap(_attr._xorigin, _attr._zorigin);
 
-  // Reshape image data
+  // Update voxel strides
   //
   // Attention: DO NOT just swap the pointers to the data elements as this
   //            changes the memory location of the image data. This is not
   //            predictable by users of the class which may still hold a pointer
   //            to the old memory and in particular complicates the synchronization
   //            of host and device memory in CUGenericImage used by CUDA code.
-  _matrix = Reshape(_matrix, _attr._x, _attr._y, _attr._z, _attr._t);
+  DeallocateMatrix();
+  UpdateStrides();
 
   // Copy flipped image
   CopyFrom(matrix[0][0][0]);
@@ -1578,7 +1645,7 @@ void GenericImage<VoxelType>::FlipYZ(bool modify_origin)
 {
   // TODO: Implement BaseImage::FlipYZ which flips the foreground mask (if any),
   //       adjusts the attributes, and updates the coordinate transformation matrices.
-  //       The subclass then only needs to reshape the image _matrix data itself.
+  //       The subclass then only needs to reshape the image data itself.
 
   // Allocate memory for flipped image
   VoxelType ****matrix = Allocate<VoxelType>(_attr._x, _attr._z, _attr._y, _attr._t);
@@ -1588,7 +1655,7 @@ void GenericImage<VoxelType>::FlipYZ(bool modify_origin)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    matrix[l][j][k][i] = _matrix[l][k][j][i];
+    matrix[l][j][k][i] = _data[DataIndex(i, j, k, l)];
   }
 
   // Swap image dimensions
@@ -1600,14 +1667,15 @@ void GenericImage<VoxelType>::FlipYZ(bool modify_origin)
   // Swap origin coordinates
   if (modify_origin) swap(_attr._yorigin, _attr._zorigin);
 
-  // Reshape image matrix
+  // Update voxel strides
   //
   // Attention: DO NOT just swap the pointers to the data elements as this
   //            changes the memory location of the image data. This is not
   //            predictable by users of the class which may still hold a pointer
   //            to the old memory and in particular complicates the synchronization
   //            of host and device memory in CUGenericImage used by CUDA code.
-  _matrix = Reshape(_matrix, _attr._x, _attr._y, _attr._z, _attr._t);
+  DeallocateMatrix();
+  UpdateStrides();
 
   // Copy flipped image
   CopyFrom(matrix[0][0][0]);
@@ -1625,7 +1693,7 @@ void GenericImage<VoxelType>::FlipXT(bool modify_origin)
 {
   // TODO: Implement BaseImage::FlipXT which flips the foreground mask (if any),
   //       adjusts the attributes, and updates the coordinate transformation matrices.
-  //       The subclass then only needs to reshape the image _matrix data itself.
+  //       The subclass then only needs to reshape the image data itself.
 
   // Allocate memory
   VoxelType ****matrix = Allocate<VoxelType>(_attr._t, _attr._y, _attr._z, _attr._x);
@@ -1635,7 +1703,7 @@ void GenericImage<VoxelType>::FlipXT(bool modify_origin)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    matrix[i][k][j][l] = _matrix[l][k][j][i];
+    matrix[i][k][j][l] = _data[DataIndex(i, j, k, l)];
   }
 
   // Swap image dimensions
@@ -1647,14 +1715,15 @@ void GenericImage<VoxelType>::FlipXT(bool modify_origin)
   // Swap origin coordinates
   if (modify_origin) swap(_attr._xorigin, _attr._torigin);
 
-  // Reshape image matrix
+  // Update voxel strides
   //
   // Attention: DO NOT just swap the pointers to the data elements as this
   //            changes the memory location of the image data. This is not
   //            predictable by users of the class which may still hold a pointer
   //            to the old memory and in particular complicates the synchronization
   //            of host and device memory in CUGenericImage used by CUDA code.
-  _matrix = Reshape(_matrix, _attr._x, _attr._y, _attr._z, _attr._t);
+  DeallocateMatrix();
+  UpdateStrides();
 
   // Copy flipped image
   CopyFrom(matrix[0][0][0]);
@@ -1672,7 +1741,7 @@ void GenericImage<VoxelType>::FlipYT(bool modify_origin)
 {
   // TODO: Implement BaseImage::FlipYT which flips the foreground mask (if any),
   //       adjusts the attributes, and updates the coordinate transformation matrices.
-  //       The subclass then only needs to reshape the image _matrix data itself.
+  //       The subclass then only needs to reshape the image data itself.
 
   // Allocate memory
   VoxelType ****matrix = Allocate<VoxelType>(_attr._x, _attr._t, _attr._z, _attr._y);
@@ -1681,7 +1750,7 @@ void GenericImage<VoxelType>::FlipYT(bool modify_origin)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    matrix[j][k][l][i] = _matrix[l][k][j][i];
+    matrix[j][k][l][i] = _data[DataIndex(i, j, k, l)];
   }
 
   // Swap image dimensions
@@ -1693,14 +1762,15 @@ void GenericImage<VoxelType>::FlipYT(bool modify_origin)
   // Swap origin coordinates
   if (modify_origin) swap(_attr._yorigin, _attr._torigin);
 
-  // Reshape image matrix
+  // Update voxel strides
   //
   // Attention: DO NOT just swap the pointers to the data elements as this
   //            changes the memory location of the image data. This is not
   //            predictable by users of the class which may still hold a pointer
   //            to the old memory and in particular complicates the synchronization
   //            of host and device memory in CUGenericImage used by CUDA code.
-  _matrix = Reshape(_matrix, _attr._x, _attr._y, _attr._z, _attr._t);
+  DeallocateMatrix();
+  UpdateStrides();
 
   // Copy flipped image
   CopyFrom(matrix[0][0][0]);
@@ -1718,7 +1788,7 @@ void GenericImage<VoxelType>::FlipZT(bool modify_origin)
 {
   // TODO: Implement BaseImage::FlipZT which flips the foreground mask (if any),
   //       adjusts the attributes, and updates the coordinate transformation matrices.
-  //       The subclass then only needs to reshape the image _matrix data itself.
+  //       The subclass then only needs to reshape the image data itself.
 
   // Allocate memory
   VoxelType ****matrix = Allocate<VoxelType>(_attr._x, _attr._y, _attr._t, _attr._z);
@@ -1727,7 +1797,7 @@ void GenericImage<VoxelType>::FlipZT(bool modify_origin)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    matrix[k][l][j][i] = _matrix[l][k][j][i];
+    matrix[k][l][j][i] = _data[DataIndex(i, j, k, l)];
   }
 
   // Swap image dimensions
@@ -1739,14 +1809,15 @@ void GenericImage<VoxelType>::FlipZT(bool modify_origin)
   // Swap origin coordinates
   if (modify_origin) swap(_attr._zorigin, _attr._torigin);
 
-  // Reshape image matrix
+  // Update voxel strides
   //
   // Attention: DO NOT just swap the pointers to the data elements as this
   //            changes the memory location of the image data. This is not
   //            predictable by users of the class which may still hold a pointer
   //            to the old memory and in particular complicates the synchronization
   //            of host and device memory in CUGenericImage used by CUDA code.
-  _matrix = Reshape(_matrix, _attr._x, _attr._y, _attr._z, _attr._t);
+  DeallocateMatrix();
+  UpdateStrides();
 
   // Copy flipped image
   CopyFrom(matrix[0][0][0]);
@@ -1764,7 +1835,7 @@ void GenericImage<VoxelType>::SwapXY(bool modify_axes)
 {
   // TODO: Implement BaseImage::FlipXY which flips the foreground mask (if any),
   //       adjusts the attributes, and updates the coordinate transformation matrices.
-  //       The subclass then only needs to reshape the image _matrix data itself.
+  //       The subclass then only needs to reshape the image data itself.
 
   // Allocate memory
   VoxelType ****matrix = Allocate<VoxelType>(_attr._y, _attr._x, _attr._z, _attr._t);
@@ -1774,18 +1845,19 @@ void GenericImage<VoxelType>::SwapXY(bool modify_axes)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    matrix[l][k][i][j] = _matrix[l][k][j][i];
+    matrix[l][k][i][j] = _data[DataIndex(i, j, k, l)];
   }
   swap(_attr._x, _attr._y);
 
-  // Reshape image matrix
+  // Update voxel strides
   //
   // Attention: DO NOT just swap the pointers to the data elements as this
   //            changes the memory location of the image data. This is not
   //            predictable by users of the class which may still hold a pointer
   //            to the old memory and in particular complicates the synchronization
   //            of host and device memory in CUGenericImage used by CUDA code.
-  _matrix = Reshape(_matrix, _attr._x, _attr._y, _attr._z, _attr._t);
+  DeallocateMatrix();
+  UpdateStrides();
 
   // Copy flipped image
   CopyFrom(matrix[0][0][0]);
@@ -1809,7 +1881,7 @@ void GenericImage<VoxelType>::SwapXZ(bool modify_axes)
 {
   // TODO: Implement BaseImage::FlipXZ which flips the foreground mask (if any),
   //       adjusts the attributes, and updates the coordinate transformation matrices.
-  //       The subclass then only needs to reshape the image _matrix data itself.
+  //       The subclass then only needs to reshape the image data itself.
 
   // Allocate memory
   VoxelType ****matrix = Allocate<VoxelType>(_attr._z, _attr._y, _attr._x, _attr._t);
@@ -1819,18 +1891,19 @@ void GenericImage<VoxelType>::SwapXZ(bool modify_axes)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    matrix[l][i][j][k] = _matrix[l][k][j][i];
+    matrix[l][i][j][k] = _data[DataIndex(i, j, k, l)];
   }
   swap(_attr._x, _attr._z);
 
-  // Reshape image data
+  // Update voxel strides
   //
   // Attention: DO NOT just swap the pointers to the data elements as this
   //            changes the memory location of the image data. This is not
   //            predictable by users of the class which may still hold a pointer
   //            to the old memory and in particular complicates the synchronization
   //            of host and device memory in CUGenericImage used by CUDA code.
-  _matrix = Reshape(_matrix, _attr._x, _attr._y, _attr._z, _attr._t);
+  DeallocateMatrix();
+  UpdateStrides();
 
   // Copy flipped image
   CopyFrom(matrix[0][0][0]);
@@ -1854,7 +1927,7 @@ void GenericImage<VoxelType>::SwapYZ(bool modify_axes)
 {
   // TODO: Implement BaseImage::FlipYZ which flips the foreground mask (if any),
   //       adjusts the attributes, and updates the coordinate transformation matrices.
-  //       The subclass then only needs to reshape the image _matrix data itself.
+  //       The subclass then only needs to reshape the image data itself.
 
   // Allocate memory for flipped image
   VoxelType ****matrix = Allocate<VoxelType>(_attr._x, _attr._z, _attr._y, _attr._t);
@@ -1864,18 +1937,19 @@ void GenericImage<VoxelType>::SwapYZ(bool modify_axes)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    matrix[l][j][k][i] = _matrix[l][k][j][i];
+    matrix[l][j][k][i] = _data[DataIndex(i, j, k, l)];
   }
   swap(_attr._y, _attr._z);
 
-  // Reshape image matrix
+  // Update voxel strides
   //
   // Attention: DO NOT just swap the pointers to the data elements as this
   //            changes the memory location of the image data. This is not
   //            predictable by users of the class which may still hold a pointer
   //            to the old memory and in particular complicates the synchronization
   //            of host and device memory in CUGenericImage used by CUDA code.
-  _matrix = Reshape(_matrix, _attr._x, _attr._y, _attr._z, _attr._t);
+  DeallocateMatrix();
+  UpdateStrides();
   
   // Copy flipped image
   CopyFrom(matrix[0][0][0]);
@@ -1899,7 +1973,7 @@ void GenericImage<VoxelType>::SwapXT(bool modify_axes)
 {
   // TODO: Implement BaseImage::FlipXT which flips the foreground mask (if any),
   //       adjusts the attributes, and updates the coordinate transformation matrices.
-  //       The subclass then only needs to reshape the image _matrix data itself.
+  //       The subclass then only needs to reshape the image data itself.
 
   // Allocate memory
   VoxelType ****matrix = Allocate<VoxelType>(_attr._t, _attr._y, _attr._z, _attr._x);
@@ -1909,18 +1983,19 @@ void GenericImage<VoxelType>::SwapXT(bool modify_axes)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    matrix[i][k][j][l] = _matrix[l][k][j][i];
+    matrix[i][k][j][l] = _data[DataIndex(i, j, k, l)];
   }
   swap(_attr._x, _attr._t);
 
-  // Reshape image matrix
+  // Update voxel strides
   //
   // Attention: DO NOT just swap the pointers to the data elements as this
   //            changes the memory location of the image data. This is not
   //            predictable by users of the class which may still hold a pointer
   //            to the old memory and in particular complicates the synchronization
   //            of host and device memory in CUGenericImage used by CUDA code.
-  _matrix = Reshape(_matrix, _attr._x, _attr._y, _attr._z, _attr._t);
+  DeallocateMatrix();
+  UpdateStrides();
   
   // Copy flipped image
   CopyFrom(matrix[0][0][0]);
@@ -1944,7 +2019,7 @@ void GenericImage<VoxelType>::SwapYT(bool modify_axes)
 {
   // TODO: Implement BaseImage::FlipYT which flips the foreground mask (if any),
   //       adjusts the attributes, and updates the coordinate transformation matrices.
-  //       The subclass then only needs to reshape the image _matrix data itself.
+  //       The subclass then only needs to reshape the image data itself.
 
   // Allocate memory
   VoxelType ****matrix = Allocate<VoxelType>(_attr._x, _attr._t, _attr._z, _attr._y);
@@ -1954,18 +2029,19 @@ void GenericImage<VoxelType>::SwapYT(bool modify_axes)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    matrix[j][k][l][i] = _matrix[l][k][j][i];
+    matrix[j][k][l][i] = _data[DataIndex(i, j, k, l)];
   }
   swap(_attr._y, _attr._t);
 
-  // Reshape image matrix
+  // Update voxel strides
   //
   // Attention: DO NOT just swap the pointers to the data elements as this
   //            changes the memory location of the image data. This is not
   //            predictable by users of the class which may still hold a pointer
   //            to the old memory and in particular complicates the synchronization
   //            of host and device memory in CUGenericImage used by CUDA code.
-  _matrix = Reshape(_matrix, _attr._x, _attr._y, _attr._z, _attr._t);
+  DeallocateMatrix();
+  UpdateStrides();
   
   // Copy flipped image
   CopyFrom(matrix[0][0][0]);
@@ -1989,7 +2065,7 @@ void GenericImage<VoxelType>::SwapZT(bool modify_axes)
 {
   // TODO: Implement BaseImage::FlipZT which flips the foreground mask (if any),
   //       adjusts the attributes, and updates the coordinate transformation matrices.
-  //       The subclass then only needs to reshape the image _matrix data itself.
+  //       The subclass then only needs to reshape the image data itself.
 
   // Allocate memory
   VoxelType ****matrix = Allocate<VoxelType>(_attr._x, _attr._y, _attr._t, _attr._z);
@@ -1999,18 +2075,19 @@ void GenericImage<VoxelType>::SwapZT(bool modify_axes)
   for (int k = 0; k < _attr._z; ++k)
   for (int j = 0; j < _attr._y; ++j)
   for (int i = 0; i < _attr._x; ++i) {
-    matrix[k][l][j][i] = _matrix[l][k][j][i];
+    matrix[k][l][j][i] = _data[DataIndex(i, j, k, l)];
   }
   swap(_attr._z, _attr._t);
 
-  // Reshape image matrix
+  // Update voxel strides
   //
   // Attention: DO NOT just swap the pointers to the data elements as this
   //            changes the memory location of the image data. This is not
   //            predictable by users of the class which may still hold a pointer
   //            to the old memory and in particular complicates the synchronization
   //            of host and device memory in CUGenericImage used by CUDA code.
-  _matrix = Reshape(_matrix, _attr._x, _attr._y, _attr._z, _attr._t);
+  DeallocateMatrix();
+  UpdateStrides();
   
   // Copy flipped image
   CopyFrom(matrix[0][0][0]);
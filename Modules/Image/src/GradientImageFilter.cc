@@ -24,6 +24,8 @@
 #include "mirtk/Parallel.h"
 #include "mirtk/VoxelFunction.h"
 
+#include "ImageLineUtils.h"
+
 #include <limits>
 #include <utility>
 
@@ -37,40 +39,47 @@ namespace mirtk {
 namespace GradientImageFilterUtils {
 
 // -----------------------------------------------------------------------------
-/// Evaluate image gradient at a specific voxel using finite differences
+/// Evaluate image gradient at a specific voxel
+///
+/// The partial derivatives are either approximated by finite differences or
+/// looked up in precomputed images of the Gaussian derivatives of the input.
 template <class TIn, class TOut = TIn>
 class EvaluateImageGradient : public VoxelFunction
 {
   typedef typename GradientImageFilter<TIn>::GradientType GradientType;
 
-  GradientType             _Type;
-  const GenericImage<TIn> *_Input;
-  double                   _PaddingValue;
-  bool                     _UseVoxelSize;
-  const Matrix            *_Orientation;
-  int                      _MaxI, _MaxJ, _MaxK;
-  int                      _NumberOfVoxels;
+  GradientType                _Type;
+  const GenericImage<TIn>    *_Input;
+  double                      _PaddingValue;
+  bool                        _UseVoxelSize;
+  const Matrix               *_Orientation;
+  const GenericImage<double> *_Derivatives; ///< Gaussian derivatives in x, y, and z
+  int                         _MaxI, _MaxJ, _MaxK;
+  int                         _NumberOfVoxels;
 
 public:
 
   EvaluateImageGradient(GradientType type,
                         const GenericImage<TIn> *input, double padding,
-                        bool use_voxel_size, const Matrix *orientation)
+                        bool use_voxel_size, const Matrix *orientation,
+                        const GenericImage<double> *derivatives = nullptr)
   :
     _Type(type),
     _Input(input),
     _PaddingValue(padding),
     _UseVoxelSize(use_voxel_size),
     _Orientation(orientation),
+    _Derivatives(derivatives),
     _MaxI(input->X() - 1),
     _MaxJ(input->Y() - 1),
     _MaxK(input->Z() - 1),
     _NumberOfVoxels(input->NumberOfSpatialVoxels())
   {}
 
-  void operator ()(int i, int j, int k, int l, TOut *g)
+  /// Evaluate image derivatives using finite differences
+  void FiniteDifferences(int i, int j, int k, int l, double &dx, double &dy, double &dz) const
   {
-    double dx = .0, dy = .0, dz = .0, v1, v2;
+    double v1, v2;
     const bool nan_bg = IsNaN(_PaddingValue);
 
     int i1 = (i == 0     ? 0     : i - 1);
@@ -163,6 +172,19 @@ public:
       }
       if (k1 < k2) dz = (v2 - v1) / (k2 - k1);
     }
+  }
+
+  void operator ()(int i, int j, int k, int l, TOut *g)
+  {
+    double dx = .0, dy = .0, dz = .0;
+    if (_Derivatives) {
+      const int idx = _Input->VoxelToIndex(i, j, k, l);
+      dx = _Derivatives[0].Get(idx);
+      dy = _Derivatives[1].Get(idx);
+      dz = _Derivatives[2].Get(idx);
+    } else {
+      FiniteDifferences(i, j, k, l, dx, dy, dz);
+    }
 
     if (_UseVoxelSize) {
       if (_Input->GetXSize() > .0) dx /= _Input->GetXSize();
@@ -230,7 +252,8 @@ GradientImageFilter<VoxelType>::GradientImageFilter(GradientType type)
   _Type(type),
   _UseVoxelSize(true),
   _UseOrientation(false),
-  _PaddingValue(-inf)
+  _PaddingValue(-inf),
+  _Sigma(.0)
 {
 }
 
@@ -285,10 +308,28 @@ void GradientImageFilter<VoxelType>::Run()
   ImageAttributes attr = this->Input()->Attributes();
   if (attr._dt == .0) attr._dt = 1.0; // Call voxel function for each scalar input
 
+  // Convolve input with Gaussian derivative kernels
+  GenericImage<double> deriv[3];
+  if (_Sigma > .0) {
+    GenericImage<double> image;
+    Array<double>        fg;
+    const bool   padded   = ImageLineUtils::CopyForeground(*this->Input(), _PaddingValue, image, fg);
+    const double sigma[3] = {attr._dx > .0 ? _Sigma / attr._dx : .0,
+                             attr._dy > .0 ? _Sigma / attr._dy : .0,
+                             attr._dz > .0 ? _Sigma / attr._dz : .0};
+    for (int dim = 0; dim < 3; ++dim) {
+      int order[3] = {0, 0, 0};
+      order[dim] = 1;
+      deriv[dim] = image;
+      ImageLineUtils::GaussianDerivative(deriv[dim], padded ? fg.data() : nullptr, sigma, order);
+    }
+  }
+
   Matrix R;
   if (_UseOrientation) R = attr.GetWorldToImageOrientation();
   EvaluateImageGradient<VoxelType> eval(
-    _Type, this->Input(), _PaddingValue, _UseVoxelSize, _UseOrientation ? &R : nullptr
+    _Type, this->Input(), _PaddingValue, _UseVoxelSize, _UseOrientation ? &R : nullptr,
+    _Sigma > .0 ? deriv : nullptr
   );
   ParallelForEachVoxel(attr, this->Output(), eval);
 
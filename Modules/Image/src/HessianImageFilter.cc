@@ -22,6 +22,8 @@
 #include "mirtk/Matrix.h"
 #include "mirtk/ImageAttributes.h"
 
+#include "ImageLineUtils.h"
+
 
 namespace mirtk {
 
@@ -38,6 +40,7 @@ HessianImageFilter<VoxelType>::HessianImageFilter(OutputType type)
   _UseVoxelSize   = true;
   _UseOrientation = false;
   _PaddingValue   = -numeric_limits<double>::infinity();
+  _Sigma          = .0;
 }
 
 // =============================================================================
@@ -76,6 +79,22 @@ void HessianImageFilter<VoxelType>::Run()
   const ImageAttributes &attr   = input->Attributes();
   Matrix                 R      = attr.GetWorldToImageOrientation();
 
+  // Convolve input with Gaussian derivative kernels
+  const int order[6][3] = {{2, 0, 0}, {1, 1, 0}, {1, 0, 1}, {0, 2, 0}, {0, 1, 1}, {0, 0, 2}};
+  GenericImage<double> deriv[6];
+  if (_Sigma > .0) {
+    GenericImage<double> image;
+    Array<double>        fg;
+    const bool   padded   = ImageLineUtils::CopyForeground(*this->Input(), _PaddingValue, image, fg);
+    const double sigma[3] = {attr._dx > .0 ? _Sigma / attr._dx : .0,
+                             attr._dy > .0 ? _Sigma / attr._dy : .0,
+                             attr._dz > .0 ? _Sigma / attr._dz : .0};
+    for (int n = 0; n < 6; ++n) {
+      deriv[n] = image;
+      ImageLineUtils::GaussianDerivative(deriv[n], padded ? fg.data() : nullptr, sigma, order[n]);
+    }
+  }
+
   for (int z = 0; z < attr._z; ++z) {
     z1 = z - 1;
     if (z1 < 0) z1 = 0;
@@ -94,62 +113,72 @@ void HessianImageFilter<VoxelType>::Run()
         x2 = x + 1;
         if (x2 > attr._x - 1) x2 = attr._x - 1;
 
-        if (x1 != x2 &&
-            input->Get(x,  y, z) > _PaddingValue &&
-            input->Get(x1, y, z) > _PaddingValue &&
-            input->Get(x2, y, z) > _PaddingValue) {
-          dxx = (input->Get(x2, y, z) - 2.0 * input->Get(x, y, z) + input->Get(x1, y, z));
-        } else {
-          dxx = .0;
-        }
-        if (x1 != x2 &&
-            y1 != y2 &&
-            input->Get(x1, y1, z) > _PaddingValue &&
-            input->Get(x1, y2, z) > _PaddingValue &&
-            input->Get(x2, y1, z) > _PaddingValue &&
-            input->Get(x2, y2, z) > _PaddingValue) {
-          dxy = (input->Get(x2, y2, z) - input->Get(x2, y1, z) - input->Get(x1, y2, z) + input->Get(x1, y1, z)) / ((x2 - x1) * (y2 - y1));
-        } else {
-          dxy = .0;
-        }
-        if (x1 != x2 &&
-            z1 != z2 &&
-            input->Get(x1, y, z1) > _PaddingValue &&
-            input->Get(x1, y, z2) > _PaddingValue &&
-            input->Get(x2, y, z1) > _PaddingValue &&
-            input->Get(x2, y, z2) > _PaddingValue) {
-          dxz = (input->Get(x2, y, z2) - input->Get(x2, y, z1) - input->Get(x1, y, z2) + input->Get(x1, y, z1)) / ((x2 - x1) * (z2 - z1));
+        if (_Sigma > .0) {
+          const int idx = input->VoxelToIndex(x, y, z);
+          dxx = deriv[0].Get(idx);
+          dxy = deriv[1].Get(idx);
+          dxz = deriv[2].Get(idx);
+          dyy = deriv[3].Get(idx);
+          dyz = deriv[4].Get(idx);
+          dzz = deriv[5].Get(idx);
         } else {
-          dxz = .0;
-        }
+          if (x1 != x2 &&
+              input->Get(x,  y, z) > _PaddingValue &&
+              input->Get(x1, y, z) > _PaddingValue &&
+              input->Get(x2, y, z) > _PaddingValue) {
+            dxx = (input->Get(x2, y, z) - 2.0 * input->Get(x, y, z) + input->Get(x1, y, z));
+          } else {
+            dxx = .0;
+          }
+          if (x1 != x2 &&
+              y1 != y2 &&
+              input->Get(x1, y1, z) > _PaddingValue &&
+              input->Get(x1, y2, z) > _PaddingValue &&
+              input->Get(x2, y1, z) > _PaddingValue &&
+              input->Get(x2, y2, z) > _PaddingValue) {
+            dxy = (input->Get(x2, y2, z) - input->Get(x2, y1, z) - input->Get(x1, y2, z) + input->Get(x1, y1, z)) / ((x2 - x1) * (y2 - y1));
+          } else {
+            dxy = .0;
+          }
+          if (x1 != x2 &&
+              z1 != z2 &&
+              input->Get(x1, y, z1) > _PaddingValue &&
+              input->Get(x1, y, z2) > _PaddingValue &&
+              input->Get(x2, y, z1) > _PaddingValue &&
+              input->Get(x2, y, z2) > _PaddingValue) {
+            dxz = (input->Get(x2, y, z2) - input->Get(x2, y, z1) - input->Get(x1, y, z2) + input->Get(x1, y, z1)) / ((x2 - x1) * (z2 - z1));
+          } else {
+            dxz = .0;
+          }
 
-        if (y1 != y2 &&
-            input->Get(x, y,  z) > _PaddingValue &&
-            input->Get(x, y1, z) > _PaddingValue &&
-            input->Get(x, y2, z) > _PaddingValue) {
-          dyy = (input->Get(x, y2, z) - 2.0 * input->Get(x, y, z) + input->Get(x, y1, z));
-        } else {
-          dyy = .0;
-        }
+          if (y1 != y2 &&
+              input->Get(x, y,  z) > _PaddingValue &&
+              input->Get(x, y1, z) > _PaddingValue &&
+              input->Get(x, y2, z) > _PaddingValue) {
+            dyy = (input->Get(x, y2, z) - 2.0 * input->Get(x, y, z) + input->Get(x, y1, z));
+          } else {
+            dyy = .0;
+          }
 
-        if (y1 != y2 &&
-            z1 != z2 &&
-            input->Get(x, y1, z1) > _PaddingValue &&
-            input->Get(x, y1, z2) > _PaddingValue &&
-            input->Get(x, y2, z1) > _PaddingValue &&
-            input->Get(x, y2, z2) > _PaddingValue) {
-          dyz = (input->Get(x, y2, z2) - input->Get(x, y2, z1) - input->Get(x, y1, z2) + input->Get(x, y1, z1)) / ((y2 - y1) * (z2 - z1));
-        } else {
-          dyz = .0;
-        }
+          if (y1 != y2 &&
+              z1 != z2 &&
+              input->Get(x, y1, z1) > _PaddingValue &&
+              input->Get(x, y1, z2) > _PaddingValue &&
+              input->Get(x, y2, z1) > _PaddingValue &&
+              input->Get(x, y2, z2) > _PaddingValue) {
+            dyz = (input->Get(x, y2, z2) - input->Get(x, y2, z1) - input->Get(x, y1, z2) + input->Get(x, y1, z1)) / ((y2 - y1) * (z2 - z1));
+          } else {
+            dyz = .0;
+          }
 
-        if (z1 != z2 &&
-            input->Get(x, y, z)  > _PaddingValue &&
-            input->Get(x, y, z1) > _PaddingValue &&
-            input->Get(x, y, z2) > _PaddingValue) {
-          dzz = (input->Get(x, y, z2) - 2.0 * input->Get(x, y, z) + input->Get(x, y, z1));
-        } else {
-          dzz = .0;
+          if (z1 != z2 &&
+              input->Get(x, y, z)  > _PaddingValue &&
+              input->Get(x, y, z1) > _PaddingValue &&
+              input->Get(x, y, z2) > _PaddingValue) {
+            dzz = (input->Get(x, y, z2) - 2.0 * input->Get(x, y, z) + input->Get(x, y, z1));
+          } else {
+            dzz = .0;
+          }
         }
 
         if (_UseVoxelSize) {
@@ -75,6 +75,63 @@ public:
 };
 
 
+// -----------------------------------------------------------------------------
+/// Smooth joint histogram with cubic B-spline Parzen window
+///
+/// The tensor product of the 1D kernels is applied as 3x3 kernel instead of
+/// two separable passes. The products of the kernel weights and bin values are
+/// summed in an order which is symmetric in both axes. Hence, the smoothed
+/// transposed histogram is exactly the transpose of the smoothed histogram,
+/// and the result is independent of which image is the target and which the
+/// source without smoothing the transposed histogram as well.
+template <class T>
+class SmoothHistogram
+{
+  const T *_Input;
+  T       *_Output;
+  int      _X;
+  int      _Y;
+
+  /// Bin value or zero if outside histogram
+  inline double Bin(int i, int j) const
+  {
+    if (i < 0 || i >= _X || j < 0 || j >= _Y) return 0.;
+    return static_cast<double>(_Input[j * _X + i]);
+  }
+
+public:
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const double w[3] = {1./6., 2./3., 1./6.};
+    double value;
+    for (int j = re.begin(); j != re.end(); ++j) {
+      T *out = _Output + j * _X;
+      for (int i = 0; i < _X; ++i, ++out) {
+        value = 0.;
+        for (int a = -1; a <= 1; ++a) {
+          value += w[a+1] * w[a+1] * Bin(i + a, j + a);
+          for (int b = a + 1; b <= 1; ++b) {
+            value += w[a+1] * w[b+1] * (Bin(i + a, j + b) + Bin(i + b, j + a));
+          }
+        }
+        (*out) = static_cast<T>(value);
+      }
+    }
+  }
+
+  static void Run(const T *input, T *output, int nx, int ny)
+  {
+    SmoothHistogram body;
+    body._Input  = input;
+    body._Output = output;
+    body._X      = nx;
+    body._Y      = ny;
+    parallel_for(blocked_range<int>(0, ny), body);
+  }
+};
+
+
 } // namespace Histogram2DUtils
 using namespace Histogram2DUtils;
 
@@ -883,45 +940,32 @@ void Histogram2D<HistogramType>::Smooth()
 {
   if (_nsamp == 0) return;
 
-  // Smoothing kernel
-  double kernel[3] = { 1.0/6.0, 2.0/3.0, 1.0/6.0 };
+  // Copy of unsmoothed histogram
+  const int n = NumberOfBins();
+  UniquePtr<HistogramType[]> bins(new HistogramType[n]);
+  memcpy(bins.get(), RawPointer(), n * sizeof(HistogramType));
 
-  // Allocate temporary memory
-  double value, **tmp = Allocate<double>(_nbins_x, _nbins_y);
+  // Smooth rows of histogram in parallel
+  SmoothHistogram<HistogramType>::Run(bins.get(), RawPointer(), _nbins_x, _nbins_y);
 
-  // Smooth along the x-axis
-  for (int j = 0; j < _nbins_y; j++)
-  for (int i = 0; i < _nbins_x; i++) {
-    value = .0;
-    for (int k = 0; k < 3; k++) {
-      if ((i-1+k >= 0) && (i-1+k < _nbins_x)) {
-        value += kernel[k] * static_cast<double>(_bins[j][i-1+k]);
-      }
-    }
-    tmp[j][i] = value;
+  // Kahan summation of number of samples in row and column order such that
+  // the number of samples of the transposed histogram is identical as well
+  double n1 = 0., n2 = 0., c1 = 0., c2 = 0., y, t;
+  for (int j = 0; j < _nbins_y; ++j)
+  for (int i = 0; i < _nbins_x; ++i) {
+    y  = static_cast<double>(_bins[j][i]) - c1;
+    t  = n1 + y;
+    c1 = (t - n1) - y;
+    n1 = t;
   }
-
-  // Smooth along the y-axis
-  double n = 0., c = 0., y, t;
-  for (int i = 0; i < _nbins_x; i++)
-  for (int j = 0; j < _nbins_y; j++) {
-    value = .0;
-    for (int k = 0; k < 3; k++) {
-      if ((j-1+k >= 0) && (j-1+k < _nbins_y)) {
-        value += kernel[k] * tmp[j-1+k][i];
-      }
-    }
-    _bins[j][i] = static_cast<HistogramType>(value);
-    // Kahan summation of number of samples
-    y = static_cast<double>(value) - c;
-    t = n + y;
-    c = (t - n) - y;
-    n = t;
+  for (int i = 0; i < _nbins_x; ++i)
+  for (int j = 0; j < _nbins_y; ++j) {
+    y  = static_cast<double>(_bins[j][i]) - c2;
+    t  = n2 + y;
+    c2 = (t - n2) - y;
+    n2 = t;
   }
-  _nsamp = static_cast<HistogramType>(n);
-
-  // Free tmp memory
-  Deallocate(tmp);
+  _nsamp = static_cast<HistogramType>(.5 * (n1 + n2));
 }
 
 // -----------------------------------------------------------------------------
@@ -18,13 +18,126 @@
 
 #include "mirtk/HistogramMatching.h"
 
-#include "mirtk/Histogram1D.h"
+#include "mirtk/Algorithm.h"
 #include "mirtk/Profiling.h"
+#include "mirtk/ForEachUnaryVoxelFunction.h"
+#include "mirtk/ForEachBinaryVoxelFunction.h"
 
 
 namespace mirtk {
 
 
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace HistogramMatchingUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Add foreground intensities of image to histogram
+struct FillHistogram : public VoxelReduction
+{
+  Histogram1D<int> _Histogram;
+
+  FillHistogram(const Histogram1D<int> &hist) : _Histogram(hist) {}
+  FillHistogram(const FillHistogram &other) : _Histogram(other._Histogram) {}
+
+  void split(const FillHistogram &)
+  {
+    _Histogram.Reset();
+  }
+
+  void join(const FillHistogram &other)
+  {
+    for (int bin = 0; bin < _Histogram.NumberOfBins(); ++bin) {
+      _Histogram.Add(bin, other._Histogram(bin));
+    }
+  }
+
+  template <class TImage, class T>
+  void operator ()(const TImage &image, int idx, const T *value)
+  {
+    if (image.IsForeground(idx)) {
+      _Histogram.AddSample(static_cast<double>(*value));
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Compute histogram of foreground intensities
+template <class TVoxel>
+void ComputeHistogram(Histogram1D<int> &hist, const GenericImage<TVoxel> *image, int nbins)
+{
+  double min, max;
+  image->GetMinMaxAsDouble(&min, &max);
+  hist.Min(min);
+  hist.Max(max);
+  hist.PutNumberOfBins(nbins);
+  FillHistogram fill(hist);
+  ParallelForEachScalar(*image, fill);
+  hist = fill._Histogram;
+}
+
+// -----------------------------------------------------------------------------
+/// Map foreground intensities using monotone piecewise linear function
+///
+/// The segment containing an intensity is found by binary search in the
+/// sorted source levels, and the linear map of each segment is precomputed.
+template <class TVoxel>
+struct MapIntensities : public VoxelFunction
+{
+  const GenericImage<TVoxel> *_Input;
+  const Array<double>        *_Levels;
+  Array<double>               _Offset;
+  Array<double>               _Slope;
+  double                      _Min;
+  double                      _Max;
+  double                      _Background;
+
+  MapIntensities(const GenericImage<TVoxel> *input,
+                 const Array<double> &src_levels,
+                 const Array<double> &tgt_levels, double bg)
+  :
+    _Input(input), _Levels(&src_levels),
+    _Offset(src_levels.size(), .0), _Slope(src_levels.size(), .0),
+    _Min(tgt_levels.front()), _Max(tgt_levels.back()), _Background(bg)
+  {
+    for (size_t bin = 1; bin < src_levels.size(); ++bin) {
+      const double ds = src_levels[bin] - src_levels[bin - 1];
+      if (ds > .0) {
+        _Slope [bin] = (tgt_levels[bin] - tgt_levels[bin - 1]) / ds;
+        _Offset[bin] = tgt_levels[bin - 1] - _Slope[bin] * src_levels[bin - 1];
+      } else {
+        _Offset[bin] = tgt_levels[bin];
+      }
+    }
+  }
+
+  template <class TImage, class T>
+  void operator ()(const TImage &, int idx, const T *in, T *out)
+  {
+    if (_Input->IsForeground(idx)) {
+      const double value = static_cast<double>(*in);
+      const Array<double> &levels = *_Levels;
+      const size_t bin = std::lower_bound(levels.begin(), levels.end(), value) - levels.begin();
+      if (bin == 0) {
+        *out = voxel_cast<T>(_Min);
+      } else if (bin >= levels.size() - 1) {
+        *out = voxel_cast<T>(_Max);
+      } else {
+        *out = voxel_cast<T>(_Offset[bin] + _Slope[bin] * value);
+      }
+    } else {
+      *out = voxel_cast<T>(_Background);
+    }
+  }
+};
+
+
+} // namespace HistogramMatchingUtils
+using namespace HistogramMatchingUtils;
+
 // =============================================================================
 // Construction/Destruction
 // =============================================================================
@@ -35,8 +148,17 @@ HistogramMatching<VoxelType>::HistogramMatching()
 :
   _NumberOfBins(512),
   _NumberOfSteps(10),
-  _CutOff(.01)
+  _CutOff(.01),
+  _ReferenceHistogramValid(false)
+{
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void HistogramMatching<VoxelType>::Reference(const ImageType *reference)
 {
+  _Reference               = reference;
+  _ReferenceHistogramValid = false;
 }
 
 // =============================================================================
@@ -68,31 +190,19 @@ void HistogramMatching<VoxelType>::Run()
   const ImageType * const target = this->Reference();
   ImageType       * const output = this->Output();
 
-  // Compute source image histogram
+  // Compute image histograms
   Histogram1D<int> src_hist;
-  double src_min, src_max;
-  input->GetMinMaxAsDouble(&src_min, &src_max);
-  src_hist.Min(src_min);
-  src_hist.Max(src_max);
-  src_hist.PutNumberOfBins(_NumberOfBins);
-  for (int vox = 0; vox < input->NumberOfVoxels(); ++vox) {
-    if (input->IsForeground(vox)) {
-      src_hist.AddSample(input->GetAsDouble(vox));
-    }
-  }
+  ComputeHistogram(src_hist, input, _NumberOfBins);
+  const double src_min = src_hist.Min();
+  const double src_max = src_hist.Max();
 
-  // Compute target image histogram
-  Histogram1D<int> tgt_hist;
-  double tgt_min, tgt_max;
-  _Reference->GetMinMaxAsDouble(&tgt_min, &tgt_max);
-  tgt_hist.Min(tgt_min);
-  tgt_hist.Max(tgt_max);
-  tgt_hist.PutNumberOfBins(_NumberOfBins);
-  for (int vox = 0; vox < target->NumberOfVoxels(); ++vox) {
-    if (target->IsForeground(vox)) {
-      tgt_hist.AddSample(target->GetAsDouble(vox));
-    }
+  Histogram1D<int> &tgt_hist = _ReferenceHistogram;
+  if (!_ReferenceHistogramValid || tgt_hist.NumberOfBins() != _NumberOfBins) {
+    ComputeHistogram(tgt_hist, target, _NumberOfBins);
+    _ReferenceHistogramValid = true;
   }
+  const double tgt_min = tgt_hist.Min();
+  const double tgt_max = tgt_hist.Max();
 
   // Compute linear maps
   double pct  = _CutOff / 100.;
@@ -118,32 +228,14 @@ void HistogramMatching<VoxelType>::Run()
   tgt_levels.push_back(tgt_max);
 
   // Map input intensities
-  double value, bg = -inf;
+  double bg;
   if (target->HasBackgroundValue()) {
     bg = target->GetBackgroundValueAsDouble();
   } else {
     bg = tgt_min - 1.;
   }
-  for (int bin, vox = 0; vox < input->NumberOfVoxels(); ++vox) {
-    if (input->IsForeground(vox)) {
-      value = input->GetAsDouble(vox);
-      for (bin = 0; bin < static_cast<int>(src_levels.size()); ++bin) {
-        if (value <= src_levels[bin]) break;
-      }
-      if (bin == 0) {
-        value = tgt_levels.front();
-      } else if (bin >= static_cast<int>(src_levels.size() - 1)) {
-        value = tgt_levels.back();
-      } else {
-        value  = (value - src_levels[bin - 1]) / (src_levels[bin] - src_levels[bin - 1]);
-        value *= tgt_levels[bin] - tgt_levels[bin - 1];
-        value += tgt_levels[bin-1];
-      }
-    } else {
-      value = bg;
-    }
-    output->PutAsDouble(vox, value);
-  }
+  MapIntensities<VoxelType> map(input, src_levels, tgt_levels, bg);
+  ParallelForEachScalar(*input, *output, map);
   if (input->HasBackgroundValue()) {
     output->PutBackgroundValueAsDouble(bg);
   }
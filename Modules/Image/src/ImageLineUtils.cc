@@ -0,0 +1,292 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2017 Imperial College London
+ * Copyright 2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ImageLineUtils.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Memory.h"
+#include "mirtk/Parallel.h"
+
+
+namespace mirtk {
+namespace ImageLineUtils {
+
+
+// =============================================================================
+// Recursive Gaussian filter
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+RecursiveGaussianCoefficients::RecursiveGaussianCoefficients(double sigma, int order)
+{
+  // Parameters of Deriche (1993) for the Gaussian and its first and second derivative
+  static const double params[3][8] = {
+    //   a0      a1     b0     b1     w0     w1      c0      c1
+    { 1.680,  3.735, 1.783, 1.723, .6318, 1.997, -.6803, -.2598},
+    {-.6472, -4.531, 1.527, 1.516, .6719, 2.072,  .6494,  .9557},
+    {-1.331,  3.661, 1.240, 1.314, .7480, 2.166,  .3225, -1.738}
+  };
+  const double *p = params[order];
+  const double a0 = p[0], a1 = p[1], b0 = p[2], b1 = p[3];
+  const double w0 = p[4], w1 = p[5], c0 = p[6], c1 = p[7];
+  const double cw0 = cos(w0 / sigma), sw0 = sin(w0 / sigma);
+  const double cw1 = cos(w1 / sigma), sw1 = sin(w1 / sigma);
+  const double e0  = exp(-b0 / sigma), e1 = exp(-b1 / sigma);
+  n[0] = a0 + c0;
+  n[1] = e1 * (c1 * sw1 - (c0 + 2. * a0) * cw1) + e0 * (a1 * sw0 - (2. * c0 + a0) * cw0);
+  n[2] = 2. * e0 * e1 * ((a0 + c0) * cw1 * cw0 - a1 * cw1 * sw0 - c1 * cw0 * sw1)
+       + c0 * e0 * e0 + a0 * e1 * e1;
+  n[3] = e1 * e0 * e0 * (c1 * sw1 - c0 * cw1) + e0 * e1 * e1 * (a1 * sw0 - a0 * cw0);
+  d[0] = -2. * e1 * cw1 - 2. * e0 * cw0;
+  d[1] =  4. * cw1 * cw0 * e0 * e1 + e1 * e1 + e0 * e0;
+  d[2] = -2. * cw0 * e0 * e1 * e1 - 2. * cw1 * e1 * e0 * e0;
+  d[3] = e0 * e0 * e1 * e1;
+  // Anti-causal part is symmetric for even and anti-symmetric for odd order
+  const double s = (order == 1 ? -1. : 1.);
+  m[0] = s * (n[1] - d[0] * n[0]);
+  m[1] = s * (n[2] - d[1] * n[0]);
+  m[2] = s * (n[3] - d[2] * n[0]);
+  m[3] = s * (     - d[3] * n[0]);
+  if (order == 0) {
+    // Sum of impulse response is one
+    B = (1. + d[0] + d[1] + d[2] + d[3])
+      / (n[0] + n[1] + n[2] + n[3] + m[0] + m[1] + m[2] + m[3]);
+  } else {
+    // Impulse response h[t] of unnormalized filter
+    const int    radius = iceil(30. * sigma) + 10;
+    Array<double> h(2 * radius + 1, 0.);
+    double *hp = h.data() + radius;
+    for (int t = 0; t <= radius; ++t) {
+      if (t < 4) hp[t] = n[t];
+      for (int k = 1; k <= 4 && t - k >= 0; ++k) hp[t] -= d[k-1] * hp[t-k];
+    }
+    for (int t = 1; t <= radius; ++t) {
+      if (t <= 4) hp[-t] = m[t-1];
+      for (int k = 1; k <= 4 && t - k >= 1; ++k) hp[-t] -= d[k-1] * hp[k-t];
+    }
+    if (order == 1) {
+      // Response to linear function f(x) = x is one
+      double sum = 0.;
+      for (int t = -radius; t <= radius; ++t) sum -= t * hp[t];
+      B = 1. / sum;
+    } else {
+      // The second moment is dominated by the tails of the impulse response,
+      // hence fit the gain to the sampled second derivative of the Gaussian
+      const double var = sigma * sigma;
+      const double norm = 1. / (sqrt(two_pi) * sigma * var);
+      double num = 0., den = 0., g;
+      for (int t = -radius; t <= radius; ++t) {
+        g    = norm * (t * t / var - 1.) * exp(-.5 * t * t / var);
+        num += g * hp[t];
+        den += hp[t] * hp[t];
+      }
+      B = num / den;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void RecursiveGaussian(const RecursiveGaussianCoefficients &f,
+                       double *v, const double *r, int n, int m,
+                       bool extend, double *tmp)
+{
+  const double &n0 = f.n[0], &n1 = f.n[1], &n2 = f.n[2], &n3 = f.n[3];
+  const double &m0 = f.m[0], &m1 = f.m[1], &m2 = f.m[2], &m3 = f.m[3];
+  const double &d0 = f.d[0], &d1 = f.d[1], &d2 = f.d[2], &d3 = f.d[3];
+  double * const x1 = tmp,          * const x2 = tmp +     n;
+  double * const x3 = tmp + 2 * n,  * const x4 = tmp + 3 * n;
+  double * const y1 = tmp + 4 * n,  * const y2 = tmp + 5 * n;
+  double * const y3 = tmp + 6 * n,  * const y4 = tmp + 7 * n;
+  double * const ones = tmp + 8 * n, * const yp = tmp + 9 * n;
+  double y;
+  // Steady state output of causal and anti-causal filter for constant input
+  const double sd = 1. + d0 + d1 + d2 + d3;
+  const double sn = (n0 + n1 + n2 + n3) / sd;
+  const double sm = (m0 + m1 + m2 + m3) / sd;
+  if (r == nullptr) {
+    for (int p = 0; p < n; ++p) ones[p] = 1.;
+  }
+  memset(tmp, 0, 8 * n * sizeof(double));
+  // Causal filter, filter state is reset at entries with zero link weight
+  for (int q = 0; q < m; ++q) {
+    const double *x  = v + q * n;
+    const double *rq = (r ? r + q * n : ones);
+    double       *o  = yp + q * n;
+    if (extend) {
+      for (int p = 0; p < n; ++p) {
+        if (q == 0 || (r && r[(q - 1) * n + p] == .0)) {
+          x1[p] = x2[p] = x3[p] = x[p];
+          y1[p] = y2[p] = y3[p] = y4[p] = sn * x[p];
+        }
+      }
+    }
+    for (int p = 0; p < n; ++p) {
+      y = rq[p] * (n0 * x[p] + n1 * x1[p] + n2 * x2[p] + n3 * x3[p]
+                 - d0 * y1[p] - d1 * y2[p] - d2 * y3[p] - d3 * y4[p]);
+      x3[p] = rq[p] * x2[p], x2[p] = rq[p] * x1[p], x1[p] = rq[p] * x[p];
+      y4[p] = rq[p] * y3[p], y3[p] = rq[p] * y2[p], y2[p] = rq[p] * y1[p];
+      y1[p] = o[p] = y;
+    }
+  }
+  memset(tmp, 0, 8 * n * sizeof(double));
+  // Anti-causal filter and sum of both filter outputs
+  for (int q = m - 1; q >= 0; --q) {
+    double       *x  = v + q * n;
+    const double *rq = (r ? r + q * n : ones);
+    const double *o  = yp + q * n;
+    if (extend) {
+      for (int p = 0; p < n; ++p) {
+        if (q == m - 1 || (r && r[(q + 1) * n + p] == .0)) {
+          x1[p] = x2[p] = x3[p] = x4[p] = x[p];
+          y1[p] = y2[p] = y3[p] = y4[p] = sm * x[p];
+        }
+      }
+    }
+    for (int p = 0; p < n; ++p) {
+      y = rq[p] * (m0 * x1[p] + m1 * x2[p] + m2 * x3[p] + m3 * x4[p]
+                 - d0 * y1[p] - d1 * y2[p] - d2 * y3[p] - d3 * y4[p]);
+      x4[p] = rq[p] * x3[p], x3[p] = rq[p] * x2[p], x2[p] = rq[p] * x1[p], x1[p] = rq[p] * x[p];
+      y4[p] = rq[p] * y3[p], y3[p] = rq[p] * y2[p], y2[p] = rq[p] * y1[p], y1[p] = y;
+      x[p] = f.B * (o[p] + y);
+    }
+  }
+}
+
+// =============================================================================
+// Gaussian derivatives
+// =============================================================================
+
+namespace {
+
+
+// -----------------------------------------------------------------------------
+/// Sampled Gaussian (derivative) kernel, see RecursiveGaussianCoefficients
+Array<double> GaussianKernel(double sigma, int order)
+{
+  const int    radius = max(1, ifloor(3. * sigma));
+  const double var    = sigma * sigma;
+  Array<double> kernel(2 * radius + 1);
+  double sum = 0., g;
+  for (int t = -radius; t <= radius; ++t) {
+    g = exp(-.5 * t * t / var);
+    kernel[radius + t] = g;
+    sum += g;
+  }
+  // Kernel is applied as correlation, i.e., k[radius + t] = h(-t)
+  for (int t = -radius; t <= radius; ++t) {
+    g = kernel[radius + t] / sum;
+    if      (order == 1) g *= t / var;
+    else if (order == 2) g *= t * t / (var * var) - 1. / var;
+    kernel[radius + t] = g;
+  }
+  if (order == 1) {
+    // Response to linear function f(x) = x is one
+    sum = 0.;
+    for (int t = -radius; t <= radius; ++t) sum += t * kernel[radius + t];
+    for (int t = -radius; t <= radius; ++t) kernel[radius + t] /= sum;
+  } else if (order == 2) {
+    // Response to constant function is zero
+    sum = 0.;
+    for (int t = -radius; t <= radius; ++t) sum += kernel[radius + t];
+    for (int t = -radius; t <= radius; ++t) kernel[radius + t] -= sum / (2 * radius + 1);
+  }
+  return kernel;
+}
+
+// -----------------------------------------------------------------------------
+/// Filter slabs of image lines with Gaussian (derivative) kernel
+class FilterLines
+{
+  const ImageLineSlabs                *_Slabs;
+  double                              *_Data;
+  const double                        *_Foreground;
+  const RecursiveGaussianCoefficients *_Filter;
+  const Array<double>                 *_Kernel;
+
+public:
+
+  FilterLines(const ImageLineSlabs *slabs, double *data, const double *fg,
+              const RecursiveGaussianCoefficients *filter, const Array<double> *kernel)
+  :
+    _Slabs(slabs), _Data(data), _Foreground(fg), _Filter(filter), _Kernel(kernel)
+  {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int n = _Slabs->Lines(), m = _Slabs->Length();
+    double *v, *c = nullptr, *tmp;
+    Allocate(v, n * m);
+    Allocate(tmp, LineFilterBufferSize(n, m));
+    if (_Foreground) Allocate(c, n * m);
+    for (int s = re.begin(); s != re.end(); ++s) {
+      const int offset = _Slabs->Offset(s);
+      for (int q = 0, i = 0; q < m; ++q)
+      for (int p = 0; p < n; ++p, ++i) {
+        const int idx = _Slabs->Index(offset, p, q);
+        v[i] = _Data[idx];
+        if (c) c[i] = _Foreground[idx];
+      }
+      if (_Filter) {
+        RecursiveGaussian(*_Filter, v, c, n, m, true, tmp);
+      } else {
+        const int radius = static_cast<int>(_Kernel->size()) / 2;
+        ConvolveLines(_Kernel->data(), radius, v, c, n, m, true, tmp);
+      }
+      for (int q = 0, i = 0; q < m; ++q)
+      for (int p = 0; p < n; ++p, ++i) {
+        _Data[_Slabs->Index(offset, p, q)] = v[i];
+      }
+    }
+    Deallocate(v);
+    Deallocate(c);
+    Deallocate(tmp);
+  }
+};
+
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+void GaussianDerivative(GenericImage<double> &image, const double *fg,
+                        const double sigma[3], const int order[3])
+{
+  const int dims[4] = {image.X(), image.Y(), image.Z(), image.T()};
+  for (int dim = 0; dim < 3; ++dim) {
+    if (order[dim] == 0 && sigma[dim] <= 0.) continue;
+    if (dims[dim] == 1) {
+      // Derivative along dimension of size one is zero
+      if (order[dim] > 0) image = 0.;
+      continue;
+    }
+    const double s = max(sigma[dim], .5);
+    UniquePtr<RecursiveGaussianCoefficients> filter;
+    Array<double> kernel;
+    if (s >= MinRecursiveSigma) {
+      filter.reset(new RecursiveGaussianCoefficients(s, order[dim]));
+    } else {
+      kernel = GaussianKernel(s, order[dim]);
+    }
+    ImageLineSlabs slabs(dims, dim);
+    FilterLines body(&slabs, image.Data(), fg, filter.get(), &kernel);
+    parallel_for(blocked_range<int>(0, slabs.NumberOfSlabs()), body);
+  }
+}
+
+
+} } // namespace mirtk::ImageLineUtils
@@ -0,0 +1,256 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2017 Imperial College London
+ * Copyright 2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_ImageLineUtils_H
+#define MIRTK_ImageLineUtils_H
+
+#include "mirtk/GenericImage.h"
+
+
+namespace mirtk {
+namespace ImageLineUtils {
+
+
+// =============================================================================
+// Slabs of image lines
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Partition of image into slabs of neighboring lines along one dimension
+///
+/// A slab contains all lines along the filtered dimension which lie in the
+/// same plane of the image, e.g., all lines along the x axis within a slice
+/// when filtering along x. Separable filters copy each slab to a buffer such
+/// that the values of all lines at the same position are contiguous in
+/// memory and process the lines of a slab simultaneously.
+class ImageLineSlabs
+{
+  int _Lines;      ///< Number of lines per slab
+  int _Length;     ///< Length of lines
+  int _LineStride; ///< Offset between lines
+  int _Stride;     ///< Offset between line values
+  int _Period;     ///< Number of slabs with contiguous offsets
+  int _Offset[2];  ///< Offsets between slabs
+  int _Slabs;      ///< Total number of slabs
+
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] dims Image size in each dimension.
+  /// \param[in] dim  Dimension along which image lines are oriented.
+  ImageLineSlabs(const int dims[4], int dim)
+  {
+    const int X = dims[0], Y = dims[1], Z = dims[2], T = dims[3];
+    switch (dim) {
+      case 0:
+        _Lines  = Y, _Length = X, _LineStride = X, _Stride = 1;
+        _Period = Z * T, _Offset[0] = X * Y, _Offset[1] = 0;
+        break;
+      case 1:
+        _Lines  = X, _Length = Y, _LineStride = 1, _Stride = X;
+        _Period = Z * T, _Offset[0] = X * Y, _Offset[1] = 0;
+        break;
+      case 2:
+        _Lines  = X, _Length = Z, _LineStride = 1, _Stride = X * Y;
+        _Period = Y, _Offset[0] = X, _Offset[1] = X * Y * Z;
+        break;
+      default:
+        _Lines  = X, _Length = T, _LineStride = 1, _Stride = X * Y * Z;
+        _Period = Y * Z, _Offset[0] = X, _Offset[1] = 0;
+        break;
+    }
+    _Slabs = (X * Y * Z * T) / (_Lines * _Length);
+  }
+
+  /// Number of slabs
+  int NumberOfSlabs() const { return _Slabs; }
+
+  /// Number of lines per slab
+  int Lines() const { return _Lines; }
+
+  /// Number of values per line
+  int Length() const { return _Length; }
+
+  /// Index of first voxel of s-th slab
+  int Offset(int s) const
+  {
+    return (s % _Period) * _Offset[0] + (s / _Period) * _Offset[1];
+  }
+
+  /// Index of q-th value of p-th line of slab starting at the given offset
+  int Index(int offset, int p, int q) const
+  {
+    return offset + p * _LineStride + q * _Stride;
+  }
+};
+
+// =============================================================================
+// Recursive Gaussian filter
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Minimum standard deviation in voxel units for which recursive filter is used
+const double MinRecursiveSigma = 1.0;
+
+// -----------------------------------------------------------------------------
+/// Coefficients of fourth order recursive Gaussian (derivative) filter of Deriche (1993)
+///
+/// The causal filter is y+[n] = sum_{k=0}^{3} n_k x[n-k] - sum_{k=1}^{4} d_k y+[n-k]
+/// and the anti-causal filter y-[n] = sum_{k=1}^{4} m_k x[n+k] - sum_{k=1}^{4} d_k y-[n+k].
+/// The filter output is the scaled sum of both, y[n] = B (y+[n] + y-[n]).
+struct RecursiveGaussianCoefficients
+{
+  double B;    ///< Gain of filter
+  double n[4]; ///< Feedforward coefficients of causal filter
+  double m[4]; ///< Feedforward coefficients of anti-causal filter
+  double d[4]; ///< Feedback coefficients
+
+  /// Constructor
+  ///
+  /// \param[in] sigma Standard deviation of Gaussian in voxel units.
+  /// \param[in] order Order of Gaussian derivative, i.e., 0, 1, or 2.
+  RecursiveGaussianCoefficients(double sigma, int order = 0);
+};
+
+// -----------------------------------------------------------------------------
+/// Size of temporary buffer required by line filters
+inline int LineFilterBufferSize(int n, int m)
+{
+  return n * (m + 9);
+}
+
+// -----------------------------------------------------------------------------
+/// Apply recursive Gaussian filter to image lines
+///
+/// Lines are stored in a buffer such that the values of all lines at the
+/// same position are contiguous in memory. The filter is hence applied to
+/// all lines simultaneously, i.e., vectorized across neighboring lines.
+/// A line is split into segments at entries with zero link weight r, which
+/// are filtered independently. Segments are extended beyond their ends
+/// either by zeros or by replicating the first and last value.
+///
+/// \param[in]     f      Filter coefficients.
+/// \param[in,out] v      Buffer of n lines with m values each.
+/// \param[in]     r      Link weights, either 0 or 1, or nullptr if all 1.
+/// \param[in]     n      Number of lines.
+/// \param[in]     m      Length of lines.
+/// \param[in]     extend Whether to replicate boundary values of segments.
+/// \param[in]     tmp    Temporary buffer of size LineFilterBufferSize(n, m).
+void RecursiveGaussian(const RecursiveGaussianCoefficients &f,
+                       double *v, const double *r, int n, int m,
+                       bool extend, double *tmp);
+
+// -----------------------------------------------------------------------------
+/// Convolve image lines with FIR kernel, see RecursiveGaussian for arguments
+///
+/// \param[in] k      Kernel values.
+/// \param[in] radius Radius of kernel, i.e., the kernel has 2 * radius + 1 values.
+template <class TKernel>
+void ConvolveLines(const TKernel *k, int radius,
+                   double *v, const double *r, int n, int m,
+                   bool extend, double *tmp)
+{
+  double *in = tmp, *x = v;
+  memcpy(in, v, n * m * sizeof(double));
+  for (int q = 0; q < m; ++q)
+  for (int p = 0; p < n; ++p, ++x) {
+    const int idx = q * n + p;
+    if (r && r[idx] == .0) {
+      *x = .0;
+      continue;
+    }
+    *x = static_cast<double>(k[radius]) * in[idx];
+    for (int d = 1, i = idx, end = 0; d <= radius; ++d) {
+      if (!end && (q - d < 0 || (r && r[i - n] == .0))) end = 1;
+      if (!end) i -= n;
+      else if (!extend) break;
+      *x += static_cast<double>(k[radius - d]) * in[i];
+    }
+    for (int d = 1, i = idx, end = 0; d <= radius; ++d) {
+      if (!end && (q + d >= m || (r && r[i + n] == .0))) end = 1;
+      if (!end) i += n;
+      else if (!extend) break;
+      *x += static_cast<double>(k[radius + d]) * in[i];
+    }
+  }
+}
+
+// =============================================================================
+// Gaussian derivatives
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Copy image values and determine foreground voxels
+///
+/// Voxels whose value is NaN or not greater than the padding value are
+/// background. The value of background voxels is set to zero in the copy.
+///
+/// \param[in]  input   Input image.
+/// \param[in]  padding Padding value.
+/// \param[out] image   Copy of input image.
+/// \param[out] fg      Foreground indicator for each voxel, either 0 or 1.
+///
+/// \returns Whether any voxel is background.
+template <class TVoxel>
+bool CopyForeground(const GenericImage<TVoxel> &input, double padding,
+                    GenericImage<double> &image, Array<double> &fg)
+{
+  const int n = input.NumberOfVoxels();
+  bool padded = false;
+  image.Initialize(input.Attributes(), input.T());
+  fg.resize(n);
+  for (int idx = 0; idx < n; ++idx) {
+    const double value = static_cast<double>(input.Get(idx));
+    if (IsNaN(value) || value <= padding) {
+      image.Put(idx, 0.);
+      fg[idx] = 0.;
+      padded  = true;
+    } else {
+      image.Put(idx, value);
+      fg[idx] = 1.;
+    }
+  }
+  return padded;
+}
+
+// -----------------------------------------------------------------------------
+/// Compute Gaussian derivative of image in-place
+///
+/// The image is convolved along each of the first three dimensions with
+/// a Gaussian or its first or second derivative, respectively. The recursive
+/// filters of Deriche are used for standard deviations of at least one voxel
+/// and sampled FIR kernels otherwise. Image lines are split into segments at
+/// background voxels, and each segment is extended beyond its ends by
+/// replicating its first and last value. The result is zero at background voxels.
+///
+/// \param[in,out] image Scalar or multi-channel image with zero background values.
+/// \param[in]     fg    Foreground indicator for each voxel, either 0 or 1,
+///                      or nullptr if all voxels are foreground.
+/// \param[in]     sigma Standard deviation of Gaussian in voxel units along
+///                      each dimension. Dimensions with zero sigma and zero
+///                      derivative order are not filtered.
+/// \param[in]     order Derivative order along each dimension.
+void GaussianDerivative(GenericImage<double> &image, const double *fg,
+                        const double sigma[3], const int order[3]);
+
+
+} } // namespace mirtk::ImageLineUtils
+
+#endif // MIRTK_ImageLineUtils_H
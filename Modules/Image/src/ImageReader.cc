@@ -20,7 +20,9 @@
 #include "mirtk/ImageReader.h"
 #include "mirtk/ImageReaderFactory.h"
 
+#include "mirtk/Array.h"
 #include "mirtk/Memory.h"
+#include "mirtk/MemoryMappedFile.h"
 #include "mirtk/Voxel.h"
 #include "mirtk/GenericImage.h"
 
@@ -28,6 +30,56 @@
 namespace mirtk {
 
 
+// =============================================================================
+// Global options
+// =============================================================================
+
+MIRTK_Image_EXPORT bool memory_map_images = false;
+
+// =============================================================================
+// Auxiliary functions
+// =============================================================================
+
+namespace ImageReaderUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Create image whose data is the given memory mapped file region
+template <class VoxelType>
+BaseImage *NewMappedImage(const ImageAttributes &attr, const SharedPtr<MemoryMappedFile> &file)
+{
+  const size_t size = static_cast<size_t>(attr.NumberOfLatticePoints()) * sizeof(VoxelType);
+  if (file->Size() != size) return nullptr;
+  UniquePtr<GenericImage<VoxelType> > image(new GenericImage<VoxelType>());
+  image->Initialize(attr, file);
+  return image.release();
+}
+
+// -----------------------------------------------------------------------------
+/// Whether image contains a NaN value
+template <class VoxelType>
+bool ContainsNaN(const VoxelType *data, long n)
+{
+  for (long i = 0; i < n; ++i) {
+    if (IsNaN(data[i])) return true;
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+/// Whether image contains a NaN value
+template <class VoxelType>
+bool ContainsNaN(const BaseImage *image)
+{
+  const VoxelType *data = reinterpret_cast<const VoxelType *>(image->GetDataPointer());
+  return ContainsNaN(data, static_cast<long>(image->GetNumberOfVoxels()));
+}
+
+
+} // namespace ImageReaderUtils
+using namespace ImageReaderUtils;
+
+
 // =============================================================================
 // Factory method
 // =============================================================================
@@ -69,6 +121,7 @@ ImageReader::ImageReader()
   _ReflectZ  = false;
   _Start     = 0;
   _Bytes     = 0;
+  _ContainsNaN = -1;
 }
 
 // -----------------------------------------------------------------------------
@@ -85,6 +138,7 @@ void ImageReader::Initialize()
 {
   // Close old file
   this->Close();
+  _ContainsNaN = -1;
 
   // Open new file for reading
   this->Open(_FileName.c_str());
@@ -99,6 +153,18 @@ BaseImage *ImageReader::Run()
   UniquePtr<BaseImage> output;
   const int n = _Attributes.NumberOfLatticePoints();
 
+  // Determine NaN background from the entire image data read below
+  _ContainsNaN = -1;
+
+  // Map uncompressed image data with native byte order into memory
+  if (memory_map_images && !_Swapped && !this->IsCompressed()) {
+    output.reset(this->MapImageData(this->DataFileName().c_str(), _Start));
+    if (output) {
+      this->Finalize(output.get());
+      return output.release();
+    }
+  }
+
   switch (_DataType) {
     case MIRTK_VOXEL_CHAR: {
         output.reset(new GenericImage<char>(_Attributes));
@@ -146,18 +212,126 @@ BaseImage *ImageReader::Run()
 }
 
 // -----------------------------------------------------------------------------
-void ImageReader::Finalize(BaseImage *output) const
+BaseImage *ImageReader::ReadSlab(int k1, int k2)
 {
-  // If image contains NaNs, set background value to NaN
-  if (_DataType == MIRTK_VOXEL_FLOAT || _DataType == MIRTK_VOXEL_DOUBLE) {
-    const int n = output->GetNumberOfVoxels();
-    for (int i = 0; i < n; ++i) {
-      if (IsNaN(output->GetAsDouble(i))) {
-        output->PutBackgroundValueAsDouble(numeric_limits<double>::quiet_NaN());
-        break;
+  if (k1 < 0 || k2 < k1 || k2 >= _Attributes._z) {
+    cerr << this->NameOfClass() << "::ReadSlab: Slice indices out of range" << endl;
+    exit(1);
+  }
+
+  // Attributes of image slab
+  ImageAttributes attr = _Attributes;
+  double x1 = 0., y1 = 0., z1 = k1;
+  _Attributes.LatticeToWorld(x1, y1, z1);
+  attr._z = k2 - k1 + 1;
+  attr._xorigin = attr._yorigin = attr._zorigin = 0.;
+  double x2 = 0., y2 = 0., z2 = 0.;
+  attr.LatticeToWorld(x2, y2, z2);
+  attr._xorigin = x1 - x2;
+  attr._yorigin = y1 - y2;
+  attr._zorigin = z1 - z2;
+
+  // Slices stored in file are in reverse order when z axis is reflected
+  const int  k  = (_ReflectZ ? _Attributes._z - 1 - k2 : k1);
+  const long m  = static_cast<long>(_Attributes._x) * static_cast<long>(_Attributes._y);
+  const long n  = m * static_cast<long>(attr._z);
+  const long nz = m * static_cast<long>(_Attributes._z);
+
+  // Background of every slab is NaN when any voxel of the image is NaN
+  this->DataContainsNaN();
+
+  UniquePtr<BaseImage> output(BaseImage::New(_DataType));
+  output->Initialize(attr);
+  char *data = reinterpret_cast<char *>(output->GetDataPointer());
+  for (int l = 0; l < attr._t; ++l, data += n * _Bytes) {
+    const long offset = _Start + (l * nz + k * m) * _Bytes;
+    switch (_DataType) {
+      case MIRTK_VOXEL_CHAR:           this->ReadAsChar  (data, n, offset); break;
+      case MIRTK_VOXEL_UNSIGNED_CHAR:  this->ReadAsUChar (reinterpret_cast<unsigned char  *>(data), n, offset); break;
+      case MIRTK_VOXEL_SHORT:          this->ReadAsShort (reinterpret_cast<short          *>(data), n, offset); break;
+      case MIRTK_VOXEL_UNSIGNED_SHORT: this->ReadAsUShort(reinterpret_cast<unsigned short *>(data), n, offset); break;
+      case MIRTK_VOXEL_INT:            this->ReadAsInt   (reinterpret_cast<int            *>(data), n, offset); break;
+      case MIRTK_VOXEL_FLOAT:          this->ReadAsFloat (reinterpret_cast<float          *>(data), n, offset); break;
+      case MIRTK_VOXEL_DOUBLE:         this->ReadAsDouble(reinterpret_cast<double         *>(data), n, offset); break;
+      default:
+        cerr << this->NameOfClass() << "::ReadSlab: Unsupported voxel type" << endl;
+        exit(1);
+    }
+  }
+
+  this->Finalize(output.get());
+
+  return output.release();
+}
+
+// -----------------------------------------------------------------------------
+string ImageReader::DataFileName() const
+{
+  return _FileName;
+}
+
+// -----------------------------------------------------------------------------
+BaseImage *ImageReader::MapImageData(const char *fname, long offset) const
+{
+  const int n = _Attributes.NumberOfLatticePoints();
+  if (n <= 0 || _Bytes <= 0 || offset < 0) return nullptr;
+  // Reflection would write to and thereby copy every page of the file
+  if (_ReflectX || _ReflectY || _ReflectZ) return nullptr;
+  // Mapped voxels must be aligned in memory
+  if (offset % _Bytes != 0) return nullptr;
+  const size_t size = static_cast<size_t>(n) * static_cast<size_t>(_Bytes);
+  SharedPtr<MemoryMappedFile> file = NewShared<MemoryMappedFile>();
+  if (!file->Open(fname, static_cast<size_t>(offset), size, MemoryMappedFile::CopyOnWrite)) {
+    return nullptr;
+  }
+  switch (_DataType) {
+    case MIRTK_VOXEL_CHAR:           return NewMappedImage<char>          (_Attributes, file);
+    case MIRTK_VOXEL_UNSIGNED_CHAR:  return NewMappedImage<unsigned char> (_Attributes, file);
+    case MIRTK_VOXEL_SHORT:          return NewMappedImage<short>         (_Attributes, file);
+    case MIRTK_VOXEL_UNSIGNED_SHORT: return NewMappedImage<unsigned short>(_Attributes, file);
+    case MIRTK_VOXEL_INT:            return NewMappedImage<int>           (_Attributes, file);
+    case MIRTK_VOXEL_FLOAT:          return NewMappedImage<float>         (_Attributes, file);
+    case MIRTK_VOXEL_DOUBLE:         return NewMappedImage<double>        (_Attributes, file);
+    default:                         return nullptr;
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool ImageReader::DataContainsNaN()
+{
+  if (_ContainsNaN < 0) {
+    _ContainsNaN = 0;
+    if (_DataType == MIRTK_VOXEL_FLOAT || _DataType == MIRTK_VOXEL_DOUBLE) {
+      const long m = static_cast<long>(_Attributes._x) * static_cast<long>(_Attributes._y);
+      const long n = static_cast<long>(_Attributes._z) * static_cast<long>(_Attributes._t);
+      Array<char> slice(m * _Bytes);
+      for (long k = 0; k < n && _ContainsNaN == 0; ++k) {
+        const long offset = _Start + k * m * _Bytes;
+        if (_DataType == MIRTK_VOXEL_FLOAT) {
+          float *data = reinterpret_cast<float *>(slice.data());
+          this->ReadAsFloat(data, m, offset);
+          _ContainsNaN = (ContainsNaN(data, m) ? 1 : 0);
+        } else {
+          double *data = reinterpret_cast<double *>(slice.data());
+          this->ReadAsDouble(data, m, offset);
+          _ContainsNaN = (ContainsNaN(data, m) ? 1 : 0);
+        }
       }
     }
   }
+  return _ContainsNaN != 0;
+}
+
+// -----------------------------------------------------------------------------
+void ImageReader::Finalize(BaseImage *output)
+{
+  // If image contains NaNs, set background value to NaN
+  if (_ContainsNaN < 0) {
+    if      (_DataType == MIRTK_VOXEL_FLOAT)  _ContainsNaN = (ContainsNaN<float >(output) ? 1 : 0);
+    else if (_DataType == MIRTK_VOXEL_DOUBLE) _ContainsNaN = (ContainsNaN<double>(output) ? 1 : 0);
+    else                                      _ContainsNaN = 0;
+  }
+  if (_ContainsNaN) output->PutBackgroundValueAsDouble(numeric_limits<double>::quiet_NaN());
   // Optionally reflect image axes
   if (_ReflectX) output->ReflectX();
   if (_ReflectY) output->ReflectY();
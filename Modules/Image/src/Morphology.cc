@@ -0,0 +1,554 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/Morphology.h"
+
+#include "mirtk/Memory.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/Profiling.h"
+#include "mirtk/BinaryVoxelFunction.h"
+#include "mirtk/EuclideanDistanceTransform.h"
+
+#include "ImageLineUtils.h"
+
+#include <cstdint>
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace MorphologyUtils {
+
+using namespace ImageLineUtils;
+
+
+/// Word of packed binary image row
+typedef uint64_t Word;
+
+/// Number of bits per word of packed binary image row
+const int BitsPerWord = 64;
+
+// -----------------------------------------------------------------------------
+/// Maximum of two values
+template <class T>
+struct MaxOp
+{
+  static T Identity() { return voxel_limits<T>::min_value(); }
+  T operator ()(T a, T b) const { return (a < b ? b : a); }
+};
+
+// -----------------------------------------------------------------------------
+/// Minimum of two values
+template <class T>
+struct MinOp
+{
+  static T Identity() { return voxel_limits<T>::max_value(); }
+  T operator ()(T a, T b) const { return (b < a ? b : a); }
+};
+
+// -----------------------------------------------------------------------------
+/// Bitwise disjunction of packed binary values
+struct OrOp
+{
+  static Word Identity() { return Word(0); }
+  Word operator ()(Word a, Word b) const { return a | b; }
+};
+
+// -----------------------------------------------------------------------------
+/// Running maximum or minimum along one image dimension
+///
+/// Implements the algorithm of van Herk (1992) and Gil and Werman (1993),
+/// which applies the operator three times per value independent of the
+/// window size. Values outside the image are ignored. The image lines of
+/// a slab of neighboring lines are copied to a buffer such that the values
+/// of all lines at the same position are contiguous in memory.
+template <class T, class Op>
+class RunningExtremum
+{
+  T             *_Data;
+  int            _Radius;
+  ImageLineSlabs _Slabs;
+
+public:
+
+  RunningExtremum(T *data, const int dims[4], int dim, int radius)
+  :
+    _Data(data), _Radius(radius), _Slabs(dims, dim)
+  {}
+
+  /// Number of slabs of lines
+  int NumberOfSlabs() const
+  {
+    return _Slabs.NumberOfSlabs();
+  }
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const Op  op;
+    const T   id = Op::Identity();
+    const int L  = _Slabs.Length();
+    const int n  = _Slabs.Lines(), r = _Radius, w = 2 * r + 1, m = L + 2 * r;
+    T *g, *h;
+    Allocate(g, m * n);
+    Allocate(h, m * n);
+    for (int s = re.begin(); s != re.end(); ++s) {
+      const int offset = _Slabs.Offset(s);
+      // Copy slab to buffer, padded by r identity elements at both ends
+      for (int i = 0; i < r * n; ++i) {
+        g[i] = g[(m - r) * n + i] = id;
+      }
+      for (int q = 0; q < L; ++q) {
+        T *v = g + (q + r) * n;
+        for (int p = 0; p < n; ++p) {
+          v[p] = _Data[_Slabs.Index(offset, p, q)];
+        }
+      }
+      // Backward cumulative extremum within blocks of window size
+      for (int q = m - 1; q >= 0; --q) {
+        const T *v = g + q * n;
+        T       *b = h + q * n;
+        if (q == m - 1 || q % w == w - 1) {
+          memcpy(b, v, n * sizeof(T));
+        } else {
+          for (int p = 0; p < n; ++p) b[p] = op(b[p + n], v[p]);
+        }
+      }
+      // Forward cumulative extremum within blocks of window size
+      for (int q = 1; q < m; ++q) {
+        if (q % w != 0) {
+          T *f = g + q * n;
+          for (int p = 0; p < n; ++p) f[p] = op(f[p - n], f[p]);
+        }
+      }
+      // Extremum of window [q - r, q + r] is combination of both
+      for (int q = 0; q < L; ++q) {
+        const T *b = h + q * n;
+        const T *f = g + (q + 2 * r) * n;
+        for (int p = 0; p < n; ++p) {
+          _Data[_Slabs.Index(offset, p, q)] = op(b[p], f[p]);
+        }
+      }
+    }
+    Deallocate(g);
+    Deallocate(h);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Replace values by extremum within box of given radius along each dimension
+template <class T, class Op>
+void BoxFilter(T *data, const int dims[4], const int radius[3])
+{
+  for (int dim = 0; dim < 3; ++dim) {
+    if (dims[dim] > 1 && radius[dim] > 0) {
+      RunningExtremum<T, Op> filter(data, dims, dim, radius[dim]);
+      parallel_for(blocked_range<int>(0, filter.NumberOfSlabs()), filter);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Copy values of voxels at the boundary of each image frame
+///
+/// These voxels are not modified by the Dilation and Erosion filters.
+template <class TVoxel>
+void CopyBoundary(const GenericImage<TVoxel> &input, GenericImage<TVoxel> &output)
+{
+  const int X = input.X(), Y = input.Y(), Z = input.Z();
+  for (int l = 0; l < input.T(); ++l)
+  for (int k = 0; k < Z; ++k)
+  for (int j = 0; j < Y; ++j) {
+    if (k == 0 || k == Z - 1 || j == 0 || j == Y - 1) {
+      memcpy(output.Data(0, j, k, l), input.Data(0, j, k, l), X * sizeof(TVoxel));
+    } else {
+      output(0,     j, k, l) = input(0,     j, k, l);
+      output(X - 1, j, k, l) = input(X - 1, j, k, l);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Whether all image values are either 0 or 1
+template <class TVoxel>
+bool IsBinary(const GenericImage<TVoxel> &image)
+{
+  const TVoxel *v = image.Data();
+  for (int idx = 0; idx < image.NumberOfVoxels(); ++idx) {
+    if (v[idx] != TVoxel(0) && v[idx] != TVoxel(1)) return false;
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+/// Pack rows of binary image into words, optionally complementing the values
+///
+/// The bits of words beyond the end of an image row are zero.
+template <class TVoxel>
+class PackRows
+{
+  const GenericImage<TVoxel> *_Image;
+  Word                       *_Words;
+  int                         _NumberOfWords;
+  bool                        _Complement;
+
+public:
+
+  PackRows(const GenericImage<TVoxel> *image, Word *words, int nwords, bool complement)
+  :
+    _Image(image), _Words(words), _NumberOfWords(nwords), _Complement(complement)
+  {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int X = _Image->X();
+    for (int row = re.begin(); row != re.end(); ++row) {
+      const TVoxel *v = _Image->Data() + row * X;
+      Word         *w = _Words + row * _NumberOfWords;
+      memset(w, 0, _NumberOfWords * sizeof(Word));
+      for (int i = 0; i < X; ++i) {
+        if ((v[i] != TVoxel(0)) != _Complement) {
+          w[i / BitsPerWord] |= Word(1) << (i % BitsPerWord);
+        }
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Unpack rows of binary image from words, optionally complementing the values
+template <class TVoxel>
+class UnpackRows
+{
+  const Word           *_Words;
+  GenericImage<TVoxel> *_Image;
+  int                   _NumberOfWords;
+  bool                  _Complement;
+
+public:
+
+  UnpackRows(const Word *words, GenericImage<TVoxel> *image, int nwords, bool complement)
+  :
+    _Words(words), _Image(image), _NumberOfWords(nwords), _Complement(complement)
+  {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int X = _Image->X();
+    for (int row = re.begin(); row != re.end(); ++row) {
+      const Word *w = _Words + row * _NumberOfWords;
+      TVoxel     *v = _Image->Data() + row * X;
+      for (int i = 0; i < X; ++i) {
+        const bool bit = (((w[i / BitsPerWord] >> (i % BitsPerWord)) & Word(1)) != 0);
+        v[i] = (bit != _Complement ? TVoxel(1) : TVoxel(0));
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Set bits of words which are beyond the end of an image row to zero
+inline void ClearPadding(Word *w, int X, int nwords)
+{
+  if (X % BitsPerWord != 0) {
+    w[nwords - 1] &= (Word(1) << (X % BitsPerWord)) - Word(1);
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Dilate packed rows of binary image along x by given radius
+///
+/// The disjunction of a window of bits is computed by logarithmic doubling
+/// of the window size, where each step combines the words of a row with the
+/// words shifted by the current window size.
+class DilateRows
+{
+  Word *_Words;
+  int   _X;
+  int   _NumberOfWords;
+  int   _Radius;
+
+  /// Set a[i] |= a[i + s] for all bits i of the array of n words
+  static void OrShifted(Word *a, int n, int s)
+  {
+    const int q = s / BitsPerWord, b = s % BitsPerWord;
+    for (int k = 0; k + q < n; ++k) {
+      Word v = a[k + q] >> b;
+      if (b != 0 && k + q + 1 < n) v |= a[k + q + 1] << (BitsPerWord - b);
+      a[k] |= v;
+    }
+  }
+
+public:
+
+  DilateRows(Word *words, int X, int nwords, int radius)
+  :
+    _Words(words), _X(X), _NumberOfWords(nwords), _Radius(radius)
+  {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int r = _Radius, L = 2 * r + 1;
+    const int n = (_X + 2 * r + BitsPerWord - 1) / BitsPerWord;
+    const int q = r / BitsPerWord, b = r % BitsPerWord;
+    Word *a;
+    Allocate(a, n);
+    for (int row = re.begin(); row != re.end(); ++row) {
+      Word *w = _Words + row * _NumberOfWords;
+      // Copy row to buffer, padded by r zero bits at both ends
+      memset(a, 0, n * sizeof(Word));
+      for (int k = 0; k < _NumberOfWords; ++k) {
+        a[k + q] |= w[k] << b;
+        if (b != 0 && k + q + 1 < n) a[k + q + 1] |= w[k] >> (BitsPerWord - b);
+      }
+      // Disjunction of window [i, i + L) of padded row, i.e., [i - r, i + r] of row
+      int l = 1;
+      while (2 * l <= L) {
+        OrShifted(a, n, l);
+        l *= 2;
+      }
+      if (l < L) OrShifted(a, n, L - l);
+      memcpy(w, a, _NumberOfWords * sizeof(Word));
+      ClearPadding(w, _X, _NumberOfWords);
+    }
+    Deallocate(a);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Dilate packed binary image by one iteration with given neighborhood
+///
+/// A neighbor at offset (di, dj, dk) is included when |di| + |dj| + |dk| does
+/// not exceed the maximum distance, i.e., 1 for the 4- and 6-neighborhood,
+/// 2 for the 18-neighborhood, and 3 for the 26-neighborhood. Voxels at the
+/// boundary of an image frame keep their value.
+class DilateNeighbors
+{
+  const Word *_Input;
+  Word       *_Output;
+  int         _X, _Y, _Z;
+  int         _NumberOfWords;
+  int         _MaxDistance;
+  bool        _InPlane;
+
+public:
+
+  DilateNeighbors(const Word *input, Word *output, int X, int Y, int Z,
+                  int nwords, ConnectivityType connectivity)
+  :
+    _Input(input), _Output(output), _X(X), _Y(Y), _Z(Z), _NumberOfWords(nwords),
+    _InPlane(connectivity == CONNECTIVITY_4)
+  {
+    switch (connectivity) {
+      case CONNECTIVITY_18: _MaxDistance = 2; break;
+      case CONNECTIVITY_26: _MaxDistance = 3; break;
+      default:              _MaxDistance = 1; break;
+    }
+  }
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int W = _NumberOfWords;
+    const int last = (_X - 1) / BitsPerWord;
+    const Word first_bit = Word(1);
+    const Word last_bit  = Word(1) << ((_X - 1) % BitsPerWord);
+    for (int row = re.begin(); row != re.end(); ++row) {
+      const int j = row % _Y, k = (row / _Y) % _Z;
+      const Word *in  = _Input  + row * W;
+      Word       *out = _Output + row * W;
+      if (j == 0 || j == _Y - 1 || k == 0 || k == _Z - 1) {
+        memcpy(out, in, W * sizeof(Word));
+        continue;
+      }
+      memset(out, 0, W * sizeof(Word));
+      for (int dk = -1; dk <= 1; ++dk) {
+        if (_InPlane && dk != 0) continue;
+        for (int dj = -1; dj <= 1; ++dj) {
+          const int d = abs(dj) + abs(dk);
+          if (d > _MaxDistance) continue;
+          const Word *nb = in + (dk * _Y + dj) * W;
+          if (d < _MaxDistance) {
+            for (int kw = 0; kw < W; ++kw) {
+              Word v = nb[kw] | (nb[kw] << 1) | (nb[kw] >> 1);
+              if (kw > 0)     v |= nb[kw - 1] >> (BitsPerWord - 1);
+              if (kw + 1 < W) v |= nb[kw + 1] << (BitsPerWord - 1);
+              out[kw] |= v;
+            }
+          } else {
+            for (int kw = 0; kw < W; ++kw) out[kw] |= nb[kw];
+          }
+        }
+      }
+      out[0]    = (out[0]    & ~first_bit) | (in[0]    & first_bit);
+      out[last] = (out[last] & ~last_bit ) | (in[last] & last_bit );
+      ClearPadding(out, _X, W);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Apply one iteration of morphological operation with given neighborhood
+template <class TVoxel>
+void ApplyNeighborhood(MorphologicalOperation op,
+                       const GenericImage<TVoxel> &input,
+                       GenericImage<TVoxel> &output,
+                       const NeighborhoodOffsets &offsets)
+{
+  const ImageAttributes &attr = input.Attributes();
+  if (op == MO_Dilation) {
+    ParallelForEachVoxel(BinaryVoxelFunction::Dilate(offsets), attr, &input, &output);
+  } else {
+    ParallelForEachVoxel(BinaryVoxelFunction::Erode(offsets), attr, &input, &output);
+  }
+}
+
+
+} // namespace MorphologyUtils
+using namespace MorphologyUtils;
+
+// =============================================================================
+// Morphological operations
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+template <class TVoxel>
+void ApplyMorphologicalOperation(MorphologicalOperation op,
+                                 const GenericImage<TVoxel> &input,
+                                 GenericImage<TVoxel> &output,
+                                 int iterations, ConnectivityType connectivity)
+{
+  MIRTK_START_TIMING();
+
+  const int X = input.X(), Y = input.Y(), Z = input.Z(), T = input.T();
+
+  output = input;
+  // All voxels are at the boundary of an image frame
+  if (iterations <= 0 || X < 3 || Y < 3 || Z < 3) return;
+
+  if (IsBinary(input)) {
+
+    // Erosion is the complement of the dilation of the complement
+    const bool complement = (op == MO_Erosion);
+    const int  nwords     = (X + BitsPerWord - 1) / BitsPerWord;
+    const int  nrows      = Y * Z * T;
+    blocked_range<int> rows(0, nrows);
+    Word *a;
+    Allocate(a, nrows * nwords);
+    parallel_for(rows, PackRows<TVoxel>(&input, a, nwords, complement));
+    if (connectivity == CONNECTIVITY_26) {
+      const int dims  [4] = {nwords, Y, Z, T};
+      const int radius[3] = {0, iterations, iterations};
+      parallel_for(rows, DilateRows(a, X, nwords, iterations));
+      BoxFilter<Word, OrOp>(a, dims, radius);
+    } else {
+      Word *b;
+      Allocate(b, nrows * nwords);
+      for (int n = 0; n < iterations; ++n) {
+        parallel_for(rows, DilateNeighbors(a, b, X, Y, Z, nwords, connectivity));
+        swap(a, b);
+      }
+      Deallocate(b);
+    }
+    parallel_for(rows, UnpackRows<TVoxel>(a, &output, nwords, complement));
+    Deallocate(a);
+
+  } else if (connectivity == CONNECTIVITY_26) {
+
+    const int dims  [4] = {X, Y, Z, T};
+    const int radius[3] = {iterations, iterations, iterations};
+    if (op == MO_Dilation) {
+      BoxFilter<TVoxel, MaxOp<TVoxel> >(output.Data(), dims, radius);
+    } else {
+      BoxFilter<TVoxel, MinOp<TVoxel> >(output.Data(), dims, radius);
+    }
+
+  } else {
+
+    // Alternate between output and temporary image such that last iteration
+    // writes the output image
+    NeighborhoodOffsets offsets(&input, connectivity);
+    GenericImage<TVoxel> temp(input.Attributes());
+    const GenericImage<TVoxel> *src = &input;
+    GenericImage<TVoxel>       *dst = (iterations % 2 == 1 ? &output : &temp);
+    for (int n = 0; n < iterations; ++n) {
+      ApplyNeighborhood(op, *src, *dst, offsets);
+      src = dst;
+      dst = (dst == &output ? &temp : &output);
+    }
+
+  }
+  CopyBoundary(input, output);
+
+  MIRTK_DEBUG_TIMING(5, (op == MO_Dilation ? "dilation" : "erosion")
+                     << " with " << iterations << " iteration(s)");
+}
+
+// -----------------------------------------------------------------------------
+template <class TVoxel>
+void ApplyMorphologicalOperation(MorphologicalOperation op,
+                                 const GenericImage<TVoxel> &input,
+                                 GenericImage<TVoxel> &output,
+                                 double radius)
+{
+  typedef EuclideanDistanceTransform<RealPixel> DistanceTransform;
+
+  MIRTK_START_TIMING();
+
+  // Squared distance to nearest foreground (dilation) or background (erosion)
+  const bool fg = (op == MO_Dilation);
+  RealImage dmap(input.Attributes());
+  const TVoxel *in = input.Data();
+  RealPixel    *d  = dmap .Data();
+  for (int idx = 0; idx < dmap.NumberOfVoxels(); ++idx) {
+    d[idx] = ((in[idx] != TVoxel(0)) == fg ? RealPixel(1) : RealPixel(0));
+  }
+  DistanceTransform edt(input.Z() > 1 ? DistanceTransform::DT_3D : DistanceTransform::DT_2D);
+  edt.Input (&dmap);
+  edt.Output(&dmap);
+  edt.Run();
+
+  // Threshold distance map
+  const double maxd = radius * radius * (1. + 1e-6);
+  if (&output != &input) output.Initialize(input.Attributes());
+  TVoxel *out = output.Data();
+  d = dmap.Data();
+  for (int idx = 0; idx < dmap.NumberOfVoxels(); ++idx) {
+    out[idx] = ((static_cast<double>(d[idx]) <= maxd) == fg ? TVoxel(1) : TVoxel(0));
+  }
+
+  MIRTK_DEBUG_TIMING(5, (op == MO_Dilation ? "dilation" : "erosion")
+                     << " with ball of radius " << radius);
+}
+
+// =============================================================================
+// Explicit template instantiations
+// =============================================================================
+
+template void ApplyMorphologicalOperation(MorphologicalOperation, const GenericImage<BytePixel> &, GenericImage<BytePixel> &, int, ConnectivityType);
+template void ApplyMorphologicalOperation(MorphologicalOperation, const GenericImage<GreyPixel> &, GenericImage<GreyPixel> &, int, ConnectivityType);
+template void ApplyMorphologicalOperation(MorphologicalOperation, const GenericImage<RealPixel> &, GenericImage<RealPixel> &, int, ConnectivityType);
+template void ApplyMorphologicalOperation(MorphologicalOperation, const GenericImage<BytePixel> &, GenericImage<BytePixel> &, double);
+template void ApplyMorphologicalOperation(MorphologicalOperation, const GenericImage<GreyPixel> &, GenericImage<GreyPixel> &, double);
+template void ApplyMorphologicalOperation(MorphologicalOperation, const GenericImage<RealPixel> &, GenericImage<RealPixel> &, double);
+
+
+} // namespace mirtk
@@ -0,0 +1,180 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gtest/gtest.h"
+
+#include "mirtk/ConnectedComponents.h"
+#include "mirtk/GenericImage.h"
+#include "mirtk/Array.h"
+#include "mirtk/Queue.h"
+#include "mirtk/Random.h"
+
+using namespace mirtk;
+
+// ===========================================================================
+// Auxiliaries
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Test segmentation with two labels and many small components
+GreyImage MakeSegmentation()
+{
+  // Enough slices for the image to be split into several slabs
+  GreyImage image(17, 13, 45);
+  mt19937 rng(42);
+  uniform_int_distribution<int> random(0, 7);
+  for (int idx = 0; idx < image.NumberOfVoxels(); ++idx) {
+    const int r = random(rng);
+    image(idx) = static_cast<GreyPixel>(r < 4 ? 0 : (r < 7 ? 1 : 2));
+  }
+  return image;
+}
+
+// ---------------------------------------------------------------------------
+/// Whether two voxels are neighbors given the connectivity
+bool IsNeighbor(int di, int dj, int dk, ConnectivityType conn)
+{
+  const int n = abs(di) + abs(dj) + abs(dk);
+  if (n == 0) return false;
+  switch (conn) {
+    case CONNECTIVITY_6:  return n == 1;
+    case CONNECTIVITY_18: return n <= 2;
+    default:              return true;
+  }
+}
+
+// ---------------------------------------------------------------------------
+/// Reference labelling by region growing in raster scan order
+GreyImage RegionGrowing(const GreyImage &image, ConnectivityType conn, Array<int> &size)
+{
+  GreyImage labels(image.Attributes());
+  size.clear();
+  GreyPixel label = 0;
+  for (int k = 0; k < image.Z(); ++k)
+  for (int j = 0; j < image.Y(); ++j)
+  for (int i = 0; i < image.X(); ++i) {
+    if (image(i, j, k) == 0 || labels(i, j, k) != 0) continue;
+    size.push_back(0), ++label;
+    Queue<int> active;
+    active.push(image.VoxelToIndex(i, j, k));
+    labels(i, j, k) = label;
+    while (!active.empty()) {
+      int a, b, c;
+      image.IndexToVoxel(active.front(), a, b, c);
+      active.pop();
+      size.back() += 1;
+      for (int dk = -1; dk <= 1; ++dk)
+      for (int dj = -1; dj <= 1; ++dj)
+      for (int di = -1; di <= 1; ++di) {
+        if (!IsNeighbor(di, dj, dk, conn)) continue;
+        if (!image.IsInside(a + di, b + dj, c + dk)) continue;
+        if (image(a + di, b + dj, c + dk) != image(a, b, c)) continue;
+        if (labels(a + di, b + dj, c + dk) != 0) continue;
+        labels(a + di, b + dj, c + dk) = label;
+        active.push(image.VoxelToIndex(a + di, b + dj, c + dk));
+      }
+    }
+  }
+  return labels;
+}
+
+// ---------------------------------------------------------------------------
+/// Compare labelling to reference region growing result
+void CompareToRegionGrowing(ConnectivityType conn)
+{
+  GreyImage image = MakeSegmentation(), labels;
+  Array<int> size;
+  GreyImage expected = RegionGrowing(image, conn, size);
+  ConnectedComponents<GreyPixel> cc(CC_NoOrdering, conn);
+  cc.Input (&image);
+  cc.Output(&labels);
+  cc.Run();
+  ASSERT_EQ(static_cast<int>(size.size()), cc.NumberOfComponents());
+  for (int idx = 0; idx < image.NumberOfVoxels(); ++idx) {
+    ASSERT_EQ(expected(idx), labels(idx)) << "voxel index " << idx;
+  }
+  for (int c = 1; c <= cc.NumberOfComponents(); ++c) {
+    EXPECT_EQ(size[c-1], cc.ComponentSize(c));
+  }
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(ConnectedComponents, Connectivity6)
+{
+  CompareToRegionGrowing(CONNECTIVITY_6);
+}
+
+// ---------------------------------------------------------------------------
+TEST(ConnectedComponents, Connectivity18)
+{
+  CompareToRegionGrowing(CONNECTIVITY_18);
+}
+
+// ---------------------------------------------------------------------------
+TEST(ConnectedComponents, Connectivity26)
+{
+  CompareToRegionGrowing(CONNECTIVITY_26);
+}
+
+// ---------------------------------------------------------------------------
+TEST(ConnectedComponents, Statistics)
+{
+  GenericImage<unsigned short> image(10, 8, 20), labels;
+  for (int k = 2; k <= 15; ++k)
+  for (int j = 1; j <= 3; ++j)
+  for (int i = 0; i <= 1; ++i) {
+    image(i, j, k) = 7;
+  }
+  image(9, 7, 19) = 7; // not connected to first voxel of next row
+  image(0, 0,  0) = 7;
+  ConnectedComponents<unsigned short> cc(CC_LargestFirst, CONNECTIVITY_26);
+  cc.Input (&image);
+  cc.Output(&labels);
+  cc.Run();
+  ASSERT_EQ(3, cc.NumberOfComponents());
+  const ConnectedComponent &comp = cc.Component(1);
+  EXPECT_EQ(84, comp.Size);
+  EXPECT_EQ( 0, comp.Bounds[0]);
+  EXPECT_EQ( 1, comp.Bounds[1]);
+  EXPECT_EQ( 1, comp.Bounds[2]);
+  EXPECT_EQ( 3, comp.Bounds[3]);
+  EXPECT_EQ( 2, comp.Bounds[4]);
+  EXPECT_EQ(15, comp.Bounds[5]);
+  EXPECT_DOUBLE_EQ(0.5, comp.Centroid[0]);
+  EXPECT_DOUBLE_EQ(2.0, comp.Centroid[1]);
+  EXPECT_DOUBLE_EQ(8.5, comp.Centroid[2]);
+  EXPECT_EQ(1, labels(1, 3, 15));
+  EXPECT_EQ(1, cc.ComponentSize(2));
+  EXPECT_EQ(1, cc.ComponentSize(3));
+  EXPECT_NE(labels(9, 7, 19), labels(0, 0, 0));
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,112 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include "mirtk/EuclideanDistanceTransform.h"
+#include "mirtk/GenericImage.h"
+#include "mirtk/Math.h"
+
+using namespace mirtk;
+
+typedef EuclideanDistanceTransform<RealPixel> DistanceTransform;
+
+// ===========================================================================
+// Auxiliaries
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Test object with anisotropic voxel size
+RealImage MakeObject()
+{
+  ImageAttributes attr(9, 8, 7, 1., 1.5, 2.);
+  RealImage image(attr);
+  for (int k = 0; k < image.Z(); ++k)
+  for (int j = 0; j < image.Y(); ++j)
+  for (int i = 0; i < image.X(); ++i) {
+    if ((3 <= i && i <= 5 && 2 <= j && j <= 5 && 2 <= k && k <= 4) || (i == 7 && j == 1 && k == 5)) {
+      image(i, j, k) = 1;
+    }
+  }
+  return image;
+}
+
+// ---------------------------------------------------------------------------
+/// Brute force distance to nearest voxel with given label
+double Distance(const RealImage &image, int i, int j, int k, bool label)
+{
+  double d, dmin = inf;
+  for (int c = 0; c < image.Z(); ++c)
+  for (int b = 0; b < image.Y(); ++b)
+  for (int a = 0; a < image.X(); ++a) {
+    if ((image(a, b, c) != 0) == label) {
+      d = pow((a - i) * image.XSize(), 2) + pow((b - j) * image.YSize(), 2) + pow((c - k) * image.ZSize(), 2);
+      if (d < dmin) dmin = d;
+    }
+  }
+  return sqrt(dmin);
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(EuclideanDistanceTransform, Distance)
+{
+  RealImage image = MakeObject(), dmap;
+  DistanceTransform edt(DistanceTransform::DT_3D);
+  edt.OutputDistance(DistanceTransform::DT_Distance);
+  edt.Input (&image);
+  edt.Output(&dmap);
+  edt.Run();
+  for (int k = 0; k < image.Z(); ++k)
+  for (int j = 0; j < image.Y(); ++j)
+  for (int i = 0; i < image.X(); ++i) {
+    EXPECT_NEAR(Distance(image, i, j, k, true), dmap(i, j, k), 1e-4);
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(EuclideanDistanceTransform, SignedDistance)
+{
+  RealImage image = MakeObject(), dmap(image);
+  DistanceTransform edt(DistanceTransform::DT_3D);
+  edt.OutputDistance(DistanceTransform::DT_SignedDistance);
+  edt.Input (&dmap);
+  edt.Output(&dmap);
+  edt.Run();
+  for (int k = 0; k < image.Z(); ++k)
+  for (int j = 0; j < image.Y(); ++j)
+  for (int i = 0; i < image.X(); ++i) {
+    const double d = Distance(image, i, j, k, true) - Distance(image, i, j, k, false);
+    EXPECT_NEAR(d, dmap(i, j, k), 1e-4);
+  }
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,245 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2017 Imperial College London
+ * Copyright 2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include "mirtk/GenericImage.h"
+#include "mirtk/Random.h"
+#include "mirtk/FastCubicBSplineInterpolateImageFunction3D.h"
+#include "mirtk/CubicBSplineInterpolateImageFunction3D.h"
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Auxiliaries
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Random multi-channel image
+template <class TVoxel>
+GenericImage<TVoxel> MakeImage(int t, unsigned int seed)
+{
+  GenericImage<TVoxel> image(ImageAttributes(17, 15, 13), t);
+  mt19937 rng(seed);
+  uniform_real_distribution<double> value(-50., 50.);
+  for (int vox = 0; vox < image.NumberOfVoxels(); ++vox) {
+    image(vox) = static_cast<TVoxel>(value(rng));
+  }
+  return image;
+}
+
+// ---------------------------------------------------------------------------
+/// Random points, where some points lie near the boundary or outside the image
+struct Points
+{
+  Array<double> x, y, z;
+
+  Points(const BaseImage &image, int n, unsigned int seed) : x(n), y(n), z(n)
+  {
+    mt19937 rng(seed);
+    uniform_real_distribution<double> i(-2., image.X() + 2.);
+    uniform_real_distribution<double> j(-2., image.Y() + 2.);
+    uniform_real_distribution<double> k(-2., image.Z() + 2.);
+    for (int p = 0; p < n; ++p) {
+      x[p] = i(rng);
+      y[p] = j(rng);
+      z[p] = k(rng);
+    }
+  }
+
+  /// Keep only points for which no boundary conditions are needed
+  template <class TFunction>
+  void RemoveOutside(const TFunction &f)
+  {
+    size_t m = 0;
+    for (size_t p = 0; p < x.size(); ++p) {
+      if (f.IsInside(x[p], y[p], z[p])) {
+        x[m] = x[p], y[m] = y[p], z[m] = z[p], ++m;
+      }
+    }
+    x.resize(m), y.resize(m), z.resize(m);
+  }
+
+  int Size() const { return static_cast<int>(x.size()); }
+};
+
+// ---------------------------------------------------------------------------
+/// Compare values with relative tolerance
+void ExpectNear(const Array<double> &expected, const Array<double> &actual, double tol, const char *what)
+{
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected[i], actual[i], tol * max(1., abs(expected[i]))) << what << " " << i;
+  }
+}
+
+// ---------------------------------------------------------------------------
+/// Compare vectorized batch evaluation to scalar batch evaluation
+template <class TVoxel>
+void CompareVectorizedToScalar(CubicBSplineBatchMode mode, int t, double tol)
+{
+  typedef GenericFastCubicBSplineInterpolateImageFunction3D<GenericImage<TVoxel> > Function;
+  if (CubicBSplineBatchCPUMode() < mode) {
+    cout << "Skipping test: CPU does not support "
+         << (mode == CubicBSplineBatch_AVX512 ? "AVX-512" : "AVX2")
+         << " instructions" << endl;
+    return;
+  }
+  GenericImage<TVoxel> image = MakeImage<TVoxel>(t, 1u);
+  Function f;
+  f.Input(&image);
+  f.Initialize();
+  Points points(image, 1001, 2u);
+  points.RemoveOutside(f);
+  const int n = points.Size();
+  ASSERT_GT(n, 100);
+  Array<double> v1(n * t), d1(3 * n * t), v2(n * t), d2(3 * n * t), v3(n * t);
+  f.BatchMode(CubicBSplineBatch_Scalar);
+  f.EvaluateWithGradientInside(n, points.x.data(), points.y.data(), points.z.data(), v1.data(), d1.data());
+  f.BatchMode(mode);
+  f.EvaluateWithGradientInside(n, points.x.data(), points.y.data(), points.z.data(), v2.data(), d2.data());
+  f.EvaluateInside(n, points.x.data(), points.y.data(), points.z.data(), v3.data());
+  ExpectNear(v1, v2, tol, "value");
+  ExpectNear(d1, d2, tol, "derivative");
+  ExpectNear(v1, v3, tol, "value without derivatives");
+}
+
+// ---------------------------------------------------------------------------
+/// Compare batch evaluation to evaluation of one point at a time
+template <class TVoxel>
+void CompareBatchToPointwise(CubicBSplineBatchMode mode, int t, double tol)
+{
+  typedef GenericFastCubicBSplineInterpolateImageFunction3D<GenericImage<TVoxel> > Function;
+  GenericImage<TVoxel> image = MakeImage<TVoxel>(t, 3u);
+  Function f;
+  f.Input(&image);
+  f.Initialize();
+  f.BatchMode(mode);
+  const Points points(image, 1001, 4u);
+  const int    n = points.Size();
+  const double *x = points.x.data(), *y = points.y.data(), *z = points.z.data();
+  Array<double> v(n * t), d(3 * n * t), expected_v(n * t), expected_d(3 * n * t);
+  Matrix jac;
+  for (int p = 0; p < n; ++p) {
+    f.Evaluate(expected_v.data() + p * t, x[p], y[p], z[p], 1);
+    for (int l = 0; l < t; ++l) {
+      f.Jacobian3D(jac, x[p], y[p], z[p], l);
+      for (int i = 0; i < 3; ++i) {
+        expected_d[3 * (p * t + l) + i] = jac(0, i);
+      }
+    }
+  }
+  f.Evaluate(n, x, y, z, v.data());
+  ExpectNear(expected_v, v, tol, "value");
+  f.EvaluateWithGradient(n, x, y, z, v.data(), d.data());
+  ExpectNear(expected_v, v, tol, "value");
+  ExpectNear(expected_d, d, tol, "derivative");
+}
+
+// ---------------------------------------------------------------------------
+/// Compare batch evaluation with exact spline weights to evaluation of one point at a time
+template <class TVoxel>
+void CompareExactBatchToPointwise(CubicBSplineBatchMode mode, int t, double tol)
+{
+  typedef GenericCubicBSplineInterpolateImageFunction3D<GenericImage<TVoxel> > Function;
+  GenericImage<TVoxel> image = MakeImage<TVoxel>(t, 5u);
+  Function f;
+  f.Input(&image);
+  f.Initialize();
+  f.BatchMode(mode);
+  const Points points(image, 1001, 6u);
+  const int    n = points.Size();
+  const double *x = points.x.data(), *y = points.y.data(), *z = points.z.data();
+  Array<double> v(n * t), expected_v(n * t);
+  for (int p = 0; p < n; ++p) {
+    f.Evaluate(expected_v.data() + p * t, x[p], y[p], z[p], 1);
+  }
+  f.Evaluate(n, x, y, z, v.data());
+  ExpectNear(expected_v, v, tol, "value");
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(FastCubicBSplineInterpolateImageFunction3D, VectorizedDouble)
+{
+  for (auto mode : {CubicBSplineBatch_AVX2, CubicBSplineBatch_AVX512}) {
+    CompareVectorizedToScalar<double>(mode, 1, 1e-12);
+    CompareVectorizedToScalar<double>(mode, 3, 1e-12);
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(FastCubicBSplineInterpolateImageFunction3D, VectorizedFloat)
+{
+  for (auto mode : {CubicBSplineBatch_AVX2, CubicBSplineBatch_AVX512}) {
+    CompareVectorizedToScalar<float>(mode, 1, 1e-4);
+    CompareVectorizedToScalar<float>(mode, 3, 1e-4);
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(FastCubicBSplineInterpolateImageFunction3D, BatchDouble)
+{
+  for (auto mode : {CubicBSplineBatch_Scalar, CubicBSplineBatch_Default}) {
+    CompareBatchToPointwise<double>(mode, 1, 1e-12);
+    CompareBatchToPointwise<double>(mode, 3, 1e-12);
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(FastCubicBSplineInterpolateImageFunction3D, BatchFloat)
+{
+  for (auto mode : {CubicBSplineBatch_Scalar, CubicBSplineBatch_Default}) {
+    CompareBatchToPointwise<float>(mode, 1, 1e-4);
+    CompareBatchToPointwise<float>(mode, 3, 1e-4);
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(CubicBSplineInterpolateImageFunction3D, BatchDouble)
+{
+  for (auto mode : {CubicBSplineBatch_Scalar, CubicBSplineBatch_AVX2, CubicBSplineBatch_AVX512}) {
+    CompareExactBatchToPointwise<double>(mode, 1, 1e-12);
+    CompareExactBatchToPointwise<double>(mode, 3, 1e-12);
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(CubicBSplineInterpolateImageFunction3D, BatchFloat)
+{
+  for (auto mode : {CubicBSplineBatch_Scalar, CubicBSplineBatch_AVX2, CubicBSplineBatch_AVX512}) {
+    CompareExactBatchToPointwise<float>(mode, 1, 1e-4);
+    CompareExactBatchToPointwise<float>(mode, 3, 1e-4);
+  }
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,318 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2017 Imperial College London
+ * Copyright 2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include "mirtk/GaussianBlurring.h"
+#include "mirtk/GaussianBlurringWithPadding.h"
+#include "mirtk/GradientImageFilter.h"
+#include "mirtk/HessianImageFilter.h"
+#include "mirtk/GenericImage.h"
+#include "mirtk/Math.h"
+#include "mirtk/Random.h"
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Auxiliaries
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Random image with values in [0, 100) and anisotropic voxel size
+RealImage MakeNoise(const ImageAttributes &attr, unsigned int seed = 42u)
+{
+  mt19937 rng(seed);
+  uniform_real_distribution<double> random(0., 100.);
+  RealImage image(attr);
+  for (int vox = 0; vox < image.NumberOfVoxels(); ++vox) {
+    image(vox) = static_cast<RealPixel>(random(rng));
+  }
+  return image;
+}
+
+// ---------------------------------------------------------------------------
+/// Set voxels within sphere and at one image corner to padding value
+void AddPadding(RealImage &image, double padding)
+{
+  const double cx = .6 * image.X(), cy = .4 * image.Y(), cz = .5 * image.Z();
+  const double r  = .25 * image.X();
+  for (int k = 0; k < image.Z(); ++k)
+  for (int j = 0; j < image.Y(); ++j)
+  for (int i = 0; i < image.X(); ++i) {
+    if (pow(i - cx, 2) + pow(j - cy, 2) + pow(k - cz, 2) < r * r || (i < 3 && j < 3)) {
+      image(i, j, k) = static_cast<RealPixel>(padding);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+/// Blur image using either FIR or recursive Gaussian filter
+RealImage Blur(const RealImage &image, double sigma, bool recursive)
+{
+  RealImage output;
+  GaussianBlurring<RealPixel> blur(sigma);
+  blur.Recursive(recursive);
+  blur.Input (&image);
+  blur.Output(&output);
+  blur.Run();
+  return output;
+}
+
+// ---------------------------------------------------------------------------
+/// Blur image ignoring padded voxels using either FIR or recursive Gaussian filter
+RealImage BlurWithPadding(const RealImage &image, double sigma, double padding, bool recursive)
+{
+  RealImage output;
+  GaussianBlurringWithPadding<RealPixel> blur(sigma, static_cast<RealPixel>(padding));
+  blur.Recursive(recursive);
+  blur.Input (&image);
+  blur.Output(&output);
+  blur.Run();
+  return output;
+}
+
+// ---------------------------------------------------------------------------
+/// Smooth test function f(x, y, z) = sin(a x) cos(b y) + c z^2
+struct TestFunction
+{
+  double a, b, c, sigma;
+
+  /// Attenuation of sinusoid with given frequency by Gaussian blurring
+  double Attenuation(double w) const
+  {
+    return exp(-.5 * w * w * sigma * sigma);
+  }
+
+  /// Gradient of Gaussian blurred function
+  void Gradient(double x, double y, double z, double g[3]) const
+  {
+    const double s = Attenuation(a) * Attenuation(b);
+    g[0] =  s * a * cos(a * x) * cos(b * y);
+    g[1] = -s * b * sin(a * x) * sin(b * y);
+    g[2] = 2. * c * z;
+  }
+
+  /// Upper triangle of Hessian of Gaussian blurred function
+  void Hessian(double x, double y, double z, double h[6]) const
+  {
+    const double s = Attenuation(a) * Attenuation(b);
+    h[0] = -s * a * a * sin(a * x) * cos(b * y);
+    h[1] = -s * a * b * cos(a * x) * sin(b * y);
+    h[2] = 0.;
+    h[3] = -s * b * b * sin(a * x) * cos(b * y);
+    h[4] = 0.;
+    h[5] = 2. * c;
+  }
+
+  /// Sample function at image voxels
+  RealImage Sample(const ImageAttributes &attr) const
+  {
+    RealImage image(attr);
+    double x, y, z;
+    for (int k = 0; k < image.Z(); ++k)
+    for (int j = 0; j < image.Y(); ++j)
+    for (int i = 0; i < image.X(); ++i) {
+      x = i, y = j, z = k;
+      image.ImageToWorld(x, y, z);
+      image(i, j, k) = static_cast<RealPixel>(sin(a * x) * cos(b * y) + c * z * z);
+    }
+    return image;
+  }
+};
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(GaussianBlurring, Recursive)
+{
+  ImageAttributes attr(41, 37, 29, 1., 1.25, 1.5);
+  const RealImage image = MakeNoise(attr);
+  // Sigma of 0.9 mm is less than one voxel along y and z, where FIR kernel is used
+  for (double sigma : {.9, 2., 4.5}) {
+    const RealImage expected = Blur(image, sigma, false);
+    const RealImage actual   = Blur(image, sigma, true);
+    ASSERT_TRUE(actual.HasSpatialAttributesOf(&expected));
+    for (int vox = 0; vox < image.NumberOfVoxels(); ++vox) {
+      EXPECT_NEAR(expected(vox), actual(vox), .5) << "sigma=" << sigma << ", voxel " << vox;
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(GaussianBlurring, RecursiveWithPadding)
+{
+  const double padding = -1.;
+  ImageAttributes attr(41, 37, 29, 1., 1.25, 1.5);
+  RealImage image = MakeNoise(attr);
+  AddPadding(image, padding);
+  for (double sigma : {.9, 2., 4.5}) {
+    const RealImage expected = BlurWithPadding(image, sigma, padding, false);
+    const RealImage actual   = BlurWithPadding(image, sigma, padding, true);
+    for (int vox = 0; vox < image.NumberOfVoxels(); ++vox) {
+      if (image(vox) == padding) {
+        EXPECT_EQ(padding, actual(vox)) << "sigma=" << sigma << ", voxel " << vox;
+      } else {
+        EXPECT_NEAR(expected(vox), actual(vox), .5) << "sigma=" << sigma << ", voxel " << vox;
+      }
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(GaussianBlurring, RecursiveConstant)
+{
+  // Normalization at image and foreground boundary preserves constant image
+  const double padding = -1.;
+  ImageAttributes attr(33, 30, 21, 1., 1.25, 1.5);
+  RealImage image(attr);
+  image = 7.;
+  AddPadding(image, padding);
+  const RealImage actual = BlurWithPadding(image, 3., padding, true);
+  for (int vox = 0; vox < image.NumberOfVoxels(); ++vox) {
+    if (image(vox) == padding) {
+      EXPECT_EQ(padding, actual(vox)) << "voxel " << vox;
+    } else {
+      EXPECT_NEAR(7., actual(vox), 1e-4) << "voxel " << vox;
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(GradientImageFilter, GaussianDerivative)
+{
+  ImageAttributes attr(48, 40, 32, 1., 1.2, 1.5);
+  TestFunction f = {two_pi / 16., two_pi / 20., .01, 2.};
+  RealImage image = f.Sample(attr), output;
+  GradientImageFilter<RealPixel> filter(GradientImageFilter<RealPixel>::GRADIENT_VECTOR);
+  filter.Sigma(f.sigma);
+  filter.Input (&image);
+  filter.Output(&output);
+  filter.Run();
+  ASSERT_EQ(3, output.T());
+  // Compare to analytic gradient away from the image boundary
+  const double tol = 1e-2 * f.a;
+  double x, y, z, g[3];
+  for (int k = 8; k < attr._z - 8; ++k)
+  for (int j = 8; j < attr._y - 8; ++j)
+  for (int i = 8; i < attr._x - 8; ++i) {
+    x = i, y = j, z = k;
+    image.ImageToWorld(x, y, z);
+    f.Gradient(x, y, z, g);
+    for (int c = 0; c < 3; ++c) {
+      EXPECT_NEAR(g[c], output(i, j, k, c), tol) << "voxel (" << i << ", " << j << ", " << k << "), component " << c;
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(GradientImageFilter, GaussianDerivative2D)
+{
+  ImageAttributes attr(48, 40, 1, 1., 1.2, 1.);
+  TestFunction f = {two_pi / 16., two_pi / 20., 0., 2.};
+  RealImage image = f.Sample(attr), output;
+  GradientImageFilter<RealPixel> filter(GradientImageFilter<RealPixel>::GRADIENT_VECTOR);
+  filter.Sigma(f.sigma);
+  filter.Input (&image);
+  filter.Output(&output);
+  filter.Run();
+  const double tol = 1e-2 * f.a;
+  double x, y, z, g[3];
+  for (int j = 8; j < attr._y - 8; ++j)
+  for (int i = 8; i < attr._x - 8; ++i) {
+    x = i, y = j, z = 0.;
+    image.ImageToWorld(x, y, z);
+    f.Gradient(x, y, z, g);
+    EXPECT_NEAR(g[0], output(i, j, 0, 0), tol) << "voxel (" << i << ", " << j << ")";
+    EXPECT_NEAR(g[1], output(i, j, 0, 1), tol) << "voxel (" << i << ", " << j << ")";
+    EXPECT_EQ  (0.,   output(i, j, 0, 2))      << "voxel (" << i << ", " << j << ")";
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(GradientImageFilter, GaussianDerivativeWithPadding)
+{
+  // Result is zero at background and only differs near the foreground boundary
+  const double padding = -10.;
+  ImageAttributes attr(48, 40, 32, 1., 1.2, 1.5);
+  TestFunction f = {two_pi / 16., two_pi / 20., .01, 2.};
+  RealImage image = f.Sample(attr), expected, actual;
+  GradientImageFilter<RealPixel> filter(GradientImageFilter<RealPixel>::GRADIENT_VECTOR);
+  filter.Sigma(f.sigma);
+  filter.Input (&image);
+  filter.Output(&expected);
+  filter.Run();
+  for (int k = 0; k < attr._z; ++k)
+  for (int j = 0; j < attr._y; ++j)
+  for (int i = 0; i < 4; ++i) {
+    image(i, j, k) = static_cast<RealPixel>(padding);
+  }
+  filter.PaddingValue(padding);
+  filter.Output(&actual);
+  filter.Run();
+  for (int k = 0; k < attr._z; ++k)
+  for (int j = 0; j < attr._y; ++j)
+  for (int i = 0; i < attr._x; ++i)
+  for (int c = 0; c < 3; ++c) {
+    if (i < 4) {
+      EXPECT_EQ(0., actual(i, j, k, c));
+    } else if (i >= 12) {
+      EXPECT_NEAR(expected(i, j, k, c), actual(i, j, k, c), 1e-3 * f.a);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(HessianImageFilter, GaussianDerivative)
+{
+  ImageAttributes attr(48, 40, 32, 1., 1.2, 1.5);
+  TestFunction f = {two_pi / 16., two_pi / 20., .01, 2.};
+  RealImage image = f.Sample(attr), output;
+  HessianImageFilter<RealPixel> filter(HessianImageFilter<RealPixel>::HESSIAN_VECTOR);
+  filter.Sigma(f.sigma);
+  filter.Input (&image);
+  filter.Output(&output);
+  filter.Run();
+  ASSERT_EQ(6, output.T());
+  const double tol = 2e-2 * f.a * f.a;
+  double x, y, z, h[6];
+  for (int k = 8; k < attr._z - 8; ++k)
+  for (int j = 8; j < attr._y - 8; ++j)
+  for (int i = 8; i < attr._x - 8; ++i) {
+    x = i, y = j, z = k;
+    image.ImageToWorld(x, y, z);
+    f.Hessian(x, y, z, h);
+    for (int c = 0; c < 6; ++c) {
+      EXPECT_NEAR(h[c], output(i, j, k, c), tol) << "voxel (" << i << ", " << j << ", " << k << "), component " << c;
+    }
+  }
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,148 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2015 Imperial College London
+ * Copyright 2013-2015 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include "mirtk/GenericImage.h"
+#include "mirtk/MemoryMappedFile.h"
+
+#include <cstdio>
+
+using namespace mirtk;
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(GenericImage, DataIndex)
+{
+  RealImage image(5, 4, 3, 2);
+  EXPECT_EQ(0, reinterpret_cast<size_t>(image.Data()) % MIRTK_DEFAULT_ALIGNMENT);
+  for (int l = 0; l < 2; ++l)
+  for (int k = 0; k < 3; ++k)
+  for (int j = 0; j < 4; ++j)
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(image.VoxelToIndex(i, j, k, l), image.DataIndex(i, j, k, l));
+    image(i, j, k, l) = image.VoxelToIndex(i, j, k, l);
+  }
+  for (int idx = 0; idx < image.NumberOfVoxels(); ++idx) {
+    EXPECT_EQ(double(idx), image(idx));
+  }
+  RealPixel ****matrix = image.Matrix();
+  ASSERT_TRUE(matrix != nullptr);
+  EXPECT_EQ(image.Data(), matrix[0][0][0]);
+  EXPECT_EQ(image.Data(4, 3, 2, 1), &matrix[1][2][3][4]);
+}
+
+// ---------------------------------------------------------------------------
+TEST(GenericImage, SwapXY)
+{
+  GreyImage image(3, 2, 2);
+  for (int k = 0; k < 2; ++k)
+  for (int j = 0; j < 2; ++j)
+  for (int i = 0; i < 3; ++i) {
+    image(i, j, k) = static_cast<GreyPixel>(100 * k + 10 * j + i);
+  }
+  const GreyPixel *data = image.Data();
+  image.SwapXY();
+  ASSERT_EQ(2, image.X());
+  ASSERT_EQ(3, image.Y());
+  EXPECT_EQ(data, image.Data());
+  for (int k = 0; k < 2; ++k)
+  for (int j = 0; j < 3; ++j)
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(static_cast<GreyPixel>(100 * k + 10 * i + j), image(i, j, k));
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(GenericImage, GetRegion)
+{
+  GreyImage image(4, 3, 2);
+  for (int idx = 0; idx < image.NumberOfVoxels(); ++idx) {
+    image(idx) = static_cast<GreyPixel>(idx);
+  }
+  GreyImage region;
+  image.GetRegion(region, 1, 1, 0, 3, 3, 2);
+  ASSERT_EQ(2, region.X());
+  ASSERT_EQ(2, region.Y());
+  ASSERT_EQ(2, region.Z());
+  for (int k = 0; k < 2; ++k)
+  for (int j = 0; j < 2; ++j)
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(image(i + 1, j + 1, k), region(i, j, k));
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(GenericImage, MemoryMappedData)
+{
+  const char *fname = "testGenericImage_MemoryMappedData.raw";
+  const int   header[3] = {1, 2, 3};
+  short data[4 * 3 * 2];
+  for (int i = 0; i < 24; ++i) data[i] = static_cast<short>(i);
+  FILE *fp = fopen(fname, "wb");
+  ASSERT_TRUE(fp != nullptr);
+  fwrite(header, sizeof(int),   3,  fp);
+  fwrite(data,   sizeof(short), 24, fp);
+  fclose(fp);
+
+  SharedPtr<MemoryMappedFile> file = NewShared<MemoryMappedFile>();
+  ASSERT_TRUE(file->Open(fname, sizeof(header), sizeof(data)));
+  {
+    GenericImage<short> image;
+    image.Initialize(ImageAttributes(4, 3, 2), file);
+    EXPECT_TRUE(image.IsMemoryMapped());
+    for (int k = 0; k < 2; ++k)
+    for (int j = 0; j < 3; ++j)
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_EQ(image.VoxelToIndex(i, j, k), image(i, j, k));
+    }
+    GenericImage<short> copy(image);
+    EXPECT_TRUE(copy.IsMemoryMapped());
+    EXPECT_EQ(image.Data(), copy.Data());
+    image(1, 1, 1) = -1;
+    EXPECT_EQ(-1, copy(1, 1, 1));
+    copy.Initialize(ImageAttributes(2, 2, 2));
+    EXPECT_FALSE(copy.IsMemoryMapped());
+  }
+  file.reset();
+
+  // Copy-on-write mapping must not modify file
+  short value = 0;
+  fp = fopen(fname, "rb");
+  ASSERT_TRUE(fp != nullptr);
+  fseek(fp, sizeof(header) + 17 * sizeof(short), SEEK_SET);
+  EXPECT_EQ(1u, fread(&value, sizeof(short), 1, fp));
+  fclose(fp);
+  remove(fname);
+  EXPECT_EQ(17, value);
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,195 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2017 Imperial College London
+ * Copyright 2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include "mirtk/ImageReader.h"
+#include "mirtk/GenericImage.h"
+#include "mirtk/Memory.h"
+#include "mirtk/Math.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Auxiliaries
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Image attributes of test image with oblique axes and anisotropic voxels
+ImageAttributes MakeAttributes()
+{
+  ImageAttributes attr(7, 5, 11, 3, 1.5, 2., 2.5, 1.);
+  const double c = cos(.3), s = sin(.3);
+  attr._xaxis[0] =  c, attr._xaxis[1] = s, attr._xaxis[2] = 0.;
+  attr._yaxis[0] = -s, attr._yaxis[1] = c, attr._yaxis[2] = 0.;
+  attr._zaxis[0] = 0., attr._zaxis[1] = 0., attr._zaxis[2] = 1.;
+  attr._xorigin = 10., attr._yorigin = -20., attr._zorigin = 30.;
+  return attr;
+}
+
+// ---------------------------------------------------------------------------
+/// Reader of raw single precision voxel data with native byte order
+///
+/// The file starts with a header of fixed size, followed by the voxel data.
+/// When the z axis is reflected, slices are stored in reverse order.
+class RawImageReader : public ImageReader
+{
+  mirtkObjectMacro(RawImageReader);
+
+  ImageAttributes _RawAttributes;
+  bool            _RawReflectZ;
+
+public:
+
+  static const int HeaderSize = 16;
+
+  RawImageReader(const ImageAttributes &attr, bool reflect_z)
+  :
+    _RawAttributes(attr), _RawReflectZ(reflect_z)
+  {}
+
+  bool CanRead(const char *) const { return true; }
+
+protected:
+
+  void ReadHeader()
+  {
+    _Swapped    = false;
+    _Attributes = _RawAttributes;
+    _DataType   = MIRTK_VOXEL_FLOAT;
+    _Bytes      = static_cast<int>(sizeof(float));
+    _Start      = HeaderSize;
+    _ReflectZ   = _RawReflectZ;
+  }
+};
+
+// ---------------------------------------------------------------------------
+/// Write raw image file read by RawImageReader
+///
+/// Voxel values encode the voxel indices. Only one slice near the end of
+/// the last frame contains NaN values, such that most slabs do not.
+void WriteRawImage(const char *fname, const ImageAttributes &attr, bool reflect_z)
+{
+  std::ofstream ofs(fname, std::ios::binary);
+  const char header[RawImageReader::HeaderSize] = {0};
+  ofs.write(header, RawImageReader::HeaderSize);
+  for (int l = 0; l < attr._t; ++l)
+  for (int k = 0; k < attr._z; ++k)
+  for (int j = 0; j < attr._y; ++j)
+  for (int i = 0; i < attr._x; ++i) {
+    const int z = (reflect_z ? attr._z - 1 - k : k);
+    float value = static_cast<float>(((l * attr._z + z) * attr._y + j) * attr._x + i);
+    if (l == attr._t - 1 && z == attr._z - 2 && (i + j) % 3 == 0) value = NaN;
+    ofs.write(reinterpret_cast<const char *>(&value), sizeof(float));
+  }
+  ASSERT_TRUE(ofs.good());
+}
+
+// ---------------------------------------------------------------------------
+/// Compare image read slab by slab to image read by Run
+void CompareSlabsToRun(bool reflect_z, int slab_size)
+{
+  const char *fname = "testImageReader.raw";
+  const ImageAttributes attr = MakeAttributes();
+  WriteRawImage(fname, attr, reflect_z);
+
+  RawImageReader reader(attr, reflect_z);
+  reader.FileName(fname);
+  reader.Initialize();
+  UniquePtr<BaseImage> image(reader.Run());
+  ASSERT_TRUE(image != nullptr);
+  EXPECT_TRUE(image->HasBackgroundValue());
+  EXPECT_TRUE(IsNaN(image->GetBackgroundValueAsDouble()));
+
+  // Fresh reader which did not read the entire image before
+  RawImageReader slab_reader(attr, reflect_z);
+  slab_reader.FileName(fname);
+  slab_reader.Initialize();
+  int nslabs = 0;
+  for (int k1 = 0; k1 < attr._z; k1 += slab_size, ++nslabs) {
+    const int k2 = min(k1 + slab_size, attr._z) - 1;
+    UniquePtr<BaseImage> slab(slab_reader.ReadSlab(k1, k2));
+    ASSERT_TRUE(slab != nullptr);
+    ASSERT_EQ(attr._x,      slab->X());
+    ASSERT_EQ(attr._y,      slab->Y());
+    ASSERT_EQ(k2 - k1 + 1,  slab->Z());
+    ASSERT_EQ(attr._t,      slab->T());
+    EXPECT_TRUE(slab->HasBackgroundValue()) << "slab " << nslabs;
+    EXPECT_TRUE(IsNaN(slab->GetBackgroundValueAsDouble())) << "slab " << nslabs;
+    for (int k = 0; k < slab->Z(); ++k) {
+      double x1 = 0., y1 = 0., z1 = k;
+      double x2 = 0., y2 = 0., z2 = k1 + k;
+      slab ->ImageToWorld(x1, y1, z1);
+      image->ImageToWorld(x2, y2, z2);
+      EXPECT_NEAR(x2, x1, 1e-9) << "slice " << k1 + k;
+      EXPECT_NEAR(y2, y1, 1e-9) << "slice " << k1 + k;
+      EXPECT_NEAR(z2, z1, 1e-9) << "slice " << k1 + k;
+    }
+    for (int l = 0; l < slab->T(); ++l)
+    for (int k = 0; k < slab->Z(); ++k)
+    for (int j = 0; j < slab->Y(); ++j)
+    for (int i = 0; i < slab->X(); ++i) {
+      const double expected = image->GetAsDouble(i, j, k1 + k, l);
+      const double actual   = slab ->GetAsDouble(i, j, k, l);
+      if (IsNaN(expected)) {
+        EXPECT_TRUE(IsNaN(actual)) << "voxel (" << i << ", " << j << ", " << k1 + k << ", " << l << ")";
+      } else {
+        EXPECT_EQ(expected, actual) << "voxel (" << i << ", " << j << ", " << k1 + k << ", " << l << ")";
+      }
+    }
+  }
+  EXPECT_EQ((attr._z + slab_size - 1) / slab_size, nslabs);
+
+  std::remove(fname);
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(ImageReader, ReadSlab)
+{
+  CompareSlabsToRun(false, 1);
+  CompareSlabsToRun(false, 4);
+  CompareSlabsToRun(false, 11);
+}
+
+// ---------------------------------------------------------------------------
+TEST(ImageReader, ReadSlabReflectZ)
+{
+  CompareSlabsToRun(true, 1);
+  CompareSlabsToRun(true, 4);
+  CompareSlabsToRun(true, 11);
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
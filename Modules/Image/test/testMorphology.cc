@@ -0,0 +1,217 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2017 Imperial College London
+ * Copyright 2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+
+#include "mirtk/Morphology.h"
+#include "mirtk/GenericImage.h"
+#include "mirtk/BinaryVoxelFunction.h"
+#include "mirtk/NeighborhoodOffsets.h"
+#include "mirtk/Random.h"
+
+using namespace mirtk;
+
+
+// ===========================================================================
+// Auxiliaries
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+/// Random binary image whose voxels are foreground with given probability
+template <class TVoxel>
+GenericImage<TVoxel> MakeBinary(const ImageAttributes &attr, double p, unsigned int seed)
+{
+  mt19937 rng(seed);
+  uniform_real_distribution<double> random(0., 1.);
+  GenericImage<TVoxel> image(attr);
+  for (int vox = 0; vox < image.NumberOfVoxels(); ++vox) {
+    image(vox) = (random(rng) < p ? TVoxel(1) : TVoxel(0));
+  }
+  return image;
+}
+
+// ---------------------------------------------------------------------------
+/// Random grey value image whose voxels are non-zero with given probability
+template <class TVoxel>
+GenericImage<TVoxel> MakeGrey(const ImageAttributes &attr, double p, unsigned int seed)
+{
+  mt19937 rng(seed);
+  uniform_real_distribution<double> random(0., 1.), value(1., 201.);
+  GenericImage<TVoxel> image(attr);
+  for (int vox = 0; vox < image.NumberOfVoxels(); ++vox) {
+    if (random(rng) < p) {
+      image(vox) = static_cast<TVoxel>(value(rng));
+    } else {
+      image(vox) = TVoxel(0);
+    }
+  }
+  return image;
+}
+
+// ---------------------------------------------------------------------------
+/// Iterate 3x3x3 neighborhood operation as done previously by Dilation and Erosion filters
+template <class TVoxel>
+GenericImage<TVoxel> Iterate(MorphologicalOperation op, const GenericImage<TVoxel> &input,
+                             int iterations, ConnectivityType connectivity)
+{
+  NeighborhoodOffsets offsets(&input, connectivity);
+  GenericImage<TVoxel> image(input), output(input.Attributes());
+  for (int n = 0; n < iterations; ++n) {
+    if (op == MO_Dilation) {
+      ParallelForEachVoxel(BinaryVoxelFunction::Dilate(offsets), image.Attributes(), &image, &output);
+    } else {
+      ParallelForEachVoxel(BinaryVoxelFunction::Erode(offsets), image.Attributes(), &image, &output);
+    }
+    image = output;
+  }
+  return image;
+}
+
+// ---------------------------------------------------------------------------
+/// Compare result of morphological operation to iterated neighborhood operation
+template <class TVoxel>
+void CompareToIterated(const GenericImage<TVoxel> &input)
+{
+  const ConnectivityType connectivity[] = {
+    CONNECTIVITY_4, CONNECTIVITY_6, CONNECTIVITY_18, CONNECTIVITY_26
+  };
+  GenericImage<TVoxel> actual;
+  for (MorphologicalOperation op : {MO_Dilation, MO_Erosion})
+  for (ConnectivityType c : connectivity)
+  for (int n = 1; n <= 10; ++n) {
+    const GenericImage<TVoxel> expected = Iterate(op, input, n, c);
+    ApplyMorphologicalOperation(op, input, actual, n, c);
+    ASSERT_TRUE(actual.HasSpatialAttributesOf(&expected));
+    ASSERT_EQ(expected.T(), actual.T());
+    int mismatches = 0;
+    for (int vox = 0; vox < input.NumberOfVoxels(); ++vox) {
+      if (actual(vox) != expected(vox)) ++mismatches;
+    }
+    EXPECT_EQ(0, mismatches) << (op == MO_Dilation ? "dilation" : "erosion")
+                             << ", connectivity=" << static_cast<int>(c) << ", iterations=" << n;
+  }
+}
+
+// ---------------------------------------------------------------------------
+/// Compare result of ball operation to brute force distance threshold
+template <class TVoxel>
+void CompareToBruteForce(const GenericImage<TVoxel> &input, double radius)
+{
+  const int    n    = input.NumberOfVoxels();
+  const double maxd = radius * radius * (1. + 1e-6);
+  Array<double> x(n), y(n), z(n);
+  for (int vox = 0; vox < n; ++vox) {
+    int i, j, k;
+    input.IndexToVoxel(vox, i, j, k);
+    x[vox] = i * input.XSize();
+    y[vox] = j * input.YSize();
+    z[vox] = k * input.ZSize();
+  }
+  GenericImage<TVoxel> actual;
+  for (MorphologicalOperation op : {MO_Dilation, MO_Erosion}) {
+    ApplyMorphologicalOperation(op, input, actual, radius);
+    ASSERT_TRUE(actual.HasSpatialAttributesOf(&input));
+    // Dilation: any foreground voxel within radius,
+    // Erosion:  no background voxel within radius
+    const bool fg = (op == MO_Dilation);
+    for (int a = 0; a < n; ++a) {
+      bool within = false;
+      for (int b = 0; b < n && !within; ++b) {
+        if ((input(b) != TVoxel(0)) == fg) {
+          const double d = pow(x[a] - x[b], 2) + pow(y[a] - y[b], 2) + pow(z[a] - z[b], 2);
+          within = (d <= maxd);
+        }
+      }
+      const TVoxel expected = (within == fg ? TVoxel(1) : TVoxel(0));
+      EXPECT_EQ(expected, actual(a)) << (fg ? "dilation" : "erosion")
+                                     << ", radius=" << radius << ", voxel " << a;
+    }
+  }
+}
+
+// ===========================================================================
+// Tests
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+TEST(Morphology, Grey)
+{
+  ImageAttributes attr(23, 19, 17);
+  CompareToIterated(MakeGrey<GreyPixel>(attr, .05, 1u));
+  CompareToIterated(MakeGrey<RealPixel>(attr, .95, 2u));
+}
+
+// ---------------------------------------------------------------------------
+TEST(Morphology, Binary)
+{
+  // Image rows span more than one 64-bit word
+  ImageAttributes attr(70, 19, 17);
+  CompareToIterated(MakeBinary<BytePixel>(attr, .02, 3u));
+  CompareToIterated(MakeBinary<BytePixel>(attr, .98, 4u));
+  CompareToIterated(MakeBinary<GreyPixel>(attr, .5,  5u));
+}
+
+// ---------------------------------------------------------------------------
+TEST(Morphology, Image2D)
+{
+  ImageAttributes attr(23, 19, 1);
+  CompareToIterated(MakeGrey  <GreyPixel>(attr, .1, 6u));
+  CompareToIterated(MakeBinary<BytePixel>(attr, .1, 7u));
+}
+
+// ---------------------------------------------------------------------------
+TEST(Morphology, Image4D)
+{
+  ImageAttributes attr(13, 11, 9, 3);
+  CompareToIterated(MakeGrey  <GreyPixel>(attr, .05, 8u));
+  CompareToIterated(MakeBinary<BytePixel>(attr, .05, 9u));
+}
+
+// ---------------------------------------------------------------------------
+TEST(Morphology, Ball)
+{
+  ImageAttributes attr(20, 18, 12, 1., 1.25, 2.);
+  const GreyImage sparse = MakeBinary<GreyPixel>(attr, .01, 10u);
+  const GreyImage dense  = MakeBinary<GreyPixel>(attr, .9,  11u);
+  for (double radius : {1., 2.5, 4.}) {
+    CompareToBruteForce(sparse, radius);
+    CompareToBruteForce(dense,  radius);
+  }
+}
+
+// ---------------------------------------------------------------------------
+TEST(Morphology, Ball2D)
+{
+  ImageAttributes attr(31, 27, 1, 1., 1.5, 1.);
+  const ByteImage mask = MakeBinary<BytePixel>(attr, .03, 12u);
+  for (double radius : {1.5, 3., 5.}) {
+    CompareToBruteForce(mask, radius);
+  }
+}
+
+// ===========================================================================
+// Main
+// ===========================================================================
+
+// ---------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
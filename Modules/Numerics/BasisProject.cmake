@@ -61,7 +61,6 @@ basis_project (
   OPTIONAL_DEPENDS
     ARPACK
     UMFPACK
-    LBFGS
     MATLAB{mwmclmcrrt}
     VTK-8|7|6{vtkCommonCore,vtkCommonDataModel,vtkIOGeometry,vtkIOLegacy,vtkIOPLY,vtkIOXML}
     TBB{tbb} # transitive dependency of MIRTK{Common}
@@ -26,7 +26,7 @@
 #ifndef MIRTK_LimitedMemoryBFGSDescent_H
 #define MIRTK_LimitedMemoryBFGSDescent_H
 
-#include "mirtk/LocalOptimizer.h"
+#include "mirtk/GradientDescent.h"
 
 
 namespace mirtk {
@@ -34,30 +34,50 @@ namespace mirtk {
 
 /**
  * Minimizes objective function using L-BFGS
+ *
+ * The descent direction is the product of the objective function gradient
+ * with the limited memory approximation of the inverse Hessian, computed
+ * by the standard two-loop recursion from the most recent pairs of position
+ * and gradient differences. The step length along this direction is
+ * determined by the line search of the base class, which only evaluates
+ * the objective function value at each trial step.
  */
-class LimitedMemoryBFGSDescent : public LocalOptimizer
+class LimitedMemoryBFGSDescent : public GradientDescent
 {
   mirtkOptimizerMacro(LimitedMemoryBFGSDescent, OM_LBFGS);
 
   // ---------------------------------------------------------------------------
   // Attributes
 
-  /// Maximum number of iterations
-  mirtkPublicAttributeMacro(int, NumberOfIterations);
+  /// Maximum number of correction pairs used to approximate the inverse Hessian
+  mirtkPublicAttributeMacro(int, NumberOfCorrections);
 
-  /// Minimum length of steps
-  mirtkPublicAttributeMacro(double, MinStepLength);
+  /// Whether to store correction pairs in single instead of double precision
+  ///
+  /// Halves the memory needed for the history, which is dominant for
+  /// transformations with many parameters. Dot products are nevertheless
+  /// accumulated in double precision.
+  mirtkPublicAttributeMacro(bool, SinglePrecisionHistory);
 
-  /// Maximum length of steps
-  mirtkPublicAttributeMacro(double, MaxStepLength);
+  /// Number of currently stored correction pairs
+  mirtkReadOnlyAttributeMacro(int, NumberOfStoredCorrections);
 
   /// Copy attributes of this class from another instance
   void CopyAttributes(const LimitedMemoryBFGSDescent &);
 
-public:
+protected:
 
-  /// Current line search progress
-  LineSearchStep _CurrentStep;
+  int     _NewestCorrection; ///< Index of most recent correction pair
+  bool    _HasPreviousStep;  ///< Whether previous parameters and gradient are stored
+  double *_PrevDOFs;         ///< Parameters at previous gradient evaluation
+  double *_PrevGradient;     ///< Gradient at previous parameters
+  double *_S;                ///< Position differences (double precision)
+  double *_Y;                ///< Gradient differences (double precision)
+  float  *_FS;               ///< Position differences (single precision)
+  float  *_FY;               ///< Gradient differences (single precision)
+  double *_Rho;              ///< Reciprocals of curvatures s^T y
+  double *_Alpha;            ///< Coefficients of first recursion loop
+  double  _HessianScale;     ///< Scaling of initial inverse Hessian approximation
 
   // ---------------------------------------------------------------------------
   // Construction/Destruction
@@ -79,7 +99,7 @@ public:
   // Parameters
 
   // Import other overloads
-  using LocalOptimizer::Parameter;
+  using GradientDescent::Parameter;
 
   /// Set parameter value from string
   virtual bool Set(const char *, const char *);
@@ -88,10 +108,33 @@ public:
   virtual ParameterList Parameter() const;
 
   // ---------------------------------------------------------------------------
-  // Execution
+  // Optimization
+
+  /// Discard stored correction pairs and previous parameters and gradient
+  void ResetHistory();
+
+protected:
+
+  /// Initialize gradient descent
+  virtual void Initialize();
+
+  /// Finalize gradient descent
+  virtual void Finalize();
+
+  /// Compute gradient of objective function and multiply it by the
+  /// inverse Hessian approximation
+  virtual void Gradient(double *, double = .0, bool * = NULL);
+
+  /// Add correction pair for the step from the previous to the current parameters
+  void UpdateHistory(const double *, const double *);
+
+  /// Multiply gradient by inverse Hessian approximation
+  void TwoLoopRecursion(double *);
+
+private:
 
-  /// Optimize objective function using gradient descent
-  virtual double Run();
+  /// Free memory of correction pairs
+  void DeallocateHistory();
 
 };
 
@@ -25,10 +25,11 @@
 
 #include "mirtk/LimitedMemoryBFGSDescent.h"
 
+#include "mirtk/Math.h"
+#include "mirtk/Memory.h"
+#include "mirtk/Parallel.h"
 #include "mirtk/ObjectFactory.h"
 
-#include "lbfgs.h"
-
 
 namespace mirtk {
 
@@ -38,48 +39,201 @@ mirtkAutoRegisterOptimizerMacro(LimitedMemoryBFGSDescent);
 
 
 // =============================================================================
-// liblbfgs error messages
+// Auxiliary functors
 // =============================================================================
 
+namespace LimitedMemoryBFGSDescentUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Dot product of gradient with stored correction vector
+template <class T>
+class DotProduct
+{
+  const double *_Vector;
+  const T      *_Correction;
+  double        _Sum;
+
+public:
+
+  DotProduct(const double *v, const T *c)
+  :
+    _Vector(v), _Correction(c), _Sum(.0)
+  {}
+
+  DotProduct(const DotProduct &lhs, split)
+  :
+    _Vector(lhs._Vector), _Correction(lhs._Correction), _Sum(.0)
+  {}
+
+  void join(const DotProduct &rhs)
+  {
+    _Sum += rhs._Sum;
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    double sum = _Sum;
+    for (int i = re.begin(); i != re.end(); ++i) {
+      sum += _Vector[i] * static_cast<double>(_Correction[i]);
+    }
+    _Sum = sum;
+  }
+
+  static double Run(int n, const double *v, const T *c)
+  {
+    DotProduct body(v, c);
+    parallel_reduce(blocked_range<int>(0, n), body);
+    return body._Sum;
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Add scaled correction vector to gradient
+template <class T>
+class AddScaledCorrection
+{
+  double   *_Vector;
+  const T  *_Correction;
+  double    _Scale;
+
+public:
+
+  AddScaledCorrection(double *v, double s, const T *c)
+  :
+    _Vector(v), _Correction(c), _Scale(s)
+  {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      _Vector[i] += _Scale * static_cast<double>(_Correction[i]);
+    }
+  }
+
+  static void Run(int n, double *v, double s, const T *c)
+  {
+    AddScaledCorrection body(v, s, c);
+    parallel_for(blocked_range<int>(0, n), body);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Scale gradient by initial inverse Hessian approximation
+class ScaleVector
+{
+  double *_Vector;
+  double  _Scale;
+
+public:
+
+  ScaleVector(double *v, double s) : _Vector(v), _Scale(s) {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      _Vector[i] *= _Scale;
+    }
+  }
+
+  static void Run(int n, double *v, double s)
+  {
+    ScaleVector body(v, s);
+    parallel_for(blocked_range<int>(0, n), body);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Compute and store correction pair s = x - x', y = g - g', and the
+/// dot products s^T y and y^T y of the stored (possibly rounded) vectors
+template <class T>
+class ComputeCorrection
+{
+  const double *_DOFs;
+  const double *_PrevDOFs;
+  const double *_Gradient;
+  const double *_PrevGradient;
+  T            *_S;
+  T            *_Y;
+
+public:
+
+  double _SY;
+  double _YY;
+
+  ComputeCorrection(const double *x, const double *px,
+                    const double *g, const double *pg, T *s, T *y)
+  :
+    _DOFs(x), _PrevDOFs(px), _Gradient(g), _PrevGradient(pg),
+    _S(s), _Y(y), _SY(.0), _YY(.0)
+  {}
+
+  ComputeCorrection(const ComputeCorrection &lhs, split)
+  :
+    _DOFs(lhs._DOFs), _PrevDOFs(lhs._PrevDOFs),
+    _Gradient(lhs._Gradient), _PrevGradient(lhs._PrevGradient),
+    _S(lhs._S), _Y(lhs._Y), _SY(.0), _YY(.0)
+  {}
+
+  void join(const ComputeCorrection &rhs)
+  {
+    _SY += rhs._SY;
+    _YY += rhs._YY;
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    double sy = _SY, yy = _YY, s, y;
+    for (int i = re.begin(); i != re.end(); ++i) {
+      _S[i] = static_cast<T>(_DOFs[i] - _PrevDOFs[i]);
+      _Y[i] = static_cast<T>(_Gradient[i] - _PrevGradient[i]);
+      s = static_cast<double>(_S[i]);
+      y = static_cast<double>(_Y[i]);
+      sy += s * y;
+      yy += y * y;
+    }
+    _SY = sy, _YY = yy;
+  }
+};
+
 // -----------------------------------------------------------------------------
-const char *lbfgs_error_message(int err)
-{
-  switch (err) {
-    case LBFGS_ALREADY_MINIMIZED:            return "The initial variables already minimize the objective function.";
-    case LBFGSERR_LOGICERROR:                return "Logic error.";
-    case LBFGSERR_OUTOFMEMORY:               return "Insufficient memory.";
-    case LBFGSERR_CANCELED:                  return "The minimization process has been canceled.";
-    case LBFGSERR_INVALID_N:                 return "Invalid number of variables specified.";
-    case LBFGSERR_INVALID_N_SSE:             return "Invalid number of variables (for SSE) specified.";
-    case LBFGSERR_INVALID_X_SSE:             return "The array x must be aligned to 16 (for SSE).";
-    case LBFGSERR_INVALID_EPSILON:           return "Invalid parameter lbfgs_parameter_t::epsilon specified.";
-    case LBFGSERR_INVALID_TESTPERIOD:        return "Invalid parameter lbfgs_parameter_t::past specified.";
-    case LBFGSERR_INVALID_DELTA:             return "Invalid parameter lbfgs_parameter_t::delta specified.";
-    case LBFGSERR_INVALID_LINESEARCH:        return "Invalid parameter lbfgs_parameter_t::linesearch specified.";
-    case LBFGSERR_INVALID_MINSTEP:           return "Invalid parameter lbfgs_parameter_t::max_step specified.";
-    case LBFGSERR_INVALID_MAXSTEP:           return "Invalid parameter lbfgs_parameter_t::max_step specified.";
-    case LBFGSERR_INVALID_FTOL:              return "Invalid parameter lbfgs_parameter_t::ftol specified.";
-    case LBFGSERR_INVALID_WOLFE:             return "Invalid parameter lbfgs_parameter_t::wolfe specified.";
-    case LBFGSERR_INVALID_GTOL:              return "Invalid parameter lbfgs_parameter_t::gtol specified.";
-    case LBFGSERR_INVALID_XTOL:              return "Invalid parameter lbfgs_parameter_t::xtol specified.";
-    case LBFGSERR_INVALID_MAXLINESEARCH:     return "Invalid parameter lbfgs_parameter_t::max_linesearch specified.";
-    case LBFGSERR_INVALID_ORTHANTWISE:       return "Invalid parameter lbfgs_parameter_t::orthantwise_c specified.";
-    case LBFGSERR_INVALID_ORTHANTWISE_START: return "Invalid parameter lbfgs_parameter_t::orthantwise_start specified.";
-    case LBFGSERR_INVALID_ORTHANTWISE_END:   return "Invalid parameter lbfgs_parameter_t::orthantwise_end specified.";
-    case LBFGSERR_OUTOFINTERVAL:             return "The line-search step went out of the interval of uncertainty.";
-    case LBFGSERR_INCORRECT_TMINMAX:         return "A logic error occurred; alternatively, the interval of uncertainty became too small.";
-    case LBFGSERR_ROUNDING_ERROR:            return "A rounding error occurred; alternatively, no line-search step satisfies the sufficient decrease and curvature conditions.";
-    case LBFGSERR_MINIMUMSTEP:               return "The line-search step became smaller than lbfgs_parameter_t::min_step.";
-    case LBFGSERR_MAXIMUMSTEP:               return "The line-search step became larger than lbfgs_parameter_t::max_step.";
-    case LBFGSERR_MAXIMUMLINESEARCH:         return "The line-search routine reaches the maximum number of evaluations.";
-    case LBFGSERR_MAXIMUMITERATION:          return "The algorithm routine reaches the maximum number of iterations.";
-    case LBFGSERR_WIDTHTOOSMALL:             return "Relative width of the interval of uncertainty is at most lbfgs_parameter_t::xtol.";
-    case LBFGSERR_INVALIDPARAMETERS:         return "A logic error (negative line-search step) occurred.";
-    case LBFGSERR_INCREASEGRADIENT:          return "The current search direction increases the objective function value.";
-    default:                                 return "Unknown error.";
+/// Two-loop recursion for multiplication of the gradient by the L-BFGS
+/// approximation of the inverse Hessian
+///
+/// \param[in]     n      Number of parameters.
+/// \param[in,out] q      Gradient vector which is replaced by H^-1 g.
+/// \param[in]     S      Position differences, one vector of length n per pair.
+/// \param[in]     Y      Gradient differences, one vector of length n per pair.
+/// \param[in]     rho    Reciprocals of s^T y for each pair.
+/// \param[out]    alpha  Coefficients of first recursion loop.
+/// \param[in]     m      Maximum number of correction pairs.
+/// \param[in]     k      Number of stored correction pairs.
+/// \param[in]     newest Index of most recent correction pair.
+/// \param[in]     gamma  Scaling of initial inverse Hessian approximation.
+template <class T>
+void TwoLoopRecursion(int n, double *q, const T *S, const T *Y,
+                      const double *rho, double *alpha,
+                      int m, int k, int newest, double gamma)
+{
+  int j = newest;
+  for (int l = 0; l < k; ++l) {
+    alpha[j] = rho[j] * DotProduct<T>::Run(n, q, S + j * n);
+    AddScaledCorrection<T>::Run(n, q, -alpha[j], Y + j * n);
+    j = (j + m - 1) % m;
+  }
+  ScaleVector::Run(n, q, gamma);
+  for (int l = 0; l < k; ++l) {
+    j = (j + 1) % m;
+    const double beta = rho[j] * DotProduct<T>::Run(n, q, Y + j * n);
+    AddScaledCorrection<T>::Run(n, q, alpha[j] - beta, S + j * n);
   }
 }
 
+
+} // namespace LimitedMemoryBFGSDescentUtils
+
+using namespace LimitedMemoryBFGSDescentUtils;
+
 // =============================================================================
 // Construction/Destruction
 // =============================================================================
@@ -87,26 +241,40 @@ const char *lbfgs_error_message(int err)
 // -----------------------------------------------------------------------------
 LimitedMemoryBFGSDescent::LimitedMemoryBFGSDescent(ObjectiveFunction *f)
 :
-  LocalOptimizer(f),
-  _NumberOfIterations(100),
-  _MinStepLength     (0.01),
-  _MaxStepLength     (1.0)
+  GradientDescent(f),
+  _NumberOfCorrections(5),
+  _SinglePrecisionHistory(false),
+  _NumberOfStoredCorrections(0),
+  _NewestCorrection(-1),
+  _HasPreviousStep(false),
+  _PrevDOFs(nullptr), _PrevGradient(nullptr),
+  _S(nullptr), _Y(nullptr), _FS(nullptr), _FY(nullptr),
+  _Rho(nullptr), _Alpha(nullptr),
+  _HessianScale(1.0)
 {
 }
 
 // -----------------------------------------------------------------------------
 void LimitedMemoryBFGSDescent::CopyAttributes(const LimitedMemoryBFGSDescent &other)
 {
-  _NumberOfIterations = other._NumberOfIterations;
-  _MinStepLength      = other._MinStepLength;
-  _MaxStepLength      = other._MaxStepLength;
-  _CurrentStep        = other._CurrentStep;
+  _NumberOfCorrections    = other._NumberOfCorrections;
+  _SinglePrecisionHistory = other._SinglePrecisionHistory;
+
+  // History is specific to an optimization run and not copied
+  DeallocateHistory();
 }
 
 // -----------------------------------------------------------------------------
 LimitedMemoryBFGSDescent::LimitedMemoryBFGSDescent(const LimitedMemoryBFGSDescent &other)
 :
-  LocalOptimizer(other)
+  GradientDescent(other),
+  _NumberOfStoredCorrections(0),
+  _NewestCorrection(-1),
+  _HasPreviousStep(false),
+  _PrevDOFs(nullptr), _PrevGradient(nullptr),
+  _S(nullptr), _Y(nullptr), _FS(nullptr), _FY(nullptr),
+  _Rho(nullptr), _Alpha(nullptr),
+  _HessianScale(1.0)
 {
   CopyAttributes(other);
 }
@@ -115,7 +283,7 @@ LimitedMemoryBFGSDescent::LimitedMemoryBFGSDescent(const LimitedMemoryBFGSDescen
 LimitedMemoryBFGSDescent &LimitedMemoryBFGSDescent::operator =(const LimitedMemoryBFGSDescent &other)
 {
   if (this != &other) {
-    LocalOptimizer::operator =(other);
+    GradientDescent::operator =(other);
     CopyAttributes(other);
   }
   return *this;
@@ -124,6 +292,22 @@ LimitedMemoryBFGSDescent &LimitedMemoryBFGSDescent::operator =(const LimitedMemo
 // -----------------------------------------------------------------------------
 LimitedMemoryBFGSDescent::~LimitedMemoryBFGSDescent()
 {
+  DeallocateHistory();
+}
+
+// -----------------------------------------------------------------------------
+void LimitedMemoryBFGSDescent::DeallocateHistory()
+{
+  Deallocate(_PrevDOFs);
+  Deallocate(_PrevGradient);
+  Deallocate(_S);
+  Deallocate(_Y);
+  Deallocate(_FS);
+  Deallocate(_FY);
+  Deallocate(_Rho);
+  Deallocate(_Alpha);
+  _NumberOfStoredCorrections = 0;
+  _NewestCorrection          = -1;
 }
 
 // =============================================================================
@@ -133,34 +317,24 @@ LimitedMemoryBFGSDescent::~LimitedMemoryBFGSDescent()
 // -----------------------------------------------------------------------------
 bool LimitedMemoryBFGSDescent::Set(const char *name, const char *value)
 {
-  if (strcmp(name, "No. of iterations") == 0) {
-    return FromString(value, _NumberOfIterations) && _NumberOfIterations > 0;
-  }
-  if (strcmp(name, "Minimum length of steps") == 0) {
-    return FromString(value, _MinStepLength) && _MinStepLength > .0;
-  }
-  if (strcmp(name, "Maximum length of steps") == 0) {
-    return FromString(value, _MaxStepLength) && _MaxStepLength > .0;
+  if (strcmp(name, "No. of correction pairs")     == 0 ||
+      strcmp(name, "Number of correction pairs")  == 0 ||
+      strcmp(name, "No. of L-BFGS corrections")   == 0 ||
+      strcmp(name, "Number of L-BFGS corrections") == 0) {
+    return FromString(value, _NumberOfCorrections) && _NumberOfCorrections > 0;
   }
-  if (strcmp(name, "Length of steps") == 0) {
-    if (!FromString(value, _MaxStepLength) || _MaxStepLength <= .0) return false;
-    _MinStepLength = _MaxStepLength;
-    return true;
+  if (strcmp(name, "Single precision correction pairs") == 0) {
+    return FromString(value, _SinglePrecisionHistory);
   }
-  return LocalOptimizer::Set(name, value);
+  return GradientDescent::Set(name, value);
 }
 
 // -----------------------------------------------------------------------------
 ParameterList LimitedMemoryBFGSDescent::Parameter() const
 {
-  ParameterList params = LocalOptimizer::Parameter();
-  Insert(params, "No. of iterations", ToString(_NumberOfIterations));
-  if (_MinStepLength == _MaxStepLength) {
-    Insert(params, "Length of steps", ToString(_MinStepLength));
-  } else {
-    Insert(params, "Minimum length of steps", ToString(_MinStepLength));
-    Insert(params, "Maximum length of steps", ToString(_MaxStepLength));
-  }
+  ParameterList params = GradientDescent::Parameter();
+  Insert(params, "No. of correction pairs",           _NumberOfCorrections);
+  Insert(params, "Single precision correction pairs", _SinglePrecisionHistory);
   return params;
 }
 
@@ -168,74 +342,114 @@ ParameterList LimitedMemoryBFGSDescent::Parameter() const
 // Optimization
 // =============================================================================
 
-// L-BFGS helper
-struct LBFGSCallback
+// -----------------------------------------------------------------------------
+void LimitedMemoryBFGSDescent::Initialize()
 {
-  static lbfgsfloatval_t Evaluate(
-      void                  *o,    // Instance of LimitedMemoryBFGSDescent
-      const lbfgsfloatval_t *x,    // Current parameters
-      lbfgsfloatval_t       *g,    // Gradient of objective function
-      const int              n,    // Number of parameters
-      const lbfgsfloatval_t  step) // Line search step length
-  {
-    LimitedMemoryBFGSDescent *_this = reinterpret_cast<LimitedMemoryBFGSDescent *>(o);
-    _this->Function()->Put(x);
-    lbfgsfloatval_t m = _this->Function()->Evaluate(g, step);
-    _this->_CurrentStep._Value = m;
-    return m;
-  }
-
-  static int Progress(
-      void                  *o,        // Instance of LimitedMemoryBFGSDescent
-      const lbfgsfloatval_t *x,        // Current parameters
-      const lbfgsfloatval_t * /*g*/,   // Current gradient
-      const lbfgsfloatval_t fx,        // Current value
-      const lbfgsfloatval_t xnorm,     // Norm of parameter vector
-      const lbfgsfloatval_t /*gnorm*/, // Norm of gradient vector
-      const lbfgsfloatval_t step,      // Current step length
-      int n,                           // Number of parameters
-      int k,                           // Current iteration
-      int ls                           // Current line search iteration
-      )
-  {
-    LimitedMemoryBFGSDescent *_this = reinterpret_cast<LimitedMemoryBFGSDescent *>(o);
-    string msg = "Current best metric value is ";
-    msg += ToString(fx);
-    msg += ", step ";
-    msg += ToString(step);
-    msg += ", after ";
-    msg += ToString(ls);
-    msg += " line search steps\n";
-    _this->Broadcast(LogEvent, msg.c_str());
-    return 0;
+  GradientDescent::Initialize();
+  DeallocateHistory();
+  const int n = Function()->NumberOfDOFs();
+  const int m = _NumberOfCorrections;
+  Allocate(_PrevDOFs,     n);
+  Allocate(_PrevGradient, n);
+  if (_SinglePrecisionHistory) {
+    Allocate(_FS, m * n);
+    Allocate(_FY, m * n);
+  } else {
+    Allocate(_S, m * n);
+    Allocate(_Y, m * n);
   }
-};
+  Allocate(_Rho,   m);
+  Allocate(_Alpha, m);
+  ResetHistory();
+}
 
 // -----------------------------------------------------------------------------
-double LimitedMemoryBFGSDescent::Run()
+void LimitedMemoryBFGSDescent::Finalize()
 {
-  lbfgs_parameter_t param;
-  lbfgs_parameter_init(&param);
+  GradientDescent::Finalize();
+  DeallocateHistory();
+}
 
-  param.past           = 1;
-  param.delta          = _Epsilon;
-  param.epsilon        = _Delta;
-  param.max_iterations = _NumberOfIterations;
-  param.min_step       = _MinStepLength;
-  param.max_step       = _MaxStepLength;
+// -----------------------------------------------------------------------------
+void LimitedMemoryBFGSDescent::ResetHistory()
+{
+  _NumberOfStoredCorrections = 0;
+  _NewestCorrection          = -1;
+  _HessianScale              = 1.0;
+  _HasPreviousStep           = false;
+}
 
-  const int        n = Function()->NumberOfDOFs();
-  lbfgsfloatval_t *x = lbfgs_malloc(n);
-  Function()->Get(x);
+// -----------------------------------------------------------------------------
+void LimitedMemoryBFGSDescent::UpdateHistory(const double *x, const double *g)
+{
+  const int n = Function()->NumberOfDOFs();
+  const int m = _NumberOfCorrections;
+  const int j = (_NewestCorrection + 1) % m;
+
+  double sy, yy;
+  if (_SinglePrecisionHistory) {
+    ComputeCorrection<float> body(x, _PrevDOFs, g, _PrevGradient, _FS + j * n, _FY + j * n);
+    parallel_reduce(blocked_range<int>(0, n), body);
+    sy = body._SY, yy = body._YY;
+  } else {
+    ComputeCorrection<double> body(x, _PrevDOFs, g, _PrevGradient, _S + j * n, _Y + j * n);
+    parallel_reduce(blocked_range<int>(0, n), body);
+    sy = body._SY, yy = body._YY;
+  }
 
-  int ret = lbfgs(n, x, NULL, LBFGSCallback::Evaluate, LBFGSCallback::Progress, this, &param);
-  if (ret < 0 && ret != LBFGSERR_MAXIMUMITERATION && ret != LBFGSERR_MAXIMUMLINESEARCH) {
-    cerr << "L-BFGS optimization failed: " << lbfgs_error_message(ret) << " (error code: " << ret << ")" << endl;
-    exit(1);
+  // Accept pair only when curvature condition holds, which guarantees that
+  // the inverse Hessian approximation remains positive definite. Otherwise,
+  // the oldest pair was overwritten when the history was full.
+  if (yy > .0 && sy > 1e-10 * yy) {
+    _Rho[j]           = 1.0 / sy;
+    _HessianScale     = sy / yy;
+    _NewestCorrection = j;
+    if (_NumberOfStoredCorrections < m) ++_NumberOfStoredCorrections;
+  } else if (_NumberOfStoredCorrections == m) {
+    --_NumberOfStoredCorrections;
   }
+}
 
-  lbfgs_free(x);
-  return _CurrentStep._Value;
+// -----------------------------------------------------------------------------
+void LimitedMemoryBFGSDescent::TwoLoopRecursion(double *q)
+{
+  if (_NumberOfStoredCorrections == 0) return;
+  const int n = Function()->NumberOfDOFs();
+  if (_SinglePrecisionHistory) {
+    LimitedMemoryBFGSDescentUtils::TwoLoopRecursion(n, q, _FS, _FY, _Rho, _Alpha,
+        _NumberOfCorrections, _NumberOfStoredCorrections, _NewestCorrection, _HessianScale);
+  } else {
+    LimitedMemoryBFGSDescentUtils::TwoLoopRecursion(n, q, _S, _Y, _Rho, _Alpha,
+        _NumberOfCorrections, _NumberOfStoredCorrections, _NewestCorrection, _HessianScale);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void LimitedMemoryBFGSDescent::Gradient(double *gradient, double step, bool *sgn_chg)
+{
+  const int n = Function()->NumberOfDOFs();
+
+  // Compute gradient of objective function at current parameters
+  GradientDescent::Gradient(gradient, step, sgn_chg);
+
+  // Add correction pair for step taken by previous line search
+  Array<double> x(n);
+  Function()->Get(x.data());
+  if (_HasPreviousStep) UpdateHistory(x.data(), gradient);
+  memcpy(_PrevDOFs,     x.data(), n * sizeof(double));
+  memcpy(_PrevGradient, gradient, n * sizeof(double));
+  _HasPreviousStep = true;
+
+  // Multiply gradient by inverse Hessian approximation
+  TwoLoopRecursion(gradient);
+
+  // Fall back to steepest descent when the L-BFGS direction is not a descent
+  // direction, e.g., after the objective function was modified upon restart
+  if (DotProduct<double>::Run(n, gradient, _PrevGradient) <= .0) {
+    memcpy(gradient, _PrevGradient, n * sizeof(double));
+    ResetHistory();
+    _HasPreviousStep = true; // just stored at the current parameters
+  }
 }
 
 
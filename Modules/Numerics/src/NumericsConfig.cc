@@ -23,9 +23,7 @@
 #ifndef MIRTK_AUTO_REGISTER
   #include "mirtk/GradientDescent.h"
   #include "mirtk/ConjugateGradientDescent.h"
-  #if MIRTK_Numerics_WITH_LBFGS
-    #include "mirtk/LimitedMemoryBFGSDescent.h"
-  #endif
+  #include "mirtk/LimitedMemoryBFGSDescent.h"
 #endif
 
 
@@ -38,9 +36,7 @@ static void RegisterOptimizers()
   #ifndef MIRTK_AUTO_REGISTER
     mirtkRegisterOptimizerMacro(GradientDescent);
     mirtkRegisterOptimizerMacro(ConjugateGradientDescent);
-    #if MIRTK_Numerics_WITH_LBFGS
-      mirtkRegisterOptimizerMacro(LimitedMemoryBFGSDescent);
-    #endif
+    mirtkRegisterOptimizerMacro(LimitedMemoryBFGSDescent);
   #endif
 }
 
@@ -0,0 +1,160 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2016 Imperial College London
+ * Copyright 2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NumericsTest.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Array.h"
+#include "mirtk/ObjectiveFunction.h"
+#include "mirtk/GradientDescent.h"
+#include "mirtk/LimitedMemoryBFGSDescent.h"
+using namespace mirtk;
+
+// =============================================================================
+// Test function
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Ill-conditioned quadratic f(x) = 1/2 sum_i a_i (x_i - i)^2
+class IllConditionedQuadratic : public ObjectiveFunction
+{
+  mirtkObjectMacro(IllConditionedQuadratic);
+
+  Array<double> _x;
+  Array<double> _a;
+
+public:
+
+  int _NumberOfGradientEvaluations;
+
+  IllConditionedQuadratic(int n)
+  :
+    _x(n, .0), _a(n), _NumberOfGradientEvaluations(0)
+  {
+    for (int i = 0; i < n; ++i) _a[i] = 1.0 + 99.0 * i / (n - 1);
+  }
+
+  double Solution(int i) const { return static_cast<double>(i); }
+
+  int    NumberOfDOFs() const           { return static_cast<int>(_x.size()); }
+  void   Put(const double *x)           { for (size_t i = 0; i < _x.size(); ++i) _x[i] = x[i]; }
+  double Get(int i) const               { return _x[i]; }
+  void   Get(double *x) const           { for (size_t i = 0; i < _x.size(); ++i) x[i] = _x[i]; }
+
+  double Step(double *dx)
+  {
+    double max_delta = .0;
+    for (size_t i = 0; i < _x.size(); ++i) {
+      _x[i] += dx[i];
+      max_delta = max(max_delta, abs(dx[i]));
+    }
+    return max_delta;
+  }
+
+  double Value()
+  {
+    double value = .0;
+    for (size_t i = 0; i < _x.size(); ++i) {
+      value += .5 * _a[i] * pow(_x[i] - Solution(int(i)), 2);
+    }
+    return value;
+  }
+
+  void Gradient(double *dx, double = .0, bool * = nullptr)
+  {
+    for (size_t i = 0; i < _x.size(); ++i) {
+      dx[i] = _a[i] * (_x[i] - Solution(int(i)));
+    }
+    ++_NumberOfGradientEvaluations;
+  }
+
+  double GradientNorm(const double *dx) const
+  {
+    double norm = .0;
+    for (size_t i = 0; i < _x.size(); ++i) norm = max(norm, abs(dx[i]));
+    return norm;
+  }
+};
+
+// -----------------------------------------------------------------------------
+static void SetParameters(LocalOptimizer &optimizer)
+{
+  optimizer.Set("Maximum no. of iterations", "200");
+  optimizer.Set("Maximum length of steps", "10");
+  optimizer.Set("Minimum length of steps", "1e-6");
+  optimizer.Set("Epsilon", "0");
+  optimizer.Set("Delta", "1e-9");
+}
+
+// =============================================================================
+// Tests
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+TEST(LimitedMemoryBFGSDescent, Minimize)
+{
+  IllConditionedQuadratic f(100);
+  LimitedMemoryBFGSDescent optimizer(&f);
+  SetParameters(optimizer);
+  const double value = optimizer.Run();
+  EXPECT_LT(value, 1e-6);
+  for (int i = 0; i < f.NumberOfDOFs(); ++i) {
+    EXPECT_DOUBLE_EQ(f.Solution(i), f.Get(i));
+  }
+}
+
+// -----------------------------------------------------------------------------
+TEST(LimitedMemoryBFGSDescent, SinglePrecisionHistory)
+{
+  IllConditionedQuadratic f(100);
+  LimitedMemoryBFGSDescent optimizer(&f);
+  SetParameters(optimizer);
+  EXPECT_TRUE(optimizer.Set("Single precision correction pairs", "Yes"));
+  EXPECT_TRUE(optimizer.SinglePrecisionHistory());
+  const double value = optimizer.Run();
+  EXPECT_LT(value, 1e-6);
+  for (int i = 0; i < f.NumberOfDOFs(); ++i) {
+    EXPECT_DOUBLE_EQ(f.Solution(i), f.Get(i));
+  }
+}
+
+// -----------------------------------------------------------------------------
+TEST(LimitedMemoryBFGSDescent, FewerGradientsThanGradientDescent)
+{
+  IllConditionedQuadratic f1(100), f2(100);
+  GradientDescent          gd   (&f1);
+  LimitedMemoryBFGSDescent lbfgs(&f2);
+  SetParameters(gd);
+  SetParameters(lbfgs);
+  const double v1 = gd.Run();
+  const double v2 = lbfgs.Run();
+  EXPECT_LE(v2, v1);
+  EXPECT_LT(f2._NumberOfGradientEvaluations, f1._NumberOfGradientEvaluations);
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
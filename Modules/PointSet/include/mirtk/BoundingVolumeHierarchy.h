@@ -0,0 +1,262 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_BoundingVolumeHierarchy_H
+#define MIRTK_BoundingVolumeHierarchy_H
+
+#include "mirtk/Object.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Array.h"
+
+
+namespace mirtk {
+
+
+/**
+ * Bounding volume hierarchy of axis-aligned bounding boxes
+ *
+ * This search structure is used to find the cells of a mesh, e.g., the
+ * triangles of a surface, whose bounding boxes overlap a query region.
+ * The hierarchy is built top-down using a binned surface area heuristic (SAH).
+ * When the cells are only slightly displaced, as during the iterations of a
+ * surface deformation, the hierarchy can be refit to the new bounding boxes
+ * in linear time instead of being rebuilt. Update does so automatically and
+ * only rebuilds the hierarchy when the refit tree became too inefficient.
+ *
+ * Bounding boxes are given in the same order as by vtkDataSet::GetBounds,
+ * i.e., (x1, x2, y1, y2, z1, z2), with six values per cell stored
+ * contiguously. Queries are thread-safe.
+ */
+class BoundingVolumeHierarchy : public Object
+{
+  mirtkObjectMacro(BoundingVolumeHierarchy);
+
+  // ---------------------------------------------------------------------------
+  // Types
+public:
+
+  /// Node of bounding volume hierarchy
+  struct Node
+  {
+    double _Bounds[6]; ///< Bounding box of all cells below this node
+    int    _First;     ///< Index of first child node or first cell of leaf
+    int    _Count;     ///< Number of cells of leaf node, zero for inner node
+
+    /// Whether this node is a leaf node
+    bool IsLeaf() const { return _Count > 0; }
+  };
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Maximum number of cells per leaf node
+  mirtkPublicAttributeMacro(int, MaxLeafSize);
+
+  /// Number of bins used to evaluate the surface area heuristic
+  mirtkPublicAttributeMacro(int, NumberOfBins);
+
+  /// Maximum ratio of SAH cost of refit hierarchy to cost after last rebuild
+  /// before Update rebuilds the hierarchy instead of refitting it
+  mirtkPublicAttributeMacro(double, MaxRefitCostRatio);
+
+  /// Nodes of the hierarchy, where the root node is the first node and the
+  /// children of an inner node are stored next to each other after it
+  mirtkReadOnlyAttributeMacro(Array<Node>, Nodes);
+
+  /// IDs of cells in the order in which they are referenced by leaf nodes
+  mirtkReadOnlyAttributeMacro(Array<int>, CellIds);
+
+  /// SAH cost of hierarchy after last rebuild
+  mirtkReadOnlyAttributeMacro(double, BuildCost);
+
+  /// Copy attributes of this class from another instance
+  void CopyAttributes(const BoundingVolumeHierarchy &);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  BoundingVolumeHierarchy();
+
+  /// Copy constructor
+  BoundingVolumeHierarchy(const BoundingVolumeHierarchy &);
+
+  /// Assignment operator
+  BoundingVolumeHierarchy &operator =(const BoundingVolumeHierarchy &);
+
+  /// Destructor
+  virtual ~BoundingVolumeHierarchy();
+
+  // ---------------------------------------------------------------------------
+  // Construction of hierarchy
+
+  /// Build hierarchy from scratch
+  ///
+  /// \param[in] n      Number of cells.
+  /// \param[in] bounds Bounding boxes of the cells.
+  void Build(int n, const double *bounds);
+
+  /// Recompute bounding boxes of nodes without changing the tree structure
+  ///
+  /// \param[in] bounds New bounding boxes of the cells, in the same order
+  ///                   and of the same number as given to Build.
+  void Refit(const double *bounds);
+
+  /// Refit hierarchy or rebuild it when the number of cells changed or the
+  /// refit hierarchy is more than MaxRefitCostRatio times less efficient
+  ///
+  /// \returns Whether the hierarchy was rebuilt.
+  bool Update(int n, const double *bounds);
+
+  /// Clear hierarchy
+  void Clear();
+
+  /// Number of cells
+  int NumberOfCells() const;
+
+  /// Whether the hierarchy is empty
+  bool IsEmpty() const;
+
+  /// SAH cost of the current hierarchy
+  double Cost() const;
+
+  // ---------------------------------------------------------------------------
+  // Queries
+
+  /// Find cells whose bounding box satisfies the given predicate
+  ///
+  /// The predicate is called with a bounding box and must return \c true when
+  /// the query region intersects this box. It is called for both nodes and
+  /// cells, and hence must not be more restrictive for a box than for any
+  /// box contained within it.
+  ///
+  /// \param[in]  overlaps Predicate testing whether a box overlaps the query region.
+  /// \param[in]  bounds   Bounding boxes of cells given to Build or Refit.
+  /// \param[out] cellIds  IDs of found cells. Existing entries are removed,
+  ///                      but the memory is reused by subsequent calls.
+  template <class Predicate>
+  void Find(const Predicate &overlaps, const double *bounds, Array<int> &cellIds) const;
+
+  /// Find cells whose bounding box overlaps the given box
+  void FindCellsInBox(const double box[6], const double *bounds, Array<int> &cellIds) const;
+
+  /// Find cells whose bounding box intersects the given sphere
+  void FindCellsWithinRadius(const double c[3], double r, const double *bounds, Array<int> &cellIds) const;
+
+  // ---------------------------------------------------------------------------
+  // Bounding box auxiliaries
+
+  /// Whether two bounding boxes overlap
+  static bool Overlap(const double a[6], const double b[6]);
+
+  /// Squared distance of point to bounding box
+  static double Distance2(const double box[6], const double p[3]);
+
+  /// Surface area of bounding box
+  static double Area(const double box[6]);
+
+protected:
+
+  /// Find cells below the given node
+  template <class Predicate>
+  void Find(int node, const Predicate &, const double *, Array<int> &) const;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+inline int BoundingVolumeHierarchy::NumberOfCells() const
+{
+  return static_cast<int>(_CellIds.size());
+}
+
+// -----------------------------------------------------------------------------
+inline bool BoundingVolumeHierarchy::IsEmpty() const
+{
+  return _Nodes.empty();
+}
+
+// -----------------------------------------------------------------------------
+inline bool BoundingVolumeHierarchy::Overlap(const double a[6], const double b[6])
+{
+  return a[0] <= b[1] && b[0] <= a[1] &&
+         a[2] <= b[3] && b[2] <= a[3] &&
+         a[4] <= b[5] && b[4] <= a[5];
+}
+
+// -----------------------------------------------------------------------------
+inline double BoundingVolumeHierarchy::Distance2(const double box[6], const double p[3])
+{
+  double d, d2 = 0.;
+  for (int i = 0; i < 3; ++i) {
+    if      (p[i] < box[2*i  ]) d = box[2*i  ] - p[i];
+    else if (p[i] > box[2*i+1]) d = p[i] - box[2*i+1];
+    else continue;
+    d2 += d * d;
+  }
+  return d2;
+}
+
+// -----------------------------------------------------------------------------
+inline double BoundingVolumeHierarchy::Area(const double box[6])
+{
+  const double dx = box[1] - box[0];
+  const double dy = box[3] - box[2];
+  const double dz = box[5] - box[4];
+  return 2. * (dx * dy + dx * dz + dy * dz);
+}
+
+// -----------------------------------------------------------------------------
+template <class Predicate>
+void BoundingVolumeHierarchy::Find(int node, const Predicate &overlaps,
+                                   const double *bounds, Array<int> &cellIds) const
+{
+  const Node *n = &_Nodes[node];
+  while (overlaps(n->_Bounds)) {
+    if (n->IsLeaf()) {
+      for (int i = n->_First; i < n->_First + n->_Count; ++i) {
+        const int &cellId = _CellIds[i];
+        if (overlaps(bounds + 6 * cellId)) cellIds.push_back(cellId);
+      }
+      break;
+    }
+    // Recurse into first child, continue iteratively with second child
+    Find(n->_First, overlaps, bounds, cellIds);
+    n = &_Nodes[n->_First + 1];
+  }
+}
+
+// -----------------------------------------------------------------------------
+template <class Predicate>
+inline void BoundingVolumeHierarchy::Find(const Predicate &overlaps, const double *bounds,
+                                          Array<int> &cellIds) const
+{
+  cellIds.clear();
+  if (!_Nodes.empty()) Find(0, overlaps, bounds, cellIds);
+}
+
+
+} // namespace mirtk
+
+#endif // MIRTK_BoundingVolumeHierarchy_H
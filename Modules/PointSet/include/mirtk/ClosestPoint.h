@@ -62,6 +62,12 @@ protected:
   /// Distance of closest source points from target samples
   mirtkAttributeMacro(Array<double>, SourceDistance);
 
+  /// Search structure of target points, refitted after the points moved
+  UniquePtr<PointLocator> _TargetLocator;
+
+  /// Search structure of source points, refitted after the points moved
+  UniquePtr<PointLocator> _SourceLocator;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 public:
@@ -208,6 +208,15 @@ public:
   /// Get index of point data array using case insensitive name
   static int GetPointDataIndexByCaseInsensitiveName(vtkPointData *, const string &);
 
+  /// Refit point locator to moved points or build new locator for given dataset
+  ///
+  /// \param[in,out] locator  Point locator of previous update or NULL.
+  /// \param[in]     dataset  Dataset in which points are searched.
+  /// \param[in]     sample   Indices of points in \p dataset to consider only or NULL for all.
+  /// \param[in]     features Indices and weights of point data in \p dataset to use.
+  static void UpdateLocator(UniquePtr<PointLocator> &locator, vtkPointSet *dataset,
+                            const Array<int> *sample, const FeatureList *features);
+
   // ---------------------------------------------------------------------------
   // Attributes
 protected:
@@ -32,16 +32,21 @@
 #include "vtkDataArray.h"
 
 
-// Forward declaration of implementation using VTK point locator
-class vtkOctreePointLocator;
-
-
 namespace mirtk {
 
 
+// Forward declaration of implementation using uniform grid
+class GridPointLocator;
+
 // Forward declaration of implementation using FLANN (if available)
 class FlannPointLocator;
 
+// Forward declaration of parallel batch queries
+namespace PointLocatorUtils {
+  struct FindClosestNPoints;
+  struct FindPointsWithinRadius;
+}
+
 
 /**
  * Point search structure for establishing point correspondences
@@ -51,12 +56,12 @@ class FlannPointLocator;
  * nearest neighbors within the n-dimensional feature space spanned by the
  * feature arrays used to establish point correspondences.
  *
- * The implementation uses either VTK for point search in three dimensions or
- * FLANN for higher dimensional feature spaces if available. Alternatively,
- * an ITK Kd tree is used if the library is available. As last resort, a brute
- * force search without actual Kd tree search structure is performed.
- *
- * \todo Consider actual implementation of own thread-safe N-dimensional Kd tree?
+ * The implementation uses a uniform grid for point search in up to three
+ * dimensions or FLANN for higher dimensional feature spaces if available.
+ * As last resort, a brute force search without actual Kd tree search structure
+ * is performed. The uniform grid can be refitted in linear time after the
+ * points of the dataset moved, e.g., after each iteration of a deformable
+ * surface registration, and all its queries are thread-safe.
  *
  * \attention When only a subset of the points is used, i.e., an index array
  *            of point set samples is given (_Sample attribute), the indices
@@ -69,6 +74,9 @@ class PointLocator : public Object
 {
   mirtkObjectMacro(PointLocator);
 
+  friend struct PointLocatorUtils::FindClosestNPoints;
+  friend struct PointLocatorUtils::FindPointsWithinRadius;
+
   // ---------------------------------------------------------------------------
   // Feature Arrays
 public:
@@ -204,8 +212,8 @@ public:
   /// Dimension of feature Arrays/points
   mirtkReadOnlyAttributeMacro(int, PointDimension);
 
-  /// VTK point locator used for three-dimensional feature spaces
-  vtkSmartPointer<vtkOctreePointLocator> _VtkLocator;
+  /// Uniform grid used for up to three-dimensional feature spaces
+  SharedPtr<GridPointLocator> _GridLocator;
 
   /// FLANN point locator used for higher-dimensional feature spaces when available
   SharedPtr<FlannPointLocator> _FlannLocator;
@@ -245,6 +253,13 @@ public:
   /// Destructor
   virtual ~PointLocator();
 
+  /// Update search structure after the points or features of the dataset changed
+  ///
+  /// When the number of points and their dimension is unchanged, the uniform
+  /// grid is refitted to the new point positions. Otherwise, the search
+  /// structure is rebuilt from scratch.
+  void Refit();
+
   // ---------------------------------------------------------------------------
   // Closest point
 
@@ -53,6 +53,12 @@ protected:
   /// for outlier rejection during (iterative) closest point matching
   mirtkPublicAttributeMacro(double, Sigma);
 
+  /// Search structure of target points, refitted after the points moved
+  UniquePtr<PointLocator> _TargetLocator;
+
+  /// Search structure of source points, refitted after the points moved
+  UniquePtr<PointLocator> _SourceLocator;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 public:
@@ -90,6 +96,10 @@ public:
 
   // ---------------------------------------------------------------------------
   // Correspondences
+
+  /// Initialize correspondence map
+  virtual void Initialize();
+
 protected:
 
   /// (Re-)calculate weights of correspondence links
@@ -26,6 +26,7 @@
 #include "mirtk/Array.h"
 #include "mirtk/OrderedSet.h"
 #include "mirtk/Memory.h"
+#include "mirtk/BoundingVolumeHierarchy.h"
 #include "mirtk/PointSetExport.h"
 
 #include "vtkSmartPointer.h"
@@ -45,6 +46,12 @@ namespace mirtk {
  * triangular faces and a list of non-adjacent faces which are about to collide,
  * i.e., very close to each other. They are used to impose either hard or soft
  * non-self-intersection constraints on a deformable surface.
+ *
+ * Candidate pairs of triangles are found using a bounding volume hierarchy of
+ * the triangle bounding boxes. When the filter is executed again for a mesh
+ * with the same number of triangles, e.g., the deformed surface in the next
+ * iteration of a surface deformation, the hierarchy of the previous run is
+ * refit to the new triangle positions instead of being rebuilt.
  */
 class SurfaceCollisions : public SurfaceFilter
 {
@@ -195,6 +202,10 @@ private:
 
   /// Minimum search radius around triangle center used to determine the set
   /// of nearby triangles to be tested for collisions with this triangle
+  ///
+  /// Triangles whose bounding box overlaps the bounding box of this triangle
+  /// enlarged by the minimum distance are always tested. This radius can be
+  /// used to test additional triangles within the given distance.
   mirtkPublicAttributeMacro(double, MinSearchRadius);
 
   /// Maximum search radius around triangle center used to determine the set
@@ -251,6 +262,12 @@ private:
   /// \note Only non-empty after Run when _StoreCollisionDetails is \c true.
   mirtkReadOnlyAttributeMacro(CollisionsArray, Collisions);
 
+  /// Bounding volume hierarchy of triangles
+  BoundingVolumeHierarchy _Hierarchy;
+
+  /// Bounding boxes of triangles
+  Array<double> _CellBounds;
+
   /// Copy attributes of this class from another instance
   void CopyAttributes(const SurfaceCollisions &);
 
@@ -0,0 +1,414 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/BoundingVolumeHierarchy.h"
+
+#include "mirtk/Algorithm.h"
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+namespace BoundingVolumeHierarchyUtils {
+
+
+/// Depth of hierarchy below which cells are split at their median instead of
+/// the plane with minimum SAH cost, such that the depth of the tree is bounded
+const int MaxSAHDepth = 48;
+
+// -----------------------------------------------------------------------------
+/// Reset bounding box to empty box
+inline void ResetBounds(double b[6])
+{
+  b[0] = b[2] = b[4] = + inf;
+  b[1] = b[3] = b[5] = - inf;
+}
+
+// -----------------------------------------------------------------------------
+/// Extend bounding box by another box
+inline void ExtendBounds(double b[6], const double c[6])
+{
+  if (c[0] < b[0]) b[0] = c[0];
+  if (c[1] > b[1]) b[1] = c[1];
+  if (c[2] < b[2]) b[2] = c[2];
+  if (c[3] > b[3]) b[3] = c[3];
+  if (c[4] < b[4]) b[4] = c[4];
+  if (c[5] > b[5]) b[5] = c[5];
+}
+
+// -----------------------------------------------------------------------------
+/// Bin of cells used to evaluate the surface area heuristic
+struct Bin
+{
+  double _Bounds[6];
+  int    _Count;
+};
+
+// -----------------------------------------------------------------------------
+/// Compare cells by the coordinate of their center along one axis
+struct CompareCenters
+{
+  const double *_Centers;
+  int           _Axis;
+
+  bool operator ()(int a, int b) const
+  {
+    return _Centers[3 * a + _Axis] < _Centers[3 * b + _Axis];
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Whether bounding box of cell is in the half space left of the split plane
+struct IsLeftOfSplit
+{
+  const double *_Centers;
+  int           _Axis;
+  double        _Min;
+  double        _Scale;
+  int           _Split;
+  int           _NumberOfBins;
+
+  bool operator ()(int cellId) const
+  {
+    int bin = static_cast<int>((_Centers[3 * cellId + _Axis] - _Min) * _Scale);
+    if (bin >= _NumberOfBins) bin = _NumberOfBins - 1;
+    return bin < _Split;
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Predicate for cells overlapping a given bounding box
+struct OverlapsBox
+{
+  const double *_Box;
+
+  bool operator ()(const double bounds[6]) const
+  {
+    return BoundingVolumeHierarchy::Overlap(_Box, bounds);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Predicate for cells overlapping a given sphere
+struct OverlapsSphere
+{
+  const double *_Center;
+  double        _Radius2;
+
+  bool operator ()(const double bounds[6]) const
+  {
+    return BoundingVolumeHierarchy::Distance2(bounds, _Center) <= _Radius2;
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Top-down construction of bounding volume hierarchy
+class BuildHierarchy
+{
+  typedef BoundingVolumeHierarchy::Node Node;
+
+  Array<Node>  &_Nodes;
+  Array<int>   &_CellIds;
+  const double *_Bounds;
+  Array<double> _Centers;
+  Array<Bin>    _Bins;
+  int           _MaxLeafSize;
+
+public:
+
+  BuildHierarchy(Array<Node> &nodes, Array<int> &cellIds, const double *bounds,
+                 int nbins, int max_leaf_size)
+  :
+    _Nodes(nodes), _CellIds(cellIds), _Bounds(bounds),
+    _Bins(max(nbins, 2)), _MaxLeafSize(max(max_leaf_size, 1))
+  {
+    const int n = static_cast<int>(_CellIds.size());
+    _Centers.resize(3 * n);
+    for (int i = 0; i < n; ++i) {
+      const double *b = _Bounds + 6 * i;
+      _Centers[3*i  ] = .5 * (b[0] + b[1]);
+      _Centers[3*i+1] = .5 * (b[2] + b[3]);
+      _Centers[3*i+2] = .5 * (b[4] + b[5]);
+    }
+  }
+
+  /// Subdivide cells [first, first + count) of the given node
+  void Subdivide(int node, int first, int count, int depth)
+  {
+    double bounds[6], centers[6];
+    ResetBounds(bounds);
+    ResetBounds(centers);
+    for (int i = first; i < first + count; ++i) {
+      const int     cellId = _CellIds[i];
+      const double *c      = _Centers.data() + 3 * cellId;
+      const double  p[6]   = {c[0], c[0], c[1], c[1], c[2], c[2]};
+      ExtendBounds(bounds,  _Bounds + 6 * cellId);
+      ExtendBounds(centers, p);
+    }
+    memcpy(_Nodes[node]._Bounds, bounds, 6 * sizeof(double));
+    _Nodes[node]._First = first;
+    _Nodes[node]._Count = count;
+    if (count <= _MaxLeafSize) return;
+
+    // Find split plane with minimum SAH cost
+    const int nbins = static_cast<int>(_Bins.size());
+    int    best_axis = -1, best_split = 0;
+    double best_cost = inf;
+    if (depth < MaxSAHDepth) {
+      double left[6], right[6];
+      Array<double> left_area(nbins);
+      Array<int>    left_count(nbins);
+      for (int axis = 0; axis < 3; ++axis) {
+        const double extent = centers[2*axis+1] - centers[2*axis];
+        if (extent <= 0.) continue;
+        IsLeftOfSplit bin_of;
+        bin_of._Centers      = _Centers.data();
+        bin_of._Axis         = axis;
+        bin_of._Min          = centers[2*axis];
+        bin_of._Scale        = nbins / extent;
+        bin_of._NumberOfBins = nbins;
+        for (int b = 0; b < nbins; ++b) {
+          ResetBounds(_Bins[b]._Bounds);
+          _Bins[b]._Count = 0;
+        }
+        for (int i = first; i < first + count; ++i) {
+          const int cellId = _CellIds[i];
+          int b = static_cast<int>((_Centers[3 * cellId + axis] - bin_of._Min) * bin_of._Scale);
+          if (b >= nbins) b = nbins - 1;
+          ExtendBounds(_Bins[b]._Bounds, _Bounds + 6 * cellId);
+          _Bins[b]._Count += 1;
+        }
+        // Sweep from left to right to get area and count left of each plane,
+        // then from right to left to evaluate the cost of each split
+        ResetBounds(left);
+        for (int b = 0, n = 0; b < nbins - 1; ++b) {
+          ExtendBounds(left, _Bins[b]._Bounds);
+          n += _Bins[b]._Count;
+          left_count[b] = n;
+          left_area [b] = (n > 0 ? BoundingVolumeHierarchy::Area(left) : 0.);
+        }
+        ResetBounds(right);
+        for (int b = nbins - 1, n = 0; b > 0; --b) {
+          ExtendBounds(right, _Bins[b]._Bounds);
+          n += _Bins[b]._Count;
+          if (n == 0 || left_count[b-1] == 0) continue;
+          const double cost = left_count[b-1] * left_area[b-1] + n * BoundingVolumeHierarchy::Area(right);
+          if (cost < best_cost) {
+            best_cost  = cost;
+            best_axis  = axis;
+            best_split = b;
+          }
+        }
+      }
+    }
+
+    // Partition cells
+    int mid;
+    if (best_axis != -1) {
+      IsLeftOfSplit is_left;
+      is_left._Centers      = _Centers.data();
+      is_left._Axis         = best_axis;
+      is_left._Min          = centers[2*best_axis];
+      is_left._Scale        = nbins / (centers[2*best_axis+1] - centers[2*best_axis]);
+      is_left._Split        = best_split;
+      is_left._NumberOfBins = nbins;
+      mid = static_cast<int>(partition(_CellIds.begin() + first,
+                                       _CellIds.begin() + first + count,
+                                       is_left) - _CellIds.begin());
+    } else {
+      // Split at median along longest axis of cell centers
+      int axis = 0;
+      for (int i = 1; i < 3; ++i) {
+        if (centers[2*i+1] - centers[2*i] > centers[2*axis+1] - centers[2*axis]) axis = i;
+      }
+      if (centers[2*axis+1] - centers[2*axis] <= 0.) return; // coincident centers
+      CompareCenters compare;
+      compare._Centers = _Centers.data();
+      compare._Axis    = axis;
+      mid = first + count / 2;
+      nth_element(_CellIds.begin() + first,
+                  _CellIds.begin() + mid,
+                  _CellIds.begin() + first + count, compare);
+    }
+    if (mid <= first || mid >= first + count) return;
+
+    // Create child nodes
+    const int child = static_cast<int>(_Nodes.size());
+    _Nodes.resize(_Nodes.size() + 2);
+    _Nodes[node]._First = child;
+    _Nodes[node]._Count = 0;
+    Subdivide(child,     first, mid - first,         depth + 1);
+    Subdivide(child + 1, mid,   first + count - mid, depth + 1);
+  }
+};
+
+
+} // namespace BoundingVolumeHierarchyUtils
+using namespace BoundingVolumeHierarchyUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::CopyAttributes(const BoundingVolumeHierarchy &other)
+{
+  _MaxLeafSize       = other._MaxLeafSize;
+  _NumberOfBins      = other._NumberOfBins;
+  _MaxRefitCostRatio = other._MaxRefitCostRatio;
+  _Nodes             = other._Nodes;
+  _CellIds           = other._CellIds;
+  _BuildCost         = other._BuildCost;
+}
+
+// -----------------------------------------------------------------------------
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+:
+  _MaxLeafSize(4),
+  _NumberOfBins(16),
+  _MaxRefitCostRatio(1.5),
+  _BuildCost(0.)
+{
+}
+
+// -----------------------------------------------------------------------------
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(const BoundingVolumeHierarchy &other)
+:
+  Object(other)
+{
+  CopyAttributes(other);
+}
+
+// -----------------------------------------------------------------------------
+BoundingVolumeHierarchy &BoundingVolumeHierarchy::operator =(const BoundingVolumeHierarchy &other)
+{
+  if (this != &other) {
+    Object::operator =(other);
+    CopyAttributes(other);
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+BoundingVolumeHierarchy::~BoundingVolumeHierarchy()
+{
+}
+
+// =============================================================================
+// Construction of hierarchy
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::Build(int n, const double *bounds)
+{
+  Clear();
+  if (n <= 0) return;
+  _CellIds.resize(n);
+  for (int i = 0; i < n; ++i) _CellIds[i] = i;
+  _Nodes.reserve(2 * n / max(_MaxLeafSize, 1) + 1);
+  _Nodes.resize(1);
+  BuildHierarchy builder(_Nodes, _CellIds, bounds, _NumberOfBins, _MaxLeafSize);
+  builder.Subdivide(0, 0, n, 0);
+  _BuildCost = Cost();
+}
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::Refit(const double *bounds)
+{
+  // Children are stored after their parent, hence a reverse sweep visits
+  // all children of a node before the node itself
+  for (int i = static_cast<int>(_Nodes.size()) - 1; i >= 0; --i) {
+    Node &node = _Nodes[i];
+    ResetBounds(node._Bounds);
+    if (node.IsLeaf()) {
+      for (int j = node._First; j < node._First + node._Count; ++j) {
+        ExtendBounds(node._Bounds, bounds + 6 * _CellIds[j]);
+      }
+    } else {
+      ExtendBounds(node._Bounds, _Nodes[node._First    ]._Bounds);
+      ExtendBounds(node._Bounds, _Nodes[node._First + 1]._Bounds);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool BoundingVolumeHierarchy::Update(int n, const double *bounds)
+{
+  if (n != NumberOfCells() || IsEmpty()) {
+    Build(n, bounds);
+    return true;
+  }
+  Refit(bounds);
+  if (Cost() > _MaxRefitCostRatio * _BuildCost) {
+    Build(n, bounds);
+    return true;
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::Clear()
+{
+  _Nodes.clear();
+  _CellIds.clear();
+  _BuildCost = 0.;
+}
+
+// -----------------------------------------------------------------------------
+double BoundingVolumeHierarchy::Cost() const
+{
+  if (_Nodes.empty()) return 0.;
+  double cost = 0.;
+  for (size_t i = 0; i < _Nodes.size(); ++i) {
+    const Node &node = _Nodes[i];
+    cost += Area(node._Bounds) * (node.IsLeaf() ? node._Count : 1);
+  }
+  const double area = Area(_Nodes[0]._Bounds);
+  return (area > 0. ? cost / area : cost);
+}
+
+// =============================================================================
+// Queries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::FindCellsInBox(const double box[6], const double *bounds,
+                                             Array<int> &cellIds) const
+{
+  OverlapsBox overlaps;
+  overlaps._Box = box;
+  Find(overlaps, bounds, cellIds);
+}
+
+// -----------------------------------------------------------------------------
+void BoundingVolumeHierarchy::FindCellsWithinRadius(const double c[3], double r, const double *bounds,
+                                                    Array<int> &cellIds) const
+{
+  OverlapsSphere overlaps;
+  overlaps._Center  = c;
+  overlaps._Radius2 = r * r;
+  Find(overlaps, bounds, cellIds);
+}
+
+
+} // namespace mirtk
@@ -106,6 +106,10 @@ void ClosestPoint::Initialize()
   // Initialize base class
   PointCorrespondence::Initialize();
 
+  // Discard search structures of previous input point sets
+  _TargetLocator.reset();
+  _SourceLocator.reset();
+
   // Set maximum squared distance threshold
   if (_Sigma < .0) {
     if (_MaxDistance > .0 && !IsInf(_MaxDistance)) {
@@ -124,18 +128,16 @@ void ClosestPoint::Update()
 
   // Find closest points
   if (_FromTargetToSource) {
-    UniquePtr<PointLocator> locator(PointLocator::New(_Source->PointSet(), _SourceSample, &_SourceFeatures));
-    locator->GlobalIndices(true);
-    _SourceIndex = locator->FindClosestPoint(_Target->PointSet(), _TargetSample, &_TargetFeatures, &_SourceDistance);
+    UpdateLocator(_SourceLocator, _Source->PointSet(), _SourceSample, &_SourceFeatures);
+    _SourceIndex = _SourceLocator->FindClosestPoint(_Target->PointSet(), _TargetSample, &_TargetFeatures, &_SourceDistance);
   } else {
     _SourceIndex   .clear();
     _SourceDistance.clear();
   }
 
   if (_FromSourceToTarget) {
-    UniquePtr<PointLocator> locator(PointLocator::New(_Target->PointSet(), _TargetSample, &_TargetFeatures));
-    locator->GlobalIndices(true);
-    _TargetIndex = locator->FindClosestPoint(_Source->PointSet(), _SourceSample, &_SourceFeatures, &_TargetDistance);
+    UpdateLocator(_TargetLocator, _Target->PointSet(), _TargetSample, &_TargetFeatures);
+    _TargetIndex = _TargetLocator->FindClosestPoint(_Source->PointSet(), _SourceSample, &_SourceFeatures, &_TargetDistance);
   } else {
     _TargetIndex   .clear();
     _TargetDistance.clear();
@@ -690,6 +690,20 @@ int PointCorrespondence::GetPointDataIndexByCaseInsensitiveName(vtkPointData *pd
   return -1;
 }
 
+// -----------------------------------------------------------------------------
+void PointCorrespondence
+::UpdateLocator(UniquePtr<PointLocator> &locator, vtkPointSet *dataset,
+                const Array<int> *sample, const FeatureList *features)
+{
+  if (locator && locator->DataSet() == dataset && locator->Sample() == sample) {
+    locator->Features(*features);
+    locator->Refit();
+  } else {
+    locator.reset(PointLocator::New(dataset, sample, features));
+    locator->GlobalIndices(true);
+  }
+}
+
 // -----------------------------------------------------------------------------
 bool PointCorrespondence::Set(const char *param, const char *value)
 {
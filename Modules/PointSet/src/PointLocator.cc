@@ -27,20 +27,18 @@
 #include "mirtk/PointLocator.h"
 
 #include "mirtk/Assert.h"
+#include "mirtk/Math.h"
+#include "mirtk/Memory.h"
 #include "mirtk/Array.h"
 #include "mirtk/ArrayHeap.h"
+#include "mirtk/Algorithm.h"
 #include "mirtk/Pair.h"
 #include "mirtk/Allocate.h"
 #include "mirtk/Deallocate.h"
 #include "mirtk/Parallel.h"
 
-#include "vtkNew.h"
 #include "vtkSmartPointer.h"
-#include "vtkPoints.h"
 #include "vtkPointSet.h"
-#include "vtkPolyData.h"
-#include "vtkIdList.h"
-#include "vtkOctreePointLocator.h"
 
 
 #ifdef HAVE_FLANN
@@ -364,6 +362,497 @@ Array<Array<int> > FlannPointLocator
 }
 
 #endif // HAVE_FLANN
+////////////////////////////////////////////////////////////////////////////////
+// class: GridPointLocator
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Uniform grid of points in up to three-dimensional feature space
+ *
+ * The indices of the points are sorted by grid cell using a counting sort,
+ * i.e., each grid cell refers to a contiguous range of point indices. Queries
+ * visit the grid cells in order of increasing distance from the query point
+ * until no closer point can be found. After the points moved, the grid is
+ * refitted in linear time by redistributing the points among the cells of
+ * the existing grid as long as these remain within the bounds of the grid.
+ */
+class GridPointLocator
+{
+public:
+
+  /// List of point features to use for nearest neighbor search
+  typedef PointLocator::FeatureList FeatureList;
+
+  /// Squared distance and index of found point
+  typedef Pair<double, int> Neighbor;
+
+protected:
+
+  /// Dataset for which search structure is build
+  mirtkPublicAggregateMacro(vtkPointSet, DataSet);
+
+  /// Indices of points to consider only or NULL
+  mirtkPublicAggregateMacro(const Array<int>, Sample);
+
+  /// Indices/names and rescaling parameters of point data arrays
+  mirtkPublicAttributeMacro(FeatureList, Features);
+
+  /// Dimension of feature vectors/points
+  mirtkPublicAttributeMacro(int, PointDimension);
+
+  /// Feature points padded with zeros to three dimensions
+  Array<double> _Points;
+
+  /// Linear index of grid cell of each point
+  Array<int> _PointCell;
+
+  /// Indices of points sorted by grid cell
+  Array<int> _CellPoints;
+
+  /// Offset of first point of each grid cell in _CellPoints
+  Array<int> _CellOffset;
+
+  /// Lower bounds of grid
+  double _Origin[3];
+
+  /// Edge length of grid cells
+  double _CellSize;
+
+  /// Number of grid cells along each dimension
+  int _Size[3];
+
+public:
+
+  /// Constructor
+  GridPointLocator();
+
+  /// Build search structure
+  void Initialize();
+
+  /// Update search structure after the points moved
+  void Refit();
+
+  /// Find nearest neighbor
+  int FindClosestPoint(const double *, double *) const;
+
+  /// Find k nearest neighbors sorted by increasing distance
+  void FindClosestNPoints(int, const double *, Array<Neighbor> &) const;
+
+  /// Find points within radius sorted by increasing distance
+  void FindPointsWithinRadius(double, const double *, Array<Neighbor> &) const;
+
+protected:
+
+  /// Read feature points of dataset and get their bounding box
+  void ReadPoints(double [6]);
+
+  /// Initialize grid geometry such that it encloses the given bounding box
+  void InitializeGrid(const double [6]);
+
+  /// Whether bounding box fits into grid and is not much smaller than it
+  bool FitsGrid(const double [6]) const;
+
+  /// Sort points by grid cell
+  void SortPoints();
+
+  /// Get query point padded with zeros to three dimensions
+  void GetQueryPoint(const double *, double [3]) const;
+
+  /// Get grid cell containing the given point, clamped to the grid bounds
+  void GetCell(const double [3], int [3]) const;
+
+  /// Squared distance of point to grid cell
+  double Distance2ToCell(const double [3], int, int, int) const;
+
+  /// Pass points of grid cell to search visitor unless cell is too far away
+  template <class Visitor>
+  void VisitCell(const double [3], int, int, int, Visitor &) const;
+
+  /// Visit grid cells in order of increasing distance from query point
+  template <class Visitor>
+  void Search(const double [3], Visitor &) const;
+};
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+namespace PointLocatorUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Read feature points of dataset and pad these with zeros to three dimensions
+struct ReadGridPoints
+{
+  vtkPointSet                     *_DataSet;
+  const Array<int>                *_Sample;
+  const PointLocator::FeatureList *_Features;
+  int                              _PointDimension;
+  double                          *_Points;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    Array<double> point(max(_PointDimension, 3), .0);
+    for (int i = re.begin(); i != re.end(); ++i) {
+      PointLocator::GetPoint(point.data(), _DataSet, _Sample, i, _Features);
+      memcpy(_Points + 3 * i, point.data(), 3 * sizeof(double));
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Determine grid cell of each point
+struct ComputeGridCells
+{
+  const double *_Points;
+  const double *_Origin;
+  double        _CellSize;
+  const int    *_Size;
+  int          *_Cell;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    int c[3];
+    for (int i = re.begin(); i != re.end(); ++i) {
+      const double *p = _Points + 3 * i;
+      for (int d = 0; d < 3; ++d) {
+        c[d] = ifloor((p[d] - _Origin[d]) / _CellSize);
+        c[d] = max(0, min(c[d], _Size[d] - 1));
+      }
+      _Cell[i] = c[0] + _Size[0] * (c[1] + _Size[1] * c[2]);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Search visitor which keeps track of the nearest neighbor
+struct ClosestPointVisitor
+{
+  double _Dist2;
+  int    _Index;
+
+  ClosestPointVisitor() : _Dist2(inf), _Index(-1) {}
+
+  double MaxDistance2() const { return _Dist2; }
+
+  void Add(double dist2, int i)
+  {
+    if (dist2 < _Dist2) _Dist2 = dist2, _Index = i;
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Search visitor which keeps track of the k nearest neighbors in a max-heap
+struct ClosestNPointsVisitor
+{
+  Array<GridPointLocator::Neighbor> &_Heap;
+  size_t                             _K;
+
+  ClosestNPointsVisitor(Array<GridPointLocator::Neighbor> &heap, int k)
+  :
+    _Heap(heap), _K(static_cast<size_t>(k))
+  {
+    _Heap.clear();
+  }
+
+  double MaxDistance2() const
+  {
+    return (_Heap.size() < _K ? inf : _Heap.front().first);
+  }
+
+  void Add(double dist2, int i)
+  {
+    if (_Heap.size() < _K) {
+      _Heap.push_back(MakePair(dist2, i));
+      push_heap(_Heap.begin(), _Heap.end());
+    } else if (dist2 < _Heap.front().first) {
+      pop_heap(_Heap.begin(), _Heap.end());
+      _Heap.back() = MakePair(dist2, i);
+      push_heap(_Heap.begin(), _Heap.end());
+    }
+  }
+};
+
+
+} // namespace PointLocatorUtils
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+GridPointLocator::GridPointLocator()
+:
+  _DataSet(NULL),
+  _Sample(NULL),
+  _PointDimension(0),
+  _CellSize(.0)
+{
+  _Origin[0] = _Origin[1] = _Origin[2] = .0;
+  _Size  [0] = _Size  [1] = _Size  [2] = 0;
+}
+
+// -----------------------------------------------------------------------------
+void GridPointLocator::ReadPoints(double bounds[6])
+{
+  const int n = PointLocator::GetNumberOfPoints(_DataSet, _Sample);
+  _Points.resize(3 * n);
+  PointLocatorUtils::ReadGridPoints read;
+  read._DataSet        = _DataSet;
+  read._Sample         = _Sample;
+  read._Features       = &_Features;
+  read._PointDimension = _PointDimension;
+  read._Points         = _Points.data();
+  parallel_for(blocked_range<int>(0, n), read);
+  for (int d = 0; d < 3; ++d) {
+    bounds[2*d] = +inf, bounds[2*d+1] = -inf;
+  }
+  const double *p = _Points.data();
+  for (int i = 0; i < n; ++i, p += 3) {
+    for (int d = 0; d < 3; ++d) {
+      if (p[d] < bounds[2*d  ]) bounds[2*d  ] = p[d];
+      if (p[d] > bounds[2*d+1]) bounds[2*d+1] = p[d];
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void GridPointLocator::InitializeGrid(const double bounds[6])
+{
+  const int n = static_cast<int>(_Points.size() / 3);
+  // Choose cell size such that there are about as many cells as points,
+  // ignoring dimensions along which all points have the same coordinate
+  double extent[3], maxext = .0;
+  for (int d = 0; d < 3; ++d) {
+    extent[d] = bounds[2*d+1] - bounds[2*d];
+    maxext    = max(maxext, extent[d]);
+  }
+  int    ndims  = 0;
+  double volume = 1.0;
+  for (int d = 0; d < 3; ++d) {
+    if (extent[d] > 1e-6 * maxext) {
+      volume *= extent[d];
+      ++ndims;
+    }
+  }
+  _CellSize = (ndims > 0 ? pow(volume / n, 1.0 / ndims) : 1.0);
+  // Add margin of half a cell such that points may move slightly
+  // before the grid has to be rebuilt when it is refitted
+  for (int d = 0; d < 3; ++d) {
+    _Origin[d] = bounds[2*d] - .5 * _CellSize;
+    _Size  [d] = ifloor(extent[d] / _CellSize) + 2;
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool GridPointLocator::FitsGrid(const double bounds[6]) const
+{
+  for (int d = 0; d < 3; ++d) {
+    const double lower = _Origin[d];
+    const double upper = _Origin[d] + _Size[d] * _CellSize;
+    if (bounds[2*d] < lower || bounds[2*d+1] >= upper) return false;
+    if (_Size[d] > 2 && 2.0 * (bounds[2*d+1] - bounds[2*d]) < upper - lower) return false;
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void GridPointLocator::SortPoints()
+{
+  const int n = static_cast<int>(_Points.size() / 3);
+  const int m = _Size[0] * _Size[1] * _Size[2];
+  _PointCell.resize(n);
+  PointLocatorUtils::ComputeGridCells cells;
+  cells._Points   = _Points.data();
+  cells._Origin   = _Origin;
+  cells._CellSize = _CellSize;
+  cells._Size     = _Size;
+  cells._Cell     = _PointCell.data();
+  parallel_for(blocked_range<int>(0, n), cells);
+  // Count number of points per cell
+  _CellOffset.assign(m + 1, 0);
+  for (int i = 0; i < n; ++i) {
+    ++_CellOffset[_PointCell[i] + 1];
+  }
+  for (int c = 0; c < m; ++c) {
+    _CellOffset[c + 1] += _CellOffset[c];
+  }
+  // Sort point indices by cell, shifting offsets by one cell in the process
+  _CellPoints.resize(n);
+  for (int i = 0; i < n; ++i) {
+    _CellPoints[_CellOffset[_PointCell[i]]++] = i;
+  }
+  for (int c = m; c > 0; --c) {
+    _CellOffset[c] = _CellOffset[c - 1];
+  }
+  _CellOffset[0] = 0;
+}
+
+// -----------------------------------------------------------------------------
+void GridPointLocator::Initialize()
+{
+  mirtkAssert(0 < _PointDimension && _PointDimension <= 3, "_PointDimension attribute set");
+  double bounds[6];
+  ReadPoints(bounds);
+  InitializeGrid(bounds);
+  SortPoints();
+}
+
+// -----------------------------------------------------------------------------
+void GridPointLocator::Refit()
+{
+  double bounds[6];
+  ReadPoints(bounds);
+  if (!FitsGrid(bounds)) InitializeGrid(bounds);
+  SortPoints();
+}
+
+// =============================================================================
+// Search
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+inline void GridPointLocator::GetQueryPoint(const double *point, double q[3]) const
+{
+  for (int d = 0; d < 3; ++d) {
+    q[d] = (d < _PointDimension ? point[d] : .0);
+  }
+}
+
+// -----------------------------------------------------------------------------
+inline void GridPointLocator::GetCell(const double q[3], int c[3]) const
+{
+  for (int d = 0; d < 3; ++d) {
+    c[d] = ifloor((q[d] - _Origin[d]) / _CellSize);
+    c[d] = max(0, min(c[d], _Size[d] - 1));
+  }
+}
+
+// -----------------------------------------------------------------------------
+inline double GridPointLocator::Distance2ToCell(const double q[3], int i, int j, int k) const
+{
+  const int c[3] = {i, j, k};
+  double lower, upper, delta, dist2 = .0;
+  for (int d = 0; d < 3; ++d) {
+    lower = _Origin[d] + c[d] * _CellSize;
+    upper = lower + _CellSize;
+    if      (q[d] < lower) delta = lower - q[d];
+    else if (q[d] > upper) delta = q[d] - upper;
+    else                   delta = .0;
+    dist2 += delta * delta;
+  }
+  return dist2;
+}
+
+// -----------------------------------------------------------------------------
+template <class Visitor>
+inline void GridPointLocator::VisitCell(const double q[3], int i, int j, int k, Visitor &visitor) const
+{
+  if (Distance2ToCell(q, i, j, k) >= visitor.MaxDistance2()) return;
+  const int cell = i + _Size[0] * (j + _Size[1] * k);
+  const double *p;
+  double dx, dy, dz;
+  for (int n = _CellOffset[cell]; n < _CellOffset[cell + 1]; ++n) {
+    const int idx = _CellPoints[n];
+    p  = _Points.data() + 3 * idx;
+    dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+    visitor.Add(dx * dx + dy * dy + dz * dz, idx);
+  }
+}
+
+// -----------------------------------------------------------------------------
+template <class Visitor>
+void GridPointLocator::Search(const double q[3], Visitor &visitor) const
+{
+  int c[3], rmax = 0;
+  GetCell(q, c);
+  for (int d = 0; d < 3; ++d) {
+    rmax = max(rmax, max(c[d], _Size[d] - 1 - c[d]));
+  }
+  double bound;
+  for (int r = 0; r <= rmax; ++r) {
+    // Visit cells whose Chebyshev distance to the cell of the query point is r
+    const int i1 = max(c[0] - r, 0), i2 = min(c[0] + r, _Size[0] - 1);
+    const int j1 = max(c[1] - r, 0), j2 = min(c[1] + r, _Size[1] - 1);
+    const int k1 = max(c[2] - r, 0), k2 = min(c[2] + r, _Size[2] - 1);
+    for (int k = k1; k <= k2; ++k)
+    for (int j = j1; j <= j2; ++j) {
+      if (abs(k - c[2]) == r || abs(j - c[1]) == r) {
+        for (int i = i1; i <= i2; ++i) {
+          VisitCell(q, i, j, k, visitor);
+        }
+      } else {
+        if (c[0] - r >= 0)       VisitCell(q, c[0] - r, j, k, visitor);
+        if (c[0] + r < _Size[0]) VisitCell(q, c[0] + r, j, k, visitor);
+      }
+    }
+    // Lower bound of distance of points in cells not yet visited
+    bound = inf;
+    for (int d = 0; d < 3; ++d) {
+      if (c[d] - r > 0) {
+        bound = min(bound, q[d] - (_Origin[d] + (c[d] - r) * _CellSize));
+      }
+      if (c[d] + r < _Size[d] - 1) {
+        bound = min(bound, (_Origin[d] + (c[d] + r + 1) * _CellSize) - q[d]);
+      }
+    }
+    if (IsInf(bound)) break;
+    if (bound >= .0 && bound * bound >= visitor.MaxDistance2()) break;
+  }
+}
+
+// -----------------------------------------------------------------------------
+int GridPointLocator::FindClosestPoint(const double *point, double *dist2) const
+{
+  double q[3];
+  GetQueryPoint(point, q);
+  PointLocatorUtils::ClosestPointVisitor visitor;
+  Search(q, visitor);
+  if (dist2) *dist2 = visitor._Dist2;
+  return visitor._Index;
+}
+
+// -----------------------------------------------------------------------------
+void GridPointLocator
+::FindClosestNPoints(int k, const double *point, Array<Neighbor> &neighbors) const
+{
+  double q[3];
+  GetQueryPoint(point, q);
+  PointLocatorUtils::ClosestNPointsVisitor visitor(neighbors, k);
+  Search(q, visitor);
+  sort_heap(neighbors.begin(), neighbors.end());
+}
+
+// -----------------------------------------------------------------------------
+void GridPointLocator
+::FindPointsWithinRadius(double radius, const double *point, Array<Neighbor> &neighbors) const
+{
+  double q[3], dx, dy, dz, dist2;
+  GetQueryPoint(point, q);
+  neighbors.clear();
+  const double maxdist2 = radius * radius;
+  int c1[3], c2[3];
+  for (int d = 0; d < 3; ++d) {
+    c1[d] = max(0,            ifloor((q[d] - radius - _Origin[d]) / _CellSize));
+    c2[d] = min(_Size[d] - 1, ifloor((q[d] + radius - _Origin[d]) / _CellSize));
+  }
+  const double *p;
+  for (int k = c1[2]; k <= c2[2]; ++k)
+  for (int j = c1[1]; j <= c2[1]; ++j)
+  for (int i = c1[0]; i <= c2[0]; ++i) {
+    if (Distance2ToCell(q, i, j, k) > maxdist2) continue;
+    const int cell = i + _Size[0] * (j + _Size[1] * k);
+    for (int n = _CellOffset[cell]; n < _CellOffset[cell + 1]; ++n) {
+      const int idx = _CellPoints[n];
+      p  = _Points.data() + 3 * idx;
+      dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+      dist2 = dx * dx + dy * dy + dz * dz;
+      if (dist2 <= maxdist2) neighbors.push_back(MakePair(dist2, idx));
+    }
+  }
+  sort(neighbors.begin(), neighbors.end());
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // class: PointLocator
 ////////////////////////////////////////////////////////////////////////////////
@@ -392,7 +881,7 @@ PointLocator::~PointLocator()
 void PointLocator::Initialize()
 {
   // Destruct previous internal locator(s)
-  _VtkLocator = NULL;
+  _GridLocator = nullptr;
 #ifdef HAVE_FLANN
   _FlannLocator = nullptr;
 #endif
@@ -411,23 +900,14 @@ void PointLocator::Initialize()
     cerr << "PointLocator: Point feature vector size is zero!" << endl;
     exit(1);
   }
-  // Build VTK locator for 3-D feature vectors
+  // Build uniform grid for up to 3-D feature vectors
   if (_PointDimension <= 3) {
-    // Dataset of 2/3-D sample feature points
-    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
-    points->SetNumberOfPoints(_NumberOfPoints);
-    double point[3] = {0};
-    for (int i = 0; i < _NumberOfPoints; ++i) {
-      GetPoint(point, _DataSet, _Sample, i, &_Features);
-      points->SetPoint(i, point);
-    }
-    vtkSmartPointer<vtkPolyData> dataset = vtkSmartPointer<vtkPolyData>::New();
-    dataset->SetPoints(points);
-    // Note: vtkOctreeLocator preferred over vtkKdTree because the
-    //       latter is not thread safe even after BuildLocator was called!
-    _VtkLocator = vtkSmartPointer<vtkOctreePointLocator>::New();
-    _VtkLocator->SetDataSet(dataset);
-    _VtkLocator->BuildLocator();
+    _GridLocator = NewShared<GridPointLocator>();
+    _GridLocator->DataSet(_DataSet);
+    _GridLocator->Sample(_Sample);
+    _GridLocator->Features(_Features);
+    _GridLocator->PointDimension(_PointDimension);
+    _GridLocator->Initialize();
   } else {
 #ifdef HAVE_FLANN
     // Build FLANN tree for N-D feature vectors
@@ -454,6 +934,54 @@ PointLocator *PointLocator::New(vtkPointSet       *dataset,
   return locator.release();
 }
 
+// -----------------------------------------------------------------------------
+void PointLocator::Refit()
+{
+  if (_GridLocator && _DataSet &&
+      GetNumberOfPoints(_DataSet, _Sample) == _NumberOfPoints &&
+      GetPointDimension(_DataSet, &_Features) == _PointDimension) {
+    _GridLocator->DataSet(_DataSet);
+    _GridLocator->Sample(_Sample);
+    _GridLocator->Features(_Features);
+    _GridLocator->Refit();
+  } else {
+    Initialize();
+  }
+}
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+namespace PointLocatorUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Copy indices and squared distances of neighbors found by uniform grid
+///
+/// \param[in]  neighbors Squared distances and indices of found points.
+/// \param[in]  sample    Global indices of sample points or NULL.
+/// \param[out] indices   Indices of found points.
+/// \param[out] dist2     Squared distances of found points or NULL.
+inline void GetNeighbors(const Array<GridPointLocator::Neighbor> &neighbors,
+                         const Array<int> *sample, Array<int> &indices, Array<double> *dist2)
+{
+  const size_t n = neighbors.size();
+  indices.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    indices[i] = (sample ? (*sample)[neighbors[i].second] : neighbors[i].second);
+  }
+  if (dist2) {
+    dist2->resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      (*dist2)[i] = neighbors[i].first;
+    }
+  }
+}
+
+
+} // namespace PointLocatorUtils
+
 // =============================================================================
 // Closest point
 // =============================================================================
@@ -464,15 +992,9 @@ int PointLocator::FindClosestPoint(double *point, double *dist2)
   int index;
 
   // ---------------------------------------------------------------------------
-  // Using VTK
-  if (_VtkLocator) {
-    vtkIdType j = _VtkLocator->FindClosestPoint(point);
-    if (dist2) {
-      double p[3] = {0};
-      _VtkLocator->GetDataSet()->GetPoint(j, p);
-      *dist2 = Distance2BetweenPoints(p, point);
-    }
-    index = static_cast<int>(j);
+  // Using uniform grid
+  if (_GridLocator) {
+    index = _GridLocator->FindClosestPoint(point, dist2);
   }
 
   // ---------------------------------------------------------------------------
@@ -522,14 +1044,10 @@ struct FindClosestPoint
 
   void operator ()(const blocked_range<int> &idx) const
   {
-    if (_Dist2) {
-      for (int i = idx.begin(); i != idx.end(); ++i) {
-        (*_Index)[i] = _Locator->FindClosestPoint(_DataSet, _Sample, i, _Features, &((*_Dist2)[i]));
-      }
-    } else {
-      for (int i = idx.begin(); i != idx.end(); ++i) {
-        (*_Index)[i] = _Locator->FindClosestPoint(_DataSet, _Sample, i, _Features);
-      }
+    Array<double> point(max(_Locator->PointDimension(), 3), .0);
+    for (int i = idx.begin(); i != idx.end(); ++i) {
+      PointLocator::GetPoint(point.data(), _DataSet, _Sample, i, _Features);
+      (*_Index)[i] = _Locator->FindClosestPoint(point.data(), _Dist2 ? &((*_Dist2)[i]) : NULL);
     }
   }
 };
@@ -541,7 +1059,7 @@ Array<int> PointLocator
                    const FeatureList *features, Array<double> *dist2)
 {
 #ifdef HAVE_FLANN
-  if (!_VtkLocator && _FlannLocator) {
+  if (!_GridLocator && _FlannLocator) {
     Array<int> index;
     index = _FlannLocator->FindClosestPoint(dataset, sample, features, dist2);
     if (_Sample && _GlobalIndices) {
@@ -576,20 +1094,11 @@ Array<int> PointLocator::FindClosestNPoints(int k, double *point, Array<double>
   Array<int> indices;
 
   // ---------------------------------------------------------------------------
-  // Using VTK
-  if (_VtkLocator) {
-    double p[3];
-    vtkSmartPointer<vtkIdList> ids = vtkSmartPointer<vtkIdList>::New();
-    _VtkLocator->FindClosestNPoints(k, point, ids);
-    indices.resize(ids->GetNumberOfIds());
-    if (dist2) dist2->resize(ids->GetNumberOfIds());
-    for (vtkIdType i = 0; i < ids->GetNumberOfIds(); ++i) {
-      indices[i] = static_cast<int>(ids->GetId(i));
-      if (dist2) {
-        _VtkLocator->GetDataSet()->GetPoint(ids->GetId(i), p);
-        (*dist2)[i] = Distance2BetweenPoints(point, p);
-      }
-    }
+  // Using uniform grid
+  if (_GridLocator) {
+    Array<GridPointLocator::Neighbor> neighbors;
+    _GridLocator->FindClosestNPoints(k, point, neighbors);
+    PointLocatorUtils::GetNeighbors(neighbors, NULL, indices, dist2);
   }
 
   // ---------------------------------------------------------------------------
@@ -620,6 +1129,7 @@ Array<int> PointLocator::FindClosestNPoints(int k, double *point, Array<double>
     }
     make_heap(dists.begin(), dists.end(), comp);
     indices.resize(k);
+    if (dist2) dist2->resize(k);
     for (int i = 0; i < k; ++i) {
       Pair<double, int> &min = dists.front();
       if (dist2) (*dist2)[i] = min.first;
@@ -653,13 +1163,19 @@ struct FindClosestNPoints
 
   void operator ()(const blocked_range<int> &idx) const
   {
-    if (_Dist2) {
-      for (int i = idx.begin(); i != idx.end(); ++i) {
-        (*_Indices)[i] = _Locator->FindClosestNPoints(_K, _DataSet, _Sample, i, _Features, &((*_Dist2)[i]));
-      }
-    } else {
-      for (int i = idx.begin(); i != idx.end(); ++i) {
-        (*_Indices)[i] = _Locator->FindClosestNPoints(_K, _DataSet, _Sample, i, _Features);
+    const GridPointLocator * const grid = _Locator->_GridLocator.get();
+    const Array<int> * const sample = (_Locator->GlobalIndices() ? _Locator->Sample() : NULL);
+    Array<double> point(max(_Locator->PointDimension(), 3), .0);
+    Array<GridPointLocator::Neighbor> neighbors;
+    neighbors.reserve(_K);
+    for (int i = idx.begin(); i != idx.end(); ++i) {
+      PointLocator::GetPoint(point.data(), _DataSet, _Sample, i, _Features);
+      Array<double> * const dist2 = (_Dist2 ? &((*_Dist2)[i]) : NULL);
+      if (grid) {
+        grid->FindClosestNPoints(_K, point.data(), neighbors);
+        GetNeighbors(neighbors, sample, (*_Indices)[i], dist2);
+      } else {
+        (*_Indices)[i] = _Locator->FindClosestNPoints(_K, point.data(), dist2);
       }
     }
   }
@@ -680,7 +1196,7 @@ Array<Array<int> > PointLocator
   }
 
 #ifdef HAVE_FLANN
-  if (!_VtkLocator && _FlannLocator) {
+  if (!_GridLocator && _FlannLocator) {
     Array<Array<int> > indices;
     indices = _FlannLocator->FindClosestNPoints(k, dataset, sample, features, dist2);
     if (_Sample && _GlobalIndices) {
@@ -719,20 +1235,11 @@ Array<int> PointLocator
   Array<int> indices;
 
   // ---------------------------------------------------------------------------
-  // Using VTK
-  if (_VtkLocator) {
-    double p[3] = {0};
-    vtkNew<vtkIdList> ids;
-    _VtkLocator->FindPointsWithinRadius(radius, point, ids.GetPointer());
-    indices.resize(ids->GetNumberOfIds());
-    if (dist2) dist2->resize(ids->GetNumberOfIds());
-    for (vtkIdType i = 0; i < ids->GetNumberOfIds(); ++i) {
-      indices[i] = static_cast<int>(ids->GetId(i));
-      if (dist2) {
-        _VtkLocator->GetDataSet()->GetPoint(ids->GetId(i), p);
-        (*dist2)[i] = Distance2BetweenPoints(point, p);
-      }
-    }
+  // Using uniform grid
+  if (_GridLocator) {
+    Array<GridPointLocator::Neighbor> neighbors;
+    _GridLocator->FindPointsWithinRadius(radius, point, neighbors);
+    PointLocatorUtils::GetNeighbors(neighbors, NULL, indices, dist2);
   }
 
   // ---------------------------------------------------------------------------
@@ -798,13 +1305,18 @@ struct FindPointsWithinRadius
 
   void operator ()(const blocked_range<int> &idx) const
   {
-    if (_Dist2) {
-      for (int i = idx.begin(); i != idx.end(); ++i) {
-        (*_Indices)[i] = _Locator->FindPointsWithinRadius(_Radius, _DataSet, _Sample, i, _Features, &((*_Dist2)[i]));
-      }
-    } else {
-      for (int i = idx.begin(); i != idx.end(); ++i) {
-        (*_Indices)[i] = _Locator->FindPointsWithinRadius(_Radius, _DataSet, _Sample, i, _Features);
+    const GridPointLocator * const grid = _Locator->_GridLocator.get();
+    const Array<int> * const sample = (_Locator->GlobalIndices() ? _Locator->Sample() : NULL);
+    Array<double> point(max(_Locator->PointDimension(), 3), .0);
+    Array<GridPointLocator::Neighbor> neighbors;
+    for (int i = idx.begin(); i != idx.end(); ++i) {
+      PointLocator::GetPoint(point.data(), _DataSet, _Sample, i, _Features);
+      Array<double> * const dist2 = (_Dist2 ? &((*_Dist2)[i]) : NULL);
+      if (grid) {
+        grid->FindPointsWithinRadius(_Radius, point.data(), neighbors);
+        GetNeighbors(neighbors, sample, (*_Indices)[i], dist2);
+      } else {
+        (*_Indices)[i] = _Locator->FindPointsWithinRadius(_Radius, point.data(), dist2);
       }
     }
   }
@@ -822,7 +1334,7 @@ Array<Array<int> > PointLocator
               "Query points must have same dimension as feature points");
 
 #ifdef HAVE_FLANN
-  if (!_VtkLocator && _FlannLocator) {
+  if (!_GridLocator && _FlannLocator) {
     Array<Array<int> > indices;
     indices = _FlannLocator->FindPointsWithinRadius(radius, dataset, sample, features, dist2);
     if (_Sample && _GlobalIndices) {
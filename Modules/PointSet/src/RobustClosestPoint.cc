@@ -104,6 +104,17 @@ ParameterList RobustClosestPoint::Parameter() const
 // Correspondences
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+void RobustClosestPoint::Initialize()
+{
+  // Initialize base class
+  FuzzyCorrespondence::Initialize();
+
+  // Discard search structures of previous input point sets
+  _TargetLocator.reset();
+  _SourceLocator.reset();
+}
+
 // -----------------------------------------------------------------------------
 void RobustClosestPoint::CalculateWeights()
 {
@@ -116,17 +127,11 @@ void RobustClosestPoint::CalculateWeights()
   Array<int   > corr12, corr21;
   Array<double> dist12, dist21;
 
-  UniquePtr<PointLocator> source_locator;
-  source_locator.reset(PointLocator::New(_Source->PointSet(), _SourceSample, &_SourceFeatures));
-  source_locator->GlobalIndices(true);
-  corr12 = source_locator->FindClosestPoint(_Target->PointSet(), _TargetSample, &_TargetFeatures, &dist12);
-  source_locator.reset();
-
-  UniquePtr<PointLocator> target_locator;
-  target_locator.reset(PointLocator::New(_Target->PointSet(), _TargetSample, &_TargetFeatures));
-  target_locator->GlobalIndices(true);
-  corr21 = target_locator->FindClosestPoint(_Source->PointSet(), _SourceSample, &_SourceFeatures, &dist21);
-  target_locator.reset();
+  UpdateLocator(_SourceLocator, _Source->PointSet(), _SourceSample, &_SourceFeatures);
+  corr12 = _SourceLocator->FindClosestPoint(_Target->PointSet(), _TargetSample, &_TargetFeatures, &dist12);
+
+  UpdateLocator(_TargetLocator, _Target->PointSet(), _TargetSample, &_TargetFeatures);
+  corr21 = _TargetLocator->FindClosestPoint(_Source->PointSet(), _SourceSample, &_SourceFeatures, &dist21);
 
   // Allocate lists for non-zero weight entries
   const int nentries = (_Weight.Layout() == WeightMatrix::CRS ? _M : _N);
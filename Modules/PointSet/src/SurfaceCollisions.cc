@@ -38,9 +38,6 @@
 #include "vtkFloatArray.h"
 #include "vtkUnsignedCharArray.h"
 
-#include "vtkAbstractPointLocator.h"
-#include "vtkOctreePointLocator.h"
-
 
 namespace mirtk {
 
@@ -116,6 +113,78 @@ public:
   }
 };
 
+// -----------------------------------------------------------------------------
+/// Compute axis-aligned bounding box of each triangle
+class ComputeCellBounds
+{
+  vtkPolyData *_Surface;
+  double      *_Bounds;
+
+  ComputeCellBounds(vtkPolyData *surface, double *bounds)
+  :
+    _Surface(surface), _Bounds(bounds)
+  {}
+
+public:
+
+  /// Compute bounding boxes of specified range of cells
+  void operator ()(const blocked_range<vtkIdType> &re) const
+  {
+    vtkIdType npts, *pts;
+    double p[3], *b;
+
+    for (vtkIdType cellId = re.begin(); cellId != re.end(); ++cellId) {
+      _Surface->GetCellPoints(cellId, npts, pts);
+      b = _Bounds + 6 * cellId;
+      _Surface->GetPoint(pts[0], p);
+      b[0] = b[1] = p[0];
+      b[2] = b[3] = p[1];
+      b[4] = b[5] = p[2];
+      for (vtkIdType i = 1; i < npts; ++i) {
+        _Surface->GetPoint(pts[i], p);
+        if (p[0] < b[0]) b[0] = p[0];
+        if (p[0] > b[1]) b[1] = p[0];
+        if (p[1] < b[2]) b[2] = p[1];
+        if (p[1] > b[3]) b[3] = p[1];
+        if (p[2] < b[4]) b[4] = p[2];
+        if (p[2] > b[5]) b[5] = p[2];
+      }
+    }
+  }
+
+  /// Compute bounding boxes of surface faces
+  static void Run(vtkPolyData *surface, Array<double> &bounds)
+  {
+    bounds.resize(6 * surface->GetNumberOfCells());
+    if (surface->GetNumberOfCells() == 0) return;
+    ComputeCellBounds eval(surface, bounds.data());
+    parallel_for(blocked_range<vtkIdType>(0, surface->GetNumberOfCells()), eval);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Query of bounding volume hierarchy for triangles which may collide
+///
+/// A nearby triangle can only intersect or be closer than the minimum distance
+/// to a given triangle when its bounding box overlaps the bounding box of the
+/// given triangle enlarged by the minimum distance. The search can be extended
+/// and limited to a sphere around the triangle center by the minimum and
+/// maximum search radius, respectively.
+struct CollisionCandidates
+{
+  double _Box[6];
+  double _Center[3];
+  double _MinRadius2;
+  double _MaxRadius2;
+
+  bool operator ()(const double bounds[6]) const
+  {
+    const double d2 = BoundingVolumeHierarchy::Distance2(bounds, _Center);
+    if (d2 > _MaxRadius2) return false;
+    return d2 <= _MinRadius2 || BoundingVolumeHierarchy::Overlap(_Box, bounds);
+  }
+};
+
 // -----------------------------------------------------------------------------
 /// Check for collisions such as self-intersections and faces too close
 class FindCollisions
@@ -126,14 +195,14 @@ class FindCollisions
   typedef SurfaceCollisions::CollisionsArray    CollisionsArray;
   typedef SurfaceCollisions::CollisionInfo      CollisionInfo;
 
-  SurfaceCollisions       *_Filter;
-  vtkAbstractPointLocator *_Locator;
-  IntersectionsArray      *_Intersections;
-  CollisionsArray         *_Collisions;
-  double                   _MaxRadius;
-  double                   _MinFrontfaceDistance;
-  double                   _MinBackfaceDistance;
-  double                   _MinAngleCos;
+  SurfaceCollisions             *_Filter;
+  const BoundingVolumeHierarchy *_Hierarchy;
+  const double                  *_Bounds;
+  IntersectionsArray            *_Intersections;
+  CollisionsArray               *_Collisions;
+  double                         _MinFrontfaceDistance;
+  double                         _MinBackfaceDistance;
+  double                         _MinAngleCos;
 
   /// Check whether point c is on the "left" of the line defined by a and b
   inline int IsLeft(const double a[2], const double b[2], const double c[2]) const
@@ -150,23 +219,23 @@ public:
     vtkDataArray *mask      = _Filter->Mask();
     vtkPolyData  *surface   = _Filter->Output();
     vtkDataArray *center    = _Filter->GetCenterArray();
-    vtkDataArray *radius    = _Filter->GetRadiusArray();
     vtkDataArray *coll_type = _Filter->GetCollisionTypeArray();
 
     const bool   coll_test    = (_MinFrontfaceDistance > .0 || _MinBackfaceDistance > .0);
     const double min_distance = max(_MinFrontfaceDistance, _MinBackfaceDistance);
-    const double R            = _MaxRadius + 1.1 * min_distance;
+    const double max_radius   = _Filter->MaxSearchRadius();
 
     double         tri1[3][3], tri2[3][3], tri1_2D[3][2], tri2_2D[3][2];
-    double         n1[3], n2[3], p1[3], p2[3], r1, c1[3], d[3], search_radius, dot;
+    double         n1[3], n2[3], p1[3], p2[3], d[3], dot;
     int            tri12[3], i1, i2, shared_vertex1, shared_vertex2, coplanar, s1, s2;
-    vtkIdType      npts, *pts1, *pts2, *cells, cellId1, cellId2;
-    vtkPolyDataGetPointCellsNumCellsType ncells;
+    vtkIdType      npts, *pts1, *pts2, cellId1, cellId2;
     CollisionInfo  collision;
     CollisionType  type;
 
-    vtkSmartPointer<vtkIdList> ptIds   = vtkSmartPointer<vtkIdList>::New();
-    vtkSmartPointer<vtkIdList> cellIds = vtkSmartPointer<vtkIdList>::New();
+    CollisionCandidates query;
+    query._MinRadius2 = pow(_Filter->MinSearchRadius(), 2);
+    query._MaxRadius2 = (IsInf(max_radius) ? inf : max_radius * max_radius);
+    Array<int> cellIds;
 
     for (cellId1 = re.begin(); cellId1 != re.end(); ++cellId1) {
 
@@ -185,24 +254,19 @@ public:
       surface->GetPoint(pts1[2], tri1[2]);
       vtkTriangle::ComputeNormal(tri1[0], tri1[1], tri1[2], n1);
 
-      // Get bounding sphere
-      center->GetTuple(cellId1, c1);
-      r1 = radius->GetComponent(cellId1, 0);
-
-      // Find other triangles within search radius
-      search_radius = min(max(_Filter->MinSearchRadius(), r1 + R), _Filter->MaxSearchRadius());
-      _Locator->FindPointsWithinRadius(search_radius, c1, ptIds);
-      cellIds->Reset();
-      for (vtkIdType i = 0; i < ptIds->GetNumberOfIds(); ++i) {
-        surface->GetPointCells(ptIds->GetId(i), ncells, cells);
-        for (vtkPolyDataGetPointCellsNumCellsType j = 0; j < ncells; ++j) {
-          if (cells[j] != cellId1) cellIds->InsertUniqueId(cells[j]);
-        }
+      // Find other triangles which may intersect or collide with this triangle
+      const double *b1 = _Bounds + 6 * cellId1;
+      for (int j = 0; j < 6; j += 2) {
+        query._Box[j  ] = b1[j  ] - min_distance;
+        query._Box[j+1] = b1[j+1] + min_distance;
       }
+      center->GetTuple(cellId1, query._Center);
+      _Hierarchy->Find(query, _Bounds, cellIds);
 
       // Check for collisions between this triangle and the found nearby triangles
-      for (vtkIdType i = 0; i < cellIds->GetNumberOfIds(); ++i) {
-        cellId2 = cellIds->GetId(i);
+      for (size_t i = 0; i < cellIds.size(); ++i) {
+        cellId2 = cellIds[i];
+        if (cellId2 == cellId1) continue;
 
         // Get vertex positions of nearby candidate triangle
         surface->GetCellPoints(cellId2, npts, pts2);
@@ -394,21 +458,18 @@ public:
   }
 
   /// Find collision and self-intersections
-  static void Run(SurfaceCollisions  *filter,
-                  IntersectionsArray *intersections,
-                  CollisionsArray    *collisions)
+  static void Run(SurfaceCollisions             *filter,
+                  const BoundingVolumeHierarchy *hierarchy,
+                  const double                  *bounds,
+                  IntersectionsArray            *intersections,
+                  CollisionsArray               *collisions)
   {
-    vtkDataArray *radius = filter->GetRadiusArray();
-    vtkSmartPointer<vtkAbstractPointLocator> locator;
-    locator = vtkSmartPointer<vtkOctreePointLocator>::New();
-    locator->SetDataSet(filter->Output());
-    locator->BuildLocator();
     FindCollisions body;
     body._Filter               = filter;
-    body._Locator              = locator;
+    body._Hierarchy            = hierarchy;
+    body._Bounds               = bounds;
     body._Intersections        = intersections;
     body._Collisions           = collisions;
-    body._MaxRadius            = radius->GetRange(0)[1];
     body._MinAngleCos          = cos(filter->MaxAngle() * rad_per_deg);
     body._MinFrontfaceDistance = filter->MinFrontfaceDistance();
     body._MinBackfaceDistance  = filter->MinBackfaceDistance();
@@ -447,6 +508,8 @@ void SurfaceCollisions::CopyAttributes(const SurfaceCollisions &other)
   _ResetCollisionType          = other._ResetCollisionType;
   _Intersections               = other._Intersections;
   _Collisions                  = other._Collisions;
+  _Hierarchy                   = other._Hierarchy;
+  _CellBounds                  = other._CellBounds;
 }
 
 // -----------------------------------------------------------------------------
@@ -625,9 +688,14 @@ void SurfaceCollisions::Initialize()
 // -----------------------------------------------------------------------------
 void SurfaceCollisions::Execute()
 {
-  if (_Output->GetNumberOfCells() > 0) {
-    FindCollisions::Run(this, _StoreIntersectionDetails ? &_Intersections : nullptr,
-                              _StoreCollisionDetails    ? &_Collisions    : nullptr);
+  const int ncells = static_cast<int>(_Output->GetNumberOfCells());
+  if (ncells > 0) {
+    // Refit bounding volume hierarchy of previous run if mesh is only deformed
+    ComputeCellBounds::Run(_Output, _CellBounds);
+    _Hierarchy.Update(ncells, _CellBounds.data());
+    FindCollisions::Run(this, &_Hierarchy, _CellBounds.data(),
+                        _StoreIntersectionDetails ? &_Intersections : nullptr,
+                        _StoreCollisionDetails    ? &_Collisions    : nullptr);
   }
 }
 
@@ -0,0 +1,147 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2016 Imperial College London
+ * Copyright 2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/BoundingVolumeHierarchy.h"
+
+#include "mirtk/Algorithm.h"
+#include "mirtk/Random.h"
+
+#include "gtest/gtest.h"
+
+using namespace mirtk;
+
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Bounding boxes of small random triangles on the unit sphere
+Array<double> MakeBounds(int n, unsigned int seed = 1)
+{
+  mt19937 rng(seed);
+  uniform_real_distribution<double> random(0., 1.);
+  Array<double> bounds(6 * n);
+  for (int i = 0; i < n; ++i) {
+    const double theta = 2. * pi * random(rng);
+    const double phi   = acos(2. * random(rng) - 1.);
+    const double c[3]  = {sin(phi) * cos(theta), sin(phi) * sin(theta), cos(phi)};
+    for (int d = 0; d < 3; ++d) {
+      bounds[6*i+2*d  ] = c[d] - .02 * random(rng);
+      bounds[6*i+2*d+1] = c[d] + .02 * random(rng);
+    }
+  }
+  return bounds;
+}
+
+// -----------------------------------------------------------------------------
+/// Find cells overlapping box by brute force
+Array<int> FindCellsInBox(const Array<double> &bounds, const double box[6])
+{
+  Array<int> cellIds;
+  for (int i = 0; i < static_cast<int>(bounds.size() / 6); ++i) {
+    if (BoundingVolumeHierarchy::Overlap(box, bounds.data() + 6 * i)) cellIds.push_back(i);
+  }
+  return cellIds;
+}
+
+// -----------------------------------------------------------------------------
+/// Compare box queries of hierarchy to brute force search
+void CompareToBruteForce(const BoundingVolumeHierarchy &bvh, const Array<double> &bounds)
+{
+  Array<int> cellIds;
+  for (int i = 0; i < static_cast<int>(bounds.size() / 6); i += 7) {
+    double box[6];
+    for (int d = 0; d < 6; ++d) box[d] = bounds[6*i+d] + (d % 2 == 0 ? -.05 : .05);
+    bvh.FindCellsInBox(box, bounds.data(), cellIds);
+    sort(cellIds.begin(), cellIds.end());
+    ASSERT_EQ(FindCellsInBox(bounds, box), cellIds);
+  }
+}
+
+// =============================================================================
+// Tests
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+TEST(BoundingVolumeHierarchy, Build)
+{
+  const int n = 5000;
+  Array<double> bounds = MakeBounds(n);
+  BoundingVolumeHierarchy bvh;
+  bvh.Build(n, bounds.data());
+  ASSERT_EQ(n, bvh.NumberOfCells());
+  Array<int> cellIds = bvh.CellIds();
+  sort(cellIds.begin(), cellIds.end());
+  for (int i = 0; i < n; ++i) ASSERT_EQ(i, cellIds[i]);
+  for (size_t i = 0; i < bvh.Nodes().size(); ++i) {
+    EXPECT_LE(bvh.Nodes()[i]._Count, bvh.MaxLeafSize());
+  }
+  CompareToBruteForce(bvh, bounds);
+}
+
+// -----------------------------------------------------------------------------
+TEST(BoundingVolumeHierarchy, FindCellsWithinRadius)
+{
+  const int n = 2000;
+  Array<double> bounds = MakeBounds(n, 7);
+  BoundingVolumeHierarchy bvh;
+  bvh.Build(n, bounds.data());
+  const double c[3] = {.5, .5, .5}, r = .4;
+  Array<int> cellIds, expected;
+  for (int i = 0; i < n; ++i) {
+    if (BoundingVolumeHierarchy::Distance2(bounds.data() + 6 * i, c) <= r * r) expected.push_back(i);
+  }
+  bvh.FindCellsWithinRadius(c, r, bounds.data(), cellIds);
+  sort(cellIds.begin(), cellIds.end());
+  EXPECT_FALSE(expected.empty());
+  EXPECT_EQ(expected, cellIds);
+}
+
+// -----------------------------------------------------------------------------
+TEST(BoundingVolumeHierarchy, Refit)
+{
+  const int n = 3000;
+  Array<double> bounds = MakeBounds(n);
+  BoundingVolumeHierarchy bvh;
+  bvh.Build(n, bounds.data());
+  const Array<int> cellIds = bvh.CellIds();
+  // Small deformation is refit without changing the tree structure
+  for (int i = 0; i < n; ++i) {
+    for (int d = 0; d < 6; ++d) bounds[6*i+d] *= 1.01;
+  }
+  EXPECT_FALSE(bvh.Update(n, bounds.data()));
+  EXPECT_EQ(cellIds, bvh.CellIds());
+  CompareToBruteForce(bvh, bounds);
+  // Large deformation, i.e., shuffled cells, triggers a rebuild
+  Array<double> shuffled = MakeBounds(n, 3);
+  EXPECT_TRUE(bvh.Update(n, shuffled.data()));
+  CompareToBruteForce(bvh, shuffled);
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,200 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2016 Imperial College London
+ * Copyright 2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/PointLocator.h"
+
+#include "mirtk/Pair.h"
+#include "mirtk/Algorithm.h"
+#include "mirtk/Random.h"
+
+#include "vtkSmartPointer.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+
+#include "gtest/gtest.h"
+
+using namespace mirtk;
+
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Random points in the cube [-s, s]^3, or the square [-s, s]^2 if planar
+vtkSmartPointer<vtkPolyData> MakePoints(int n, unsigned int seed, double s = 10., bool planar = false)
+{
+  mt19937 rng(seed);
+  uniform_real_distribution<double> random(-s, s);
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetNumberOfPoints(n);
+  for (int i = 0; i < n; ++i) {
+    const double x = random(rng);
+    const double y = random(rng);
+    const double z = (planar ? 0. : random(rng));
+    points->SetPoint(i, x, y, z);
+  }
+  vtkSmartPointer<vtkPolyData> dataset = vtkSmartPointer<vtkPolyData>::New();
+  dataset->SetPoints(points);
+  return dataset;
+}
+
+// -----------------------------------------------------------------------------
+/// Displace points of dataset, i.e., p' = a * p + b + c * noise
+void MovePoints(vtkPolyData *dataset, unsigned int seed, double a, double b, double c)
+{
+  mt19937 rng(seed);
+  uniform_real_distribution<double> noise(-c, c);
+  vtkPoints *points = dataset->GetPoints();
+  double p[3];
+  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); ++i) {
+    points->GetPoint(i, p);
+    for (int d = 0; d < 3; ++d) {
+      p[d] = a * p[d] + b + noise(rng);
+    }
+    points->SetPoint(i, p);
+  }
+  points->Modified();
+}
+
+// -----------------------------------------------------------------------------
+/// Compare results of locator queries to brute force nearest neighbor search
+void CompareToBruteForce(PointLocator *locator, vtkPolyData *dataset,
+                         const Array<int> *sample, vtkPolyData *queries,
+                         int k, double radius)
+{
+  const double tol = 1e-12;
+  const int    n   = PointLocator::GetNumberOfPoints(dataset, sample);
+  const int    m   = static_cast<int>(queries->GetNumberOfPoints());
+
+  Array<double>          dist2;
+  Array<Array<double> >  knn_dist2, rad_dist2;
+  Array<int>             closest = locator->FindClosestPoint(queries, &dist2);
+  Array<Array<int> >     knn     = locator->FindClosestNPoints(k, queries, &knn_dist2);
+  Array<Array<int> >     rad     = locator->FindPointsWithinRadius(radius, queries, &rad_dist2);
+  ASSERT_EQ(m, static_cast<int>(closest.size()));
+  ASSERT_EQ(m, static_cast<int>(knn.size()));
+  ASSERT_EQ(m, static_cast<int>(rad.size()));
+
+  // Squared distance of query point to point with given locator index
+  Point p, q;
+  auto distance2 = [&](int idx) {
+    if (sample && !locator->GlobalIndices()) idx = (*sample)[idx];
+    dataset->GetPoint(idx, p);
+    return p.SquaredDistance(q);
+  };
+
+  Array<Pair<double, int> > expected(n);
+  for (int j = 0; j < m; ++j) {
+    queries->GetPoint(j, q);
+    for (int i = 0; i < n; ++i) {
+      PointLocator::GetPoint(p, dataset, sample, i);
+      expected[i] = MakePair(p.SquaredDistance(q), i);
+    }
+    sort(expected.begin(), expected.end());
+    // Closest point
+    EXPECT_NEAR(expected[0].first, dist2[j], tol) << "query " << j;
+    EXPECT_NEAR(expected[0].first, distance2(closest[j]), tol) << "query " << j;
+    // k nearest neighbors in ascending order of distance
+    ASSERT_EQ(k, static_cast<int>(knn[j].size())) << "query " << j;
+    for (int l = 0; l < k; ++l) {
+      EXPECT_NEAR(expected[l].first, knn_dist2[j][l], tol) << "query " << j << ", neighbor " << l;
+      EXPECT_NEAR(expected[l].first, distance2(knn[j][l]), tol) << "query " << j << ", neighbor " << l;
+    }
+    // Points within radius
+    int count = 0;
+    while (count < n && expected[count].first <= radius * radius) ++count;
+    ASSERT_EQ(count, static_cast<int>(rad[j].size())) << "query " << j;
+    for (int l = 0; l < count; ++l) {
+      EXPECT_LE(rad_dist2[j][l], radius * radius) << "query " << j;
+      EXPECT_NEAR(rad_dist2[j][l], distance2(rad[j][l]), tol) << "query " << j;
+    }
+    // Single point query
+    double d2;
+    const int idx = locator->FindClosestPoint(q, &d2);
+    EXPECT_NEAR(expected[0].first, d2, tol) << "query " << j;
+    EXPECT_NEAR(expected[0].first, distance2(idx), tol) << "query " << j;
+  }
+}
+
+// =============================================================================
+// Tests
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+TEST(PointLocator, BruteForce)
+{
+  vtkSmartPointer<vtkPolyData> dataset = MakePoints(2000, 1u);
+  vtkSmartPointer<vtkPolyData> queries = MakePoints(300,  2u, 13.);
+  UniquePtr<PointLocator> locator(PointLocator::New(dataset));
+  CompareToBruteForce(locator.get(), dataset, nullptr, queries, 7, 1.5);
+}
+
+// -----------------------------------------------------------------------------
+TEST(PointLocator, Sample)
+{
+  vtkSmartPointer<vtkPolyData> dataset = MakePoints(2000, 3u);
+  vtkSmartPointer<vtkPolyData> queries = MakePoints(300,  4u, 13.);
+  Array<int> sample;
+  for (int i = 0; i < 2000; i += 3) sample.push_back(i);
+  UniquePtr<PointLocator> locator(PointLocator::New(dataset, &sample));
+  CompareToBruteForce(locator.get(), dataset, &sample, queries, 5, 2.);
+  locator->GlobalIndices(true);
+  CompareToBruteForce(locator.get(), dataset, &sample, queries, 5, 2.);
+}
+
+// -----------------------------------------------------------------------------
+TEST(PointLocator, Planar)
+{
+  vtkSmartPointer<vtkPolyData> dataset = MakePoints(2000, 5u, 10., true);
+  vtkSmartPointer<vtkPolyData> queries = MakePoints(300,  6u, 13.);
+  UniquePtr<PointLocator> locator(PointLocator::New(dataset));
+  CompareToBruteForce(locator.get(), dataset, nullptr, queries, 7, 2.);
+}
+
+// -----------------------------------------------------------------------------
+TEST(PointLocator, Refit)
+{
+  vtkSmartPointer<vtkPolyData> dataset = MakePoints(2000, 7u);
+  vtkSmartPointer<vtkPolyData> queries = MakePoints(300,  8u, 13.);
+  UniquePtr<PointLocator> locator(PointLocator::New(dataset));
+  // Small displacement, points are redistributed among existing grid cells
+  MovePoints(dataset, 9u, 1., 0., .05);
+  locator->Refit();
+  CompareToBruteForce(locator.get(), dataset, nullptr, queries, 7, 1.5);
+  // Points moved out of grid
+  MovePoints(dataset, 10u, 2., 3., 0.);
+  locator->Refit();
+  CompareToBruteForce(locator.get(), dataset, nullptr, queries, 7, 3.);
+  // Extent of points shrunk
+  MovePoints(dataset, 11u, .1, 0., 0.);
+  locator->Refit();
+  CompareToBruteForce(locator.get(), dataset, nullptr, queries, 7, .5);
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
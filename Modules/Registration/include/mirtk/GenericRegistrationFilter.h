@@ -263,6 +263,15 @@ public:
   /// Whether to precompute image derivatives or compute them on the fly
   mirtkPublicAttributeMacro(bool, PrecomputeDerivatives);
 
+  /// Directory of cached image resolution pyramids
+  ///
+  /// When set, the resolution pyramid of each input image is read from a file
+  /// in this directory if one was written by a previous run with identical
+  /// input image and pyramid settings. Otherwise, the pyramid is computed and
+  /// written to this directory. The cached image data is mapped into memory.
+  /// By default, this parameter is empty and no pyramids are cached.
+  mirtkPublicAttributeMacro(string, PyramidCacheDirectory);
+
   /// Default similarity measure
   mirtkPublicAttributeMacro(enum SimilarityMeasure, SimilarityMeasure);
 
@@ -358,6 +367,8 @@ protected:
   Array<double>              _Background;                     ///< Image background value
   bool                       _DownsampleWithPadding;          ///< Whether to take background into account
                                                               ///< during initialization of the image pyramid
+  bool                       _RecursiveBlurring;              ///< Whether to blur images of pyramid using
+                                                              ///< recursive Gaussian filter
   bool                       _CropPadImages;                  ///< Whether to crop/pad input images
   int                        _CropPadFFD;                     ///< Whether to crop/pad FFD lattice
 
@@ -622,6 +633,12 @@ protected:
   /// Initialize image resolution pyramid
   virtual void InitializePyramid();
 
+  /// Name of cache file of n-th image resolution pyramid
+  ///
+  /// The file name is a hash of the input image and the settings
+  /// which determine the images of its resolution pyramid.
+  string PyramidCacheFileName(int) const;
+
   /// Remesh/-sample input point sets
   virtual void InitializePointSets();
 
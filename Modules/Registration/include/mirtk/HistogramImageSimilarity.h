@@ -23,6 +23,7 @@
 #include "mirtk/ImageSimilarity.h"
 
 #include "mirtk/Math.h"
+#include "mirtk/Array.h"
 #include "mirtk/Histogram2D.h"
 #include "mirtk/Parallel.h"
 
@@ -93,6 +94,16 @@ public:
   /// Number of histogram bins for source image intensities
   mirtkPublicAttributeMacro(int, NumberOfSourceBins);
 
+  /// Whether to update the joint histogram only from voxels whose joint bin
+  /// changed since the last update instead of refilling it (default: true)
+  ///
+  /// This requires the joint bin index of each voxel to be stored.
+  mirtkPublicAttributeMacro(bool, IncrementalUpdate);
+
+  /// Joint bin index of each voxel counted by the joint histogram of samples,
+  /// or -1 when the voxel is not counted (cf. IncrementalUpdate)
+  mirtkAttributeMacro(Array<int>, BinIndex);
+
   /// Copy attributes of this class from another instance
   void CopyAttributes(const HistogramImageSimilarity &);
 
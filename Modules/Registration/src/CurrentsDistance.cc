@@ -26,6 +26,8 @@
 #include "mirtk/Profiling.h"
 #include "mirtk/ObjectFactory.h"
 #include "mirtk/VtkMath.h"
+#include "mirtk/GenericImage.h"
+#include "mirtk/SeparableConvolution.h"
 
 #include "vtkSmartPointer.h"
 #include "vtkPoints.h"
@@ -58,6 +60,10 @@ CurrentsDistance::CurrentsDistance(const char *name, double weight)
   PointSetDistance(name, weight),
   _Sigma(-0.05),
   _Symmetric(true),
+  _GridSpacing(.0),
+  _GridTolerance(.0),
+  _MaxGridSize(1 << 24),
+  _GridError(.0),
   _TargetNormSquared(.0)
 {
 }
@@ -66,6 +72,12 @@ CurrentsDistance::CurrentsDistance(const char *name, double weight)
 CurrentsDistance::CurrentsDistance(const CurrentsDistance &other)
 :
   PointSetDistance(other),
+  _Sigma(other._Sigma),
+  _Symmetric(other._Symmetric),
+  _GridSpacing(other._GridSpacing),
+  _GridTolerance(other._GridTolerance),
+  _MaxGridSize(other._MaxGridSize),
+  _GridError(other._GridError),
   _TargetNormSquared(other._TargetNormSquared)
 {
   if (other._TargetCurrent) {
@@ -82,6 +94,12 @@ CurrentsDistance::CurrentsDistance(const CurrentsDistance &other)
 CurrentsDistance &CurrentsDistance::operator =(const CurrentsDistance &other)
 {
   PointSetDistance::operator =(other);
+  _Sigma             = other._Sigma;
+  _Symmetric         = other._Symmetric;
+  _GridSpacing       = other._GridSpacing;
+  _GridTolerance     = other._GridTolerance;
+  _MaxGridSize       = other._MaxGridSize;
+  _GridError         = other._GridError;
   _TargetNormSquared = other._TargetNormSquared;
   if (other._TargetCurrent) {
     _TargetCurrent = vtkSmartPointer<vtkPolyData>::New();
@@ -165,6 +183,236 @@ vtkSmartPointer<vtkPolyData> CurrentsDistance::ToCurrent(vtkPointSet *data)
   return SurfaceToCurrent(surface);
 }
 
+// -----------------------------------------------------------------------------
+/// Grid-based evaluation of currents kernel sums
+///
+/// The weights of the currents are distributed to the nodes of a regular
+/// lattice using trilinear interpolation weights, convolved with the separable
+/// Gaussian kernel, and interpolated at the centers of the other current.
+/// The cost is linear in the number of lattice nodes and current elements
+/// instead of proportional to the number of elements within the kernel support.
+/// The approximation error decreases quadratically with the lattice spacing.
+class CurrentsDistanceGridKernel
+{
+private:
+
+  GenericImage<double> _Field;     ///< Convolved weights at lattice nodes
+  double               _Variance;  ///< Squared kernel width
+  double               _Radius;    ///< Radius of kernel support
+  double               _Spacing;   ///< Lattice spacing
+  double               _Origin[3]; ///< Position of first lattice node
+  int                  _X, _Y, _Z; ///< Number of lattice nodes
+  int                  _N;         ///< Total number of lattice nodes
+
+  /// Get index of lower lattice cell corner and fractional offsets of point
+  inline int Cell(const double p[3], double f[3]) const
+  {
+    int    i[3];
+    double u;
+    for (int d = 0; d < 3; ++d) {
+      u    = (p[d] - _Origin[d]) / _Spacing;
+      i[d] = ifloor(u);
+      f[d] = u - i[d];
+    }
+    return i[0] + _X * (i[1] + _Y * i[2]);
+  }
+
+  /// Get offsets and trilinear weights of lattice cell corners
+  inline void Corners(const double f[3], int offset[8], double weight[8]) const
+  {
+    for (int c = 0; c < 8; ++c) {
+      const int a = (c & 1), b = ((c >> 1) & 1), e = ((c >> 2) & 1);
+      offset[c] = a + _X * (b + _Y * e);
+      weight[c] = (a ? f[0] : 1.0 - f[0])
+                * (b ? f[1] : 1.0 - f[1])
+                * (e ? f[2] : 1.0 - f[2]);
+    }
+  }
+
+public:
+
+  CurrentsDistanceGridKernel(double sigma, double spacing)
+  :
+    _Variance(sigma * sigma), _Radius(2.5 * sigma), _Spacing(spacing),
+    _X(0), _Y(0), _Z(0), _N(0)
+  {
+    _Origin[0] = _Origin[1] = _Origin[2] = .0;
+  }
+
+  /// Initialize lattice enclosing the centers of the given currents
+  ///
+  /// \param[in] a         Centers of first current.
+  /// \param[in] b         Centers of second current.
+  /// \param[in] max_nodes Maximum number of lattice nodes.
+  ///
+  /// \returns Whether the lattice was initialized. When the lattice would
+  ///          exceed the maximum size, the kernel sums must be evaluated directly.
+  bool Initialize(vtkPoints *a, vtkPoints *b, double max_nodes)
+  {
+    double ba[6], bb[6];
+    a->GetBounds(ba);
+    b->GetBounds(bb);
+    // Margin of two nodes such that the central differences
+    // at the corners of each lattice cell are defined
+    double n[3], size = 3.0;
+    for (int d = 0; d < 3; ++d) {
+      const double lo = min(ba[2*d  ], bb[2*d  ]);
+      const double hi = max(ba[2*d+1], bb[2*d+1]);
+      _Origin[d] = lo - 2.0 * _Spacing;
+      n[d]  = floor((hi - lo) / _Spacing) + 5.0;
+      size *= n[d];
+    }
+    if (size > 3.0 * max_nodes) return false;
+    ImageAttributes attr;
+    attr._x  = _X = static_cast<int>(n[0]);
+    attr._y  = _Y = static_cast<int>(n[1]);
+    attr._z  = _Z = static_cast<int>(n[2]);
+    attr._t  = 3;
+    attr._dx = attr._dy = attr._dz = _Spacing;
+    attr._dt = .0;
+    _Field.Initialize(attr);
+    _N = _X * _Y * _Z;
+    return true;
+  }
+
+private:
+
+  /// Add weights of the points in every other slab of lattice cells
+  ///
+  /// The weights of a point in slab k are added to the nodes of the lattice
+  /// slices k and k+1. Slabs of equal parity can thus be processed in parallel.
+  struct SplatSlabs
+  {
+    const CurrentsDistanceGridKernel *_Kernel;
+    vtkPoints                        *_Centers;
+    vtkDataArray                     *_Weights;
+    const int                        *_Offset;  ///< Start of each slab in _Order
+    const int                        *_Order;   ///< Point indices sorted by slab
+    int                               _Parity;
+    double                            _Scale;
+    double                           *_Data;
+
+    void operator ()(const blocked_range<int> &re) const
+    {
+      const int N = _Kernel->_N;
+      // See CurrentsDistanceDotProduct regarding weights of 0-currents
+      double c[3], w[3] = {1.0, .0, .0}, f[3], weight[8];
+      int    i, idx, offset[8];
+      for (int k = 2 * re.begin() + _Parity; k < 2 * re.end() + _Parity; k += 2) {
+        for (int p = _Offset[k]; p < _Offset[k+1]; ++p) {
+          i = _Order[p];
+          _Centers->GetPoint(i, c);
+          _Weights->GetTuple(i, w);
+          idx = _Kernel->Cell(c, f);
+          _Kernel->Corners(f, offset, weight);
+          for (int n = 0; n < 8; ++n) {
+            for (int d = 0; d < 3; ++d) {
+              _Data[idx + offset[n] + d * N] += _Scale * weight[n] * w[d];
+            }
+          }
+        }
+      }
+    }
+  };
+
+public:
+
+  /// Add weights of current scaled by the given factor to lattice nodes
+  void Splat(vtkPoints *centers, vtkDataArray *weights, double s = 1.0)
+  {
+    // Sort points by slab of lattice cells, i.e., z index of lower cell corner
+    const int n = static_cast<int>(centers->GetNumberOfPoints());
+    Array<int> slab(n), offset(_Z + 1, 0), order(n);
+    double c[3];
+    for (int i = 0; i < n; ++i) {
+      centers->GetPoint(i, c);
+      slab[i] = ifloor((c[2] - _Origin[2]) / _Spacing);
+      ++offset[slab[i] + 1];
+    }
+    for (int k = 0; k < _Z; ++k) {
+      offset[k + 1] += offset[k];
+    }
+    Array<int> next(offset.begin(), offset.end() - 1);
+    for (int i = 0; i < n; ++i) {
+      order[next[slab[i]]++] = i;
+    }
+    // Add weights of even and odd slabs in two parallel passes
+    SplatSlabs body;
+    body._Kernel  = this;
+    body._Centers = centers;
+    body._Weights = weights;
+    body._Offset  = offset.data();
+    body._Order   = order.data();
+    body._Scale   = s;
+    body._Data    = _Field.Data();
+    for (body._Parity = 0; body._Parity < 2; ++body._Parity) {
+      // There are _Z - 1 slabs of cells, the last one with index _Z - 2
+      parallel_for(blocked_range<int>(0, (_Z - body._Parity) / 2), body);
+    }
+  }
+
+  /// Convolve lattice weights with Gaussian kernel
+  ///
+  /// Trilinear splatting and interpolation each smooth the kernel sums by
+  /// a linear B-spline. The variance of the lattice kernel is reduced by the
+  /// variance of these such that the second moments of the effective kernel
+  /// match those of the Gaussian kernel, while its integral is preserved.
+  void Convolve()
+  {
+    const double var   = max(_Variance - 2.0 * _Spacing * _Spacing / 3.0, .25 * _Variance);
+    const double scale = sqrt(_Variance / var);
+    const int    r     = iceil(_Radius / _Spacing);
+    GenericImage<double> kernel(2 * r + 1, 1);
+    for (int n = -r; n <= r; ++n) {
+      kernel(n + r, 0) = scale * exp(- pow(n * _Spacing, 2) / var);
+    }
+    SeparableConvolution<double, double> conv(&kernel, &kernel, &kernel);
+    conv.Normalize(false);
+    conv.Input (&_Field);
+    conv.Output(&_Field);
+    conv.Run();
+  }
+
+  /// Interpolate kernel sum at given point
+  inline void Evaluate(const double p[3], double v[3]) const
+  {
+    const double * const data = _Field.Data();
+    double f[3], weight[8];
+    int    offset[8];
+    const int idx = Cell(p, f);
+    Corners(f, offset, weight);
+    v[0] = v[1] = v[2] = .0;
+    for (int n = 0; n < 8; ++n) {
+      for (int d = 0; d < 3; ++d) {
+        v[d] += weight[n] * data[idx + offset[n] + d * _N];
+      }
+    }
+  }
+
+  /// Interpolate derivatives of kernel sum at given point, where
+  /// j[e][d] is the derivative of the d-th component w.r.t. the e-th coordinate
+  inline void Jacobian(const double p[3], double j[3][3]) const
+  {
+    const double * const data = _Field.Data();
+    const int    stride[3] = {1, _X, _X * _Y};
+    const double norm = .5 / _Spacing;
+    double f[3], weight[8];
+    int    offset[8], node;
+    const int idx = Cell(p, f);
+    Corners(f, offset, weight);
+    memset(j, 0, 9 * sizeof(double));
+    for (int n = 0; n < 8; ++n) {
+      node = idx + offset[n];
+      for (int e = 0; e < 3; ++e) {
+        for (int d = 0; d < 3; ++d) {
+          j[e][d] += weight[n] * norm * (data[node + stride[e] + d * _N] -
+                                         data[node - stride[e] + d * _N]);
+        }
+      }
+    }
+  }
+};
+
 // -----------------------------------------------------------------------------
 class CurrentsDistanceDotProduct
 {
@@ -175,19 +423,30 @@ private:
   vtkPoints               *_CentersB;
   vtkFloatArray           *_WeightsB;
   vtkAbstractPointLocator *_LocatorB;
+  CurrentsDistanceGridKernel *_GridB;
+  double                   _Sigma;
   double                   _Variance;
   double                   _Radius;
+  double                   _Spacing;
+  double                   _MaxNodes;
   vtkDataArray            *_Value;
   double                   _Sum;
 
 public:
 
-  CurrentsDistanceDotProduct(double sigma)
+  /// Constructor
+  ///
+  /// \param[in] sigma     Kernel width.
+  /// \param[in] spacing   Lattice spacing of grid-based evaluation of kernel sums.
+  ///                      The kernel sums are evaluated directly when not positive.
+  /// \param[in] max_nodes Maximum number of lattice nodes. The kernel sums are
+  ///                      evaluated directly when the lattice would be larger.
+  CurrentsDistanceDotProduct(double sigma, double spacing = .0, double max_nodes = inf)
   :
     _CentersA(NULL), _WeightsA(NULL),
-    _CentersB(NULL), _WeightsB(NULL), _LocatorB(NULL),
-    _Variance(sigma * sigma), _Radius(2.5 * sigma),
-    _Value(NULL), _Sum(.0)
+    _CentersB(NULL), _WeightsB(NULL), _LocatorB(NULL), _GridB(NULL),
+    _Sigma(sigma), _Variance(sigma * sigma), _Radius(2.5 * sigma),
+    _Spacing(spacing), _MaxNodes(max_nodes), _Value(NULL), _Sum(.0)
   {}
 
   inline double Evaluate(vtkPolyData *a, vtkPolyData *b, vtkDataArray *value = NULL)
@@ -215,17 +474,32 @@ public:
       cerr << "Cannot compute inner product between different types of currents" << endl;
       exit(1);
     }
-    // Initialize point locator
-    _LocatorB = vtkOctreePointLocator::New();
-    _LocatorB->SetDataSet(b);
-    _LocatorB->BuildLocator();
+    // Initialize point locator or convolved lattice weights
+    UniquePtr<CurrentsDistanceGridKernel> grid;
+    if (_Spacing > .0) {
+      grid.reset(new CurrentsDistanceGridKernel(_Sigma, _Spacing));
+      if (grid->Initialize(_CentersA, _CentersB, _MaxNodes)) {
+        grid->Splat(_CentersB, _WeightsB);
+        grid->Convolve();
+        _GridB = grid.get();
+      } else {
+        if (debug) cout << "CurrentsDistance: Lattice too large, evaluating kernel sums directly" << endl;
+        grid.reset();
+      }
+    }
+    if (!_GridB) {
+      _LocatorB = vtkOctreePointLocator::New();
+      _LocatorB->SetDataSet(b);
+      _LocatorB->BuildLocator();
+    }
     // Evaluate inner product
     _Value = value;
     _Sum   = .0;
     blocked_range<vtkIdType> cellsA(0, _CentersA->GetNumberOfPoints());
     parallel_reduce(cellsA, *this);
     // Free point locator
-    _LocatorB->Delete(), _LocatorB = NULL;
+    if (_LocatorB) _LocatorB->Delete(), _LocatorB = NULL;
+    _GridB = NULL;
     MIRTK_DEBUG_TIMING(3, "evaluation of dot product of currents");
     return _Sum;
   }
@@ -239,8 +513,11 @@ public:
     _CentersB(other._CentersB),
     _WeightsB(other._WeightsB),
     _LocatorB(other._LocatorB),
+    _GridB   (other._GridB),
+    _Sigma   (other._Sigma),
     _Variance(other._Variance),
     _Radius  (other._Radius),
+    _Spacing (other._Spacing),
     _Value   (other._Value),
     _Sum     (.0)
   {}
@@ -266,13 +543,18 @@ public:
     for (vtkIdType i = re.begin(); i != re.end(); ++i) {
       _CentersA->GetPoint(i, ca);
       _WeightsA->GetTuple(i, da);
-      _LocatorB->FindPointsWithinRadius(_Radius, ca, ids);
       double value = .0;
-      for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
-        vtkIdType j = ids->GetId(k);
-        _CentersB->GetPoint(j, cb);
-        _WeightsB->GetTuple(j, db);
-        value += EvaluateKernel(ca, cb) * vtkMath::Dot(da, db);
+      if (_GridB) {
+        _GridB->Evaluate(ca, db);
+        value = vtkMath::Dot(da, db);
+      } else {
+        _LocatorB->FindPointsWithinRadius(_Radius, ca, ids);
+        for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
+          vtkIdType j = ids->GetId(k);
+          _CentersB->GetPoint(j, cb);
+          _WeightsB->GetTuple(j, db);
+          value += EvaluateKernel(ca, cb) * vtkMath::Dot(da, db);
+        }
       }
       if (_Value) _Value->SetTuple1(i, _Value->GetTuple1(i) + value);
       _Sum += value;
@@ -293,17 +575,29 @@ private:
   vtkPoints               *_CentersB;
   vtkFloatArray           *_WeightsB;
   vtkAbstractPointLocator *_LocatorB;
+  CurrentsDistanceGridKernel *_GridAB;
+  double                   _Sigma;
   double                   _Variance;
   double                   _Radius;
+  double                   _Spacing;
+  double                   _MaxNodes;
   Vector3D<double>        *_Gradient;
 
 public:
 
-  CurrentsDistanceGradient(double sigma)
+  /// Constructor
+  ///
+  /// \param[in] sigma     Kernel width.
+  /// \param[in] spacing   Lattice spacing of grid-based evaluation of kernel sums.
+  ///                      The kernel sums are evaluated directly when not positive.
+  /// \param[in] max_nodes Maximum number of lattice nodes. The kernel sums are
+  ///                      evaluated directly when the lattice would be larger.
+  CurrentsDistanceGradient(double sigma, double spacing = .0, double max_nodes = inf)
   :
     _SurfaceA(NULL), _CentersA(NULL), _WeightsA(NULL), _LocatorA(NULL),
     _SurfaceB(NULL), _CentersB(NULL), _WeightsB(NULL), _LocatorB(NULL),
-    _Variance(sigma * sigma), _Radius(2.5 * sigma), _Gradient(NULL)
+    _GridAB(NULL), _Sigma(sigma), _Variance(sigma * sigma), _Radius(2.5 * sigma),
+    _Spacing(spacing), _MaxNodes(max_nodes), _Gradient(NULL)
   {}
 
   inline void EvaluateGradient(vtkPointSet *sa, vtkPolyData *ca,
@@ -335,13 +629,28 @@ public:
       cerr << "Cannot compute inner product between different types of currents" << endl;
       exit(1);
     }
-    // Initialize point locators
-    _LocatorA = vtkOctreePointLocator::New();
-    _LocatorA->SetDataSet(ca);
-    _LocatorA->BuildLocator();
-    _LocatorB = vtkOctreePointLocator::New();
-    _LocatorB->SetDataSet(cb);
-    _LocatorB->BuildLocator();
+    // Initialize point locators or convolved difference of lattice weights
+    UniquePtr<CurrentsDistanceGridKernel> grid;
+    if (_Spacing > .0) {
+      grid.reset(new CurrentsDistanceGridKernel(_Sigma, _Spacing));
+      if (grid->Initialize(_CentersA, _CentersB, _MaxNodes)) {
+        grid->Splat(_CentersA, _WeightsA, +1.0);
+        grid->Splat(_CentersB, _WeightsB, -1.0);
+        grid->Convolve();
+        _GridAB = grid.get();
+      } else {
+        if (debug) cout << "CurrentsDistance: Lattice too large, evaluating kernel sums directly" << endl;
+        grid.reset();
+      }
+    }
+    if (!_GridAB) {
+      _LocatorA = vtkOctreePointLocator::New();
+      _LocatorA->SetDataSet(ca);
+      _LocatorA->BuildLocator();
+      _LocatorB = vtkOctreePointLocator::New();
+      _LocatorB->SetDataSet(cb);
+      _LocatorB->BuildLocator();
+    }
     // Evaluate gradient of currents distance measure
     _Gradient = g;
     for (int i = 0; i < _SurfaceA->GetNumberOfPoints(); ++i) {
@@ -350,8 +659,9 @@ public:
     blocked_range<vtkIdType> cellsA(0, _SurfaceA->GetNumberOfCells());
     parallel_reduce(cellsA, *this);
     // Free point locators
-    _LocatorA->Delete(), _LocatorA = NULL;
-    _LocatorB->Delete(), _LocatorB = NULL;
+    if (_LocatorA) _LocatorA->Delete(), _LocatorA = NULL;
+    if (_LocatorB) _LocatorB->Delete(), _LocatorB = NULL;
+    _GridAB = NULL;
     MIRTK_DEBUG_TIMING(3, "evaluation of gradient of currents distance");
   }
 
@@ -367,8 +677,11 @@ public:
     _CentersB(other._CentersB),
     _WeightsB(other._WeightsB),
     _LocatorB(other._LocatorB),
+    _GridAB  (other._GridAB),
+    _Sigma   (other._Sigma),
     _Variance(other._Variance),
     _Radius  (other._Radius),
+    _Spacing (other._Spacing),
     _Gradient(other._Gradient)
   {}
 
@@ -382,8 +695,11 @@ public:
     _CentersB(lhs._CentersB),
     _WeightsB(lhs._WeightsB),
     _LocatorB(lhs._LocatorB),
+    _GridAB  (lhs._GridAB),
+    _Sigma   (lhs._Sigma),
     _Variance(lhs._Variance),
-    _Radius  (lhs._Radius)
+    _Radius  (lhs._Radius),
+    _Spacing (lhs._Spacing)
   {
     CAllocate(_Gradient, _SurfaceA->GetNumberOfPoints());
   }
@@ -421,7 +737,7 @@ public:
     double    e1[3], e2[3], e3[3]; // edge vectors
     double    c1[3], c2[3];        // center coordinates
     double    n1[3], n2[3];        // surface normals
-    double    kws[3], dks[3][3], kwt[3], dkt[3][3], kw[3];
+    double    kws[3], dks[3][3], kwt[3], dkt[3][3], kw[3], dk[3][3];
     double    w, g[3];
 
     const double _2over3 = 2.0 / 3.0;
@@ -445,40 +761,52 @@ public:
       // Get center and normal
       _CentersA->GetPoint(i, c1);
       _WeightsA->GetTuple(i, n1);
-      // Compute kds = KtauS and dks = gradKtauS.transpose()
-      // (cf. Deformetrica 2.0 OrientedSurfaceMesh::ComputeMatchGradient)
-      _LocatorA->FindPointsWithinRadius(_Radius, c1, ids);
-      memset(kws, 0, 3 * sizeof(double));
-      memset(dks, 0, 9 * sizeof(double));
-      for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
-        j = ids->GetId(k);
-        _CentersA->GetPoint(j, c2);
-        _WeightsA->GetTuple(j, n2);
-        w = EvaluateKernel(c1, c2);
-        EvaluateKernelGradient(g, c1, c2);
-        for (int d = 0; d < 3; ++d) {
-          kws   [d] += w    * n2[d];
-          dks[0][d] += g[0] * n2[d];
-          dks[1][d] += g[1] * n2[d];
-          dks[2][d] += g[2] * n2[d];
+      if (_GridAB) {
+        // Interpolate kw = KtauS - KtauT and dk = (gradKtauS - gradKtauT).transpose()
+        _GridAB->Evaluate(c1, kw);
+        _GridAB->Jacobian(c1, dk);
+      } else {
+        // Compute kds = KtauS and dks = gradKtauS.transpose()
+        // (cf. Deformetrica 2.0 OrientedSurfaceMesh::ComputeMatchGradient)
+        _LocatorA->FindPointsWithinRadius(_Radius, c1, ids);
+        memset(kws, 0, 3 * sizeof(double));
+        memset(dks, 0, 9 * sizeof(double));
+        for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
+          j = ids->GetId(k);
+          _CentersA->GetPoint(j, c2);
+          _WeightsA->GetTuple(j, n2);
+          w = EvaluateKernel(c1, c2);
+          EvaluateKernelGradient(g, c1, c2);
+          for (int d = 0; d < 3; ++d) {
+            kws   [d] += w    * n2[d];
+            dks[0][d] += g[0] * n2[d];
+            dks[1][d] += g[1] * n2[d];
+            dks[2][d] += g[2] * n2[d];
+          }
+        }
+        // Compute kwt = KtauT and dkt = gradKtauT.transpose()
+        // (cf. Deformetrica 2.0 OrientedSurfaceMesh::ComputeMatchGradient)
+        _LocatorB->FindPointsWithinRadius(_Radius, c1, ids);
+        memset(kwt, 0, 3 * sizeof(double));
+        memset(dkt, 0, 9 * sizeof(double));
+        for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
+          j = ids->GetId(k);
+          _CentersB->GetPoint(j, c2);
+          _WeightsB->GetTuple(j, n2);
+          w = EvaluateKernel(c1, c2);
+          EvaluateKernelGradient(g, c1, c2);
+          for (int d = 0; d < 3; ++d) {
+            kwt   [d] += w    * n2[d];
+            dkt[0][d] += g[0] * n2[d];
+            dkt[1][d] += g[1] * n2[d];
+            dkt[2][d] += g[2] * n2[d];
+          }
         }
-      }
-      // Compute kwt = KtauT and dkt = gradKtauT.transpose()
-      // (cf. Deformetrica 2.0 OrientedSurfaceMesh::ComputeMatchGradient)
-      _LocatorB->FindPointsWithinRadius(_Radius, c1, ids);
-      memset(kwt, 0, 3 * sizeof(double));
-      memset(dkt, 0, 9 * sizeof(double));
-      for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
-        j = ids->GetId(k);
-        _CentersB->GetPoint(j, c2);
-        _WeightsB->GetTuple(j, n2);
-        w = EvaluateKernel(c1, c2);
-        EvaluateKernelGradient(g, c1, c2);
         for (int d = 0; d < 3; ++d) {
-          kwt   [d] += w    * n2[d];
-          dkt[0][d] += g[0] * n2[d];
-          dkt[1][d] += g[1] * n2[d];
-          dkt[2][d] += g[2] * n2[d];
+          kw[d] = kws[d] - kwt[d];
+          for (int e = 0; e < 3; ++e) {
+            dk[d][e] = dks[d][e] - dkt[d][e];
+          }
         }
       }
       // Add gradient
@@ -486,10 +814,7 @@ public:
         e1[d] =  v3[d] -  v2[d];
         e2[d] =  v1[d] -  v3[d];
         e3[d] =  v2[d] -  v1[d];
-        kw[d] = kws[d] - kwt[d];
-        g [d] = ((dks[d][0] - dkt[d][0]) * n1[0] +
-                 (dks[d][1] - dkt[d][1]) * n1[1] +
-                 (dks[d][2] - dkt[d][2]) * n1[2]) * _2over3;
+        g [d] = (dk[d][0] * n1[0] + dk[d][1] * n1[1] + dk[d][2] * n1[2]) * _2over3;
       }
       Add(g1, g), Add(g2, g), Add(g3, g);
       vtkMath::Cross(e1, kw, g), Add(g1, g);
@@ -522,13 +847,21 @@ void CurrentsDistance::Init()
     _Sigma = 0.5 * (ra + rb) * abs(_Sigma);
   }
 
+  // Estimate approximation error of grid-based evaluation of kernel sums
+  const double h = KernelGridSpacing() / _Sigma;
+  _GridError = .5 * h * h;
+  if (debug && _GridError > .0) {
+    cout << "CurrentsDistance: Kernel grid spacing = " << h * _Sigma
+         << ", estimated relative gradient error = " << _GridError << endl;
+  }
+
   // Get currents representation of input data sets
   _TargetCurrent = ToCurrent(_Target->InputPointSet());
   _SourceCurrent = ToCurrent(_Source->InputPointSet());
 
   // Compute squared norm of fixed current(s)
   _TargetNormSquared = .0;
-  CurrentsDistanceDotProduct dot_product(_Sigma);
+  CurrentsDistanceDotProduct dot_product(_Sigma, KernelGridSpacing(), _MaxGridSize);
   if (!_Target->Transformation()) {
     _TargetNormSquared += dot_product.Evaluate(_TargetCurrent, _TargetCurrent);
   }
@@ -537,6 +870,14 @@ void CurrentsDistance::Init()
   }
 }
 
+// -----------------------------------------------------------------------------
+double CurrentsDistance::KernelGridSpacing() const
+{
+  if (_GridSpacing   > .0) return _GridSpacing * _Sigma;
+  if (_GridTolerance > .0) return sqrt(2.0 * _GridTolerance) * _Sigma;
+  return .0;
+}
+
 // -----------------------------------------------------------------------------
 void CurrentsDistance::Initialize()
 {
@@ -568,6 +909,15 @@ bool CurrentsDistance::SetWithPrefix(const char *param, const char *value)
   if (strcmp(param, "Symmetric currents distance") == 0) {
     return FromString(value, _Symmetric);
   }
+  if (strcmp(param, "Currents kernel grid spacing") == 0) {
+    return FromString(value, _GridSpacing);
+  }
+  if (strcmp(param, "Currents kernel grid tolerance") == 0) {
+    return FromString(value, _GridTolerance);
+  }
+  if (strcmp(param, "Currents kernel grid size limit") == 0) {
+    return FromString(value, _MaxGridSize) && _MaxGridSize >= 0;
+  }
   return PointSetDistance::SetWithPrefix(param, value);
 }
 
@@ -580,6 +930,15 @@ bool CurrentsDistance::SetWithoutPrefix(const char *param, const char *value)
   if (strcmp(param, "Symmetric") == 0) {
     return FromString(value, _Symmetric);
   }
+  if (strcmp(param, "Kernel grid spacing") == 0) {
+    return FromString(value, _GridSpacing);
+  }
+  if (strcmp(param, "Kernel grid tolerance") == 0) {
+    return FromString(value, _GridTolerance);
+  }
+  if (strcmp(param, "Kernel grid size limit") == 0) {
+    return FromString(value, _MaxGridSize) && _MaxGridSize >= 0;
+  }
   return PointSetDistance::SetWithoutPrefix(param, value);
 }
 
@@ -587,8 +946,11 @@ bool CurrentsDistance::SetWithoutPrefix(const char *param, const char *value)
 ParameterList CurrentsDistance::Parameter() const
 {
   ParameterList params = PointSetDistance::Parameter();
-  InsertWithPrefix(params, "Kernel width", _Sigma);
-  InsertWithPrefix(params, "Symmetric",    _Symmetric);
+  InsertWithPrefix(params, "Kernel width",             _Sigma);
+  InsertWithPrefix(params, "Symmetric",                _Symmetric);
+  InsertWithPrefix(params, "Kernel grid spacing",      _GridSpacing);
+  InsertWithPrefix(params, "Kernel grid tolerance",    _GridTolerance);
+  InsertWithPrefix(params, "Kernel grid size limit",   _MaxGridSize);
   return params;
 }
 
@@ -614,7 +976,7 @@ double CurrentsDistance::Evaluate()
 {
   MIRTK_START_TIMING();
   double d = _TargetNormSquared;
-  CurrentsDistanceDotProduct dot_product(_Sigma);
+  CurrentsDistanceDotProduct dot_product(_Sigma, KernelGridSpacing(), _MaxGridSize);
   if (_Target->Transformation()) {
     d += dot_product.Evaluate(_TargetCurrent, _TargetCurrent);
   }
@@ -640,7 +1002,7 @@ void CurrentsDistance::NonParametricGradient(const RegisteredPointSet *target,
   vtkPointSet *sb = _Source->PointSet();
   vtkPolyData *cb = _SourceCurrent;
   if (target == _Source) swap(sa, sb), swap(ca, cb);
-  CurrentsDistanceGradient d(_Sigma);
+  CurrentsDistanceGradient d(_Sigma, KernelGridSpacing(), _MaxGridSize);
   d.EvaluateGradient(sa, ca, sb, cb, gradient);
 }
 
@@ -667,7 +1029,7 @@ void CurrentsDistance::WriteDataSets(const char *p, const char *suffix, bool all
   if (_Target->Transformation() || all) {
     vtkSmartPointer<vtkFloatArray> dist;
     if (_Target->Transformation()) {
-      CurrentsDistanceDotProduct dot_product(_Sigma);
+      CurrentsDistanceDotProduct dot_product(_Sigma, KernelGridSpacing(), _MaxGridSize);
       dist = vtkSmartPointer<vtkFloatArray>::New();
       dist->SetName("distance");
       dist->SetNumberOfComponents(1);
@@ -684,7 +1046,7 @@ void CurrentsDistance::WriteDataSets(const char *p, const char *suffix, bool all
   if (_Source->Transformation() || all) {
     vtkSmartPointer<vtkFloatArray> dist;
     if (_Source->Transformation()) {
-      CurrentsDistanceDotProduct dot_product(_Sigma);
+      CurrentsDistanceDotProduct dot_product(_Sigma, KernelGridSpacing(), _MaxGridSize);
       dist = vtkSmartPointer<vtkFloatArray>::New();
       dist->SetName("distance");
       dist->SetNumberOfComponents(1);
@@ -25,6 +25,8 @@
 #include "mirtk/Utils.h"
 #include "mirtk/Math.h"
 #include "mirtk/Memory.h"
+#include "mirtk/MemoryMappedFile.h"
+#include "mirtk/Path.h"
 #include "mirtk/Version.h"
 #include "mirtk/Matrix.h"
 #include "mirtk/Parallel.h"
@@ -66,6 +68,10 @@
 
 #include "RegistrationEnergyParser.h"
 
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
 
 namespace mirtk {
 
@@ -398,14 +404,16 @@ class BlurImages
   Array<ResampledImageList> &_Image;
   const Array<double>       *_Sigma;
   const Array<double>       *_Padding;
+  bool                       _Recursive;
 
 public:
 
   BlurImages(Array<ResampledImageList> &image,
              const Array<double>       *sigma,
-             const Array<double>       *padding = nullptr)
+             const Array<double>       *padding = nullptr,
+             bool                       recursive = false)
   :
-    _Image(image), _Sigma(sigma), _Padding(padding)
+    _Image(image), _Sigma(sigma), _Padding(padding), _Recursive(recursive)
   {}
 
   void operator()(const blocked_range2d<int> &re) const
@@ -415,11 +423,13 @@ public:
       if (_Sigma[l][n] > .0) {
         if (_Padding) {
           GaussianBlurringWithPadding<VoxelType> blurring(_Sigma[l][n], (*_Padding)[n]);
+          blurring.Recursive(_Recursive);
           blurring.Input (&_Image[l][n]);
           blurring.Output(&_Image[l][n]);
           blurring.Run();
         } else {
           GaussianBlurring<VoxelType> blurring(_Sigma[l][n]);
+          blurring.Recursive(_Recursive);
           blurring.Input (&_Image[l][n]);
           blurring.Output(&_Image[l][n]);
           blurring.Run();
@@ -491,6 +501,7 @@ class DownsampleImages
   const Array<double>       *_Padding;
   const Array<double>       *_Blurring;
   bool                       _CropPad;
+  bool                       _Recursive;
   int                        _Level;
 
 public:
@@ -500,7 +511,7 @@ public:
                    const Array<double> *outside  = nullptr,
                    const Array<double> *padding  = nullptr,
                    const Array<double> *blurring = nullptr,
-                   bool crop_pad = false)
+                   bool crop_pad = false, bool recursive = false)
   :
     _Image(image),
     _Background(background),
@@ -508,6 +519,7 @@ public:
     _Padding(padding),
     _Blurring(blurring),
     _CropPad(crop_pad),
+    _Recursive(recursive),
     _Level(l)
   {}
 
@@ -578,6 +590,7 @@ public:
         typedef GaussianBlurringWithPadding<VoxelType> BlurFilter;
         typedef ResamplingWithPadding      <VoxelType> ResampleFilter;
         BlurFilter blurring(sigma._x, sigma._y, sigma._z, (*_Padding)[n]);
+        blurring.Recursive(_Recursive);
         blurring.Input (&_Image[1][n]);
         blurring.Output(&_Image[_Level][n]);
         blurring.Run();
@@ -603,6 +616,7 @@ public:
         resize.Output(&_Image[_Level][n]);
         resize.Run();
         BlurFilter blurring(sigma._x, sigma._y, sigma._z);
+        blurring.Recursive(_Recursive);
         blurring.Input (&_Image[_Level][n]);
         blurring.Output(&_Image[_Level][n]);
         blurring.Run();
@@ -615,6 +629,7 @@ public:
         typedef GaussianBlurring<VoxelType> BlurFilter;
         typedef Resampling      <VoxelType> ResampleFilter;
         BlurFilter blurring(sigma._x, sigma._y, sigma._z);
+        blurring.Recursive(_Recursive);
         blurring.Input (&_Image[1][n]);
         blurring.Output(&_Image[_Level][n]);
         blurring.Run();
@@ -893,6 +908,274 @@ public:
   }
 };
 
+// -----------------------------------------------------------------------------
+/// Execute body for each range of consecutive images which are not cached
+template <class Body>
+void ParallelForUncachedImages(const Array<bool> &cached, const Body &body)
+{
+  const int n = static_cast<int>(cached.size());
+  for (int i = 0, j = 0; i < n; i = j) {
+    while (i < n &&  cached[i]) ++i;
+    j = i;
+    while (j < n && !cached[j]) ++j;
+    if (i < j) parallel_for(blocked_range<int>(i, j), body);
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Execute body for resolution levels [1, nlevels] of each range of
+/// consecutive images which are not cached
+template <class Body>
+void ParallelForUncachedImages(const Array<bool> &cached, int nlevels, const Body &body)
+{
+  const int n = static_cast<int>(cached.size());
+  for (int i = 0, j = 0; i < n; i = j) {
+    while (i < n &&  cached[i]) ++i;
+    j = i;
+    while (j < n && !cached[j]) ++j;
+    if (i < j) parallel_for(blocked_range2d<int>(1, nlevels + 1, i, j), body);
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Incremental 64-bit FNV-1a hash used as key of cached image pyramids
+class PyramidCacheKey
+{
+  uint64_t _Hash;
+
+public:
+
+  PyramidCacheKey() : _Hash(14695981039346656037ULL) {}
+
+  void Add(const void *data, size_t size)
+  {
+    const unsigned char *byte = reinterpret_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+      _Hash ^= byte[i];
+      _Hash *= 1099511628211ULL;
+    }
+  }
+
+  template <class T>
+  void Add(const T &value)
+  {
+    Add(&value, sizeof(T));
+  }
+
+  void Add(const ImageAttributes &attr)
+  {
+    Add(attr._x), Add(attr._y), Add(attr._z), Add(attr._t);
+    Add(attr._dx), Add(attr._dy), Add(attr._dz), Add(attr._dt);
+    Add(attr._xorigin), Add(attr._yorigin), Add(attr._zorigin), Add(attr._torigin);
+    Add(attr._xaxis), Add(attr._yaxis), Add(attr._zaxis);
+    for (int r = 0; r < attr._smat.Rows(); ++r)
+    for (int c = 0; c < attr._smat.Cols(); ++c) {
+      Add(attr._smat(r, c));
+    }
+  }
+
+  string ToString() const
+  {
+    char str[17];
+    snprintf(str, 17, "%016llx", static_cast<unsigned long long>(_Hash));
+    return str;
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Magic number and format version of image pyramid cache files
+static const char     PYRAMID_CACHE_MAGIC[8]  = {'M', 'I', 'R', 'T', 'K', 'P', 'Y', 'R'};
+static const int32_t  PYRAMID_CACHE_VERSION   = 1;
+static const uint64_t PYRAMID_CACHE_ALIGNMENT = 64;
+
+// -----------------------------------------------------------------------------
+/// Header entry of one resolution level of a cached image pyramid
+struct PyramidCacheLevel
+{
+  int32_t  _Size[4];
+  double   _Spacing[4];
+  double   _Origin[4];
+  double   _Axes[9];
+  double   _Matrix[16];
+  uint64_t _Offset;
+};
+
+// -----------------------------------------------------------------------------
+/// Write resolution levels [1, nlevels] of n-th image pyramid to cache file
+///
+/// The file is first written under a temporary name and then renamed, such
+/// that concurrent registrations never read an incomplete cache file.
+bool WritePyramidCache(const string &fname, const Array<GenericRegistrationFilter::ResampledImageList> &image,
+                       int n, int nlevels)
+{
+  typedef GenericRegistrationFilter::VoxelType VoxelType;
+  Array<PyramidCacheLevel> header(nlevels);
+  uint64_t offset = sizeof(PYRAMID_CACHE_MAGIC) + 3 * sizeof(int32_t) + nlevels * sizeof(PyramidCacheLevel);
+  for (int l = 1; l <= nlevels; ++l) {
+    const ImageAttributes &attr  = image[l][n].Attributes();
+    PyramidCacheLevel     &level = header[l-1];
+    memset(&level, 0, sizeof(PyramidCacheLevel));
+    level._Size[0]    = attr._x,  level._Size[1]    = attr._y;
+    level._Size[2]    = attr._z,  level._Size[3]    = attr._t;
+    level._Spacing[0] = attr._dx, level._Spacing[1] = attr._dy;
+    level._Spacing[2] = attr._dz, level._Spacing[3] = attr._dt;
+    level._Origin[0]  = attr._xorigin, level._Origin[1] = attr._yorigin;
+    level._Origin[2]  = attr._zorigin, level._Origin[3] = attr._torigin;
+    memcpy(level._Axes,     attr._xaxis, 3 * sizeof(double));
+    memcpy(level._Axes + 3, attr._yaxis, 3 * sizeof(double));
+    memcpy(level._Axes + 6, attr._zaxis, 3 * sizeof(double));
+    for (int r = 0; r < 4; ++r)
+    for (int c = 0; c < 4; ++c) {
+      level._Matrix[4 * r + c] = attr._smat(r, c);
+    }
+    offset = PYRAMID_CACHE_ALIGNMENT * ((offset + PYRAMID_CACHE_ALIGNMENT - 1) / PYRAMID_CACHE_ALIGNMENT);
+    level._Offset = offset;
+    offset += static_cast<uint64_t>(image[l][n].NumberOfVoxels()) * sizeof(VoxelType);
+  }
+  const string tmp_name = fname + ".tmp" + ToString(std::chrono::steady_clock::now().time_since_epoch().count());
+  ofstream ofs(tmp_name.c_str(), std::ios::binary);
+  if (!ofs) return false;
+  const int32_t info[3] = {PYRAMID_CACHE_VERSION, voxel_info<VoxelType>::type(), nlevels};
+  ofs.write(PYRAMID_CACHE_MAGIC, sizeof(PYRAMID_CACHE_MAGIC));
+  ofs.write(reinterpret_cast<const char *>(info), sizeof(info));
+  ofs.write(reinterpret_cast<const char *>(header.data()), nlevels * sizeof(PyramidCacheLevel));
+  for (int l = 1; l <= nlevels; ++l) {
+    const PyramidCacheLevel &level = header[l-1];
+    while (static_cast<uint64_t>(ofs.tellp()) < level._Offset) ofs.put('\0');
+    ofs.write(reinterpret_cast<const char *>(image[l][n].Data()),
+              static_cast<std::streamsize>(image[l][n].NumberOfVoxels() * sizeof(VoxelType)));
+  }
+  ofs.close();
+  if (!ofs || std::rename(tmp_name.c_str(), fname.c_str()) != 0) {
+    std::remove(tmp_name.c_str());
+    return false;
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+/// Map resolution levels [1, nlevels] of n-th image pyramid from cache file
+bool ReadPyramidCache(const string &fname, Array<GenericRegistrationFilter::ResampledImageList> &image,
+                      int n, int nlevels)
+{
+  typedef GenericRegistrationFilter::VoxelType VoxelType;
+  ifstream ifs(fname.c_str(), std::ios::binary);
+  if (!ifs) return false;
+  char    magic[sizeof(PYRAMID_CACHE_MAGIC)];
+  int32_t info[3];
+  ifs.read(magic, sizeof(magic));
+  ifs.read(reinterpret_cast<char *>(info), sizeof(info));
+  if (!ifs || memcmp(magic, PYRAMID_CACHE_MAGIC, sizeof(magic)) != 0) return false;
+  if (info[0] != PYRAMID_CACHE_VERSION || info[1] != voxel_info<VoxelType>::type() || info[2] != nlevels) {
+    return false;
+  }
+  Array<PyramidCacheLevel> header(nlevels);
+  ifs.read(reinterpret_cast<char *>(header.data()), nlevels * sizeof(PyramidCacheLevel));
+  if (!ifs) return false;
+  ifs.close();
+  for (int l = 1; l <= nlevels; ++l) {
+    const PyramidCacheLevel &level = header[l-1];
+    ImageAttributes attr;
+    attr._x  = level._Size[0],    attr._y  = level._Size[1];
+    attr._z  = level._Size[2],    attr._t  = level._Size[3];
+    attr._dx = level._Spacing[0], attr._dy = level._Spacing[1];
+    attr._dz = level._Spacing[2], attr._dt = level._Spacing[3];
+    attr._xorigin = level._Origin[0], attr._yorigin = level._Origin[1];
+    attr._zorigin = level._Origin[2], attr._torigin = level._Origin[3];
+    memcpy(attr._xaxis, level._Axes,     3 * sizeof(double));
+    memcpy(attr._yaxis, level._Axes + 3, 3 * sizeof(double));
+    memcpy(attr._zaxis, level._Axes + 6, 3 * sizeof(double));
+    for (int r = 0; r < 4; ++r)
+    for (int c = 0; c < 4; ++c) {
+      attr._smat(r, c) = level._Matrix[4 * r + c];
+    }
+    const size_t size = static_cast<size_t>(attr.NumberOfLatticePoints()) * sizeof(VoxelType);
+    SharedPtr<MemoryMappedFile> file = NewShared<MemoryMappedFile>();
+    if (size == 0 || !file->Open(fname.c_str(), level._Offset, size, MemoryMappedFile::CopyOnWrite)) {
+      return false;
+    }
+    image[l][n].Initialize(attr, file);
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+/// Whether two displacement cache entries store the same displacement field
+inline bool IsSameDisplacement(const GenericRegistrationFilter::DisplacementInfo &a,
+                        const GenericRegistrationFilter::DisplacementInfo &b)
+{
+  if (a._Transformation != b._Transformation) return false;
+  if (IsNaN(a._InputTime) != IsNaN(b._InputTime)) return false;
+  if (!IsNaN(a._InputTime) && !fequal(a._InputTime, b._InputTime, 1e-9)) return false;
+  return a._Domain.EqualInSpace(b._Domain) && fequal(a._Domain._torigin, b._Domain._torigin, 1e-9);
+}
+
+// -----------------------------------------------------------------------------
+/// Update cached displacement fields
+///
+/// Each task updates in sequence the cache entries which belong to the same
+/// transformation instance, while the tasks of different instances, e.g., the
+/// forward and inverse transformation of a symmetric registration, run
+/// concurrently. An entry which stores the same displacement field as a
+/// previous entry of the task is copied instead of evaluated again.
+class UpdateDisplacements
+{
+  typedef GenericRegistrationFilter::DisplacementInfo      DisplacementInfo;
+  typedef GenericRegistrationFilter::DisplacementImageType DisplacementImageType;
+
+  const Array<DisplacementInfo>        &_Info;
+  const Array<DisplacementImageType *> &_Field;
+  Array<Array<int> >                    _Tasks;
+
+public:
+
+  UpdateDisplacements(const Array<DisplacementInfo>        &info,
+                      const Array<DisplacementImageType *> &field)
+  :
+    _Info(info), _Field(field)
+  {
+    Array<const Transformation *> dofs;
+    for (size_t i = 0; i < _Info.size(); ++i) {
+      size_t t = 0;
+      while (t < dofs.size() && dofs[t] != _Info[i]._Transformation) ++t;
+      if (t == dofs.size()) {
+        dofs.push_back(_Info[i]._Transformation);
+        _Tasks.resize(t + 1);
+      }
+      _Tasks[t].push_back(static_cast<int>(i));
+    }
+  }
+
+  void operator()(const blocked_range<int> &re) const
+  {
+    for (int t = re.begin(); t != re.end(); ++t) {
+      const Array<int> &task = _Tasks[t];
+      for (size_t n = 0; n < task.size(); ++n) {
+        const DisplacementInfo &info = _Info[task[n]];
+        size_t m = 0;
+        while (m < n && !IsSameDisplacement(_Info[task[m]], info)) ++m;
+        if (m < n) {
+          _Field[info._DispIndex]->CopyFrom(*_Field[_Info[task[m]]._DispIndex]);
+        } else if (IsNaN(info._InputTime)) {
+          info._Transformation->Displacement(*_Field[info._DispIndex]);
+        } else {
+          info._Transformation->Displacement(*_Field[info._DispIndex], info._InputTime);
+        }
+      }
+    }
+  }
+
+  void Run()
+  {
+    const int ntasks = static_cast<int>(_Tasks.size());
+    if (ntasks > 1) {
+      parallel_for(blocked_range<int>(0, ntasks, 1), *this);
+    } else if (ntasks == 1) {
+      (*this)(blocked_range<int>(0, 1));
+    }
+  }
+};
+
 
 } // namespace GenericRegistrationFilterUtils
 using namespace GenericRegistrationFilterUtils;
@@ -954,6 +1237,7 @@ void GenericRegistrationFilter::Reset()
   _OptimizationMethod                  = OM_ConjugateGradientDescent;
   _RegisterX = _RegisterY = _RegisterZ = true;
   _DownsampleWithPadding               = true;
+  _RecursiveBlurring                   = false;
   _CropPadImages                       = true;
   _CropPadFFD                          = -1;
   _NormalizeWeights                    = true;
@@ -966,6 +1250,7 @@ void GenericRegistrationFilter::Reset()
   _Background.clear();
   _DefaultBackground = NaN;
   _MaxRescaledIntensity = inf;
+  _PyramidCacheDirectory.clear();
   memset(_MinControlPointSpacing, 0, 4 * MAX_NO_RESOLUTIONS * sizeof(double));
   memset(_MaxControlPointSpacing, 0, 4 * MAX_NO_RESOLUTIONS * sizeof(double));
   for (int level = 0; level < MAX_NO_RESOLUTIONS; ++level) {
@@ -1937,9 +2222,16 @@ bool GenericRegistrationFilter::Set(const char *param, const char *value, int le
   } else if (name == "Downsample images with padding") {
     return FromString(value, _DownsampleWithPadding);
 
+  } else if (name == "Recursive image blurring") {
+    return FromString(value, _RecursiveBlurring);
+
   } else if (name == "Crop/pad images") {
     return FromString(value, _CropPadImages);
 
+  } else if (name == "Image pyramid cache") {
+    _PyramidCacheDirectory = value;
+    return true;
+
   } else if (name == "Crop/pad FFD lattice" ||
              name == "Crop/pad lattice") {
     bool do_crop_pad;
@@ -1994,7 +2286,11 @@ ParameterList GenericRegistrationFilter::Parameter(int level) const
     Insert(params, "Maximum rescaled intensities",          _MaxRescaledIntensity);
     Insert(params, "Normalize weights of energy terms",     _NormalizeWeights);
     Insert(params, "Downsample images with padding",        _DownsampleWithPadding);
+    Insert(params, "Recursive image blurring",              _RecursiveBlurring);
     Insert(params, "Crop/pad images",                       _CropPadImages);
+    if (!_PyramidCacheDirectory.empty()) {
+      Insert(params, "Image pyramid cache", _PyramidCacheDirectory);
+    }
     if (_CropPadFFD != -1) {
       Insert(params, "Crop/pad lattice", _CropPadFFD != 0 ? true : false);
     }
@@ -2875,16 +3171,39 @@ void GenericRegistrationFilter::MultiResolutionOptimization()
   }
 }
 
+// -----------------------------------------------------------------------------
+string GenericRegistrationFilter::PyramidCacheFileName(int n) const
+{
+  const BaseImage * const input = _Input[n];
+  PyramidCacheKey key;
+  key.Add(PYRAMID_CACHE_VERSION);
+  key.Add(input->Attributes());
+  key.Add(input->GetDataType());
+  key.Add(input->GetDataPointer(), static_cast<size_t>(input->NumberOfVoxels()) * input->GetDataTypeSize());
+  key.Add(voxel_info<VoxelType>::type());
+  key.Add(_NumberOfLevels);
+  key.Add(_Background[n]);
+  key.Add(_MaxRescaledIntensity);
+  key.Add(_UseGaussianResolutionPyramid);
+  key.Add(_DownsampleWithPadding);
+  key.Add(_RecursiveBlurring);
+  key.Add(_CropPadImages);
+  for (int l = 1; l <= _NumberOfLevels; ++l) {
+    key.Add(_Resolution[l][n]._x);
+    key.Add(_Resolution[l][n]._y);
+    key.Add(_Resolution[l][n]._z);
+    key.Add(_Blurring[l][n]);
+  }
+  return _PyramidCacheDirectory + PATHSEP + key.ToString() + ".pyr";
+}
+
 // -----------------------------------------------------------------------------
 void GenericRegistrationFilter::InitializePyramid()
 {
   MIRTK_START_TIMING();
 
   // Note: Level indices are in the range [1, N]
-  const blocked_range  <int> images (0,  NumberOfImages());
-  const blocked_range  <int> levels (1, _NumberOfLevels + 1);
-  const blocked_range2d<int> pyramid(1, _NumberOfLevels + 1, 0, NumberOfImages());
-  const blocked_range  <int> &level = images;
+  const blocked_range<int> levels(1, _NumberOfLevels + 1);
 
   // Allocate image list for each level even if empty
   _Image.resize(_NumberOfLevels + 1);
@@ -2896,6 +3215,20 @@ void GenericRegistrationFilter::InitializePyramid()
       _Image[l].resize(NumberOfImages());
     }
 
+    // Map previously computed resolution pyramids from cache files
+    Array<string> cache_file(NumberOfImages());
+    Array<bool>   cached(NumberOfImages(), false);
+    if (!_PyramidCacheDirectory.empty()) {
+      Broadcast(LogEvent, "Read cached pyramids ....");
+      for (int n = 0; n < NumberOfImages(); ++n) {
+        cache_file[n] = PyramidCacheFileName(n);
+        cached[n] = ReadPyramidCache(cache_file[n], _Image, n, _NumberOfLevels);
+      }
+      Broadcast(LogEvent, " done\n");
+      MIRTK_DEBUG_TIMING(1, "reading of cached image pyramids");
+      MIRTK_RESET_TIMING();
+    }
+
     // Use minimum intensity value to pad image unless user specified
     // a background value above the minimum intensity value. The background
     // value is not used here such that when user set no background value,
@@ -2904,6 +3237,7 @@ void GenericRegistrationFilter::InitializePyramid()
     // Note: Outside value always greater or equal background value.
     Array<double> outside(NumberOfImages());
     for (int n = 0; n < NumberOfImages(); ++n) {
+      if (cached[n]) continue;
       outside[n] = +inf;
       const int nvox = _Input[n]->NumberOfVoxels();
       for (int vox = 0; vox < nvox; ++vox) {
@@ -2918,11 +3252,11 @@ void GenericRegistrationFilter::InitializePyramid()
     if (_CropPadImages) {
       Broadcast(LogEvent, "Crop/pad images .........");
       CropImages crop(_Input, _Background, outside, _Resolution[1], _Blurring[1], _Image[1]);
-      parallel_for(images, crop);
+      ParallelForUncachedImages(cached, crop);
     } else {
       Broadcast(LogEvent, "Padding images ..........");
       PadImages pad(_Input, _Background, _Image[1]);
-      parallel_for(images, pad);
+      ParallelForUncachedImages(cached, pad);
     }
     Broadcast(LogEvent, " done\n");
 
@@ -2940,12 +3274,12 @@ void GenericRegistrationFilter::InitializePyramid()
     if (_MaxRescaledIntensity > _MinRescaledIntensity && !IsInf(_MaxRescaledIntensity)) {
       Broadcast(LogEvent, "Rescaling images ........");
       for (int n = 0; n < NumberOfImages(); ++n) {
-        _Image[1][n].ResetBackgroundValueAsDouble(NaN);
+        if (!cached[n]) _Image[1][n].ResetBackgroundValueAsDouble(NaN);
       }
       Rescale rescale(_Image[1], VoxelType(_MinRescaledIntensity), VoxelType(_MaxRescaledIntensity));
-      parallel_for(images, rescale);
+      ParallelForUncachedImages(cached, rescale);
       for (int n = 0; n < NumberOfImages(); ++n) {
-        _Image[1][n].ResetBackgroundValueAsDouble(0.);
+        if (!cached[n]) _Image[1][n].ResetBackgroundValueAsDouble(0.);
         _Background[n] = outside[n] = 0.;
       }
       Broadcast(LogEvent, " done\n");
@@ -2991,14 +3325,15 @@ void GenericRegistrationFilter::InitializePyramid()
     }
     for (int l = 2; l <= _NumberOfLevels; ++l) {
       if (_UseGaussianResolutionPyramid) {
-        DownsampleImages downsample(_Image, l, &_Background, &outside, padding, &_Blurring[l], _CropPadImages);
-        parallel_for(level, downsample);
+        DownsampleImages downsample(_Image, l, &_Background, &outside, padding,
+                                    &_Blurring[l], _CropPadImages, _RecursiveBlurring);
+        ParallelForUncachedImages(cached, downsample);
       } else if (_CropPadImages) {
         CropImages crop(_Image[1], _Background, outside, _Resolution[l], _Blurring[l], _Image[l]);
-        parallel_for(level, crop);
+        ParallelForUncachedImages(cached, crop);
       } else {
         CopyImages copy(_Image[1], _Image[l]);
-        parallel_for(level, copy);
+        ParallelForUncachedImages(cached, copy);
       }
     }
     if (_UseGaussianResolutionPyramid && _NumberOfLevels > 1) {
@@ -3010,13 +3345,13 @@ void GenericRegistrationFilter::InitializePyramid()
     bool anything_to_blur = false;
     for (int l = 1; l <= _NumberOfLevels;   ++l)
     for (int n = 0; n <   NumberOfImages(); ++n) {
-      if (_Blurring[l][n] > .0) anything_to_blur = true;
+      if (_Blurring[l][n] > .0 && !cached[n]) anything_to_blur = true;
     }
     if (anything_to_blur) {
       Broadcast(LogEvent, "Blurring images .........");
       if (debug_time) Broadcast(LogEvent, "\n");
-      BlurImages blur(_Image, _Blurring, padding);
-      parallel_for(pyramid, blur);
+      BlurImages blur(_Image, _Blurring, padding, _RecursiveBlurring);
+      ParallelForUncachedImages(cached, _NumberOfLevels, blur);
       if (debug_time) Broadcast(LogEvent, "Blurring images .........");
       Broadcast(LogEvent, " done\n");
     }
@@ -3033,11 +3368,24 @@ void GenericRegistrationFilter::InitializePyramid()
       Broadcast(LogEvent, "Resample images .........");
       if (debug_time) Broadcast(LogEvent, "\n");
       ResampleImages resample(_Image, _Resolution, outside, padding);
-      parallel_for(pyramid, resample);
+      ParallelForUncachedImages(cached, _NumberOfLevels, resample);
       if (debug_time) Broadcast(LogEvent, "Resample images .........");
       Broadcast(LogEvent, " done\n");
     }
 
+    // Write newly computed resolution pyramids to cache files
+    if (!_PyramidCacheDirectory.empty() && find(cached.begin(), cached.end(), false) != cached.end()) {
+      MIRTK_RESET_TIMING();
+      Broadcast(LogEvent, "Write cached pyramids ...");
+      for (int n = 0; n < NumberOfImages(); ++n) {
+        if (!cached[n] && !WritePyramidCache(cache_file[n], _Image, n, _NumberOfLevels)) {
+          cerr << "Warning: Failed to write image pyramid cache file " << cache_file[n] << endl;
+        }
+      }
+      Broadcast(LogEvent, " done\n");
+      MIRTK_DEBUG_TIMING(1, "writing of cached image pyramids");
+    }
+
     // Set background value to be considered by RegisteredImage for
     // image gradient computation and image interpolation (resampling)
     for (int l = 1; l <= _NumberOfLevels;   ++l)
@@ -4513,14 +4861,8 @@ void GenericRegistrationFilter::PreUpdateCallback(bool gradient)
   // Update cached displacements
   if (_Transformation->Changed() || gradient) {
     MIRTK_START_TIMING();
-    Array<DisplacementInfo>::const_iterator i;
-    for (i = _DisplacementInfo.begin(); i != _DisplacementInfo.end(); ++i) {
-      if (IsNaN(i->_InputTime)) {
-        i->_Transformation->Displacement(*_DisplacementField[i->_DispIndex]);
-      } else {
-        i->_Transformation->Displacement(*_DisplacementField[i->_DispIndex], i->_InputTime);
-      }
-    }
+    UpdateDisplacements update(_DisplacementInfo, _DisplacementField);
+    update.Run();
     MIRTK_DEBUG_TIMING(2, "caching of displacements");
   }
 
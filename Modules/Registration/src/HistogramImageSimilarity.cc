@@ -100,6 +100,81 @@ public:
 };
 
 
+// -----------------------------------------------------------------------------
+/// Update joint histogram of samples from voxels whose joint bin has changed
+///
+/// The joint bin of each voxel which was added to the histogram is cached,
+/// where -1 denotes a voxel which is not counted. Only the difference of the
+/// counts of voxels whose bin changed since the previous update are added to
+/// the histogram. The result is identical to refilling the entire histogram.
+class UpdateSamples
+{
+  const HistogramImageSimilarity               *_Similarity;
+  HistogramImageSimilarity::JointHistogramType *_Samples;
+  int                                          *_BinIndex;
+  Array<int>                                    _Delta;
+  int                                           _Changed;
+
+public:
+
+  UpdateSamples(const HistogramImageSimilarity               *sim,
+                HistogramImageSimilarity::JointHistogramType *samples,
+                int                                          *bins)
+  :
+    _Similarity(sim), _Samples(samples), _BinIndex(bins),
+    _Delta(samples->NumberOfBins(), 0), _Changed(0)
+  {}
+
+  UpdateSamples(const UpdateSamples &lhs, split)
+  :
+    _Similarity(lhs._Similarity), _Samples(lhs._Samples), _BinIndex(lhs._BinIndex),
+    _Delta(lhs._Delta.size(), 0), _Changed(0)
+  {}
+
+  void join(const UpdateSamples &rhs)
+  {
+    if (rhs._Changed > 0) {
+      for (size_t bin = 0; bin < _Delta.size(); ++bin) _Delta[bin] += rhs._Delta[bin];
+      _Changed += rhs._Changed;
+    }
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    const int nx = _Samples->NumberOfBinsX();
+    const RegisteredImage::VoxelType *tgt = _Similarity->Target()->Data(re.begin());
+    const RegisteredImage::VoxelType *src = _Similarity->Source()->Data(re.begin());
+    int bin;
+    for (int idx = re.begin(); idx != re.end(); ++idx, ++tgt, ++src) {
+      if (_Similarity->IsForeground(idx)) {
+        bin = _Samples->ValToBinY(*src) * nx + _Samples->ValToBinX(*tgt);
+      } else {
+        bin = -1;
+      }
+      if (bin != _BinIndex[idx]) {
+        if (_BinIndex[idx] != -1) _Delta[_BinIndex[idx]] -= 1;
+        if (bin            != -1) _Delta[bin]            += 1;
+        _BinIndex[idx] = bin;
+        ++_Changed;
+      }
+    }
+  }
+
+  /// Apply changes of bin counts to joint histogram
+  void Apply() const
+  {
+    if (_Changed == 0) return;
+    const int nx = _Samples->NumberOfBinsX();
+    for (size_t bin = 0; bin < _Delta.size(); ++bin) {
+      const int i = static_cast<int>(bin) % nx;
+      const int j = static_cast<int>(bin) / nx;
+      if      (_Delta[bin] > 0) _Samples->Add   (i, j,  _Delta[bin]);
+      else if (_Delta[bin] < 0) _Samples->Delete(i, j, -_Delta[bin]);
+    }
+  }
+};
+
+
 } // namespace HistogramImageSimilarityUtils
 using namespace HistogramImageSimilarityUtils;
 
@@ -118,6 +193,8 @@ void HistogramImageSimilarity::CopyAttributes(const HistogramImageSimilarity &ot
   _PadHistogram       = other._PadHistogram;
   _NumberOfTargetBins = other._NumberOfTargetBins;
   _NumberOfSourceBins = other._NumberOfSourceBins;
+  _IncrementalUpdate  = other._IncrementalUpdate;
+  _BinIndex           = other._BinIndex;
 }
 
 // -----------------------------------------------------------------------------
@@ -128,7 +205,8 @@ HistogramImageSimilarity::HistogramImageSimilarity(const char *name, double weig
   _UseParzenWindow(true),
   _PadHistogram(false),
   _NumberOfTargetBins(0),
-  _NumberOfSourceBins(0)
+  _NumberOfSourceBins(0),
+  _IncrementalUpdate(true)
 {
 }
 
@@ -182,6 +260,9 @@ bool HistogramImageSimilarity::SetWithPrefix(const char *param, const char *valu
       strcmp(param, "Parzen window estimation with padding") == 0) {
     return FromString(value, _PadHistogram);
   }
+  if (strcmp(param, "Incremental joint histogram update") == 0) {
+    return FromString(value, _IncrementalUpdate);
+  }
   return ImageSimilarity::SetWithPrefix(param, value);
 }
 
@@ -197,6 +278,7 @@ ParameterList HistogramImageSimilarity::Parameter() const
   }
   Insert(params, "Use Parzen window estimation", _UseParzenWindow);
   Insert(params, "Pad Parzen window estimation", _PadHistogram);
+  Insert(params, "Incremental joint histogram update", _IncrementalUpdate);
   return params;
 }
 
@@ -254,6 +336,8 @@ void HistogramImageSimilarity::Initialize()
     const double twidth = (tmax - tmin) / _NumberOfTargetBins;
     const double swidth = (smax - smin) / _NumberOfSourceBins;
     _Samples->Initialize(tmin, tmax, twidth, smin, smax, swidth);
+    // Joint bins of voxels are cached upon first update
+    _BinIndex.clear();
   } else {
     _NumberOfTargetBins = _Samples->NumberOfBinsX();
     _NumberOfSourceBins = _Samples->NumberOfBinsY();
@@ -284,10 +368,20 @@ void HistogramImageSimilarity::Update(bool gradient)
 
   // Update joint histogram
   if (_SamplesOwner) {
-    _Samples->Reset();
     blocked_range<int> voxels(0, _NumberOfVoxels, _NumberOfVoxels / 8);
-    FillHistogram add(this, _Samples);
-    parallel_reduce(voxels, add);
+    if (_IncrementalUpdate) {
+      if (static_cast<int>(_BinIndex.size()) != _NumberOfVoxels) {
+        _Samples->Reset();
+        _BinIndex.assign(_NumberOfVoxels, -1);
+      }
+      UpdateSamples update(this, _Samples, _BinIndex.data());
+      parallel_reduce(voxels, update);
+      update.Apply();
+    } else {
+      _Samples->Reset();
+      FillHistogram add(this, _Samples);
+      parallel_reduce(voxels, add);
+    }
   }
 
   // Smooth histogram
@@ -322,14 +416,22 @@ void HistogramImageSimilarity::Exclude(const blocked_range3d<int> &region)
 // -----------------------------------------------------------------------------
 void HistogramImageSimilarity::Include(const blocked_range3d<int> &region)
 {
+  const bool cached = !_BinIndex.empty();
+  const int  nx      = _Samples->NumberOfBinsX();
   bool changed = false;
+  int  idx, bin_x, bin_y;
   for (int k = region.pages().begin(); k < region.pages().end(); ++k)
   for (int j = region.rows ().begin(); j < region.rows ().end(); ++j)
   for (int i = region.cols ().begin(); i < region.cols ().end(); ++i) {
-    if (IsForeground(i, j, k)) {
-      _Samples->Add(_Samples->ValToBinX(_Target->Get(i, j, k)),
-                    _Samples->ValToBinY(_Source->Get(i, j, k)));
+    idx = _Domain.LatticeToIndex(i, j, k);
+    if (IsForeground(idx)) {
+      bin_x = _Samples->ValToBinX(_Target->Get(i, j, k));
+      bin_y = _Samples->ValToBinY(_Source->Get(i, j, k));
+      _Samples->Add(bin_x, bin_y);
+      if (cached) _BinIndex[idx] = bin_y * nx + bin_x;
       changed = true;
+    } else if (cached) {
+      _BinIndex[idx] = -1;
     }
   }
   if (changed) {
@@ -342,25 +444,19 @@ void HistogramImageSimilarity::UpdateHistogram()
 {
   if (_UseParzenWindow) {
     // Smooth joint histogram of raw samples
-    _Histogram = _Samples->Smoothed(_PadHistogram);
-    // Smooth also transposed histogram to ensure numerically identical results
-    // when target and source images are exchanged; this is required for an
-    // inverse consistent result using for example the symmetric SVFFD algorithm
-    auto hist = _Samples->Transposed();
+    //
+    // The smoothing is symmetric in both histogram axes. This ensures
+    // numerically identical results when target and source images are
+    // exchanged; this is required for an inverse consistent result using
+    // for example the symmetric SVFFD algorithm
     if (_PadHistogram) {
-      hist = hist.Smoothed(_PadHistogram);
+      _Histogram = _Samples->Smoothed(_PadHistogram);
     } else {
-      hist.Smooth();
-    }
-    // Average both smoothed histograms
-    for (int j = 0; j < _Histogram.NumberOfBinsY(); ++j)
-    for (int i = 0; i < _Histogram.NumberOfBinsX(); ++i) {
-      _Histogram(i, j) = .5 * (_Histogram(i, j) + hist(j, i));
+      _Histogram.Reset(*_Samples);
+      _Histogram.Smooth();
     }
-    // Average number of samples (better than summing a[i] again even when Kahan summation used)
-    _Histogram.NumberOfSamples(.5 * (_Histogram.NumberOfSamples() + hist.NumberOfSamples()));
   } else {
-    _Histogram = *_Samples;
+    _Histogram.Reset(*_Samples);
   }
 }
 
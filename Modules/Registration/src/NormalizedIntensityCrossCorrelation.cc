@@ -202,7 +202,7 @@ struct SubtractProduct : VoxelFunction
   void operator ()(int i, int j, int k, int, const TVoxel *a, const TVoxel *b, TReal *c)
   {
     if (_MaskA->IsForeground(i, j, k) && _MaskB->IsForeground(i, j, k)) {
-      (*c) -= (*a) * (*b);
+      (*c) -= static_cast<TReal>(*a) * static_cast<TReal>(*b);
     } else {
       (*c) = numeric_limits<TReal>::quiet_NaN();
     }
@@ -76,7 +76,8 @@ struct EvaluateSumOfSquaredDifferences : public VoxelReduction
   void operator ()(int i, int j, int k, int, VoxelType *t, VoxelType *s)
   {
     if (_Sim->IsForeground(i, j, k)) {
-      _Sum += static_cast<double>(pow(*t - *s, 2));
+      const double d = static_cast<double>(*t) - static_cast<double>(*s);
+      _Sum += d * d;
       ++_Cnt;
     }
   }
@@ -97,7 +98,7 @@ struct EvaluateSumOfSquaredDifferencesGradient : public VoxelFunction
   void operator ()(int i, int j, int k, int, const VoxelType *t, const VoxelType *s, GradientType *g)
   {
     if (_Sim->IsForeground(i, j, k)) {
-      *g = -_Scale * static_cast<double>(*t - *s);
+      *g = -_Scale * (static_cast<double>(*t) - static_cast<double>(*s));
     } else {
       *g = .0;
     }
@@ -0,0 +1,194 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2016 Imperial College London
+ * Copyright 2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/CurrentsDistance.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Array.h"
+#include "mirtk/RegisteredPointSet.h"
+#include "mirtk/RigidTransformation.h"
+
+#include "vtkSmartPointer.h"
+#include "vtkPoints.h"
+#include "vtkCellArray.h"
+#include "vtkPolyData.h"
+
+#include "gtest/gtest.h"
+
+using namespace mirtk;
+
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Expose protected evaluation functions of currents distance
+class TestCurrentsDistance : public CurrentsDistance
+{
+public:
+  using CurrentsDistance::Evaluate;
+  using CurrentsDistance::NonParametricGradient;
+};
+
+// -----------------------------------------------------------------------------
+/// Triangulated sphere of radius r with bumps of relative height a
+vtkSmartPointer<vtkPolyData> MakeSphere(double r, double a, double cx, int nu, int nv)
+{
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  for (int j = 0; j <= nv; ++j)
+  for (int i = 0; i <  nu; ++i) {
+    const double theta = pi *  j / nv;
+    const double phi   = two_pi * i / nu;
+    const double s     = r * (1. + a * sin(3. * theta) * cos(2. * phi));
+    points->InsertNextPoint(cx + s * sin(theta) * cos(phi),
+                                 s * sin(theta) * sin(phi),
+                                 s * cos(theta));
+  }
+  vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+  vtkIdType tri[3];
+  for (int j = 0; j < nv; ++j)
+  for (int i = 0; i < nu; ++i) {
+    const vtkIdType a00 = j * nu + i, a01 = j * nu + (i + 1) % nu;
+    const vtkIdType a10 = a00 + nu,   a11 = a01 + nu;
+    if (j > 0) {
+      tri[0] = a00, tri[1] = a10, tri[2] = a01;
+      polys->InsertNextCell(3, tri);
+    }
+    if (j < nv - 1) {
+      tri[0] = a01, tri[1] = a10, tri[2] = a11;
+      polys->InsertNextCell(3, tri);
+    }
+  }
+  vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
+  surface->SetPoints(points);
+  surface->SetPolys(polys);
+  return surface;
+}
+
+// -----------------------------------------------------------------------------
+/// Currents distance of two spheres and its gradient w.r.t. transformed sphere
+struct CurrentsDistanceTest : public ::testing::Test
+{
+  vtkSmartPointer<vtkPolyData> _TargetSurface;
+  vtkSmartPointer<vtkPolyData> _SourceSurface;
+  RigidTransformation          _Transformation;
+  RegisteredPointSet           _Target;
+  RegisteredPointSet           _Source;
+  double                       _Sigma;
+
+  void SetUp()
+  {
+    _Sigma         = 4.;
+    _TargetSurface = MakeSphere(20., .1, 0., 60, 30);
+    _SourceSurface = MakeSphere(18., 0., 1., 50, 25);
+    _Transformation.PutTranslationY(.5);
+    _Transformation.PutRotationZ(5.);
+    _Target.InputPointSet(_TargetSurface);
+    _Source.InputPointSet(_SourceSurface);
+    _Source.Transformation(&_Transformation);
+    _Target.Initialize(), _Target.Update(true);
+    _Source.Initialize(), _Source.Update(true);
+  }
+
+  /// Evaluate distance and gradient w.r.t. source points
+  double Evaluate(TestCurrentsDistance &dist, Array<Vector3D<double> > &gradient)
+  {
+    dist.Target(&_Target);
+    dist.Source(&_Source);
+    dist.Sigma(_Sigma);
+    dist.Initialize();
+    dist.Update(true);
+    gradient.resize(_Source.NumberOfPoints());
+    dist.NonParametricGradient(&_Source, gradient.data());
+    return dist.Evaluate();
+  }
+
+  /// Relative L2 norm of gradient difference
+  static double Error(const Array<Vector3D<double> > &expected,
+                      const Array<Vector3D<double> > &actual)
+  {
+    double diff = 0., norm = 0.;
+    for (size_t i = 0; i < expected.size(); ++i) {
+      diff += (actual[i] - expected[i]).SquaredLength();
+      norm += expected[i].SquaredLength();
+    }
+    return sqrt(diff / norm);
+  }
+};
+
+// =============================================================================
+// Tests
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+TEST_F(CurrentsDistanceTest, GridSpacing)
+{
+  Array<Vector3D<double> > expected, actual;
+  TestCurrentsDistance direct, grid;
+  const double d0 = Evaluate(direct, expected);
+  EXPECT_EQ(0., direct.GridError());
+  for (double h = .25; h > .1; h /= 2.) {
+    grid.GridSpacing(h);
+    const double d = Evaluate(grid, actual);
+    EXPECT_DOUBLE_EQ(.5 * h * h, grid.GridError());
+    EXPECT_NEAR(d0, d, 1e-2 * abs(d0)) << "spacing=" << h;
+    EXPECT_LT(Error(expected, actual), 2. * grid.GridError()) << "spacing=" << h;
+  }
+}
+
+// -----------------------------------------------------------------------------
+TEST_F(CurrentsDistanceTest, GridTolerance)
+{
+  Array<Vector3D<double> > expected, actual;
+  TestCurrentsDistance direct, grid;
+  const double d0 = Evaluate(direct, expected);
+  for (double tol = .02; tol > .004; tol /= 4.) {
+    grid.GridTolerance(tol);
+    const double d = Evaluate(grid, actual);
+    EXPECT_DOUBLE_EQ(tol, grid.GridError());
+    EXPECT_NEAR(d0, d, tol * abs(d0)) << "tolerance=" << tol;
+    EXPECT_LT(Error(expected, actual), 2. * tol) << "tolerance=" << tol;
+  }
+}
+
+// -----------------------------------------------------------------------------
+TEST_F(CurrentsDistanceTest, MaxGridSize)
+{
+  // Lattice exceeding maximum size is not used, i.e., kernel sums are exact
+  Array<Vector3D<double> > expected, actual;
+  TestCurrentsDistance direct, grid;
+  grid.GridSpacing(.25);
+  grid.MaxGridSize(1000);
+  const double d0 = Evaluate(direct, expected);
+  const double d  = Evaluate(grid,   actual);
+  EXPECT_NEAR(d0, d, 1e-12 * abs(d0));
+  EXPECT_LT(Error(expected, actual), 1e-12);
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -56,8 +56,10 @@ public:
   /// Options for parametric gradient calculation
   enum ParametricGradientType
   {
-    PG_Default,       ///< Default gradient computation.
-    PG_Analytic,      ///< Analytic derivation w.r.t. DoFs.
+    PG_Default,       ///< Default gradient computation, i.e., separable
+                      ///< analytic derivation when the image grid is
+                      ///< aligned with the control point lattice.
+    PG_Analytic,      ///< Analytic derivation w.r.t. DoFs for each control point.
     PG_Convolution,   ///< Convolution with cubic B-spline filter.
     PG_Approximation  ///< Approximate voxel-wise non-parametric gradient
                       ///< field with cubic B-spline function, also known
@@ -328,6 +330,9 @@ public:
   // ---------------------------------------------------------------------------
   // Point transformation
 
+  /// Whether InverseDisplacement can use DisplacementFieldInversion
+  virtual bool SupportsDisplacementFieldInversion() const;
+
   /// Transforms a single point using the local transformation component only
   virtual void LocalTransform(double &, double &, double &, double = 0, double = NaN) const;
 
@@ -575,6 +580,12 @@ inline void BSplineFreeFormTransformation3D
 // Point transformation
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+inline bool BSplineFreeFormTransformation3D::SupportsDisplacementFieldInversion() const
+{
+  return true;
+}
+
 // -----------------------------------------------------------------------------
 inline void BSplineFreeFormTransformation3D
 ::LocalTransform(double &x, double &y, double &z, double, double) const
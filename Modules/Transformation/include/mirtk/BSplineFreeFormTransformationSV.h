@@ -328,6 +328,10 @@ public:
   /// for the scaling and squaring method.
   virtual bool RequiresCachingOfDisplacements() const;
 
+  /// Whether InverseDisplacement can use DisplacementFieldInversion, which is
+  /// not the case, because the inverse is obtained by integrating -v instead
+  virtual bool SupportsDisplacementFieldInversion() const;
+
   /// Transforms a single point using the local transformation component only
   virtual void LocalTransform(double &, double &, double &, double = 0, double = NaN) const;
 
@@ -768,6 +772,12 @@ inline bool BSplineFreeFormTransformationSV::RequiresCachingOfDisplacements() co
   return (_IntegrationMethod == FFDIM_SS || _IntegrationMethod == FFDIM_FastSS);
 }
 
+// -----------------------------------------------------------------------------
+inline bool BSplineFreeFormTransformationSV::SupportsDisplacementFieldInversion() const
+{
+  return false;
+}
+
 // -----------------------------------------------------------------------------
 inline double BSplineFreeFormTransformationSV::UpperIntegrationLimit(double t, double t0) const
 {
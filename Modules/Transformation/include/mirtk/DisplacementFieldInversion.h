@@ -0,0 +1,188 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_DisplacementFieldInversion_H
+#define MIRTK_DisplacementFieldInversion_H
+
+#include "mirtk/Object.h"
+
+#include "mirtk/Indent.h"
+#include "mirtk/ImageAttributes.h"
+#include "mirtk/GenericImage.h"
+
+
+namespace mirtk {
+
+
+class Transformation;
+
+
+/**
+ * Dense inversion of a transformation on a regular lattice
+ *
+ * Instead of solving T(x) = y independently for each lattice point by
+ * Newton-Raphson iterations, the inverse displacements of a whole image
+ * are found by a preconditioned fixed-point iteration
+ *
+ *   x_{n+1} = x_n + J^-1 (y - T(x_n)),
+ *
+ * where the Jacobian J is only re-evaluated when the iteration stalls. The
+ * iteration at each lattice point is warm-started from the solution and
+ * Jacobian of the preceding point in the same image row, such that smooth
+ * transformations typically converge within very few evaluations of T and
+ * without any memory allocations. Image rows are processed in parallel.
+ * Points at which the fixed-point iteration does not converge fall back to
+ * the Newton-Raphson solver of Transformation::Inverse.
+ *
+ * The displacements are computed in-place at the positions after applying
+ * the current displacements, which are then added to the current ones, as
+ * documented for Transformation::InverseDisplacement.
+ *
+ * The transformation must implement Transformation::Jacobian. The result
+ * only agrees with Transformation::Inverse when the latter is the solution
+ * of T(x) = y found by Newton's method, which is indicated by
+ * Transformation::SupportsDisplacementFieldInversion.
+ */
+class DisplacementFieldInversion : public Object
+{
+  mirtkObjectMacro(DisplacementFieldInversion);
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Transformation to invert
+  mirtkPublicAggregateMacro(const class Transformation, Transformation);
+
+  /// Maximum number of fixed-point iterations per point
+  mirtkPublicAttributeMacro(int, MaxNumberOfIterations);
+
+  /// Maximum residual distance |y - T(x)| in world units
+  mirtkPublicAttributeMacro(double, Tolerance);
+
+  // ---------------------------------------------------------------------------
+  // Statistics of last run
+
+  /// Number of lattice points
+  mirtkReadOnlyAttributeMacro(int, NumberOfPoints);
+
+  /// Total number of fixed-point iterations
+  mirtkReadOnlyAttributeMacro(int, NumberOfIterations);
+
+  /// Number of points which required the Newton-Raphson fallback
+  mirtkReadOnlyAttributeMacro(int, NumberOfFallbackPoints);
+
+  /// Number of points at which the transformation is non-invertible
+  mirtkReadOnlyAttributeMacro(int, NumberOfSingularPoints);
+
+  /// Maximum residual distance of inverse
+  mirtkReadOnlyAttributeMacro(double, MaxResidual);
+
+  /// Mean residual distance of inverse
+  mirtkReadOnlyAttributeMacro(double, MeanResidual);
+
+  /// Copy attributes of this class from another instance
+  void CopyAttributes(const DisplacementFieldInversion &);
+
+public:
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+
+  /// Constructor
+  DisplacementFieldInversion(const class Transformation * = nullptr);
+
+  /// Copy constructor
+  DisplacementFieldInversion(const DisplacementFieldInversion &);
+
+  /// Assignment operator
+  DisplacementFieldInversion &operator =(const DisplacementFieldInversion &);
+
+  /// Destructor
+  virtual ~DisplacementFieldInversion();
+
+  // ---------------------------------------------------------------------------
+  // Execution
+
+  /// Calculate inverse displacements at lattice points of given domain
+  ///
+  /// \param[in]     domain Lattice with optional temporal dimension.
+  /// \param[in,out] dx     Displacements along x axis.
+  /// \param[in,out] dy     Displacements along y axis.
+  /// \param[in,out] dz     Displacements along z axis.
+  /// \param[in]     t0     Time point of end points.
+  ///
+  /// \returns Number of points at which transformation is non-invertible.
+  int Run(const ImageAttributes &domain, double *dx, double *dy, double *dz, double t0 = 1.0);
+
+  /// Calculate inverse displacement vectors for a whole image domain
+  ///
+  /// \param[in,out] disp Displacement field with 2 or 3 vector components.
+  /// \param[in]     t    Time point of start points.
+  /// \param[in]     t0   Time point of end points.
+  /// \param[in]     i2w  Pre-computed world coordinates.
+  ///
+  /// \returns Number of points at which transformation is non-invertible.
+  int Run(GenericImage<double> &disp, double t, double t0, const WorldCoordsImage *i2w = nullptr);
+
+  /// Calculate inverse displacement vectors for a whole image domain
+  ///
+  /// \param[in,out] disp Displacement field with 2 or 3 vector components.
+  /// \param[in]     t    Time point of start points.
+  /// \param[in]     t0   Time point of end points.
+  /// \param[in]     i2w  Pre-computed world coordinates.
+  ///
+  /// \returns Number of points at which transformation is non-invertible.
+  int Run(GenericImage<float> &disp, double t, double t0, const WorldCoordsImage *i2w = nullptr);
+
+  /// Average number of fixed-point iterations per point
+  double AverageNumberOfIterations() const;
+
+  /// Print convergence statistics of last run
+  void Print(ostream &, Indent = 0) const;
+
+protected:
+
+  /// Reset convergence statistics
+  void ResetStatistics();
+
+  /// Run inversion of displacement field with given component data pointers
+  template <class TReal>
+  void Run(const ImageAttributes &, const double *, int, TReal *, TReal *, TReal *, double, double);
+
+  /// Calculate inverse displacement vectors for a whole image domain
+  template <class TReal>
+  int RunImage(GenericImage<TReal> &, double, double, const WorldCoordsImage *);
+
+};
+
+// =============================================================================
+// Inline definitions
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+inline double DisplacementFieldInversion::AverageNumberOfIterations() const
+{
+  if (_NumberOfPoints == 0) return .0;
+  return static_cast<double>(_NumberOfIterations) / static_cast<double>(_NumberOfPoints);
+}
+
+
+} // namespace mirtk
+
+#endif // MIRTK_DisplacementFieldInversion_H
@@ -199,6 +199,9 @@ public:
   using Transformation::Transform;
   using Transformation::Inverse;
 
+  /// Whether InverseDisplacement can use DisplacementFieldInversion
+  virtual bool SupportsDisplacementFieldInversion() const;
+
   /// Transforms a single point using the global transformation component only
   virtual void GlobalTransform(double &, double &, double &, double = 0, double = -1) const;
 
@@ -396,6 +399,12 @@ inline void HomogeneousTransformation::Transform(double &x, double &y, double &z
   this->GlobalTransform(x, y, z, t, t0);
 }
 
+// -----------------------------------------------------------------------------
+inline bool HomogeneousTransformation::SupportsDisplacementFieldInversion() const
+{
+  return true;
+}
+
 // -----------------------------------------------------------------------------
 inline void HomogeneousTransformation::GlobalInverse(double &x, double &y, double &z, double, double) const
 {
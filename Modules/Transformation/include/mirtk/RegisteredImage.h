@@ -20,6 +20,7 @@
 #ifndef MIRTK_RegisteredImage_H
 #define MIRTK_RegisteredImage_H
 
+#include "mirtk/CommonConfig.h" // MIRTK_USE_FLOAT_REGISTERED_IMAGE
 #include "mirtk/GenericImage.h"
 
 #include "mirtk/Parallel.h"
@@ -33,6 +34,17 @@
 namespace mirtk {
 
 
+/// Voxel type of registered image channels
+///
+/// Single-precision halves the memory footprint of the warped intensities and
+/// derivatives. Image similarity measures accumulate in double-precision.
+#if MIRTK_USE_FLOAT_REGISTERED_IMAGE
+  typedef float  RegisteredPixel;
+#else
+  typedef double RegisteredPixel;
+#endif
+
+
 /**
  * Registered image such as fixed target image or transformed source image
  *
@@ -67,7 +79,7 @@ namespace mirtk {
  * - t=8: Transformed 2nd order derivative w.r.t yz
  * - t=9: Transformed 2nd order derivative w.r.t zz
  */
-class RegisteredImage : public GenericImage<double>
+class RegisteredImage : public GenericImage<RegisteredPixel>
 {
   mirtkObjectMacro(RegisteredImage);
 
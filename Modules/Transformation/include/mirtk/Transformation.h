@@ -331,6 +331,13 @@ public:
   /// for the scaling and squaring method.
   virtual bool RequiresCachingOfDisplacements() const;
 
+  /// Whether the inverse of this transformation is the solution of T(x) = y
+  /// found by Newton's method using the Jacobian of the transformation, such
+  /// that InverseDisplacement can invert it on a whole lattice at once using
+  /// DisplacementFieldInversion. Otherwise, the inverse displacements are
+  /// evaluated at each lattice point separately using InverseDisplacement.
+  virtual bool SupportsDisplacementFieldInversion() const;
+
   /// Transforms a single point using the global transformation component only
   virtual void GlobalTransform(double &, double &, double &, double = 0, double = NaN) const = 0;
 
@@ -795,6 +802,12 @@ inline bool Transformation::RequiresCachingOfDisplacements() const
   return false;
 }
 
+// -----------------------------------------------------------------------------
+inline bool Transformation::SupportsDisplacementFieldInversion() const
+{
+  return false;
+}
+
 // -----------------------------------------------------------------------------
 inline void Transformation::Transform(Point &p, double t, double t0) const
 {
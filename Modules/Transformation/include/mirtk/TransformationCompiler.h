@@ -0,0 +1,202 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIRTK_TransformationCompiler_H
+#define MIRTK_TransformationCompiler_H
+
+#include "mirtk/Object.h"
+
+#include "mirtk/Array.h"
+#include "mirtk/Indent.h"
+#include "mirtk/ImageAttributes.h"
+#include "mirtk/GenericImage.h"
+
+
+namespace mirtk {
+
+
+class Transformation;
+class FreeFormTransformation;
+class ImageTransformationCache;
+
+
+/**
+ * Flattens a chain of transformations into a single displacement field
+ *
+ * Evaluating a composite transformation, e.g., the global and all levels of
+ * a multi-level FFD, or a sequence of (inverted) transformations given to
+ * transform-image, costs a full evaluation of every transformation in the
+ * chain for each point. This class evaluates the chain once on a chosen
+ * lattice and stores the result either as dense displacement field, i.e.,
+ * a linear FFD whose control points coincide with the lattice points, or
+ * approximates it by a cubic B-spline FFD. The compiled transformation can
+ * be written to a file and reused for the resampling of any number of images
+ * sharing the same target grid with a single interpolation per voxel.
+ *
+ * The transformations are applied in the order in which they were added,
+ * i.e., a point x is mapped to Tn o ... o T2 o T1(x). Optionally, the compiled
+ * transformation is compared to the exact composition at the centers of the
+ * lattice cells, where the interpolation error is largest, in order to report
+ * an estimate of the compilation error.
+ */
+class TransformationCompiler : public Object
+{
+  mirtkObjectMacro(TransformationCompiler);
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Time point of target points
+  mirtkPublicAttributeMacro(double, TargetTime);
+
+  /// Time point of source points
+  mirtkPublicAttributeMacro(double, SourceTime);
+
+  /// Whether to evaluate compilation error at lattice cell centers
+  mirtkPublicAttributeMacro(bool, EvaluateError);
+
+  /// Number of points at which an inverse transformation was non-invertible
+  mirtkReadOnlyAttributeMacro(int, NumberOfSingularPoints);
+
+  /// Maximum distance between compiled and exact transformation
+  mirtkReadOnlyAttributeMacro(double, MaxError);
+
+  /// Root mean squared distance between compiled and exact transformation
+  mirtkReadOnlyAttributeMacro(double, RMSError);
+
+  /// Transformations in order of application
+  Array<const Transformation *> _Transformation;
+
+  /// Whether to apply the inverse of the respective transformation
+  Array<bool> _Invert;
+
+  /// Copy attributes of this class from another instance
+  void CopyAttributes(const TransformationCompiler &);
+
+public:
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+
+  /// Constructor
+  TransformationCompiler();
+
+  /// Copy constructor
+  TransformationCompiler(const TransformationCompiler &);
+
+  /// Assignment operator
+  TransformationCompiler &operator =(const TransformationCompiler &);
+
+  /// Destructor
+  virtual ~TransformationCompiler();
+
+  // ---------------------------------------------------------------------------
+  // Transformation chain
+
+  /// Append transformation to chain
+  void Add(const Transformation *, bool inv = false);
+
+  /// Remove all transformations from chain
+  void Clear();
+
+  /// Number of transformations in chain
+  int NumberOfTransformations() const;
+
+  /// Get n-th transformation of chain
+  const Transformation *GetTransformation(int) const;
+
+  /// Whether n-th transformation of chain is inverted
+  bool IsInverted(int) const;
+
+  /// Transform point by exact composition of transformations
+  ///
+  /// \returns Whether all inverse transformations were invertible at this point.
+  bool Transform(double &, double &, double &) const;
+
+  // ---------------------------------------------------------------------------
+  // Compilation
+
+  /// Evaluate displacements of transformation chain at lattice points
+  ///
+  /// \param[in,out] disp Displacement field on target lattice, set to zero
+  ///                     unless the chain is applied after these displacements.
+  ///
+  /// \returns Number of points at which transformation is non-invertible.
+  int Displacement(GenericImage<double> &disp);
+
+  /// Compile transformation chain into transformation cache
+  void Compile(ImageTransformationCache &);
+
+  /// Compile transformation chain into dense displacement field
+  ///
+  /// \param[in] domain Target lattice on which to evaluate displacements.
+  ///
+  /// \returns Linear FFD with control points at the lattice points.
+  FreeFormTransformation *Compile(const ImageAttributes &domain);
+
+  /// Compile transformation chain into cubic B-spline FFD
+  ///
+  /// \param[in] domain Target lattice on which to evaluate displacements.
+  /// \param[in] dx     Control point spacing in x.
+  /// \param[in] dy     Control point spacing in y.
+  /// \param[in] dz     Control point spacing in z.
+  ///
+  /// \returns Cubic B-spline FFD approximating the dense displacements.
+  FreeFormTransformation *Compile(const ImageAttributes &domain,
+                                  double dx, double dy, double dz);
+
+  /// Compare compiled transformation to exact composition at lattice cell centers
+  ///
+  /// \param[in] compiled Compiled transformation.
+  /// \param[in] domain   Lattice on which transformation was compiled.
+  ///
+  /// \returns Maximum distance between transformed points.
+  double EvaluateCompilationError(const Transformation *compiled, const ImageAttributes &domain);
+
+  /// Print compilation error
+  void Print(ostream &, Indent = 0) const;
+
+};
+
+// =============================================================================
+// Inline definitions
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+inline int TransformationCompiler::NumberOfTransformations() const
+{
+  return static_cast<int>(_Transformation.size());
+}
+
+// -----------------------------------------------------------------------------
+inline const Transformation *TransformationCompiler::GetTransformation(int n) const
+{
+  return _Transformation[n];
+}
+
+// -----------------------------------------------------------------------------
+inline bool TransformationCompiler::IsInverted(int n) const
+{
+  return _Invert[n];
+}
+
+
+} // namespace mirtk
+
+#endif // MIRTK_TransformationCompiler_H
@@ -22,19 +22,13 @@
 
 #include "mirtk/Math.h"
 #include "mirtk/Memory.h"
+#include "mirtk/Parallel.h"
 #include "mirtk/Profiling.h"
 #include "mirtk/LinearInterpolateImageFunction3D.h"
 #include "mirtk/ImageToInterpolationCoefficients.h"
 #include "mirtk/CubicBSplineConvolution.h"
 
 
-// The approximation of B-spline coefficients using parallel_reduce gives slightly
-// different results depending on the number of threads; also, it did not demonstrate
-// to be faster than a single-threaded execution. Thus, this code is disabled here,
-// but kept for future reference.
-#define _MIRTK_BSPLINEFFD_PARALLEL_APPROXIMATION 0
-
-
 namespace mirtk {
 
 
@@ -135,102 +129,118 @@ ParameterList BSplineFreeFormTransformation3D::Parameter() const
 // Approximation/Interpolation
 // =============================================================================
 
-#if _MIRTK_BSPLINEFFD_PARALLEL_APPROXIMATION
-namespace {
+namespace BSplineFreeFormTransformation3DUtils {
 
-/// 2D cubic B-spline scattered data approximation
-template <class Kernel>
-class ApproximateSplineCoefficients2D
-{
-  typedef BSplineFreeFormTransformation3D::Vector Vector;
+typedef BSplineFreeFormTransformation3D::Vector Vector;
+typedef BSplineFreeFormTransformation3D::Kernel Kernel;
 
-  // Scattered data to approximate
-  int _NumberOfPoints;
-  const double *_PointX;
-  const double *_PointY;
-  const double *_PointZ;
-  const double *_ValueX;
-  const double *_ValueY;
-  const double *_ValueZ;
 
-  // Cubic B-spline function
-  const ImageAttributes  *_Attr;
-  Vector                **_Data;
-  double                **_Norm;
+// -----------------------------------------------------------------------------
+/// Determine slab of control points to which each scattered data point contributes
+///
+/// The slab index is the lattice index of the first control point in the
+/// support of the point along the slowest varying lattice dimension plus one,
+/// such that the slab indices of all points with influence on the lattice
+/// are in the range [0, n) with n = number of control points in this
+/// dimension plus three. Points without influence are assigned index -1.
+class FindSupportSlab
+{
+  const BSplineFreeFormTransformation3D *_FFD;
+  const double *_PointX, *_PointY, *_PointZ;
+  const double *_ValueX, *_ValueY, *_ValueZ;
+  int          *_Slab;
+  int           _NumberOfSlabs;
 
 public:
 
-  /// Default constructor
-  ApproximateSplineCoefficients2D(const ImageAttributes *attr,
-                                  const double *wx, const double *wy, const double *wz,
-                                  const double *dx, const double *dy, const double *dz, int no)
+  FindSupportSlab(const BSplineFreeFormTransformation3D *ffd,
+                  const double *wx, const double *wy, const double *wz,
+                  const double *dx, const double *dy, const double *dz,
+                  int *slab, int nslabs)
   :
-    _NumberOfPoints(no),
+    _FFD(ffd),
     _PointX(wx), _PointY(wy), _PointZ(wz),
     _ValueX(dx), _ValueY(dy), _ValueZ(dz),
-    _Attr(attr)
-  {
-    _Data = CAllocate<Vector>(_Attr->X(), _Attr->Y());
-    _Norm = CAllocate<double>(_Attr->X(), _Attr->Y());
-  }
+    _Slab(slab), _NumberOfSlabs(nslabs)
+  {}
 
-  /// Split constructor
-  ApproximateSplineCoefficients2D(const ApproximateSplineCoefficients2D &rhs, split)
-  :
-    _NumberOfPoints(rhs._NumberOfPoints),
-    _PointX(rhs._PointX), _PointY(rhs._PointY), _PointZ(rhs._PointZ),
-    _ValueX(rhs._ValueX), _ValueY(rhs._ValueY), _ValueZ(rhs._ValueZ),
-    _Attr(rhs._Attr)
+  void operator ()(const blocked_range<int> &re) const
   {
-    _Data = CAllocate<Vector>(_Attr->X(), _Attr->Y());
-    _Norm = CAllocate<double>(_Attr->X(), _Attr->Y());
+    int    s;
+    double x, y, z;
+    for (int idx = re.begin(); idx != re.end(); ++idx) {
+      if (AreEqual(_ValueX[idx], 0.) && AreEqual(_ValueY[idx], 0.) && AreEqual(_ValueZ[idx], 0.)) {
+        _Slab[idx] = -1;
+      } else {
+        x = _PointX[idx], y = _PointY[idx], z = _PointZ[idx];
+        _FFD->WorldToLattice(x, y, z);
+        s = ifloor(_FFD->Z() == 1 ? y : z) + 2;
+        _Slab[idx] = (0 <= s && s < _NumberOfSlabs ? s : -1);
+      }
+    }
   }
+};
 
-  /// Destructor
-  ~ApproximateSplineCoefficients2D()
-  {
-    Deallocate(_Data);
-    Deallocate(_Norm);
-  }
+// -----------------------------------------------------------------------------
+/// Add contributions of scattered data points to control point coefficients
+///
+/// Each scattered data point contributes to the four control point slices
+/// of its support in the slowest varying lattice dimension. Slabs whose
+/// indices differ by at least four thus update disjoint sets of control
+/// points, and the slabs of one colour, i.e., index modulo four, can be
+/// processed in parallel without synchronization. Points within a slab are
+/// processed in the order given, such that the result does not depend on
+/// the number of threads.
+class AddSplineCoefficients
+{
+  const BSplineFreeFormTransformation3D *_FFD;
+  const double *_PointX, *_PointY, *_PointZ;
+  const double *_ValueX, *_ValueY, *_ValueZ;
+  const int    *_Offset;
+  const int    *_Index;
+  int           _Colour;
+  Vector     ***_Data;
+  double     ***_Norm;
 
-  /// Joint results of parallel reduction
-  void join(const ApproximateSplineCoefficients2D &rhs)
-  {
-    for (int j = 0; j < _Attr->Y(); ++j)
-    for (int i = 0; i < _Attr->X(); ++i) {
-      _Data[j][i] += rhs._Data[j][i];
-      _Norm[j][i] += rhs._Norm[j][i];
-    }
-  }
+public:
 
-  /// Add coefficients approximating subset of values
-  void operator ()(const blocked_range<int> &re)
-  {
-    int    i, j, ci, cj, A, B;
-    double x, y, z, w[2], basis, sum;
+  AddSplineCoefficients(const BSplineFreeFormTransformation3D *ffd,
+                        const double *wx, const double *wy, const double *wz,
+                        const double *dx, const double *dy, const double *dz,
+                        const int *offset, const int *index, int colour,
+                        Vector ***data, double ***norm)
+  :
+    _FFD(ffd),
+    _PointX(wx), _PointY(wy), _PointZ(wz),
+    _ValueX(dx), _ValueY(dy), _ValueZ(dz),
+    _Offset(offset), _Index(index), _Colour(colour),
+    _Data(data), _Norm(norm)
+  {}
 
-    const double *wx = _PointX + re.begin();
-    const double *wy = _PointY + re.begin();
-    const double *wz = _PointZ + re.begin();
+  /// Add contribution of single scattered data point
+  void Add(int idx) const
+  {
+    const int X = _FFD->X();
+    const int Y = _FFD->Y();
+    const int Z = _FFD->Z();
 
-    const double *dx = _ValueX + re.begin();
-    const double *dy = _ValueY + re.begin();
-    const double *dz = _ValueZ + re.begin();
+    int    i, j, k, ci, cj, ck, A, B, C;
+    double x, y, z, w[3], basis, sum;
 
-    for (int n = re.begin(); n != re.end(); ++n, ++wx, ++wy, ++wz, ++dx, ++dy, ++dz) {
-      if (AreEqual(*dx, 0.) && AreEqual(*dy, 0.) && AreEqual(*dz, 0.)) continue;
+    x = _PointX[idx], y = _PointY[idx], z = _PointZ[idx];
+    _FFD->WorldToLattice(x, y, z);
 
-      x = *wx, y = *wy, z = *wz;
-      _Attr->WorldToLattice(x, y, z);
+    i = ifloor(x);
+    j = ifloor(y);
 
-      i = ifloor(x);
-      j = ifloor(y);
+    A = Kernel::VariableToIndex(x - i);
+    B = Kernel::VariableToIndex(y - j);
+    --i, --j;
 
-      A = Kernel::VariableToIndex(x - i);
-      B = Kernel::VariableToIndex(y - j);
-      --i, --j;
+    // 2D
+    if (Z == 1) {
 
-      sum = 0.;
+      sum = .0;
       for (int b = 0; b <= 3; ++b) {
         w[1] = Kernel::LookupTable[B][b];
         for (int a = 0; a <= 3; ++a) {
@@ -241,141 +251,29 @@ public:
 
       for (int b = 0; b <= 3; ++b) {
         cj = j + b;
-        if (cj < 0 || cj >= _Attr->Y()) continue;
+        if (cj < 0 || cj >= Y) continue;
         w[1] = Kernel::LookupTable[B][b];
         for (int a = 0; a <= 3; ++a) {
           ci = i + a;
-          if (ci < 0 || ci >= _Attr->X()) continue;
+          if (ci < 0 || ci >= X) continue;
           w[0]  = Kernel::LookupTable[A][a] * w[1];
           basis = w[0] * w[0];
-          _Norm[cj][ci] += basis;
+          _Norm[0][cj][ci] += basis;
           basis *= w[0] / sum;
-          _Data[cj][ci]._x += basis * (*dx);
-          _Data[cj][ci]._y += basis * (*dy);
-          _Data[cj][ci]._z += basis * (*dz);
+          _Data[0][cj][ci]._x += basis * _ValueX[idx];
+          _Data[0][cj][ci]._y += basis * _ValueY[idx];
+          _Data[0][cj][ci]._z += basis * _ValueZ[idx];
         }
       }
-    }
-  }
-
-  void Approximate()
-  {
-    parallel_reduce(blocked_range<int>(0, _NumberOfPoints, _NumberOfPoints / 4), *this);
-    for (int j = 0; j < _Attr->Y(); ++j)
-    for (int i = 0; i < _Attr->X(); ++i) {
-      if (!AreEqual(_Norm[j][i], 0.)) {
-        _Data[j][i] /= _Norm[j][i];
-      }
-    }
-  }
-
-  const Vector &Get(int cp) const
-  {
-    return *(_Data[0] + cp);
-  }
-
-  const Vector &Get(int i, int j) const
-  {
-    return *(_Data[j][i]);
-  }
-};
-
-/// 3D cubic B-spline scattered data approximation
-template <class Kernel>
-class ApproximateSplineCoefficients3D
-{
-  typedef BSplineFreeFormTransformation3D::Vector Vector;
-
-  // Scattered data to approximate
-  int _NumberOfPoints;
-  const double *_PointX;
-  const double *_PointY;
-  const double *_PointZ;
-  const double *_ValueX;
-  const double *_ValueY;
-  const double *_ValueZ;
-
-  // Cubic B-spline function
-  const ImageAttributes   *_Attr;
-  Vector                ***_Data;
-  double                ***_Norm;
-
-public:
-
-  /// Default constructor
-  ApproximateSplineCoefficients3D(const ImageAttributes *attr,
-                                  const double *wx, const double *wy, const double *wz,
-                                  const double *dx, const double *dy, const double *dz, int no)
-  :
-    _NumberOfPoints(no),
-    _PointX(wx), _PointY(wy), _PointZ(wz),
-    _ValueX(dx), _ValueY(dy), _ValueZ(dz),
-    _Attr(attr)
-  {
-    _Data = CAllocate<Vector>(_Attr->X(), _Attr->Y(), _Attr->Z());
-    _Norm = CAllocate<double>(_Attr->X(), _Attr->Y(), _Attr->Z());
-  }
 
-  /// Split constructor
-  ApproximateSplineCoefficients3D(const ApproximateSplineCoefficients3D &rhs, split)
-  :
-    _NumberOfPoints(rhs._NumberOfPoints),
-    _PointX(rhs._PointX), _PointY(rhs._PointY), _PointZ(rhs._PointZ),
-    _ValueX(rhs._ValueX), _ValueY(rhs._ValueY), _ValueZ(rhs._ValueZ),
-    _Attr(rhs._Attr)
-  {
-    _Data = CAllocate<Vector>(_Attr->X(), _Attr->Y(), _Attr->Z());
-    _Norm = CAllocate<double>(_Attr->X(), _Attr->Y(), _Attr->Z());
-  }
-
-  /// Destructor
-  ~ApproximateSplineCoefficients3D()
-  {
-    Deallocate(_Data);
-    Deallocate(_Norm);
-  }
-
-  /// Joint results of parallel reduction
-  void join(const ApproximateSplineCoefficients3D &rhs)
-  {
-    for (int k = 0; k < _Attr->Z(); ++k)
-    for (int j = 0; j < _Attr->Y(); ++j)
-    for (int i = 0; i < _Attr->X(); ++i) {
-      _Data[k][j][i] += rhs._Data[k][j][i];
-      _Norm[k][j][i] += rhs._Norm[k][j][i];
-    }
-  }
-
-  /// Add coefficients approximating subset of values
-  void operator ()(const blocked_range<int> &re)
-  {
-    int    i, j, k, ci, cj, ck, A, B, C;
-    double x, y, z, w[3], basis, sum;
-
-    const double *wx = _PointX + re.begin();
-    const double *wy = _PointY + re.begin();
-    const double *wz = _PointZ + re.begin();
-
-    const double *dx = _ValueX + re.begin();
-    const double *dy = _ValueY + re.begin();
-    const double *dz = _ValueZ + re.begin();
-
-    for (int n = re.begin(); n != re.end(); ++n, ++wx, ++wy, ++wz, ++dx, ++dy, ++dz) {
-      if (AreEqual(*dx, 0.) && AreEqual(*dy, 0.) && AreEqual(*dz, 0.)) continue;
-
-      x = *wx, y = *wy, z = *wz;
-      _Attr->WorldToLattice(x, y, z);
+    // 3D
+    } else {
 
-      i = ifloor(x);
-      j = ifloor(y);
       k = ifloor(z);
-
-      A = Kernel::VariableToIndex(x - i);
-      B = Kernel::VariableToIndex(y - j);
       C = Kernel::VariableToIndex(z - k);
-      --i, --j, --k;
+      --k;
 
-      sum = 0.;
+      sum = .0;
       for (int c = 0; c <= 3; ++c) {
         w[2] = Kernel::LookupTable[C][c];
         for (int b = 0; b <= 3; ++b) {
@@ -389,52 +287,44 @@ public:
 
       for (int c = 0; c <= 3; ++c) {
         ck = k + c;
-        if (ck < 0 || ck >= _Attr->Z()) continue;
+        if (ck < 0 || ck >= Z) continue;
         w[2] = Kernel::LookupTable[C][c];
         for (int b = 0; b <= 3; ++b) {
           cj = j + b;
-          if (cj < 0 || cj >= _Attr->Y()) continue;
+          if (cj < 0 || cj >= Y) continue;
           w[1] = Kernel::LookupTable[B][b] * w[2];
           for (int a = 0; a <= 3; ++a) {
             ci = i + a;
-            if (ci < 0 || ci >= _Attr->X()) continue;
+            if (ci < 0 || ci >= X) continue;
             w[0]  = Kernel::LookupTable[A][a] * w[1];
             basis = w[0] * w[0];
             _Norm[ck][cj][ci] += basis;
             basis *= w[0] / sum;
-            _Data[ck][cj][ci]._x += basis * (*dx);
-            _Data[ck][cj][ci]._y += basis * (*dy);
-            _Data[ck][cj][ci]._z += basis * (*dz);
+            _Data[ck][cj][ci]._x += basis * _ValueX[idx];
+            _Data[ck][cj][ci]._y += basis * _ValueY[idx];
+            _Data[ck][cj][ci]._z += basis * _ValueZ[idx];
           }
         }
       }
+
     }
   }
 
-  void Approximate()
+  /// Add contributions of points in slabs of this colour within given range
+  void operator ()(const blocked_range<int> &re) const
   {
-    parallel_reduce(blocked_range<int>(0, _NumberOfPoints, _NumberOfPoints / 4), *this);
-    for (int k = 0; k < _Attr->Z(); ++k)
-    for (int j = 0; j < _Attr->Y(); ++j)
-    for (int i = 0; i < _Attr->X(); ++i) {
-      if (!AreEqual(_Norm[k][j][i], 0.)) {
-        _Data[k][j][i] /= _Norm[k][j][i];
+    for (int n = re.begin(); n != re.end(); ++n) {
+      const int s = 4 * n + _Colour;
+      for (int m = _Offset[s]; m < _Offset[s + 1]; ++m) {
+        this->Add(_Index[m]);
       }
     }
   }
-
-  const Vector &Get(int cp) const
-  {
-    return *(_Data[0][0] + cp);
-  }
-
-  const Vector &Get(int i, int j, int k) const
-  {
-    return *(_Data[k][j][i]);
-  }
 };
 
-} // namespace
+
+} // namespace BSplineFreeFormTransformation3DUtils
+using namespace BSplineFreeFormTransformation3DUtils;
 
 // -----------------------------------------------------------------------------
 void BSplineFreeFormTransformation3D
@@ -443,135 +333,40 @@ void BSplineFreeFormTransformation3D
                                    int no, double *gradient, double weight, bool incl_passive) const
 {
   if (AreEqual(weight, 0.)) return;
-  int xdof, ydof, zdof;
-  if (_z == 1) {
-    ApproximateSplineCoefficients2D<Kernel> spline(&_attr, wx, wy, wz, dx, dy, dz, no);
-    spline.Approximate();
-    for (int cp = 0; cp < NumberOfCPs(); ++cp) {
-      if (incl_passive || IsActive(cp)) {
-        auto &coeff = spline.Get(cp);
-        this->IndexToDOFs(cp, xdof, ydof, zdof);
-        gradient[xdof] += weight * coeff._x;
-        gradient[ydof] += weight * coeff._y;
-        gradient[zdof] += weight * coeff._z;
-      }
-    }
-  } else {
-    ApproximateSplineCoefficients3D<Kernel> spline(&_attr, wx, wy, wz, dx, dy, dz, no);
-    spline.Approximate();
-    for (int cp = 0; cp < NumberOfCPs(); ++cp) {
-      if (incl_passive || IsActive(cp)) {
-        auto &coeff = spline.Get(cp);
-        this->IndexToDOFs(cp, xdof, ydof, zdof);
-        gradient[xdof] += weight * coeff._x;
-        gradient[ydof] += weight * coeff._y;
-        gradient[zdof] += weight * coeff._z;
-      }
-    }
-  }
-}
-#else // _MIRTK_BSPLINEFFD_PARALLEL_APPROXIMATION
-// -----------------------------------------------------------------------------
-void BSplineFreeFormTransformation3D
-::AddApproximateSplineCoefficients(const double *wx, const double *wy, const double *wz,
-                                   const double *dx, const double *dy, const double *dz,
-                                   int no, double *gradient, double weight, bool incl_passive) const
-{
-  if (AreEqual(weight, 0.)) return;
-
-  int    i, j, k, ci, cj, ck, A, B, C;
-  double x, y, z, w[3], basis, sum;
 
   // Allocate memory
   Vector ***data = CAllocate<Vector>(_x, _y, _z);
   double ***norm = CAllocate<double>(_x, _y, _z);
 
-  // Initial loop: Calculate change of control points
+  // Group points by slab of control points in their support
+  const int nslabs = (_z == 1 ? _y : _z) + 3;
+  int *slab   = Allocate <int>(no);
+  int *offset = CAllocate<int>(nslabs + 1);
+  parallel_for(blocked_range<int>(0, no),
+               FindSupportSlab(this, wx, wy, wz, dx, dy, dz, slab, nslabs));
   for (int idx = 0; idx < no; ++idx) {
-    if (AreEqual(dx[idx], 0.) && AreEqual(dy[idx], 0.) && AreEqual(dz[idx], 0.)) continue;
-
-    x = wx[idx], y = wy[idx], z = wz[idx];
-    this->WorldToLattice(x, y, z);
-
-    i = ifloor(x);
-    j = ifloor(y);
-
-    A = Kernel::VariableToIndex(x - i);
-    B = Kernel::VariableToIndex(y - j);
-    --i, --j;
-
-    // 2D
-    if (_z == 1) {
-
-      sum = .0;
-      for (int b = 0; b <= 3; ++b) {
-        w[1] = Kernel::LookupTable[B][b];
-        for (int a = 0; a <= 3; ++a) {
-          w[0] = Kernel::LookupTable[A][a] * w[1];
-          sum += w[0] * w[0];
-        }
-      }
-
-      for (int b = 0; b <= 3; ++b) {
-        cj = j + b;
-        if (cj < 0 || cj >= _y) continue;
-        w[1] = Kernel::LookupTable[B][b];
-        for (int a = 0; a <= 3; ++a) {
-          ci = i + a;
-          if (ci < 0 || ci >= _x) continue;
-          w[0]  = Kernel::LookupTable[A][a] * w[1];
-          basis = w[0] * w[0];
-          norm[0][cj][ci] += basis;
-          basis *= w[0] / sum;
-          data[0][cj][ci]._x += basis * dx[idx];
-          data[0][cj][ci]._y += basis * dy[idx];
-          data[0][cj][ci]._z += basis * dz[idx];
-        }
-      }
-
-    // 3D
-    } else {
-
-      k = ifloor(z);
-      C = Kernel::VariableToIndex(z - k);
-      --k;
-
-      sum = .0;
-      for (int c = 0; c <= 3; ++c) {
-        w[2] = Kernel::LookupTable[C][c];
-        for (int b = 0; b <= 3; ++b) {
-          w[1] = Kernel::LookupTable[B][b] * w[2];
-          for (int a = 0; a <= 3; ++a) {
-            w[0] = Kernel::LookupTable[A][a] * w[1];
-            sum += w[0] * w[0];
-          }
-        }
-      }
-
-      for (int c = 0; c <= 3; ++c) {
-        ck = k + c;
-        if (ck < 0 || ck >= _z) continue;
-        w[2] = Kernel::LookupTable[C][c];
-        for (int b = 0; b <= 3; ++b) {
-          cj = j + b;
-          if (cj < 0 || cj >= _y) continue;
-          w[1] = Kernel::LookupTable[B][b] * w[2];
-          for (int a = 0; a <= 3; ++a) {
-            ci = i + a;
-            if (ci < 0 || ci >= _x) continue;
-            w[0]  = Kernel::LookupTable[A][a] * w[1];
-            basis = w[0] * w[0];
-            norm[ck][cj][ci] += basis;
-            basis *= w[0] / sum;
-            data[ck][cj][ci]._x += basis * dx[idx];
-            data[ck][cj][ci]._y += basis * dy[idx];
-            data[ck][cj][ci]._z += basis * dz[idx];
-          }
-        }
-      }
+    if (slab[idx] >= 0) ++offset[slab[idx] + 1];
+  }
+  for (int s = 0; s < nslabs; ++s) {
+    offset[s + 1] += offset[s];
+  }
+  int *index = Allocate<int>(offset[nslabs]);
+  int *next  = Allocate<int>(nslabs);
+  memcpy(next, offset, nslabs * sizeof(int));
+  for (int idx = 0; idx < no; ++idx) {
+    if (slab[idx] >= 0) index[next[slab[idx]]++] = idx;
+  }
+  Deallocate(next);
+  Deallocate(slab);
 
-    }
+  // Initial loop: Calculate change of control points
+  for (int colour = 0; colour < 4; ++colour) {
+    const int n = (nslabs - colour + 3) / 4;
+    AddSplineCoefficients add(this, wx, wy, wz, dx, dy, dz, offset, index, colour, data, norm);
+    parallel_for(blocked_range<int>(0, n), add);
   }
+  Deallocate(index);
+  Deallocate(offset);
 
   // Final loop: Calculate new control points
   int xdof, ydof, zdof;
@@ -592,7 +387,6 @@ void BSplineFreeFormTransformation3D
   Deallocate(data);
   Deallocate(norm);
 }
-#endif // _MIRTK_BSPLINEFFD_PARALLEL_APPROXIMATION
 
 // -----------------------------------------------------------------------------
 void BSplineFreeFormTransformation3D
@@ -1548,6 +1342,193 @@ public:
   }
 };
 
+// -----------------------------------------------------------------------------
+/// Cubic B-spline weights of control points along one lattice axis
+///
+/// For each voxel index i along an image axis which is aligned with a lattice
+/// axis, stores the index of the first of the four control points whose basis
+/// function may be non-zero at lattice coordinate u = a * i + b and the
+/// weights of these four control points.
+struct SeparableBSplineWeights
+{
+  Array<int>    _First;  ///< Index of first control point in support region
+  Array<double> _Weight; ///< Weights of four control points for each voxel
+
+  /// Compute weights of control points for voxel indices [0, n)
+  void Initialize(int n, double a, double b)
+  {
+    typedef BSplineFreeFormTransformation3D::Kernel Kernel;
+    _First .resize(n);
+    _Weight.resize(4 * n);
+    double *w = _Weight.data();
+    for (int i = 0; i < n; ++i, w += 4) {
+      const double u = a * i + b;
+      _First[i] = ifloor(u) - 1;
+      for (int l = 0; l < 4; ++l) {
+        w[l] = Kernel::Weight(u - (_First[i] + l));
+      }
+    }
+  }
+
+  /// Assign unit weight to single control point, i.e., along z axis of 2D FFD
+  /// and 2D image
+  void Constant(int n)
+  {
+    _First .assign(n, 0);
+    _Weight.assign(4 * n, .0);
+    for (int i = 0; i < n; ++i) _Weight[4 * i] = 1.0;
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Whether image axes are aligned with the axes of the control point lattice
+///
+/// \param[in] m Homogeneous transformation from image to lattice coordinates.
+/// \param[in] image Attributes of image domain.
+/// \param[in] lattice Attributes of control point lattice.
+bool IsAlignedWithLattice(const Matrix &m, const ImageAttributes &image,
+                                           const ImageAttributes &lattice)
+{
+  // Maximum deviation of lattice coordinates along image axes
+  const double tol = 1e-6;
+  if (abs(m(0, 0)) < tol || abs(m(1, 1)) < tol) return false;
+  if (abs(m(0, 1)) * image._y > tol || abs(m(1, 0)) * image._x > tol) return false;
+  if (image._z > 1 && (abs(m(0, 2)) * image._z > tol || abs(m(1, 2)) * image._z > tol)) return false;
+  if (lattice._z > 1) {
+    if (abs(m(2, 2)) < tol) return false;
+    if (abs(m(2, 0)) * image._x > tol || abs(m(2, 1)) * image._y > tol) return false;
+  } else if (image._z > 1) {
+    // Support region of 2D FFD in image space still depends on slice position
+    return false;
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+/// Reduce non-parametric gradient along x and y axis for each image slice
+///
+/// The output buffer stores for each vector component, image slice, and
+/// control point row and column the weighted sum of the gradient vectors.
+class SeparableParametricGradientXY
+{
+public:
+
+  const GenericImage<double>    *_Input;
+  const SeparableBSplineWeights *_WeightsX;
+  const SeparableBSplineWeights *_WeightsY;
+  int                            _CX, _CY;
+  double                        *_Output;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int nx = _Input->X();
+    const int ny = _Input->Y();
+    const int nz = _Input->Z();
+    const int n  = nx * ny * nz;
+    const int m  = ny * _CX;   // size of x-reduced slice per component
+    const int s  = _CY * _CX;  // size of xy-reduced slice per component
+
+    const double *gx, *gy, *gz, *w;
+    double       *rx, *ry, *rz, *ox, *oy, *oz;
+    int           ci, cj;
+
+    double *row = Allocate<double>(3 * m);
+    for (int k = re.begin(); k != re.end(); ++k) {
+      // Reduce along x axis
+      memset(row, 0, 3 * m * sizeof(double));
+      gx = _Input->Data(0, 0, k), gy = gx + n, gz = gy + n;
+      for (int j = 0; j < ny; ++j) {
+        rx = row + j * _CX, ry = rx + m, rz = ry + m;
+        for (int i = 0; i < nx; ++i, ++gx, ++gy, ++gz) {
+          // Check whether reference point is valid
+          if (*gx == .0 && *gy == .0 && *gz == .0) continue;
+          w = _WeightsX->_Weight.data() + 4 * i;
+          for (int l = 0; l < 4; ++l) {
+            ci = _WeightsX->_First[i] + l;
+            if (0 <= ci && ci < _CX) {
+              rx[ci] += w[l] * (*gx);
+              ry[ci] += w[l] * (*gy);
+              rz[ci] += w[l] * (*gz);
+            }
+          }
+        }
+      }
+      // Reduce along y axis
+      ox = _Output + k * s, oy = ox + nz * s, oz = oy + nz * s;
+      for (int j = 0; j < ny; ++j) {
+        rx = row + j * _CX, ry = rx + m, rz = ry + m;
+        w  = _WeightsY->_Weight.data() + 4 * j;
+        for (int l = 0; l < 4; ++l) {
+          cj = _WeightsY->_First[j] + l;
+          if (cj < 0 || cj >= _CY || w[l] == .0) continue;
+          for (ci = 0; ci < _CX; ++ci) {
+            ox[cj * _CX + ci] += w[l] * rx[ci];
+            oy[cj * _CX + ci] += w[l] * ry[ci];
+            oz[cj * _CX + ci] += w[l] * rz[ci];
+          }
+        }
+      }
+    }
+    Deallocate(row);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Reduce partial sums of SeparableParametricGradientXY along z axis and add
+/// weighted result to the gradient w.r.t. the active control point parameters
+class SeparableParametricGradientZ
+{
+public:
+
+  const BSplineFreeFormTransformation3D *_FFD;
+  const SeparableBSplineWeights         *_WeightsZ;
+  const double                          *_Input;
+  int                                    _Z;
+  double                                *_Output;
+  double                                 _Weight;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int cx = _FFD->X();
+    const int cy = _FFD->Y();
+    const int cz = _FFD->Z();
+    const int s  = cy * cx;      // size of xy-reduced slice per component
+    const int m  = cz * cx;      // size of accumulated control point row per component
+
+    const double *tx, *ty, *tz, *w;
+    double       *ax, *ay, *az;
+    int           ck, cp, xdof, ydof, zdof;
+
+    double *sum = Allocate<double>(3 * m);
+    for (int cj = re.begin(); cj != re.end(); ++cj) {
+      memset(sum, 0, 3 * m * sizeof(double));
+      for (int k = 0; k < _Z; ++k) {
+        tx = _Input + k * s + cj * cx, ty = tx + _Z * s, tz = ty + _Z * s;
+        w  = _WeightsZ->_Weight.data() + 4 * k;
+        for (int l = 0; l < 4; ++l) {
+          ck = _WeightsZ->_First[k] + l;
+          if (ck < 0 || ck >= cz || w[l] == .0) continue;
+          ax = sum + ck * cx, ay = ax + m, az = ay + m;
+          for (int ci = 0; ci < cx; ++ci) {
+            ax[ci] += w[l] * tx[ci];
+            ay[ci] += w[l] * ty[ci];
+            az[ci] += w[l] * tz[ci];
+          }
+        }
+      }
+      ax = sum, ay = ax + m, az = ay + m;
+      for (ck = 0; ck < cz; ++ck)
+      for (int ci = 0; ci < cx; ++ci, ++ax, ++ay, ++az) {
+        cp = _FFD->LatticeToIndex(ci, cj, ck);
+        _FFD->IndexToDOFs(cp, xdof, ydof, zdof);
+        if (_FFD->GetStatus(xdof) == Active) _Output[xdof] += _Weight * (*ax);
+        if (_FFD->GetStatus(ydof) == Active) _Output[ydof] += _Weight * (*ay);
+        if (_FFD->GetStatus(zdof) == Active) _Output[zdof] += _Weight * (*az);
+      }
+    }
+    Deallocate(sum);
+  }
+};
 
 }
 
@@ -1559,7 +1540,43 @@ void BSplineFreeFormTransformation3D
                      double t0, double w) const
 {
   switch (_ParametricGradientCalculation) {
-    case PG_Default:
+    case PG_Default: {
+      // Separable reduction when image grid is aligned with control point lattice
+      if (wc == nullptr && fequal(_SpeedupFactor, 1.0)) {
+        const ImageAttributes &attr = in->Attributes();
+        const Matrix m = _attr.GetWorldToImageMatrix() * attr.GetImageToWorldMatrix();
+        if (IsAlignedWithLattice(m, attr, _attr)) {
+          MIRTK_START_TIMING();
+          SeparableBSplineWeights wx, wy, wz;
+          wx.Initialize(attr._x, m(0, 0), m(0, 3));
+          wy.Initialize(attr._y, m(1, 1), m(1, 3));
+          if (_z > 1) wz.Initialize(attr._z, m(2, 2), m(2, 3));
+          else        wz.Constant  (attr._z);
+          double *tmp = CAllocate<double>(3 * attr._z * _y * _x);
+          SeparableParametricGradientXY reduce_xy;
+          reduce_xy._Input    = in;
+          reduce_xy._WeightsX = &wx;
+          reduce_xy._WeightsY = &wy;
+          reduce_xy._CX       = _x;
+          reduce_xy._CY       = _y;
+          reduce_xy._Output   = tmp;
+          parallel_for(blocked_range<int>(0, attr._z), reduce_xy);
+          SeparableParametricGradientZ reduce_z;
+          reduce_z._FFD      = this;
+          reduce_z._WeightsZ = &wz;
+          reduce_z._Input    = tmp;
+          reduce_z._Z        = attr._z;
+          reduce_z._Output   = out;
+          reduce_z._Weight   = w;
+          parallel_for(blocked_range<int>(0, _y), reduce_z);
+          Deallocate(tmp);
+          MIRTK_DEBUG_TIMING(2, "parametric gradient computation (3D B-spline separable)");
+          break;
+        }
+      }
+      FreeFormTransformation3D::ParametricGradient(in, out, i2w, wc, t0, w);
+    } break;
+
     case PG_Analytic: {
       FreeFormTransformation3D::ParametricGradient(in, out, i2w, wc, t0, w);
     } break;
@@ -0,0 +1,397 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/DisplacementFieldInversion.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Matrix.h"
+#include "mirtk/Matrix3x3.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/Profiling.h"
+#include "mirtk/Transformation.h"
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace DisplacementFieldInversionUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Solve T(x) = y for each lattice point y of a single 3D image row by row
+template <class TReal>
+class InvertDisplacementField
+{
+  const Transformation  *_Transformation;
+  const ImageAttributes *_Domain;
+  const double          *_WorldCoords; ///< Optional world coordinates
+  int                    _Stride;      ///< Number of voxels between components
+  TReal                 *_Dx;
+  TReal                 *_Dy;
+  TReal                 *_Dz;          ///< NULL for 2D vector fields
+  double                 _SourceTime;
+  double                 _TargetTime;
+  int                    _MaxNumberOfIterations;
+  double                 _Tolerance;
+  Matrix                 _Jacobian;    ///< Reused storage of Jacobian matrix
+
+public:
+
+  int    _NumberOfPoints;
+  int    _NumberOfIterations;
+  int    _NumberOfFallbackPoints;
+  int    _NumberOfSingularPoints;
+  double _SumOfResiduals;
+  double _MaxResidual;
+
+  InvertDisplacementField(const Transformation *transformation,
+                          const ImageAttributes &domain, const double *wc,
+                          TReal *dx, TReal *dy, TReal *dz,
+                          double t, double t0, int maxiter, double tol)
+  :
+    _Transformation(transformation),
+    _Domain(&domain),
+    _WorldCoords(wc),
+    _Stride(domain._x * domain._y * domain._z),
+    _Dx(dx), _Dy(dy), _Dz(dz),
+    _SourceTime(t),
+    _TargetTime(t0),
+    _MaxNumberOfIterations(maxiter),
+    _Tolerance(tol),
+    _Jacobian(3, 3),
+    _NumberOfPoints(0),
+    _NumberOfIterations(0),
+    _NumberOfFallbackPoints(0),
+    _NumberOfSingularPoints(0),
+    _SumOfResiduals(.0),
+    _MaxResidual(.0)
+  {}
+
+  InvertDisplacementField(const InvertDisplacementField &other, split)
+  :
+    _Transformation(other._Transformation),
+    _Domain(other._Domain),
+    _WorldCoords(other._WorldCoords),
+    _Stride(other._Stride),
+    _Dx(other._Dx), _Dy(other._Dy), _Dz(other._Dz),
+    _SourceTime(other._SourceTime),
+    _TargetTime(other._TargetTime),
+    _MaxNumberOfIterations(other._MaxNumberOfIterations),
+    _Tolerance(other._Tolerance),
+    _Jacobian(3, 3),
+    _NumberOfPoints(0),
+    _NumberOfIterations(0),
+    _NumberOfFallbackPoints(0),
+    _NumberOfSingularPoints(0),
+    _SumOfResiduals(.0),
+    _MaxResidual(.0)
+  {}
+
+  void join(const InvertDisplacementField &other)
+  {
+    _NumberOfPoints         += other._NumberOfPoints;
+    _NumberOfIterations     += other._NumberOfIterations;
+    _NumberOfFallbackPoints += other._NumberOfFallbackPoints;
+    _NumberOfSingularPoints += other._NumberOfSingularPoints;
+    _SumOfResiduals         += other._SumOfResiduals;
+    _MaxResidual             = max(_MaxResidual, other._MaxResidual);
+  }
+
+  /// Compute inverse of Jacobian of transformation at given point
+  bool InverseJacobian(Matrix3x3 &inv, double x, double y, double z)
+  {
+    _Transformation->Jacobian(_Jacobian, x, y, z, _SourceTime, _TargetTime);
+    Matrix3x3 jac;
+    for (int r = 0; r < 3; ++r)
+    for (int c = 0; c < 3; ++c) {
+      jac[r][c] = _Jacobian(r, c);
+    }
+    if (!_Dz) {
+      jac[0][2] = jac[1][2] = jac[2][0] = jac[2][1] = .0;
+      jac[2][2] = 1.0;
+    }
+    return jac.Inverse(inv, 1e-12);
+  }
+
+  /// Residual distance of approximate inverse x of target point y
+  double Residual(double x, double y, double z, const double p[3],
+                  double &rx, double &ry, double &rz) const
+  {
+    _Transformation->Transform(x, y, z, _SourceTime, _TargetTime);
+    rx = p[0] - x;
+    ry = p[1] - y;
+    rz = (_Dz ? p[2] - z : .0);
+    return sqrt(rx * rx + ry * ry + rz * rz);
+  }
+
+  void operator ()(const blocked_range2d<int> &re)
+  {
+    const int nx = _Domain->_x;
+    const double tol = _Tolerance;
+
+    Matrix3x3 inv;
+    double    p[3], x[3], v[3], rx, ry, rz, res, prev;
+    int       idx, iter;
+    bool      warm, have_inv, converged;
+
+    for (int k = re.rows().begin(); k != re.rows().end(); ++k)
+    for (int j = re.cols().begin(); j != re.cols().end(); ++j) {
+      warm = have_inv = false;
+      idx  = _Domain->LatticeToIndex(0, j, k);
+      for (int i = 0; i < nx; ++i, ++idx) {
+        // Target point after applying current displacement
+        if (_WorldCoords) {
+          p[0] = _WorldCoords[idx];
+          p[1] = _WorldCoords[idx + _Stride];
+          p[2] = (_Dz ? _WorldCoords[idx + 2 * _Stride] : .0);
+        } else {
+          p[0] = i, p[1] = j, p[2] = (_Dz ? k : 0);
+          _Domain->LatticeToWorld(p[0], p[1], p[2]);
+        }
+        p[0] += static_cast<double>(_Dx[idx]);
+        p[1] += static_cast<double>(_Dy[idx]);
+        if (_Dz) p[2] += static_cast<double>(_Dz[idx]);
+        // Initial guess from inverse displacement of preceding point
+        x[0] = p[0], x[1] = p[1], x[2] = p[2];
+        if (warm) x[0] += v[0], x[1] += v[1], x[2] += v[2];
+        // Preconditioned fixed-point iteration
+        converged = false;
+        prev = inf;
+        for (iter = 0;; ++iter) {
+          res = Residual(x[0], x[1], x[2], p, rx, ry, rz);
+          if (res <= tol) {
+            converged = true;
+            break;
+          }
+          if (iter == _MaxNumberOfIterations || IsNaN(res)) break;
+          if (!have_inv || res > .5 * prev) {
+            if (!InverseJacobian(inv, x[0], x[1], x[2])) break;
+            have_inv = true;
+          }
+          x[0] += inv[0][0] * rx + inv[0][1] * ry + inv[0][2] * rz;
+          x[1] += inv[1][0] * rx + inv[1][1] * ry + inv[1][2] * rz;
+          x[2] += inv[2][0] * rx + inv[2][1] * ry + inv[2][2] * rz;
+          prev = res;
+        }
+        _NumberOfIterations += iter;
+        // Fall back to Newton-Raphson solver of transformation
+        if (!converged) {
+          x[0] = p[0], x[1] = p[1], x[2] = p[2];
+          if (!_Transformation->Inverse(x[0], x[1], x[2], _SourceTime, _TargetTime)) {
+            ++_NumberOfSingularPoints;
+          }
+          if (!_Dz) x[2] = p[2];
+          res = Residual(x[0], x[1], x[2], p, rx, ry, rz);
+          ++_NumberOfFallbackPoints;
+          have_inv = false;
+        }
+        // Update displacement
+        v[0] = x[0] - p[0];
+        v[1] = x[1] - p[1];
+        v[2] = x[2] - p[2];
+        _Dx[idx] += static_cast<TReal>(v[0]);
+        _Dy[idx] += static_cast<TReal>(v[1]);
+        if (_Dz) _Dz[idx] += static_cast<TReal>(v[2]);
+        warm = converged;
+        // Update statistics
+        if (IsNaN(res)) res = inf;
+        _SumOfResiduals += res;
+        if (res > _MaxResidual) _MaxResidual = res;
+        ++_NumberOfPoints;
+      }
+    }
+  }
+};
+
+
+} // namespace DisplacementFieldInversionUtils
+using namespace DisplacementFieldInversionUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void DisplacementFieldInversion::CopyAttributes(const DisplacementFieldInversion &other)
+{
+  _Transformation         = other._Transformation;
+  _MaxNumberOfIterations  = other._MaxNumberOfIterations;
+  _Tolerance              = other._Tolerance;
+  _NumberOfPoints         = other._NumberOfPoints;
+  _NumberOfIterations     = other._NumberOfIterations;
+  _NumberOfFallbackPoints = other._NumberOfFallbackPoints;
+  _NumberOfSingularPoints = other._NumberOfSingularPoints;
+  _MaxResidual            = other._MaxResidual;
+  _MeanResidual           = other._MeanResidual;
+}
+
+// -----------------------------------------------------------------------------
+DisplacementFieldInversion::DisplacementFieldInversion(const class Transformation *transformation)
+:
+  _Transformation(transformation),
+  _MaxNumberOfIterations(20),
+  _Tolerance(1e-3)
+{
+  ResetStatistics();
+}
+
+// -----------------------------------------------------------------------------
+DisplacementFieldInversion::DisplacementFieldInversion(const DisplacementFieldInversion &other)
+:
+  Object(other)
+{
+  CopyAttributes(other);
+}
+
+// -----------------------------------------------------------------------------
+DisplacementFieldInversion &DisplacementFieldInversion::operator =(const DisplacementFieldInversion &other)
+{
+  if (this != &other) {
+    Object::operator =(other);
+    CopyAttributes(other);
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+DisplacementFieldInversion::~DisplacementFieldInversion()
+{
+}
+
+// -----------------------------------------------------------------------------
+void DisplacementFieldInversion::ResetStatistics()
+{
+  _NumberOfPoints         = 0;
+  _NumberOfIterations     = 0;
+  _NumberOfFallbackPoints = 0;
+  _NumberOfSingularPoints = 0;
+  _MaxResidual            = .0;
+  _MeanResidual           = .0;
+}
+
+// =============================================================================
+// Execution
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+template <class TReal>
+void DisplacementFieldInversion
+::Run(const ImageAttributes &domain, const double *wc, int nz,
+      TReal *dx, TReal *dy, TReal *dz, double t, double t0)
+{
+  InvertDisplacementField<TReal> body(_Transformation, domain, wc, dx, dy, dz,
+                                      t, t0, _MaxNumberOfIterations, _Tolerance);
+  blocked_range2d<int> rows(0, nz, 0, domain._y);
+  parallel_reduce(rows, body);
+
+  const double sum = _MeanResidual * _NumberOfPoints + body._SumOfResiduals;
+  _NumberOfPoints         += body._NumberOfPoints;
+  _NumberOfIterations     += body._NumberOfIterations;
+  _NumberOfFallbackPoints += body._NumberOfFallbackPoints;
+  _NumberOfSingularPoints += body._NumberOfSingularPoints;
+  _MaxResidual             = max(_MaxResidual, body._MaxResidual);
+  _MeanResidual            = (_NumberOfPoints > 0 ? sum / _NumberOfPoints : .0);
+}
+
+// -----------------------------------------------------------------------------
+int DisplacementFieldInversion::Run(const ImageAttributes &domain,
+                                    double *dx, double *dy, double *dz, double t0)
+{
+  MIRTK_START_TIMING();
+  ResetStatistics();
+  const int nvox = domain._x * domain._y * domain._z;
+  ImageAttributes lattice = domain;
+  lattice._t = 1;
+  for (int l = 0; l < domain._t; ++l) {
+    const int offset = l * nvox;
+    Run(lattice, nullptr, domain._z, dx + offset, dy + offset, dz + offset,
+        domain.LatticeToTime(l), t0);
+  }
+  MIRTK_DEBUG_TIMING(3, "inversion of displacement field");
+  return _NumberOfSingularPoints;
+}
+
+// -----------------------------------------------------------------------------
+template <class TReal>
+int DisplacementFieldInversion::RunImage(GenericImage<TReal> &disp, double t, double t0,
+                                         const WorldCoordsImage *i2w)
+{
+  if (disp.T() < 2 || disp.T() > 3) {
+    cerr << "DisplacementFieldInversion::Run: Input/output image must have either 2 or 3 vector components (_t)" << endl;
+    exit(1);
+  }
+  if (i2w) {
+    if (i2w->T() < 2 || i2w->T() > 3) {
+      cerr << "DisplacementFieldInversion::Run: Coordinate map must have either 2 or 3 vector components (_t)" << endl;
+      exit(1);
+    }
+    if (i2w->X() != disp.X() || i2w->Y() != disp.Y() || i2w->Z() != disp.Z()) {
+      cerr << "DisplacementFieldInversion::Run: Coordinate map must have the same size as the input/output image" << endl;
+      exit(1);
+    }
+    if (disp.T() == 3 && i2w->T() < 3) {
+      cerr << "DisplacementFieldInversion::Run: Coordinate map of 3D displacement field must have 3 components" << endl;
+      exit(1);
+    }
+  }
+
+  MIRTK_START_TIMING();
+  ResetStatistics();
+  const int nvox = disp.NumberOfSpatialVoxels();
+  TReal * const dx = disp.Data();
+  TReal * const dy = dx + nvox;
+  TReal * const dz = (disp.T() == 3 ? dy + nvox : nullptr);
+  ImageAttributes lattice = disp.Attributes();
+  lattice._t = 1;
+  Run(lattice, i2w ? i2w->Data() : nullptr, disp.Z(), dx, dy, dz, t, t0);
+  MIRTK_DEBUG_TIMING(3, "inversion of displacement field");
+  return _NumberOfSingularPoints;
+}
+
+// -----------------------------------------------------------------------------
+int DisplacementFieldInversion::Run(GenericImage<double> &disp, double t, double t0,
+                                    const WorldCoordsImage *i2w)
+{
+  return RunImage(disp, t, t0, i2w);
+}
+
+// -----------------------------------------------------------------------------
+int DisplacementFieldInversion::Run(GenericImage<float> &disp, double t, double t0,
+                                    const WorldCoordsImage *i2w)
+{
+  return RunImage(disp, t, t0, i2w);
+}
+
+// -----------------------------------------------------------------------------
+void DisplacementFieldInversion::Print(ostream &os, Indent indent) const
+{
+  os << indent << "No. of points:          " << _NumberOfPoints         << endl;
+  os << indent << "Avg. no. of iterations: " << AverageNumberOfIterations() << endl;
+  os << indent << "No. of fallback points: " << _NumberOfFallbackPoints << endl;
+  os << indent << "No. of singular points: " << _NumberOfSingularPoints << endl;
+  os << indent << "Mean residual:          " << _MeanResidual           << endl;
+  os << indent << "Max. residual:          " << _MaxResidual            << endl;
+}
+
+
+} // namespace mirtk
@@ -35,8 +35,10 @@
 #include "mirtk/Vector3D.h"
 #include "mirtk/DataStatistics.h"
 
-#include "mirtk/LinearInterpolateImageFunction.hxx"  // incl. inline definitions
-#include "mirtk/FastLinearImageGradientFunction.hxx" // incl. inline definitions
+#include "mirtk/LinearInterpolateImageFunction.hxx"             // incl. inline definitions
+#include "mirtk/FastLinearImageGradientFunction.hxx"            // incl. inline definitions
+#include "mirtk/CubicBSplineInterpolateImageFunction3D.hxx"     // incl. inline definitions
+#include "mirtk/FastCubicBSplineInterpolateImageFunction3D.hxx" // incl. inline definitions
 
 
 namespace mirtk {
@@ -808,6 +810,66 @@ void New(ImageGradientFunction *&f, const BaseImage *image,
 
 // TODO: Add template specialization for ImageHessianFunction
 
+// -----------------------------------------------------------------------------
+// Whether image function interpolates multiple points at once
+template <class ImageFunction>
+struct IsBatchInterpolator
+{
+  static const bool value = false;
+};
+
+template <class TImage>
+struct IsBatchInterpolator<GenericCubicBSplineInterpolateImageFunction3D<TImage> >
+{
+  static const bool value = true;
+};
+
+template <class TImage>
+struct IsBatchInterpolator<GenericFastCubicBSplineInterpolateImageFunction3D<TImage> >
+{
+  static const bool value = true;
+};
+
+// -----------------------------------------------------------------------------
+// Auxiliary function to interpolate all channels of image at multiple points
+template <class ImageFunction>
+void InterpolateInside(const ImageFunction *f, int n, const double *x,
+                       const double *y, const double *z, double *v)
+{
+  const int nc = f->Input()->T();
+  for (int p = 0; p < n; ++p) {
+    f->EvaluateInside(v + p * nc, x[p], y[p], z[p], 1);
+  }
+}
+
+template <class TImage>
+void InterpolateInside(const GenericCubicBSplineInterpolateImageFunction3D<TImage> *f,
+                       int n, const double *x, const double *y, const double *z, double *v)
+{
+  f->EvaluateInside(n, x, y, z, v);
+}
+
+template <class TImage>
+void InterpolateInside(const GenericFastCubicBSplineInterpolateImageFunction3D<TImage> *f,
+                       int n, const double *x, const double *y, const double *z, double *v)
+{
+  f->EvaluateInside(n, x, y, z, v);
+}
+
+// -----------------------------------------------------------------------------
+// Round continuous voxel index
+//
+// Attempt to reduce differences between registration with identical images
+// that have only a different image to world mapping by rounding continuous
+// voxel indices to a specified precision. For a single test registration,
+// this slightly increased the results due to more iterations. Results
+// with x/y axes swapped and negative z axis still different from image
+// with identity transformation... (using FastLinearGradientImageFunction).
+inline double RoundIndex(double x)
+{
+  return static_cast<double>(static_cast<long>(round(x * 1e+4))) * 1e-4;
+}
+
 // -----------------------------------------------------------------------------
 // Auxiliary evaluator functions
 template <class TIntensityFunction, class TGradientFunction, class THessianFunction>
@@ -838,6 +900,44 @@ protected:
   int                _NumberOfChannels;
   Vector3D<int>      _InputSize;
 
+  /// Set output intensity given interpolated value
+  ///
+  /// \return The interpolation mode, i.e., -1 when interpolated value is background.
+  int SetIntensity(double value, int mode, VoxelType *o) const
+  {
+    // Set background to outside value
+    if (IsNaN(value) || AreEqual(value, _IntensityFunction->DefaultValue(), 1e-6)) {
+      value = _OutsideValue;
+      if (_InterpolateWithPadding) mode = -1;
+    // Rescale/clamp foreground to [min, max] range
+    } else {
+      value = value * _RescaleSlope + _RescaleIntercept;
+      if      (value < _MinIntensity) value = _MinIntensity;
+      else if (value > _MaxIntensity) value = _MaxIntensity;
+    }
+    (*o) = static_cast<VoxelType>(value);
+    return mode;
+  }
+
+  /// Copy points whose interpolation mode is 1 to contiguous buffer
+  ///
+  /// \return Number of copied points.
+  static int GatherInside(int n, const double *x, const double *y, const double *z,
+                          const int *mode, double *buf)
+  {
+    int m = 0;
+    for (int p = 0; p < n; ++p) {
+      if (mode[p] == 1) ++m;
+    }
+    double *xi = buf, *yi = xi + m, *zi = yi + m;
+    for (int p = 0; p < n; ++p) {
+      if (mode[p] == 1) {
+        *xi++ = x[p], *yi++ = y[p], *zi++ = z[p];
+      }
+    }
+    return m;
+  }
+
 public:
 
   /// Constructor
@@ -1028,27 +1128,66 @@ public:
           value = _IntensityFunction->EvaluateOutside(x, y, z);
         }
       }
-      // Set background to outside value
-      if (IsNaN(value) || AreEqual(value, _IntensityFunction->DefaultValue(), 1e-6)) {
-        value = _OutsideValue;
-        if (_InterpolateWithPadding) mode = -1;
-      // Rescale/clamp foreground to [min, max] range
-      } else {
-        value = value * _RescaleSlope + _RescaleIntercept;
-        if      (value < _MinIntensity) value = _MinIntensity;
-        else if (value > _MaxIntensity) value = _MaxIntensity;
-      }
+      mode = SetIntensity(value, mode, o);
     // Otherwise, set output intensity to outside value
     } else {
-      value = _OutsideValue;
+      (*o) = static_cast<VoxelType>(_OutsideValue);
     }
-    (*o) = static_cast<VoxelType>(value);
     // Pass inside/outside check result on to derivative interpolation
     // functions such that these boundary checks are only done once.
     // This requires the same interpolation mode for all channels.
     return mode;
   }
 
+  /// Determine interpolation mode at consecutive output voxels
+  void Mode(int n, const double *x, const double *y, const double *z, int *mode) const
+  {
+    for (int p = 0; p < n; ++p) {
+      mode[p] = Mode(x[p], y[p], z[p]);
+    }
+  }
+
+  /// Interpolate input intensity function at consecutive output voxels
+  ///
+  /// Points for which no boundary conditions are needed are interpolated at
+  /// once when the image function supports it, see IsBatchInterpolator.
+  /// The spline weights are applied in the same order as when interpolating
+  /// one point at a time.
+  ///
+  /// \param[in]  n    Number of output voxels.
+  /// \param[in]  x    Voxel coordinates of points along x axis of input image.
+  /// \param[in]  y    Voxel coordinates of points along y axis of input image.
+  /// \param[in]  z    Voxel coordinates of points along z axis of input image.
+  /// \param[out] o    Output voxels.
+  /// \param[out] mode Interpolation mode of each point.
+  /// \param[in]  buf  Temporary buffer.
+  void Intensity(int n, const double *x, const double *y, const double *z,
+                 VoxelType *o, int *mode, Array<double> &buf) const
+  {
+    if (_InterpolateWithPadding) {
+      for (int p = 0; p < n; ++p) {
+        mode[p] = Intensity(x[p], y[p], z[p], o + p);
+      }
+      return;
+    }
+    for (int p = 0; p < n; ++p) {
+      mode[p] = Mode(x[p], y[p], z[p], false);
+    }
+    const int nc = _IntensityFunction->Input()->T();
+    buf.resize((3 + nc) * n);
+    const int m = GatherInside(n, x, y, z, mode, buf.data());
+    double *v = buf.data() + 3 * m;
+    InterpolateInside(_IntensityFunction, m, buf.data(), buf.data() + m, buf.data() + 2 * m,
+                      v);
+    for (int p = 0; p < n; ++p) {
+      if (mode[p] == 1) {
+        mode[p] = SetIntensity(*v, mode[p], o + p), v += nc;
+      } else {
+        mode[p] = Intensity(x[p], y[p], z[p], o + p);
+      }
+    }
+  }
+
 private:
 
   /// Interpolate 1st order derivatives of input intensity function
@@ -1144,6 +1283,44 @@ public:
       *o = static_cast<VoxelType>(hessian[c - 4]);
     }
   }
+
+  /// Interpolate 1st order derivatives at consecutive output voxels, see Intensity
+  void Gradient(int n, const double *x, const double *y, const double *z,
+                VoxelType *o, const int *mode, Array<double> &buf) const
+  {
+    if (_InterpolateWithPadding) {
+      for (int p = 0; p < n; ++p) {
+        Gradient(x[p], y[p], z[p], o + p, mode[p]);
+      }
+      return;
+    }
+    const int nc = _GradientFunction->Input()->T();
+    buf.resize((3 + nc) * n);
+    const int m = GatherInside(n, x, y, z, mode, buf.data());
+    double *g = buf.data() + 3 * m;
+    InterpolateInside(_GradientFunction, m, buf.data(), buf.data() + m, buf.data() + 2 * m,
+                      g);
+    for (int p = 0; p < n; ++p) {
+      if (mode[p] == 1) {
+        VoxelType *d = o + p + _NumberOfVoxels;
+        for (int c = 0; c < 3; ++c, d += _NumberOfVoxels) {
+          *d = static_cast<VoxelType>(g[c] * _RescaleSlope);
+        }
+        g += nc;
+      } else {
+        Gradient(x[p], y[p], z[p], o + p, mode[p]);
+      }
+    }
+  }
+
+  /// Interpolate 2nd order derivatives at consecutive output voxels
+  void Hessian(int n, const double *x, const double *y, const double *z,
+               VoxelType *o, const int *mode, Array<double> &) const
+  {
+    for (int p = 0; p < n; ++p) {
+      Hessian(x[p], y[p], z[p], o + p, mode[p]);
+    }
+  }
 };
 
 // -----------------------------------------------------------------------------
@@ -1164,6 +1341,12 @@ struct IntensityInterpolator
   {
     _Evaluate->Intensity(x, y, z, o);
   }
+
+  void operator()(int n, const double *x, const double *y, const double *z,
+                  VoxelType *o, int *mode, Array<double> &buf)
+  {
+    _Evaluate->Intensity(n, x, y, z, o, mode, buf);
+  }
 };
 
 // -----------------------------------------------------------------------------
@@ -1185,6 +1368,13 @@ struct GradientInterpolator
     int mode = _Evaluate->Mode(x, y, z);
     _Evaluate->Gradient(x, y, z, o, mode);
   }
+
+  void operator()(int n, const double *x, const double *y, const double *z,
+                  VoxelType *o, int *mode, Array<double> &buf)
+  {
+    _Evaluate->Mode(n, x, y, z, mode);
+    _Evaluate->Gradient(n, x, y, z, o, mode, buf);
+  }
 };
 
 // -----------------------------------------------------------------------------
@@ -1206,6 +1396,13 @@ struct HessianInterpolator
     int mode = _Evaluate->Mode(x, y, z);
     _Evaluate->Hessian(x, y, z, o, mode);
   }
+
+  void operator()(int n, const double *x, const double *y, const double *z,
+                  VoxelType *o, int *mode, Array<double> &buf)
+  {
+    _Evaluate->Mode(n, x, y, z, mode);
+    _Evaluate->Hessian(n, x, y, z, o, mode, buf);
+  }
 };
 
 // -----------------------------------------------------------------------------
@@ -1227,6 +1424,13 @@ struct IntensityAndGradientInterpolator
     int mode = _Evaluate->Intensity(x, y, z, o);
     _Evaluate->Gradient(x, y, z, o, mode);
   }
+
+  void operator()(int n, const double *x, const double *y, const double *z,
+                  VoxelType *o, int *mode, Array<double> &buf)
+  {
+    _Evaluate->Intensity(n, x, y, z, o, mode, buf);
+    _Evaluate->Gradient (n, x, y, z, o, mode, buf);
+  }
 };
 
 // -----------------------------------------------------------------------------
@@ -1248,6 +1452,13 @@ struct IntensityAndHessianInterpolator
     int mode = _Evaluate->Intensity(x, y, z, o);
     _Evaluate->Hessian(x, y, z, o, mode);
   }
+
+  void operator()(int n, const double *x, const double *y, const double *z,
+                  VoxelType *o, int *mode, Array<double> &buf)
+  {
+    _Evaluate->Intensity(n, x, y, z, o, mode, buf);
+    _Evaluate->Hessian  (n, x, y, z, o, mode, buf);
+  }
 };
 
 // -----------------------------------------------------------------------------
@@ -1270,6 +1481,14 @@ struct GradientAndHessianInterpolator
     _Evaluate->Gradient(x, y, z, o, mode);
     _Evaluate->Hessian(x, y, z, o, mode);
   }
+
+  void operator()(int n, const double *x, const double *y, const double *z,
+                  VoxelType *o, int *mode, Array<double> &buf)
+  {
+    _Evaluate->Mode    (n, x, y, z, mode);
+    _Evaluate->Gradient(n, x, y, z, o, mode, buf);
+    _Evaluate->Hessian (n, x, y, z, o, mode, buf);
+  }
 };
 
 // -----------------------------------------------------------------------------
@@ -1292,6 +1511,14 @@ struct IntensityAndGradientAndHessianInterpolator
     _Evaluate->Gradient(x, y, z, o, mode);
     _Evaluate->Hessian(x, y, z, o, mode);
   }
+
+  void operator()(int n, const double *x, const double *y, const double *z,
+                  VoxelType *o, int *mode, Array<double> &buf)
+  {
+    _Evaluate->Intensity(n, x, y, z, o, mode, buf);
+    _Evaluate->Gradient (n, x, y, z, o, mode, buf);
+    _Evaluate->Hessian  (n, x, y, z, o, mode, buf);
+  }
 };
 
 // -----------------------------------------------------------------------------
@@ -1309,17 +1536,6 @@ private:
   Transformer  _Transform;
   Interpolator _Interpolate;
 
-  // Attempt to reduce differences between registration with identical images
-  // that have only a different image to world mapping by rounding continuous
-  // voxel indices to a specified precision. For a single test registration,
-  // this slightly increased the results due to more iterations. Results
-  // with x/y axes swapped and negative z axis still different from image
-  // with identity transformation... (using FastLinearGradientImageFunction).
-  inline double RoundIndex(double x) const
-  {
-    return static_cast<double>(static_cast<long>(round(x * 1e+4))) * 1e-4;
-  }
-
 public:
 
   /// Constructor
@@ -1375,6 +1591,82 @@ public:
   }
 };
 
+// -----------------------------------------------------------------------------
+// Row update function which interpolates consecutive output voxels at once
+template <class Transformer, class Interpolator>
+class UpdateRowFunction
+{
+  typedef typename Transformer::CoordType          CoordType;
+  typedef typename Transformer::DisplacementType   DisplacementType;
+  typedef typename Interpolator::Evaluator         Evaluator;
+  typedef typename Evaluator::VoxelType            VoxelType;
+  typedef RegisteredImage::DisplacementImageType   DisplacementImageType;
+
+  const Evaluator             *_Evaluator;
+  const Transformation        *_Transformation;
+  RegisteredImage             *_Output;
+  const WorldCoordsImage      *_ImageToWorld;
+  const DisplacementImageType *_Displacement1;
+  const DisplacementImageType *_Displacement2;
+
+public:
+
+  /// Constructor
+  ///
+  /// \param[in] eval Interpolator of input image and its derivatives.
+  /// \param[in] t    Transformation used when no displacements are given.
+  /// \param[in] o    Registered image.
+  /// \param[in] wc   Pre-computed world coordinates of output voxels.
+  /// \param[in] d1   Pre-computed displacements of output voxels.
+  /// \param[in] d2   Additional displacements passed on to Transformer.
+  UpdateRowFunction(const Evaluator *eval, const Transformation *t, RegisteredImage *o,
+                    const WorldCoordsImage      *wc = nullptr,
+                    const DisplacementImageType *d1 = nullptr,
+                    const DisplacementImageType *d2 = nullptr)
+  :
+    _Evaluator(eval), _Transformation(t), _Output(o),
+    _ImageToWorld(wc), _Displacement1(d1), _Displacement2(d2)
+  {}
+
+  /// Resample input at output voxels within given region
+  void operator ()(const blocked_range3d<int> &re) const
+  {
+    Transformer transform;
+    transform.Initialize(_Evaluator->Input(), _Transformation, _Output);
+    Interpolator interpolate(_Evaluator);
+
+    const int i0 = re.cols().begin();
+    const int n  = re.cols().end() - i0;
+
+    Array<double> x(n), y(n), z(n), buf;
+    Array<int>    mode(n);
+
+    for (int k = re.pages().begin(); k != re.pages().end(); ++k)
+    for (int j = re.rows ().begin(); j != re.rows ().end(); ++j) {
+      for (int p = 0, i = i0; p < n; ++p, ++i) {
+        double &xp = x[p], &yp = y[p], &zp = z[p];
+        xp = i, yp = j, zp = k;
+        if (_ImageToWorld) {
+          const CoordType *wc = _ImageToWorld->Data(i, j, k);
+          if (_Displacement2) {
+            transform(xp, yp, zp, wc, _Displacement1->Data(i, j, k), _Displacement2->Data(i, j, k));
+          } else if (_Displacement1) {
+            transform(xp, yp, zp, wc, _Displacement1->Data(i, j, k));
+          } else {
+            transform(xp, yp, zp, wc);
+          }
+        } else {
+          transform(xp, yp, zp);
+        }
+        xp = RoundIndex(xp);
+        yp = RoundIndex(yp);
+        zp = RoundIndex(zp);
+      }
+      interpolate(n, x.data(), y.data(), z.data(), _Output->Data(i0, j, k), mode.data(), buf);
+    }
+  }
+};
+
 // =============================================================================
 // Update
 // =============================================================================
@@ -1390,6 +1682,26 @@ void RegisteredImage::Update3(const blocked_range3d<int> &region, bool, bool, bo
     eval = new Evaluator(this);
     _Evaluator.reset(eval);
   }
+  // Interpolate rows of output voxels at once when supported by the image function
+  if (IsBatchInterpolator<typename Evaluator::IntensityFunction>::value) {
+    typedef UpdateRowFunction<Transformer, Interpolator> UpdateRow;
+    if (_ImageToWorld) {
+      if (_ExternalDisplacement) {
+        parallel_for(region, UpdateRow(eval, _Transformation, this, _ImageToWorld, _ExternalDisplacement));
+      } else if (_FixedDisplacement && _Displacement) {
+        parallel_for(region, UpdateRow(eval, _Transformation, this, _ImageToWorld, _FixedDisplacement, _Displacement));
+      } else if (_Displacement) {
+        parallel_for(region, UpdateRow(eval, _Transformation, this, _ImageToWorld, _Displacement));
+      } else if (_FixedDisplacement) {
+        parallel_for(region, UpdateRow(eval, _Transformation, this, _ImageToWorld, _FixedDisplacement));
+      } else {
+        parallel_for(region, UpdateRow(eval, _Transformation, this, _ImageToWorld));
+      }
+    } else {
+      parallel_for(region, UpdateRow(eval, _Transformation, this));
+    }
+    return;
+  }
   UpdateFunction func(eval, _Transformation, this);
   if (_ImageToWorld) {
     if (_ExternalDisplacement) {
@@ -1458,21 +1770,26 @@ void RegisteredImage::Update1(const blocked_range3d<int> &region,
 {
   const auto interp = InterpolationWithoutPadding(GetInterpolationMode());
   if (_PrecomputeDerivatives) {
+    // Auxiliary macro -- undefined again at the end of this body
+    #define _update_using(InterpolatorType)                                    \
+      Update2<Transformer, InterpolatorType<InputImageType>,                   \
+                           InterpolatorType<InputGradientType>,                \
+                           InterpolatorType<InputHessianType> >                \
+          (region, intensity, gradient, hessian)
     // Instantiate image functions for commonly used interpolation methods
     // to allow the compiler to generate optimized code for these
     if (interp == Interpolation_Linear || interp == Interpolation_FastLinear) {
-      // Auxiliary macro -- undefined again at the end of this body
-      #define _update_using(InterpolatorType)                                  \
-        Update2<Transformer, InterpolatorType<InputImageType>,                 \
-                             InterpolatorType<InputGradientType>,              \
-                             InterpolatorType<InputHessianType> >              \
-            (region, intensity, gradient, hessian)
       if (this->GetZ() == 1) {
         _update_using(GenericLinearInterpolateImageFunction2D);
       } else {
         _update_using(GenericLinearInterpolateImageFunction3D);
       }
-      #undef _update_using
+    // Cubic B-spline functions of 3D images interpolate all gradient
+    // components with the spline weights computed only once per voxel
+    } else if (interp == Interpolation_CubicBSpline && this->GetZ() > 1) {
+      _update_using(GenericCubicBSplineInterpolateImageFunction3D);
+    } else if (interp == Interpolation_FastCubicBSpline && this->GetZ() > 1) {
+      _update_using(GenericFastCubicBSplineInterpolateImageFunction3D);
     // Otherwise use generic interpolate image function interface
     } else {
       Update2<Transformer, InterpolateImageFunction,
@@ -1480,6 +1797,7 @@ void RegisteredImage::Update1(const blocked_range3d<int> &region,
                            InterpolateImageFunction>
           (region, intensity, gradient, hessian);
     }
+    #undef _update_using
   } else {
     // Auxiliary macro -- undefined again at the end of this body
     // TODO: Use also some HessianInterpolatorType
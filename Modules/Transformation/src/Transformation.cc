@@ -28,6 +28,7 @@
 
 #include "mirtk/AdaptiveLineSearch.h"
 #include "mirtk/ConjugateGradientDescent.h"
+#include "mirtk/DisplacementFieldInversion.h"
 #include "mirtk/TransformationApproximationError.h"
 
 #include "mirtk/Transformations.h"
@@ -1439,6 +1440,11 @@ int Transformation::InverseDisplacement(const ImageAttributes &domain,
       }
     }
 
+  } else if (this->SupportsDisplacementFieldInversion()) {
+
+    DisplacementFieldInversion inversion(this);
+    ninv = inversion.Run(domain, dx, dy, dz);
+
   } else {
 
     GenericImage<double> xdisp(domain, dx);
@@ -1544,6 +1550,11 @@ int Transformation::InverseDisplacement(GenericImage<float> &disp, double t0, co
 // -----------------------------------------------------------------------------
 int Transformation::InverseDisplacement(GenericImage<double> &disp, double t, double t0, const WorldCoordsImage *i2w) const
 {
+  if (this->SupportsDisplacementFieldInversion()) {
+    DisplacementFieldInversion inversion(this);
+    return inversion.Run(disp, t, t0, i2w);
+  }
+
   if (disp.T() < 2 || disp.T() > 3) {
     cerr << "Transformation::InverseDisplacement: Input/output image must have either 2 or 3 vector components (_t)" << endl;
     exit(1);
@@ -1575,6 +1586,11 @@ int Transformation::InverseDisplacement(GenericImage<double> &disp, double t, do
 // -----------------------------------------------------------------------------
 int Transformation::InverseDisplacement(GenericImage<float> &disp, double t, double t0, const WorldCoordsImage *i2w) const
 {
+  if (this->SupportsDisplacementFieldInversion()) {
+    DisplacementFieldInversion inversion(this);
+    return inversion.Run(disp, t, t0, i2w);
+  }
+
   if (disp.T() < 2 || disp.T() > 3) {
     cerr << "Transformation::InverseDisplacement: Input/output image must have either 2 or 3 vector components (_t)" << endl;
     exit(1);
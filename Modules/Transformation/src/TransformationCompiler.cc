@@ -0,0 +1,318 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2013-2016 Imperial College London
+ * Copyright 2013-2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/TransformationCompiler.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Memory.h"
+#include "mirtk/Parallel.h"
+#include "mirtk/Profiling.h"
+
+#include "mirtk/Transformation.h"
+#include "mirtk/ImageTransformation.h"
+#include "mirtk/LinearFreeFormTransformation3D.h"
+#include "mirtk/BSplineFreeFormTransformation3D.h"
+
+
+namespace mirtk {
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace TransformationCompilerUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Evaluate displacements of transformation chain at lattice points
+template <class TReal>
+int EvaluateDisplacements(const Array<const Transformation *> &chain,
+                          const Array<bool> &inv, GenericImage<TReal> &disp,
+                          double t, double t0)
+{
+  int nsingular = 0;
+  for (size_t n = 0; n < chain.size(); ++n) {
+    if (inv[n]) {
+      nsingular += chain[n]->InverseDisplacement(disp, t, t0);
+    } else {
+      chain[n]->Displacement(disp, t, t0);
+    }
+  }
+  return nsingular;
+}
+
+// -----------------------------------------------------------------------------
+/// Compare compiled transformation to exact composition at lattice cell centers
+class EvaluateCompilationError
+{
+  const TransformationCompiler *_Compiler;
+  const Transformation         *_Compiled;
+  const ImageAttributes        *_Domain;
+  double                        _Offset[3];
+
+public:
+
+  double _SumOfSquaredErrors;
+  double _MaxError;
+  int    _NumberOfPoints;
+
+  EvaluateCompilationError(const TransformationCompiler *compiler,
+                           const Transformation *compiled,
+                           const ImageAttributes &domain)
+  :
+    _Compiler(compiler),
+    _Compiled(compiled),
+    _Domain(&domain),
+    _SumOfSquaredErrors(.0),
+    _MaxError(.0),
+    _NumberOfPoints(0)
+  {
+    _Offset[0] = (domain._x > 1 ? .5 : .0);
+    _Offset[1] = (domain._y > 1 ? .5 : .0);
+    _Offset[2] = (domain._z > 1 ? .5 : .0);
+  }
+
+  EvaluateCompilationError(const EvaluateCompilationError &other, split)
+  :
+    _Compiler(other._Compiler),
+    _Compiled(other._Compiled),
+    _Domain(other._Domain),
+    _SumOfSquaredErrors(.0),
+    _MaxError(.0),
+    _NumberOfPoints(0)
+  {
+    memcpy(_Offset, other._Offset, 3 * sizeof(double));
+  }
+
+  void join(const EvaluateCompilationError &other)
+  {
+    _SumOfSquaredErrors += other._SumOfSquaredErrors;
+    _MaxError            = max(_MaxError, other._MaxError);
+    _NumberOfPoints     += other._NumberOfPoints;
+  }
+
+  void operator ()(const blocked_range3d<int> &re)
+  {
+    const double t  = _Compiler->SourceTime();
+    const double t0 = _Compiler->TargetTime();
+    double x1, y1, z1, x2, y2, z2, d2;
+    for (int k = re.pages().begin(); k < re.pages().end(); ++k)
+    for (int j = re.rows ().begin(); j < re.rows ().end(); ++j)
+    for (int i = re.cols ().begin(); i < re.cols ().end(); ++i) {
+      x1 = i + _Offset[0], y1 = j + _Offset[1], z1 = k + _Offset[2];
+      _Domain->LatticeToWorld(x1, y1, z1);
+      x2 = x1, y2 = y1, z2 = z1;
+      if (!_Compiler->Transform(x1, y1, z1)) continue;
+      _Compiled->Transform(x2, y2, z2, t, t0);
+      d2 = pow(x2 - x1, 2) + pow(y2 - y1, 2) + pow(z2 - z1, 2);
+      _SumOfSquaredErrors += d2;
+      if (d2 > _MaxError) _MaxError = d2;
+      ++_NumberOfPoints;
+    }
+  }
+};
+
+
+} // namespace TransformationCompilerUtils
+using namespace TransformationCompilerUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void TransformationCompiler::CopyAttributes(const TransformationCompiler &other)
+{
+  _TargetTime             = other._TargetTime;
+  _SourceTime             = other._SourceTime;
+  _EvaluateError          = other._EvaluateError;
+  _NumberOfSingularPoints = other._NumberOfSingularPoints;
+  _MaxError               = other._MaxError;
+  _RMSError               = other._RMSError;
+  _Transformation         = other._Transformation;
+  _Invert                 = other._Invert;
+}
+
+// -----------------------------------------------------------------------------
+TransformationCompiler::TransformationCompiler()
+:
+  _TargetTime(.0),
+  _SourceTime(.0),
+  _EvaluateError(false),
+  _NumberOfSingularPoints(0),
+  _MaxError(NaN),
+  _RMSError(NaN)
+{
+}
+
+// -----------------------------------------------------------------------------
+TransformationCompiler::TransformationCompiler(const TransformationCompiler &other)
+:
+  Object(other)
+{
+  CopyAttributes(other);
+}
+
+// -----------------------------------------------------------------------------
+TransformationCompiler &TransformationCompiler::operator =(const TransformationCompiler &other)
+{
+  if (this != &other) {
+    Object::operator =(other);
+    CopyAttributes(other);
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+TransformationCompiler::~TransformationCompiler()
+{
+}
+
+// =============================================================================
+// Transformation chain
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void TransformationCompiler::Add(const Transformation *dof, bool inv)
+{
+  if (dof == nullptr) {
+    cerr << "TransformationCompiler::Add: Transformation cannot be NULL" << endl;
+    exit(1);
+  }
+  _Transformation.push_back(dof);
+  _Invert.push_back(inv);
+}
+
+// -----------------------------------------------------------------------------
+void TransformationCompiler::Clear()
+{
+  _Transformation.clear();
+  _Invert.clear();
+}
+
+// -----------------------------------------------------------------------------
+bool TransformationCompiler::Transform(double &x, double &y, double &z) const
+{
+  bool ok = true;
+  for (size_t n = 0; n < _Transformation.size(); ++n) {
+    if (_Invert[n]) {
+      ok = _Transformation[n]->Inverse(x, y, z, _SourceTime, _TargetTime) && ok;
+    } else {
+      _Transformation[n]->Transform(x, y, z, _SourceTime, _TargetTime);
+    }
+  }
+  return ok;
+}
+
+// =============================================================================
+// Compilation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int TransformationCompiler::Displacement(GenericImage<double> &disp)
+{
+  MIRTK_START_TIMING();
+  _NumberOfSingularPoints = EvaluateDisplacements(_Transformation, _Invert, disp,
+                                                  _SourceTime, _TargetTime);
+  MIRTK_DEBUG_TIMING(2, "evaluation of composite displacements");
+  return _NumberOfSingularPoints;
+}
+
+// -----------------------------------------------------------------------------
+void TransformationCompiler::Compile(ImageTransformationCache &cache)
+{
+  MIRTK_START_TIMING();
+  cache.RealImage::operator =(RealPixel(0));
+  _NumberOfSingularPoints = EvaluateDisplacements(_Transformation, _Invert, cache,
+                                                  _SourceTime, _TargetTime);
+  cache.Modified(false);
+  _MaxError = _RMSError = NaN;
+  if (_EvaluateError) {
+    const GenericImage<double> disp(cache);
+    LinearFreeFormTransformation3D compiled(disp);
+    EvaluateCompilationError(&compiled, cache.Attributes());
+  }
+  MIRTK_DEBUG_TIMING(2, "compilation of transformation cache");
+}
+
+// -----------------------------------------------------------------------------
+FreeFormTransformation *TransformationCompiler::Compile(const ImageAttributes &domain)
+{
+  MIRTK_START_TIMING();
+  ImageAttributes attr = domain;
+  attr._t = 3, attr._dt = .0;
+  GenericImage<double> disp(attr);
+  this->Displacement(disp);
+  UniquePtr<LinearFreeFormTransformation3D> ffd(new LinearFreeFormTransformation3D(disp));
+  _MaxError = _RMSError = NaN;
+  if (_EvaluateError) EvaluateCompilationError(ffd.get(), domain);
+  MIRTK_DEBUG_TIMING(2, "compilation of dense displacement field");
+  return ffd.release();
+}
+
+// -----------------------------------------------------------------------------
+FreeFormTransformation *TransformationCompiler::Compile(const ImageAttributes &domain,
+                                                        double dx, double dy, double dz)
+{
+  MIRTK_START_TIMING();
+  ImageAttributes attr = domain;
+  attr._t = 3, attr._dt = .0;
+  GenericImage<double> disp(attr);
+  this->Displacement(disp);
+  UniquePtr<BSplineFreeFormTransformation3D> ffd;
+  ffd.reset(new BSplineFreeFormTransformation3D(domain, dx, dy, dz));
+  ffd->ApproximateAsNew(disp, 10, 1e-3);
+  _MaxError = _RMSError = NaN;
+  if (_EvaluateError) EvaluateCompilationError(ffd.get(), domain);
+  MIRTK_DEBUG_TIMING(2, "compilation of B-spline FFD");
+  return ffd.release();
+}
+
+// -----------------------------------------------------------------------------
+double TransformationCompiler
+::EvaluateCompilationError(const Transformation *compiled, const ImageAttributes &domain)
+{
+  TransformationCompilerUtils::EvaluateCompilationError eval(this, compiled, domain);
+  parallel_reduce(blocked_range3d<int>(0, max(1, domain._z - 1),
+                                       0, max(1, domain._y - 1),
+                                       0, max(1, domain._x - 1)), eval);
+  if (eval._NumberOfPoints > 0) {
+    _MaxError = sqrt(eval._MaxError);
+    _RMSError = sqrt(eval._SumOfSquaredErrors / eval._NumberOfPoints);
+  } else {
+    _MaxError = _RMSError = NaN;
+  }
+  return _MaxError;
+}
+
+// -----------------------------------------------------------------------------
+void TransformationCompiler::Print(ostream &os, Indent indent) const
+{
+  if (_NumberOfSingularPoints > 0) {
+    os << indent << "No. of singular points: " << _NumberOfSingularPoints << endl;
+  }
+  if (!IsNaN(_MaxError)) {
+    os << indent << "RMS compilation error:  " << _RMSError << endl;
+    os << indent << "Max compilation error:  " << _MaxError << endl;
+  }
+}
+
+
+} // namespace mirtk
@@ -0,0 +1,138 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2016 Imperial College London
+ * Copyright 2016 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/BSplineFreeFormTransformation3D.h"
+
+#include "mirtk/Math.h"
+#include "mirtk/Array.h"
+#include "mirtk/Random.h"
+#include "mirtk/GenericImage.h"
+
+#include "gtest/gtest.h"
+
+using namespace mirtk;
+
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Random non-parametric gradient with some zero vectors, i.e., invalid voxels
+void MakeGradient(GenericImage<double> &gradient, const ImageAttributes &attr)
+{
+  mt19937 rng(42u);
+  uniform_real_distribution<double> uniform(0., 1.), value(-1., 1.);
+  gradient.Initialize(attr, 3);
+  const int n = attr.NumberOfSpatialPoints();
+  for (int vox = 0; vox < n; ++vox) {
+    const bool zero = (uniform(rng) < .1);
+    for (int c = 0; c < 3; ++c) {
+      gradient.Put(vox + c * n, zero ? 0. : value(rng));
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Compare default (separable) parametric gradient to analytic derivation
+void CompareToAnalytic(const ImageAttributes &image, const ImageAttributes &lattice,
+                       double dx, double dy, double dz)
+{
+  GenericImage<double> gradient;
+  MakeGradient(gradient, image);
+
+  BSplineFreeFormTransformation3D ffd(lattice, dx, dy, dz);
+  const int ndofs = ffd.NumberOfDOFs();
+  // Exclude some parameters from the optimization
+  for (int dof = 0; dof < ndofs; dof += 7) ffd.PutStatus(dof, Passive);
+
+  Array<double> expected(ndofs, 0.), actual(ndofs, 0.);
+  ffd.ParametricGradientCalculation(BSplineFreeFormTransformation3D::PG_Analytic);
+  ffd.ParametricGradient(&gradient, expected.data(), NaN, .5);
+  ffd.ParametricGradientCalculation(BSplineFreeFormTransformation3D::PG_Default);
+  ffd.ParametricGradient(&gradient, actual.data(), NaN, .5);
+
+  double norm = 0.;
+  for (int dof = 0; dof < ndofs; ++dof) norm = max(norm, abs(expected[dof]));
+  ASSERT_GT(norm, 0.);
+  for (int dof = 0; dof < ndofs; ++dof) {
+    EXPECT_NEAR(expected[dof], actual[dof], 1e-10 * norm) << "dof=" << dof;
+  }
+}
+
+// =============================================================================
+// Tests
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+TEST(BSplineFreeFormTransformation3D, SeparableParametricGradientAligned)
+{
+  // Image voxels coincide with every second and third control point
+  ImageAttributes image(31, 25, 19, 1., 1., 1.);
+  CompareToAnalytic(image, image, 2., 3., 3.);
+}
+
+// -----------------------------------------------------------------------------
+TEST(BSplineFreeFormTransformation3D, SeparableParametricGradientAnisotropic)
+{
+  // Lattice axes are parallel to image axes, but lattice points fall in
+  // between voxel centers and voxels are anisotropic
+  ImageAttributes image(27, 22, 13, .8, .9, 1.7);
+  image._xorigin = .3;
+  image._yorigin = -.45;
+  image._zorigin = .2;
+  ImageAttributes lattice(image);
+  lattice._xorigin = -.35;
+  lattice._yorigin = .55;
+  lattice._zorigin = .7;
+  CompareToAnalytic(image, lattice, 2.3, 3.1, 4.3);
+}
+
+// -----------------------------------------------------------------------------
+TEST(BSplineFreeFormTransformation3D, SeparableParametricGradientRotated)
+{
+  // Lattice axes are not parallel to image axes, i.e., non-separable
+  ImageAttributes image(24, 21, 15, 1., 1., 1.5);
+  ImageAttributes lattice(image);
+  const double c = cos(.3), s = sin(.3);
+  lattice._xaxis[0] =  c, lattice._xaxis[1] = s, lattice._xaxis[2] = 0.;
+  lattice._yaxis[0] = -s, lattice._yaxis[1] = c, lattice._yaxis[2] = 0.;
+  CompareToAnalytic(image, lattice, 3., 3., 3.);
+}
+
+// -----------------------------------------------------------------------------
+TEST(BSplineFreeFormTransformation3D, SeparableParametricGradient2D)
+{
+  ImageAttributes image(37, 29, 1, .7, .7, 1.);
+  image._xorigin = .25;
+  ImageAttributes lattice(image);
+  lattice._yorigin = -.4;
+  CompareToAnalytic(image, lattice, 2.5, 3.3, 0.);
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,234 @@
+/*
+ * Medical Image Registration ToolKit (MIRTK)
+ *
+ * Copyright 2017 Imperial College London
+ * Copyright 2017 Andreas Schuh
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirtk/DisplacementFieldInversion.h"
+
+#include "mirtk/Transformations.h"
+#include "mirtk/Array.h"
+#include "mirtk/Random.h"
+#include "mirtk/GenericImage.h"
+
+#include "gtest/gtest.h"
+
+using namespace mirtk;
+
+
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Domain on which transformations are inverted
+ImageAttributes MakeDomain(int nx = 13, int ny = 11, int nz = 9)
+{
+  ImageAttributes domain(nx, ny, nz, 1.5, 1.5, 2.);
+  domain._xorigin = 2.;
+  domain._yorigin = -1.;
+  domain._zorigin = .5;
+  return domain;
+}
+
+// -----------------------------------------------------------------------------
+/// Set parameters of free-form deformation to small random values
+void Randomize(FreeFormTransformation &ffd, double amplitude, unsigned int seed)
+{
+  mt19937 rng(seed);
+  uniform_real_distribution<double> random(-amplitude, amplitude);
+  for (int dof = 0; dof < ffd.NumberOfDOFs(); ++dof) {
+    ffd.Put(dof, random(rng));
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Displacement field at lattice points
+struct Displacements
+{
+  Array<double> x, y, z;
+
+  Displacements(const ImageAttributes &domain)
+  :
+    x(domain.NumberOfLatticePoints(), 0.),
+    y(domain.NumberOfLatticePoints(), 0.),
+    z(domain.NumberOfLatticePoints(), 0.)
+  {}
+};
+
+// -----------------------------------------------------------------------------
+/// Inverse displacements evaluated independently at each lattice point
+///
+/// This is how Transformation::InverseDisplacement evaluated the inverse
+/// of any transformation before DisplacementFieldInversion was added.
+int PointwiseInverse(const Transformation &T, const ImageAttributes &domain,
+                     Displacements &disp, double t = 0., double t0 = 1.)
+{
+  int nsingular = 0;
+  for (int k = 0, idx = 0; k < domain._z; ++k)
+  for (int j = 0; j < domain._y; ++j)
+  for (int i = 0; i < domain._x; ++i, ++idx) {
+    double x = i, y = j, z = k;
+    domain.LatticeToWorld(x, y, z);
+    if (!T.InverseDisplacement(x, y, z, t, t0)) ++nsingular;
+    disp.x[idx] = x;
+    disp.y[idx] = y;
+    disp.z[idx] = z;
+  }
+  return nsingular;
+}
+
+// -----------------------------------------------------------------------------
+/// Compare inverse displacements
+void Compare(const Displacements &expected, const Displacements &actual, double tol, const char *what)
+{
+  ASSERT_EQ(expected.x.size(), actual.x.size());
+  for (size_t idx = 0; idx < expected.x.size(); ++idx) {
+    EXPECT_NEAR(expected.x[idx], actual.x[idx], tol) << what << " at " << idx;
+    EXPECT_NEAR(expected.y[idx], actual.y[idx], tol) << what << " at " << idx;
+    EXPECT_NEAR(expected.z[idx], actual.z[idx], tol) << what << " at " << idx;
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Check that inverse displacements map lattice points back onto themselves
+void ExpectInverse(const Transformation &T, const ImageAttributes &domain,
+                   const Displacements &disp, double tol)
+{
+  for (int k = 0, idx = 0; k < domain._z; ++k)
+  for (int j = 0; j < domain._y; ++j)
+  for (int i = 0; i < domain._x; ++i, ++idx) {
+    double x = i, y = j, z = k;
+    domain.LatticeToWorld(x, y, z);
+    double tx = x + disp.x[idx], ty = y + disp.y[idx], tz = z + disp.z[idx];
+    T.Transform(tx, ty, tz, 0., 1.);
+    EXPECT_NEAR(0., sqrt(pow(tx - x, 2) + pow(ty - y, 2) + pow(tz - z, 2)), tol) << "residual at " << idx;
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Compare dense inversion of transformation to pointwise inversion
+///
+/// The inversion engine stops once the residual distance |y - T(x)| is below
+/// its tolerance, whereas the Newton-Raphson solver used by Inverse stops once
+/// the relative change of x is small. Both solutions therefore differ by more
+/// than the tolerance of the engine.
+///
+/// \param[in] T      Transformation to invert.
+/// \param[in] domain Lattice on which to invert the transformation.
+/// \param[in] tol    Maximum difference between the inverse displacements
+///                   found by DisplacementFieldInversion and the inverse
+///                   of T evaluated at each point.
+void CompareToPointwiseInverse(const Transformation &T, const ImageAttributes &domain, double tol)
+{
+  Displacements expected(domain);
+  const int nsingular = PointwiseInverse(T, domain, expected);
+
+  // Inversion engine used directly
+  Displacements engine(domain);
+  DisplacementFieldInversion inversion(&T);
+  EXPECT_EQ(nsingular, inversion.Run(domain, engine.x.data(), engine.y.data(), engine.z.data()));
+  EXPECT_EQ(domain.NumberOfLatticePoints(), inversion.NumberOfPoints());
+  Compare(expected, engine, tol, "DisplacementFieldInversion");
+  // Inverse of transformations for which InverseDisplacement does not use the
+  // engine is not necessarily the solution of T(x) = y, e.g., the inverse of
+  // a velocity based transformation integrates the negated velocities, such
+  // that the engine only converges to it by using its fallback at each point
+  if (T.SupportsDisplacementFieldInversion()) {
+    EXPECT_EQ(0, inversion.NumberOfFallbackPoints());
+    ExpectInverse(T, domain, engine, inversion.Tolerance());
+  }
+
+  // Transformation::InverseDisplacement uses the engine only when supported
+  // and otherwise evaluates the inverse of the transformation at each point
+  Displacements actual(domain);
+  EXPECT_EQ(nsingular, T.InverseDisplacement(domain, actual.x.data(), actual.y.data(), actual.z.data()));
+  Compare(expected, actual, T.SupportsDisplacementFieldInversion() ? tol : 0., "InverseDisplacement");
+
+  GenericImage<double> disp(domain, 3);
+  EXPECT_EQ(nsingular, T.InverseDisplacement(disp, 0., 1.));
+  for (int k = 0, idx = 0; k < domain._z; ++k)
+  for (int j = 0; j < domain._y; ++j)
+  for (int i = 0; i < domain._x; ++i, ++idx) {
+    actual.x[idx] = disp(i, j, k, 0);
+    actual.y[idx] = disp(i, j, k, 1);
+    actual.z[idx] = disp(i, j, k, 2);
+  }
+  Compare(expected, actual, T.SupportsDisplacementFieldInversion() ? tol : 0., "InverseDisplacement image");
+}
+
+// =============================================================================
+// Tests
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+TEST(DisplacementFieldInversion, BSplineFreeFormTransformation3D)
+{
+  BSplineFreeFormTransformation3D ffd(MakeDomain(), 4., 4., 5.);
+  Randomize(ffd, 1., 1u);
+  EXPECT_TRUE(ffd.SupportsDisplacementFieldInversion());
+  CompareToPointwiseInverse(ffd, MakeDomain(), 5e-3);
+}
+
+// -----------------------------------------------------------------------------
+TEST(DisplacementFieldInversion, AffineTransformation)
+{
+  AffineTransformation affine;
+  affine.PutTranslationX(1.5);
+  affine.PutRotationZ(10.);
+  affine.PutScaleY(110.);
+  affine.PutShearXY(5.);
+  EXPECT_TRUE(affine.SupportsDisplacementFieldInversion());
+  CompareToPointwiseInverse(affine, MakeDomain(), 5e-3);
+}
+
+// -----------------------------------------------------------------------------
+TEST(DisplacementFieldInversion, BSplineFreeFormTransformationTD)
+{
+  // Smaller domain, because the inverse is obtained by numerical integration
+  ImageAttributes domain = MakeDomain(7, 6, 5);
+  domain._t  = 3;
+  domain._dt = .5;
+  BSplineFreeFormTransformationTD ffd(domain, 4., 4., 5., .5);
+  Randomize(ffd, 1., 2u);
+  EXPECT_FALSE(ffd.SupportsDisplacementFieldInversion());
+  CompareToPointwiseInverse(ffd, MakeDomain(7, 6, 5), 5e-3);
+}
+
+// -----------------------------------------------------------------------------
+TEST(DisplacementFieldInversion, MultiLevelFreeFormTransformation)
+{
+  BSplineFreeFormTransformation3D *ffd;
+  ffd = new BSplineFreeFormTransformation3D(MakeDomain(), 4., 4., 5.);
+  Randomize(*ffd, 1., 3u);
+  MultiLevelFreeFormTransformation mffd;
+  mffd.GetGlobalTransformation()->PutTranslationY(-2.);
+  mffd.GetGlobalTransformation()->PutRotationX(5.);
+  mffd.PushLocalTransformation(ffd);
+  EXPECT_FALSE(mffd.SupportsDisplacementFieldInversion());
+  CompareToPointwiseInverse(mffd, MakeDomain(), 5e-3);
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}